@@ -25,7 +25,10 @@
 #include <DrawingScene.h>
 #include <DrawingItem.h>
 #include <DrawingItemPoint.h>
+#include <DrawingItemSource.h>
+#include <DrawingItemUpdate.h>
 #include <DrawingItemStyle.h>
+#include <DrawingItemFactory.h>
 
 #include <DrawingArcItem.h>
 #include <DrawingCurveItem.h>
@@ -41,6 +44,16 @@
 #include <DrawingTextRectItem.h>
 #include <DrawingItemGroup.h>
 
+#include <DrawingImageExporter.h>
+#include <DrawingThumbnailCache.h>
+#include <DrawingSceneSync.h>
+#include <DrawingArena.h>
+#include <DrawingDocument.h>
+#include <DrawingSceneDiff.h>
+#include <DrawingCacheManager.h>
+#include <DrawingImporter.h>
+#include <DrawingStyleDefaults.h>
+
 /*! \mainpage
  *
  * The jade library provides DrawingScene, a surface for managing a large number of 
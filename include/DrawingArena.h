@@ -0,0 +1,151 @@
+/* DrawingArena.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGARENA_H
+#define DRAWINGARENA_H
+
+#include <QtCore>
+
+/*! \brief Slab allocator for DrawingItem, DrawingItemPoint, and DrawingItemStyle objects.
+ *
+ * Items, item points, and item styles are normally allocated individually on the heap, so items
+ * that are painted one after another end up scattered across memory.  While a DrawingArenaScope
+ * is active on a thread, these objects are instead allocated one after another from large slabs
+ * owned by the arena.  Items that are created in stacking order (as when a drawing is loaded or
+ * pasted) are then laid out contiguously in that order, which keeps the render and hit-test loops
+ * of DrawingScene within a few slabs of memory.
+ *
+ * Memory within a slab is not reused for individual objects.  Instead, each slab counts the
+ * objects still allocated from it, and once the last of these objects is deleted the whole slab
+ * is reused by the arena for new objects.  Call releaseUnusedSlabs() to return empty slabs to the
+ * heap; DrawingScene::clearItems() does so after deleting the scene's items.
+ *
+ * Slabs do not depend on their arena, so objects may safely outlive the arena that allocated them
+ * (for example, when they are held by an undo command).  A slab that still holds objects when its
+ * arena is deleted is released once its last object is deleted.  Objects may be deleted from any
+ * thread.
+ *
+ * The arena never moves objects that are already allocated.  DrawingScene::compactItems() lays
+ * a scene's items out in z-order again by replacing them with copies.
+ *
+ * \sa DrawingArenaScope, DrawingScene::setItemArenaEnabled()
+ */
+class DrawingArena
+{
+private:
+	struct Slab;
+
+	int mSlabSize;
+	Slab* mSlab;
+	QList<Slab*> mFilledSlabs;
+	int mSlabOffset;
+	int mSlabCount;
+	QMutex mMutex;
+
+public:
+	/*! \brief Create a new DrawingArena that allocates slabs of the specified size in bytes.
+	 *
+	 * Objects larger than a quarter of the slab size are allocated on the heap instead.
+	 */
+	DrawingArena(int slabSize = 64 * 1024);
+
+	/*! \brief Delete an existing DrawingArena object.
+	 *
+	 * Objects allocated from the arena remain valid; their slabs are released when the last
+	 * object in each slab is deleted.
+	 */
+	~DrawingArena();
+
+
+	//! \brief Returns the size in bytes of each slab allocated by the arena.
+	int slabSize() const;
+
+	//! \brief Returns the number of slabs that the arena has allocated so far.
+	int slabCount() const;
+
+	/*! \brief Returns the arena's empty slabs to the heap.
+	 *
+	 * Slabs that still hold objects are kept for reuse once their objects are deleted.
+	 */
+	void releaseUnusedSlabs();
+
+
+	/*! \brief Allocates memory for an object of the specified size.
+	 *
+	 * The memory is allocated from the arena of the calling thread's innermost DrawingArenaScope,
+	 * or by the global operator new if no scope is active.  Memory returned by this function must
+	 * be released by deallocate().
+	 */
+	static void* allocate(size_t size);
+
+	/*! \brief Releases memory returned by allocate().
+	 *
+	 * Memory within a slab is found by its address, so objects allocated from the heap carry no
+	 * extra data.  While no arena holds any slabs, the memory is passed straight to the global
+	 * operator delete.  It is safe to pass a nullptr to this function.
+	 */
+	static void deallocate(void* ptr);
+
+	/*! \brief Returns the arena used by allocate() on the calling thread, or nullptr if no
+	 * DrawingArenaScope is active.
+	 */
+	static DrawingArena* current();
+
+private:
+	void* allocateFromSlab(size_t size);
+	static Slab* findSlab(void* ptr);
+	static bool isSlabUnused(Slab* slab);
+	static void releaseSlab(Slab* slab);
+
+	friend class DrawingArenaScope;
+};
+
+//==================================================================================================
+
+/*! \brief Directs the allocation of items on the current thread to a DrawingArena.
+ *
+ * While the scope exists, new DrawingItem, DrawingItemPoint, and DrawingItemStyle objects
+ * created on the same thread are allocated from the arena.  Scopes may be nested; the previous
+ * arena is restored when the scope is destroyed.  Passing nullptr directs allocations back to
+ * the heap.
+ *
+ * \code
+ * DrawingArenaScope arenaScope(scene->itemArena());
+ * for(...) items.append(createItem(...));
+ * scene->addItems(items);
+ * \endcode
+ */
+class DrawingArenaScope
+{
+private:
+	DrawingArena* mPreviousArena;
+
+public:
+	//! \brief Create a new DrawingArenaScope that allocates from the specified arena.
+	DrawingArenaScope(DrawingArena* arena);
+
+	//! \brief Restores the arena that was in use before this scope was created.
+	~DrawingArenaScope();
+
+private:
+	Q_DISABLE_COPY(DrawingArenaScope)
+};
+
+#endif
@@ -0,0 +1,189 @@
+/* DrawingCacheManager.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGCACHEMANAGER_H
+#define DRAWINGCACHEMANAGER_H
+
+#include <QtCore>
+
+/*! \brief Accounts for the memory used by a single cache and lets DrawingCacheManager evict it.
+ *
+ * The object that owns a cache creates a DrawingCache for it, reports the cache's size with
+ * setCost() whenever it changes, and calls touch() whenever the cache is used.  When the
+ * DrawingCacheManager needs to free memory, it emits releaseRequested() and the owner is expected
+ * to discard at least the requested number of bytes, if possible, and report the new cost.
+ *
+ * Caches with a lower priority() are evicted before caches with a higher priority.  Caches with
+ * the same priority are evicted in least-recently used order.
+ *
+ * The DrawingCache is registered with DrawingCacheManager::instance() when it is created and
+ * unregistered when it is deleted.
+ */
+class DrawingCache : public QObject
+{
+	Q_OBJECT
+
+	friend class DrawingCacheManager;
+
+private:
+	QString mName;
+	int mPriority;
+	qint64 mCost;
+	quint64 mLastUsed;
+
+public:
+	//! \brief Create a new DrawingCache with the specified name and priority and a cost of zero.
+	DrawingCache(const QString& name, int priority, QObject* parent = nullptr);
+
+	//! \brief Delete an existing DrawingCache object, removing its cost from the manager.
+	virtual ~DrawingCache();
+
+
+	//! \brief Returns the name of the cache, used to identify it to the host application.
+	QString name() const;
+
+	/*! \brief Sets the eviction priority of the cache.
+	 *
+	 * Caches with a lower priority are evicted first.
+	 *
+	 * \sa priority()
+	 */
+	void setPriority(int priority);
+
+	/*! \brief Returns the eviction priority of the cache.
+	 *
+	 * \sa setPriority()
+	 */
+	int priority() const;
+
+	/*! \brief Sets the number of bytes currently used by the cache.
+	 *
+	 * If this puts the total cost of all caches above DrawingCacheManager::budget(), the manager
+	 * evicts caches from the event loop.  Caches are never evicted from within setCost().
+	 *
+	 * \sa cost()
+	 */
+	void setCost(qint64 bytes);
+
+	/*! \brief Returns the number of bytes currently used by the cache.
+	 *
+	 * \sa setCost()
+	 */
+	qint64 cost() const;
+
+	//! \brief Marks the cache as recently used.
+	void touch();
+
+signals:
+	/*! \brief Emitted when the cache should discard at least the specified number of bytes.
+	 *
+	 * The owner should discard as much of the cache as it can, up to the entire cache, and then
+	 * call setCost().  This signal is emitted from the thread that the cache belongs to.
+	 */
+	void releaseRequested(qint64 bytes);
+};
+
+//==================================================================================================
+
+/*! \brief Keeps the total size of the caches used by DrawingScene and DrawingView objects within
+ * a global budget.
+ *
+ * Scenes and views cache data that can be recreated at any time, such as the item bounds table,
+ * items materialized from a DrawingItemSource, preview images, and undo history.  Each of these
+ * caches is represented by a DrawingCache registered with the single DrawingCacheManager
+ * returned by instance().
+ *
+ * Whenever the total cost() of all caches exceeds budget(), the manager evicts caches from the
+ * event loop until the total is back within budget.  The host application can also call
+ * reduceTo() directly when the system reports memory pressure.
+ *
+ * The manager is thread-safe.  Caches belonging to objects on other threads are accounted for,
+ * but are only evicted by reduceTo() when it is called from the cache's own thread.
+ */
+class DrawingCacheManager : public QObject
+{
+	Q_OBJECT
+
+	friend class DrawingCache;
+
+private:
+	mutable QMutex mMutex;
+	QList<DrawingCache*> mCaches;
+	qint64 mBudget;
+	qint64 mTotalCost;
+	quint64 mUseCount;
+	bool mTrimScheduled;
+
+	DrawingCacheManager();
+
+public:
+	//! \brief Delete the DrawingCacheManager object.
+	virtual ~DrawingCacheManager();
+
+	//! \brief Returns the application's DrawingCacheManager.
+	static DrawingCacheManager* instance();
+
+
+	/*! \brief Sets the maximum total number of bytes used by all caches.
+	 *
+	 * The default budget is 256 MB.
+	 *
+	 * \sa budget()
+	 */
+	void setBudget(qint64 bytes);
+
+	/*! \brief Returns the maximum total number of bytes used by all caches.
+	 *
+	 * \sa setBudget()
+	 */
+	qint64 budget() const;
+
+	//! \brief Returns the total number of bytes currently used by all caches.
+	qint64 totalCost() const;
+
+	//! \brief Returns all currently registered caches.
+	QList<DrawingCache*> caches() const;
+
+public slots:
+	/*! \brief Evicts caches until their total cost is at most the specified number of bytes.
+	 *
+	 * Caches are evicted in order of increasing priority and then least-recent use.  Returns the
+	 * total cost after eviction, which may still exceed bytes if some caches could not be
+	 * released.
+	 */
+	qint64 reduceTo(qint64 bytes);
+
+	/*! \brief Evicts as much of every cache as possible.
+	 *
+	 * This is equivalent to calling reduceTo(0).
+	 */
+	void clear();
+
+private slots:
+	void trim();
+
+private:
+	void addCache(DrawingCache* cache);
+	void removeCache(DrawingCache* cache);
+	void updateCost(DrawingCache* cache, qint64 bytes);
+	void touchCache(DrawingCache* cache);
+};
+
+#endif
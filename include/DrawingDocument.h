@@ -0,0 +1,271 @@
+/* DrawingDocument.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGDOCUMENT_H
+#define DRAWINGDOCUMENT_H
+
+#include <QtWidgets>
+
+class DrawingScene;
+class DrawingView;
+
+/*! \brief Interface for reading the pages of a DrawingDocument without activating them.
+ *
+ * Pass an object derived from DrawingPageVisitor to DrawingDocument::visitPages() to run queries
+ * such as searches or net connectivity across all pages of a document.  The visitor is given
+ * each top-level item of each page in the same form that DrawingItemFactory::writeItem() uses,
+ * so no DrawingItem objects need to be created.  The children of an item are part of the item's
+ * state.
+ */
+class DrawingPageVisitor
+{
+public:
+	//! \brief Delete an existing DrawingPageVisitor object.
+	virtual ~DrawingPageVisitor();
+
+	/*! \brief Called before the items of each page are visited.
+	 *
+	 * The default implementation does nothing.
+	 */
+	virtual void visitPage(int pageIndex, const QString& pageName);
+
+	/*! \brief Called for each top-level item of a page, in stacking order.
+	 *
+	 * The state can be passed to DrawingItem::readState() on an item created with
+	 * DrawingItemFactory::createItem() if the visitor needs a real item.
+	 */
+	virtual void visitItem(int pageIndex, const QString& typeName, quint64 itemId,
+		const QByteArray& state) = 0;
+
+	/*! \brief Called for each connection between two item points on a page.
+	 *
+	 * Points are identified by the DrawingItem::id() of their item and their index within
+	 * DrawingItem::points().  The items may be child items.  The default implementation does
+	 * nothing.
+	 */
+	virtual void visitConnection(int pageIndex, quint64 itemId1, int pointIndex1,
+		quint64 itemId2, int pointIndex2);
+};
+
+//==================================================================================================
+
+/*! \brief Container for a multi-page drawing in which only the pages being shown are kept as
+ * live DrawingScene objects.
+ *
+ * Each page of a DrawingDocument is normally held in a compact serialized form.  A page only
+ * becomes a live DrawingScene when it is activated, either explicitly by activatePage() or by
+ * showing it in a DrawingView with showPage().  When the last user of a page releases it, the
+ * page's scene is serialized back into its compact form and deleted.  Documents with hundreds of
+ * pages therefore only pay for the items of the pages that are actually open.
+ *
+ * Queries that span all pages, such as a text search or a netlist, can run against the compact
+ * form using visitPages() without activating any page.
+ *
+ * Documents are saved with save() and loaded with open().  When a document is opened, the file
+ * is memory-mapped if possible and the inactive pages refer directly to the mapped file, so
+ * opening a large document does not read it into memory.
+ *
+ * Items are serialized using DrawingItemFactory, so custom item classes must be registered
+ * with DrawingItemFactory::registerItem().  Items of unregistered types are loaded as hidden
+ * placeholders that cannot be selected, and are written back unchanged along with their
+ * connections, so activating a page never loses them.
+ */
+class DrawingDocument : public QObject
+{
+	Q_OBJECT
+
+	friend class DrawingThumbnailCache;
+
+private:
+	struct Page
+	{
+		QString name;
+		QByteArray data;
+		DrawingScene* scene;
+		int activeCount;
+		int activationCount;
+		bool mapped;
+
+		// Connections to items whose type is not registered with DrawingItemFactory
+		QByteArray unresolvedConnections;
+	};
+
+	QList<Page*> mPages;
+	QHash<DrawingView*,Page*> mViewPages;
+
+	QFile* mMappedFile;
+	QString mErrorString;
+
+public:
+	//! \brief Create a new DrawingDocument with no pages.
+	DrawingDocument(QObject* parent = nullptr);
+
+	/*! \brief Delete an existing DrawingDocument object.
+	 *
+	 * All pages and their scenes are deleted.  Views showing a page are left without a scene.
+	 */
+	virtual ~DrawingDocument();
+
+
+	/*! \brief Adds a new empty page to the end of the document and returns its index.
+	 *
+	 * \sa insertPage(), removePage()
+	 */
+	int addPage(const QString& name);
+
+	/*! \brief Inserts a new empty page into the document at the specified index.
+	 *
+	 * \sa addPage(), removePage()
+	 */
+	void insertPage(int index, const QString& name);
+
+	/*! \brief Removes and deletes the page at the specified index.
+	 *
+	 * Views showing the page are left without a scene.
+	 *
+	 * \sa addPage(), clearPages()
+	 */
+	void removePage(int index);
+
+	/*! \brief Removes and deletes all pages from the document.
+	 *
+	 * \sa removePage()
+	 */
+	void clearPages();
+
+	//! \brief Returns the number of pages in the document.
+	int pageCount() const;
+
+	//! \brief Sets the name of the page at the specified index.
+	void setPageName(int index, const QString& name);
+
+	//! \brief Returns the name of the page at the specified index.
+	QString pageName(int index) const;
+
+
+	/*! \brief Shows the page at the specified index in the view.
+	 *
+	 * The page is activated if necessary, and the page previously shown in the view (if any) is
+	 * released.  The view's selection and undo stack are cleared.  The document keeps ownership
+	 * of the page's scene, so the #DrawingView::ViewOwnsScene flag is cleared on the view.
+	 *
+	 * \sa releaseView(), shownPage()
+	 */
+	void showPage(DrawingView* view, int index);
+
+	/*! \brief Releases the page shown in the view, if any, and leaves the view without a scene.
+	 *
+	 * \sa showPage()
+	 */
+	void releaseView(DrawingView* view);
+
+	/*! \brief Returns the index of the page shown in the view, or -1 if the view does not show a
+	 * page of this document.
+	 */
+	int shownPage(DrawingView* view) const;
+
+
+	/*! \brief Activates the page at the specified index and returns its live scene.
+	 *
+	 * Each call must be balanced by a call to deactivatePage().  The page remains active while
+	 * it is activated or shown in any view.
+	 *
+	 * \sa deactivatePage(), isPageActive()
+	 */
+	DrawingScene* activatePage(int index);
+
+	/*! \brief Releases a page activated by activatePage().
+	 *
+	 * When the page is no longer activated or shown in any view, its scene is serialized into the
+	 * page's compact form and deleted.  Calls without a matching activatePage() are ignored, so
+	 * a page shown in a view is never deleted by this function.
+	 *
+	 * \sa activatePage()
+	 */
+	void deactivatePage(int index);
+
+	//! \brief Returns true if the page at the specified index currently has a live scene.
+	bool isPageActive(int index) const;
+
+	/*! \brief Returns the live scene of the page at the specified index, or nullptr if the page
+	 * is not active.
+	 */
+	DrawingScene* pageScene(int index) const;
+
+
+	/*! \brief Returns the compact serialized form of the page at the specified index.
+	 *
+	 * If the page is active, its scene is serialized.
+	 */
+	QByteArray pageData(int index) const;
+
+	/*! \brief Visits every item and connection of every page in page order.
+	 *
+	 * Inactive pages are read from their compact form without being activated.  Active pages are
+	 * read from their live scenes.
+	 */
+	void visitPages(DrawingPageVisitor* visitor) const;
+
+
+	/*! \brief Saves all pages of the document to the specified file.
+	 *
+	 * Returns true on success, false otherwise.
+	 *
+	 * \sa open(), errorString()
+	 */
+	bool save(const QString& fileName);
+
+	/*! \brief Replaces the pages of the document with those saved in the specified file.
+	 *
+	 * The file is memory-mapped if possible.  No pages are activated.  Returns true on success,
+	 * false otherwise.
+	 *
+	 * \sa save(), errorString()
+	 */
+	bool open(const QString& fileName);
+
+	//! \brief Returns a description of the last error that occurred in save() or open().
+	QString errorString() const;
+
+signals:
+	//! \brief Emitted whenever pages are added to or removed from the document.
+	void pageCountChanged(int pageCount);
+
+	//! \brief Emitted after a page's scene has been created from its compact form.
+	void pageActivated(int index);
+
+	//! \brief Emitted before an inactive page's scene is deleted.
+	void pageDeactivated(int index);
+
+private slots:
+	void releaseDestroyedView(QObject* object);
+
+private:
+	void activate(Page* page);
+	void release(Page* page);
+	void deletePage(Page* page);
+	void closeMappedFile();
+
+	static QByteArray writeScene(DrawingScene* scene, const QByteArray& unresolvedConnections);
+	static DrawingScene* readScene(const QByteArray& data, QByteArray& unresolvedConnections);
+	static void readPage(DrawingPageVisitor* visitor, int pageIndex, const QByteArray& data);
+};
+
+#endif
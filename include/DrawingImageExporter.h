@@ -0,0 +1,207 @@
+/* DrawingImageExporter.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGIMAGEEXPORTER_H
+#define DRAWINGIMAGEEXPORTER_H
+
+#include <QtGui>
+
+class DrawingScene;
+
+/*! \brief Exports a DrawingScene to a very large raster image file using bounded memory.
+ *
+ * Rendering a scene into a single QImage is not practical for poster-sized output, since the
+ * image alone may require many gigabytes of memory.  DrawingImageExporter instead renders the
+ * scene in horizontal bands of bandHeight() rows and streams each band straight into a PNG or
+ * TIFF encoder as soon as it is complete.  Bands are rendered in parallel on up to
+ * maximumThreadCount() threads, and at most that many bands exist in memory at any time, so
+ * the peak memory used is independent of the output size.
+ *
+ * The exported region of the scene is given by sceneRect() and is scaled to fill imageSize()
+ * pixels.  The dotsPerInch() value is only recorded in the output file so that printing
+ * applications reproduce the intended physical size.
+ *
+ * exportImage() blocks until the export is complete.  It is normally run on a worker thread,
+ * in which case progressChanged() should be connected using a queued connection and cancel()
+ * may be called from any thread.  The scene must not be modified while an export is running.
+ *
+ * Scenes that use a DrawingItemSource are always rendered one band at a time on the calling
+ * thread, since materializing items from the source is not thread-safe.  exportImage() must be
+ * called from the scene's thread (normally the GUI thread) for such scenes, and fails otherwise.
+ *
+ * PNG image data is compressed row by row into a single zlib stream using the zlib library that
+ * Qt was built with.  TIFF image data is written as uncompressed strips, which is faster but
+ * produces much larger files; TIFF files larger than 4 GB are written in the BigTIFF format.
+ */
+class DrawingImageExporter : public QObject
+{
+	Q_OBJECT
+
+public:
+	//! \brief Enum representing the file format of the exported image.
+	enum Format
+	{
+		PngFormat,				//!< Portable Network Graphics
+		TiffFormat				//!< Tagged Image File Format
+	};
+
+private:
+	DrawingScene* mScene;
+
+	QRectF mSceneRect;
+	QSize mImageSize;
+	int mDotsPerInch;
+
+	int mBandHeight;
+	int mMaximumThreadCount;
+
+	QAtomicInt mCanceled;
+	QString mErrorString;
+
+public:
+	/*! \brief Create a new DrawingImageExporter for the specified scene.
+	 *
+	 * By default, the exporter renders the entire DrawingScene::sceneRect() at a scale of one
+	 * pixel per scene unit.
+	 */
+	DrawingImageExporter(DrawingScene* scene, QObject* parent = nullptr);
+
+	//! \brief Delete an existing DrawingImageExporter object.
+	virtual ~DrawingImageExporter();
+
+
+	/*! \brief Sets the region of the scene to export.
+	 *
+	 * If the rect is null, the scene's DrawingScene::sceneRect() is exported.
+	 *
+	 * \sa sceneRect()
+	 */
+	void setSceneRect(const QRectF& rect);
+
+	/*! \brief Returns the region of the scene to export.
+	 *
+	 * \sa setSceneRect()
+	 */
+	QRectF sceneRect() const;
+
+	/*! \brief Sets the size of the exported image in pixels.
+	 *
+	 * If the size is empty, an image with one pixel per scene unit is exported.
+	 *
+	 * \sa imageSize()
+	 */
+	void setImageSize(const QSize& size);
+
+	/*! \brief Returns the size of the exported image in pixels.
+	 *
+	 * \sa setImageSize()
+	 */
+	QSize imageSize() const;
+
+	/*! \brief Sets the resolution recorded in the exported image file.
+	 *
+	 * The default resolution is 96 dots per inch.
+	 *
+	 * \sa dotsPerInch()
+	 */
+	void setDotsPerInch(int dpi);
+
+	/*! \brief Returns the resolution recorded in the exported image file.
+	 *
+	 * \sa setDotsPerInch()
+	 */
+	int dotsPerInch() const;
+
+
+	/*! \brief Sets the number of image rows rendered together in each band.
+	 *
+	 * Smaller bands reduce the peak memory used by the export; larger bands reduce the overhead of
+	 * rendering the scene once per band.  The default band height is 256 rows.
+	 *
+	 * \sa bandHeight()
+	 */
+	void setBandHeight(int rows);
+
+	/*! \brief Returns the number of image rows rendered together in each band.
+	 *
+	 * \sa setBandHeight()
+	 */
+	int bandHeight() const;
+
+	/*! \brief Sets the maximum number of threads used to render bands in parallel.
+	 *
+	 * This is also the maximum number of bands kept in memory at any time.  The default is
+	 * QThread::idealThreadCount().
+	 *
+	 * \sa maximumThreadCount()
+	 */
+	void setMaximumThreadCount(int count);
+
+	/*! \brief Returns the maximum number of threads used to render bands in parallel.
+	 *
+	 * \sa setMaximumThreadCount()
+	 */
+	int maximumThreadCount() const;
+
+
+	/*! \brief Exports the scene to the specified file.
+	 *
+	 * The file is only replaced once the export has completed successfully.  Returns true on
+	 * success, or false if the export failed or was canceled, in which case errorString()
+	 * describes the reason.
+	 */
+	bool exportImage(const QString& fileName, Format format);
+
+	/*! \brief Exports the scene to the specified device.
+	 *
+	 * The device must already be open for writing.  Returns true on success, or false if the
+	 * export failed or was canceled, in which case errorString() describes the reason.
+	 */
+	bool exportImage(QIODevice* device, Format format);
+
+	/*! \brief Returns a description of the last error that occurred during exportImage().
+	 */
+	QString errorString() const;
+
+	/*! \brief Returns true if the current or last export was stopped early, either because
+	 * cancel() was called or because of an error.
+	 */
+	bool isCanceled() const;
+
+public slots:
+	/*! \brief Cancels the export in progress.
+	 *
+	 * This function is thread-safe.  The export stops as soon as the bands currently being
+	 * rendered are finished, and exportImage() returns false.
+	 */
+	void cancel();
+
+signals:
+	/*! \brief Emitted each time a band of the image has been written.
+	 *
+	 * This signal is emitted from the thread that called exportImage().
+	 */
+	void progressChanged(int bandsWritten, int bandCount);
+
+private:
+	bool exportBands(QIODevice* device, Format format, const QRectF& sceneRect, const QSize& imageSize);
+};
+
+#endif
@@ -0,0 +1,188 @@
+/* DrawingImporter.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGIMPORTER_H
+#define DRAWINGIMPORTER_H
+
+#include <QtGui>
+
+class DrawingScene;
+
+/*! \brief Imports very large SVG and DXF files into a DrawingScene using bounded memory.
+ *
+ * Loading a large drawing into a document tree before creating any items requires memory for the
+ * whole file plus the tree.  DrawingImporter instead parses the file incrementally on a worker
+ * thread and converts each shape into a native item as soon as it has been read.  Items are
+ * handed to the calling thread in batches of batchSize() items, which adds each batch to the scene
+ * with DrawingScene::addItems().  At most maximumQueuedBatches() batches wait between the two
+ * threads, so the memory used by the import itself does not depend on the size of the file.
+ *
+ * Shapes are converted to the following item types:
+ * \li SVG line elements and DXF LINE entities become DrawingLineItem objects
+ * \li SVG polyline elements and open DXF LWPOLYLINE and POLYLINE entities become
+ *     DrawingPolylineItem objects
+ * \li SVG polygon and rect elements and closed DXF LWPOLYLINE and POLYLINE entities become
+ *     DrawingPolygonItem objects
+ * \li SVG path, circle, and ellipse elements and DXF CIRCLE and ARC entities become
+ *     DrawingPathItem objects
+ * \li SVG text elements and DXF TEXT and MTEXT entities become DrawingTextItem objects
+ *
+ * Items with the same appearance share a single set of style values, so that a drawing with
+ * millions of shapes but only a few distinct styles does not store a copy of the style per item.
+ *
+ * Coordinates are mapped through transform() after any transforms given in the file itself.  DXF
+ * files use a y-axis that points up, so their y-coordinates are also negated.  The viewBox,
+ * width, height, and preserveAspectRatio attributes of SVG svg elements map the file's user units
+ * into these coordinates; a percentage width or height keeps the size of the viewBox.  SVG
+ * gradients, patterns, markers, and use elements are not imported; neither are DXF blocks or
+ * binary DXF files.
+ *
+ * importFile() blocks until the import is complete.  progressChanged() is emitted from the
+ * calling thread after each batch is added, and cancel() may be called from any thread.  If the
+ * import fails or is canceled, any items already added to the scene are removed and deleted.
+ * If the scene has an itemArena(), the imported items are allocated from it.  New items take their
+ * default style values from the scene's styleDefaults().
+ */
+class DrawingImporter : public QObject
+{
+	Q_OBJECT
+
+public:
+	//! \brief Enum representing the file format of the imported drawing.
+	enum Format
+	{
+		SvgFormat,				//!< Scalable Vector Graphics
+		DxfFormat				//!< ASCII Drawing Exchange Format
+	};
+
+private:
+	DrawingScene* mScene;
+
+	QTransform mTransform;
+	int mBatchSize;
+	int mMaximumQueuedBatches;
+
+	QAtomicInt mCanceled;
+	QString mErrorString;
+	int mItemCount;
+
+public:
+	/*! \brief Create a new DrawingImporter for the specified scene.
+	 *
+	 * By default, one unit in the file is imported as one scene unit.
+	 */
+	DrawingImporter(DrawingScene* scene, QObject* parent = nullptr);
+
+	//! \brief Delete an existing DrawingImporter object.
+	virtual ~DrawingImporter();
+
+
+	/*! \brief Sets the transform applied to all imported coordinates.
+	 *
+	 * The transform is applied after any transforms in the file itself, and can be used to scale
+	 * the file's units to scene units.  The default is the identity transform.
+	 *
+	 * \sa transform()
+	 */
+	void setTransform(const QTransform& transform);
+
+	/*! \brief Returns the transform applied to all imported coordinates.
+	 *
+	 * \sa setTransform()
+	 */
+	QTransform transform() const;
+
+	/*! \brief Sets the number of items added to the scene together in each batch.
+	 *
+	 * Larger batches reduce the number of signals emitted by the scene; smaller batches reduce the
+	 * memory held between the threads.  The default batch size is 1000 items.
+	 *
+	 * \sa batchSize()
+	 */
+	void setBatchSize(int count);
+
+	/*! \brief Returns the number of items added to the scene together in each batch.
+	 *
+	 * \sa setBatchSize()
+	 */
+	int batchSize() const;
+
+	/*! \brief Sets the maximum number of parsed batches waiting to be added to the scene.
+	 *
+	 * The worker thread stops parsing whenever this many batches are waiting.  The default is 4.
+	 *
+	 * \sa maximumQueuedBatches()
+	 */
+	void setMaximumQueuedBatches(int count);
+
+	/*! \brief Returns the maximum number of parsed batches waiting to be added to the scene.
+	 *
+	 * \sa setMaximumQueuedBatches()
+	 */
+	int maximumQueuedBatches() const;
+
+
+	/*! \brief Imports the specified file into the scene.
+	 *
+	 * Returns true on success, or false if the import failed or was canceled, in which case
+	 * errorString() describes the reason.
+	 */
+	bool importFile(const QString& fileName, Format format);
+
+	/*! \brief Imports the contents of the specified device into the scene.
+	 *
+	 * The device must already be open for reading, and is read from the worker thread, so it must
+	 * not be used by any other thread until the import is complete.  Returns true on success, or
+	 * false if the import failed or was canceled, in which case errorString() describes the
+	 * reason.
+	 */
+	bool importDevice(QIODevice* device, Format format);
+
+	//! \brief Returns the number of items added to the scene by the last successful import.
+	int itemCount() const;
+
+	/*! \brief Returns a description of the last error that occurred during an import.
+	 */
+	QString errorString() const;
+
+	/*! \brief Returns true if the current or last import was stopped early because cancel() was
+	 * called.
+	 */
+	bool isCanceled() const;
+
+public slots:
+	/*! \brief Cancels the import in progress.
+	 *
+	 * This function is thread-safe.  The worker thread stops parsing at the next shape, and the
+	 * import function returns false once the items already added have been removed.
+	 */
+	void cancel();
+
+signals:
+	/*! \brief Emitted each time a batch of items has been added to the scene.
+	 *
+	 * bytesRead is the approximate position of the parser within the file.  totalBytes is zero if
+	 * the size of the device is not known.  This signal is emitted from the thread that called
+	 * importFile() or importDevice().
+	 */
+	void progressChanged(qint64 bytesRead, qint64 totalBytes);
+};
+
+#endif
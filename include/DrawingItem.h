@@ -22,6 +22,7 @@
 #define DRAWINGITEM_H
 
 #include <QtGui>
+#include <DrawingStoredPoint.h>
 
 class DrawingScene;
 class DrawingItemPoint;
@@ -178,12 +179,54 @@ public:
 	};
 	Q_DECLARE_FLAGS(Flags, Flag)
 
+	/*! \brief Enum representing the eight axis-aligned orientations that an item can have.
+	 *
+	 * Rotating and flipping an item only ever produces one of these orientations, so DrawingItem
+	 * stores the orientation as a small code rather than as a full transformation matrix.  Each
+	 * value corresponds to the transform() that the item would have:  for example, #Rotate90 is
+	 * equivalent to QTransform().rotate(90) and #FlipRotate90 is equivalent to
+	 * QTransform().rotate(90).scale(-1, 1).
+	 */
+	enum Orientation
+	{
+		Rotate0,					//!< The identity transform.
+		Rotate90,					//!< Rotated by 90 degrees.
+		Rotate180,					//!< Rotated by 180 degrees.
+		Rotate270,					//!< Rotated by 270 degrees.
+		FlipRotate0,				//!< Flipped horizontally.
+		FlipRotate90,				//!< Flipped horizontally, then rotated by 90 degrees.
+		FlipRotate180,				//!< Flipped horizontally, then rotated by 180 degrees.
+		FlipRotate270,				//!< Flipped horizontally, then rotated by 270 degrees.
+		CustomOrientation			//!< The item has an arbitrary transform() that is not one of
+									//!< the axis-aligned orientations.
+	};
+
+	/*! \brief Enum used to trade rendering quality for speed, such as while the user is dragging
+	 * or zooming in a DrawingView.
+	 *
+	 * \sa setRenderFlags()
+	 */
+	enum RenderFlag
+	{
+		DraftPens = 0x01,			//!< Items are stroked with cosmetic one-pixel hairlines instead
+									//!< of the width of their style's pen.
+		DraftText = 0x02,			//!< Text is drawn without antialiasing, and text too small to be
+									//!< legible is drawn as a placeholder box.
+		BoundingBoxText = 0x04,		//!< All text is drawn as a placeholder box.
+		SkipTinyItems = 0x08		//!< DrawingScene does not render items that would cover less
+									//!< than two pixels on the paint device.
+	};
+	Q_DECLARE_FLAGS(RenderFlags, RenderFlag)
+
 private:
+	struct TransformData;
+
 	DrawingScene* mScene;
+	quint64 mId;
 
-	QPointF mPosition;
-	QTransform mTransform;
-	QTransform mTransformInverse;
+	DrawingStoredPoint mPosition;
+	quint8 mOrientation;
+	TransformData* mTransform;
 
 	Flags mFlags;
 	DrawingItemStyle* mStyle;
@@ -216,6 +259,15 @@ public:
 	//! \brief Delete an existing DrawingItem object.
 	virtual ~DrawingItem();
 
+	/*! \brief Allocates memory for a new item from the current DrawingArena, if any.
+	 *
+	 * \sa DrawingArenaScope
+	 */
+	static void* operator new(size_t size);
+
+	//! \brief Releases memory allocated by operator new().
+	static void operator delete(void* ptr);
+
 
 	/*! \brief Creates a copy of the DrawingItem and returns it.
 	 *
@@ -235,6 +287,28 @@ public:
 	DrawingScene* scene() const;
 
 
+	/*! \brief Sets the item's id.
+	 *
+	 * Each item in a DrawingScene carries a 64-bit id that is unique within that scene.  The id
+	 * remains stable for the lifetime of the item, so it may be used as a compact key for undo
+	 * data, serialization, or external references instead of the item's address.  An id of 0
+	 * indicates that no id has been assigned yet.
+	 *
+	 * The id can only be changed while the item is not a member of a scene.  When the item is
+	 * added to a scene, it keeps its id if that id is not already in use within the scene;
+	 * otherwise DrawingScene assigns it a new one.
+	 *
+	 * \sa id(), DrawingScene::itemFromId()
+	 */
+	void setId(quint64 id);
+
+	/*! \brief Returns the item's id, or 0 if no id has been assigned.
+	 *
+	 * \sa setId()
+	 */
+	quint64 id() const;
+
+
 	/*! \brief Sets the position of the item.
 	 *
 	 * The position of the item describes its origin (local coordinate (0,0)) in scene
@@ -301,7 +375,11 @@ public:
 	 * mapToParent(), mapFromParent(), mapToScene(), and mapFromScene() functions that can
 	 * translate between item, parent, and scene coordinates.
 	 *
-	 * \sa transform(), transformInverted()
+	 * If the resulting matrix is one of the eight axis-aligned orientations, the item only stores
+	 * its orientation() code.  A full matrix and its inverse are only allocated for arbitrary
+	 * transforms.
+	 *
+	 * \sa transform(), transformInverted(), orientation()
 	 */
 	void setTransform(const QTransform& transform, bool combine = false);
 
@@ -317,6 +395,15 @@ public:
 	 */
 	QTransform transformInverted() const;
 
+	/*! \brief Returns the item's current orientation.
+	 *
+	 * Returns #CustomOrientation if the item's transform() is not one of the eight axis-aligned
+	 * orientations.
+	 *
+	 * \sa transform()
+	 */
+	Orientation orientation() const;
+
 
 	/*! \brief Sets the type of item through a combination of flags.
 	 *
@@ -480,8 +567,9 @@ public:
 	 * delete it as necessary.
 	 *
 	 * It is safe to pass a nullptr to this function; if a nullptr is received, this function
-	 * does nothing.  This function also does nothing if the item is already one of the item's
-	 * children().
+	 * does nothing.  This function also does nothing if the item already has a parent or is a
+	 * top-level item of a scene.  If this item is in a scene, the new child and its children are
+	 * registered with the scene and assigned new ids if theirs are already in use.
 	 *
 	 * \sa addChild(), removeChild()
 	 */
@@ -757,6 +845,28 @@ public:
 	 */
 	virtual void render(QPainter* painter) = 0;
 
+
+	/*! \brief Writes the complete state of the item to the stream.
+	 *
+	 * The state includes the item's position, transform, flags, visibility, item points, style
+	 * values, and children, but not its id() or its item point connections.  Derived classes that
+	 * store additional state (such as a caption) must reimplement this function, call the base
+	 * class implementation first, and then write their own state.
+	 *
+	 * \sa readState(), DrawingItemFactory::writeItem()
+	 */
+	virtual void writeState(QDataStream& stream) const;
+
+	/*! \brief Restores the state of the item from the stream.
+	 *
+	 * Reads a state written by writeState().  Existing item points are updated in place where
+	 * possible so that their connections are preserved; points are added or removed if the
+	 * number of points has changed.  Existing children are replaced.
+	 *
+	 * \sa writeState(), DrawingItemFactory::readItem()
+	 */
+	virtual void readState(QDataStream& stream);
+
 protected:
 	/*! \brief Moves the item within the scene.
 	 *
@@ -790,6 +900,22 @@ protected:
 	 */
 	virtual void resizeEvent(DrawingItemPoint* itemPoint, const QPointF& parentPos);
 
+	/*! \brief Resizes the item within the scene by moving several of its item points at once.
+	 *
+	 * This function is called by DrawingScene::resizeItemPoints() with all of the item's points
+	 * that are moved together.  Each point in itemPoints is moved to the position at the same
+	 * index in parentPos, which is in the coordinate system of the parent(), or the scene() if no
+	 * parent is set.
+	 *
+	 * The default implementation calls resizeEvent() for each point in order.  Derived classes
+	 * whose resizeEvent() does nothing more than move the point can reimplement this function to
+	 * move all of the points and then adjust the item's position only once.
+	 *
+	 * \sa resizeEvent()
+	 */
+	virtual void resizePointsEvent(const QVector<DrawingItemPoint*>& itemPoints,
+		const QVector<QPointF>& parentPos);
+
 	/*! \brief Rotates the item counter-clockwise within the scene.
 	 *
 	 * This function is called when the item is to be rotated within the scene.  This will only be
@@ -875,8 +1001,21 @@ protected:
 	virtual void keyReleaseEvent(QKeyEvent* event);
 
 protected:
+	void adjustPositionToFirstPoint();
+
 	QPainterPath strokePath(const QPainterPath& path, const QPen& pen) const;
 
+	QPen renderPen(const QPen& pen) const;
+	void renderText(QPainter* painter, const QRectF& rect, int flags, const QString& text) const;
+
+private:
+	void setTransformData(const QTransform& transform);
+	void combineOrientation(Orientation orientation);
+
+	static QPointF mapByOrientation(quint8 orientation, const QPointF& point);
+	static QPointF mapByOrientationInverted(quint8 orientation, const QPointF& point);
+	static QTransform orientationTransform(quint8 orientation);
+
 public:
 	/*! \brief Creates a copy of each of the specified items and returns them as a new list.
 	 *
@@ -887,8 +1026,29 @@ public:
 	 * list.  Any item point connections to items not in the original list are broken.
 	 */
 	static QList<DrawingItem*> copyItems(const QList<DrawingItem*>& items);
+
+
+	/*! \brief Sets the render flags used by all items rendered from the calling thread.
+	 *
+	 * Render flags are kept separately for each thread, so a view rendering a draft frame does not
+	 * affect a DrawingImageExporter rendering the same scene on a worker thread.  Item classes
+	 * apply the flags by passing their pens through renderPen() and their text through
+	 * renderText().
+	 *
+	 * The default is no flags (full quality).
+	 *
+	 * \sa renderFlags()
+	 */
+	static void setRenderFlags(RenderFlags flags);
+
+	/*! \brief Returns the render flags used by all items rendered from the calling thread.
+	 *
+	 * \sa setRenderFlags()
+	 */
+	static RenderFlags renderFlags();
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(DrawingItem::Flags)
+Q_DECLARE_OPERATORS_FOR_FLAGS(DrawingItem::RenderFlags)
 
 #endif
@@ -0,0 +1,106 @@
+/* DrawingItemFactory.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGITEMFACTORY_H
+#define DRAWINGITEMFACTORY_H
+
+#include <QtGui>
+
+class DrawingItem;
+
+/*! \brief Creates DrawingItem objects by type name and reads and writes them to data streams.
+ *
+ * Each item class is registered under a stable type name together with either a function that
+ * constructs a new item or a prototype item.  Items of classes registered with a function are
+ * constructed on each call to createItem(), so they take the DrawingStyleDefaults that are
+ * current at that time.  Items of classes registered with a prototype are created by calling
+ * copy() on the prototype and keep the style values the prototype was constructed with.  All of
+ * the item classes provided by the library are registered with a function; applications must
+ * call registerItem() for their own item classes before items of those classes can be written or
+ * read.
+ *
+ * Items are written as their type name, their DrawingItem::id(), and their state as written by
+ * DrawingItem::writeState().  Since the state is length-prefixed, items of unknown types are
+ * skipped when reading.
+ *
+ * All functions of this class are thread-safe.
+ */
+class DrawingItemFactory
+{
+public:
+	//! \brief Function that constructs a new item of a registered item class.
+	typedef DrawingItem* (*CreateFunction)();
+
+	/*! \brief Registers an item class under the specified type name.
+	 *
+	 * The factory takes ownership of the prototype item.  Registering a type name again replaces
+	 * the previous registration.
+	 */
+	static void registerItem(const QString& typeName, DrawingItem* prototype);
+
+	/*! \brief Registers an item class under the specified type name.
+	 *
+	 * New items are constructed by calling the create function, which should return a new item
+	 * constructed with the current defaults.  Registering a type name again replaces the previous
+	 * registration.
+	 */
+	static void registerItem(const QString& typeName, CreateFunction create);
+
+	/*! \brief Creates a new item of the specified type.
+	 *
+	 * Items of classes registered with a create function are constructed with the
+	 * DrawingStyleDefaults::current() defaults of the calling thread.  Returns nullptr if no item
+	 * class is registered under the type name.
+	 */
+	static DrawingItem* createItem(const QString& typeName);
+
+	/*! \brief Returns the type name under which the item's class is registered.
+	 *
+	 * Returns an empty string if the item's class is not registered.
+	 */
+	static QString typeName(const DrawingItem* item);
+
+
+	/*! \brief Writes the item's type name, id, and state to the stream.
+	 *
+	 * \sa readItem()
+	 */
+	static void writeItem(QDataStream& stream, const DrawingItem* item);
+
+	/*! \brief Reads an item written by writeItem() from the stream and returns it.
+	 *
+	 * The new item has the same DrawingItem::id() as the item that was written.  Returns nullptr
+	 * if the item's type is not registered.
+	 *
+	 * \sa writeItem()
+	 */
+	static DrawingItem* readItem(QDataStream& stream);
+
+	/*! \brief Returns the item's state in a canonical form suitable for comparing or hashing.
+	 *
+	 * The result is the state written by DrawingItem::writeState(), except that the ids of any
+	 * child items are written as zero.  Two items with the same content therefore have the same
+	 * canonical state even if their children were created separately.  The result cannot be read
+	 * back with readItem().
+	 */
+	static QByteArray canonicalState(const DrawingItem* item);
+};
+
+#endif
@@ -123,6 +123,13 @@ public:
 	virtual void render(QPainter* painter);
 
 
+	//! \brief Writes the state of the group, including each of its items(), to the stream.
+	virtual void writeState(QDataStream& stream) const;
+
+	//! \brief Restores the state of the group, including each of its items(), from the stream.
+	virtual void readState(QDataStream& stream);
+
+
 private:
 	void recalculateContentsRect();
 };
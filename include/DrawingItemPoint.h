@@ -22,6 +22,7 @@
 #define DRAWINGITEMPOINT_H
 
 #include <QtCore>
+#include <DrawingStoredPoint.h>
 
 class DrawingItem;
 
@@ -77,7 +78,7 @@ public:
 private:
 	DrawingItem* mItem;
 
-	QPointF mPosition;
+	DrawingStoredPoint mPosition;
 	Flags mFlags;
 
 	QList<DrawingItemPoint*> mConnections;
@@ -111,6 +112,15 @@ public:
 	 */
 	virtual ~DrawingItemPoint();
 
+	/*! \brief Allocates memory for a new point from the current DrawingArena, if any.
+	 *
+	 * \sa DrawingArenaScope
+	 */
+	static void* operator new(size_t size);
+
+	//! \brief Releases memory allocated by operator new().
+	static void operator delete(void* ptr);
+
 
 	/*! \brief Returns the current item that this point is a member of, or nullptr if the point
 	 * is not associated with an item.
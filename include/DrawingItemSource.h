@@ -0,0 +1,96 @@
+/* DrawingItemSource.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGITEMSOURCE_H
+#define DRAWINGITEMSOURCE_H
+
+#include <QtGui>
+
+class DrawingItem;
+
+/*! \brief Provides the items of a virtualized DrawingScene on demand.
+ *
+ * For very large drawings it is not practical to keep a DrawingItem object in memory for every
+ * element of the drawing.  Instead, an application can store its elements in a compact record
+ * store of its own and expose them to a DrawingScene through a DrawingItemSource.  Each record
+ * is identified by a 64-bit id and must be able to report its bounds in scene coordinates and its
+ * position in the drawing order.
+ *
+ * DrawingScene only asks the source to create real DrawingItem objects (see createItem()) for
+ * records that are currently being painted or hit-tested.  These materialized items are kept
+ * while they are selected or have been edited, and are otherwise deleted again under a
+ * least-recently-used budget (see DrawingScene::setMaterializedItemBudget()).  Before an edited
+ * item is deleted, its new state is written back to the source using storeItem().
+ *
+ * Record ids share the id space of the scene's regular items (see DrawingItem::id()).  When an
+ * item is added through DrawingScene::addItem(), the scene asks containsRecord() whether its id
+ * is already used by a record and assigns the item a new id if so.
+ */
+class DrawingItemSource
+{
+public:
+	//! \brief Create a new DrawingItemSource.
+	DrawingItemSource();
+
+	//! \brief Delete an existing DrawingItemSource object.
+	virtual ~DrawingItemSource();
+
+
+	/*! \brief Returns the ids of all records whose bounds intersect the specified rect.
+	 *
+	 * The rect is given in scene coordinates.  The ids must be returned in drawing order, from
+	 * the bottom-most record to the top-most record.
+	 */
+	virtual QList<quint64> records(const QRectF& sceneRect) const = 0;
+
+	/*! \brief Returns the bounding rect of all records in scene coordinates.
+	 */
+	virtual QRectF boundingRect() const = 0;
+
+	/*! \brief Returns true if a record exists with the specified id, false otherwise.
+	 *
+	 * DrawingScene calls this function each time it registers a regular item, so it should not
+	 * need to search the records.
+	 */
+	virtual bool containsRecord(quint64 id) const = 0;
+
+
+	/*! \brief Creates a new DrawingItem for the record with the specified id and returns it.
+	 *
+	 * DrawingScene takes ownership of the new item.  The item's id is set to the record's id by
+	 * DrawingScene.  This function may return nullptr if no record exists with the specified id.
+	 */
+	virtual DrawingItem* createItem(quint64 id) = 0;
+
+	/*! \brief Writes the state of an edited item back to its record.
+	 *
+	 * The record to update is identified by the item's DrawingItem::id().  DrawingScene calls
+	 * this function before deleting an item that was edited after it was materialized.
+	 */
+	virtual void storeItem(const DrawingItem* item) = 0;
+
+	/*! \brief Removes the record with the specified id from the source.
+	 *
+	 * DrawingScene calls this function when a materialized item is removed from the scene.
+	 */
+	virtual void removeRecord(quint64 id) = 0;
+};
+
+#endif
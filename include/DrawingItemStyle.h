@@ -36,7 +36,10 @@
  * type; use of other data types will result in undefined behavior.
  *
  * DrawingItemStyle also supports a set of default style properties.  If a property is not set on
- * a particular style, DrawingItemStyle will attempt to use the default property value.
+ * a particular style, DrawingItemStyle will attempt to use the default property value.  Defaults
+ * are looked up in the DrawingStyleDefaults context that is current on the calling thread, which
+ * is the scene's DrawingScene::styleDefaults() while the scene renders or creates items, and
+ * otherwise the global context modified by setDefaultValue() and the related static functions.
  *
  * DrawingItem classes should use the valueLookup() functions to determine the property value using
  * default style properties.  If the style has a value() for the specified property, that value is
@@ -124,6 +127,15 @@ public:
 	 */
 	~DrawingItemStyle();
 
+	/*! \brief Allocates memory for a new style from the current DrawingArena, if any.
+	 *
+	 * \sa DrawingArenaScope
+	 */
+	static void* operator new(size_t size);
+
+	//! \brief Releases memory allocated by operator new().
+	static void operator delete(void* ptr);
+
 
 	/*! \brief Set the style's properties and values.
 	 *
@@ -293,13 +305,12 @@ private:
 		const QPointF& pos, qreal direction) const;
 
 
-private:
-	static QHash<Property,QVariant> mDefaultProperties;
-
 public:
 	/*! \brief Set the default properties and values for all DrawingItemStyle objects.
 	 *
-	 * Existing default properties and values are cleared to make way for the new values.
+	 * Existing default properties and values are cleared to make way for the new values.  This
+	 * function modifies DrawingStyleDefaults::global() and is thread-safe, as are the other static
+	 * functions below.
 	 *
 	 * \sa setDefaultValue(), defaultValues()
 	 */
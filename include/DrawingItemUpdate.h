@@ -0,0 +1,86 @@
+/* DrawingItemUpdate.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGITEMUPDATE_H
+#define DRAWINGITEMUPDATE_H
+
+#include <DrawingItemStyle.h>
+
+/*! \brief Describes a single change to an item that is posted to a DrawingScene from any thread.
+ *
+ * DrawingItemUpdate objects are used to drive items from live data sources running on worker
+ * threads.  Each update identifies its target item by DrawingItem::id() rather than by pointer,
+ * so that it can be created without touching the item itself.  Updates are posted using
+ * DrawingScene::postItemUpdates() and are applied together on the scene's thread.
+ *
+ * An update either sets the position of the item (#PositionUpdate) or sets the value of one of
+ * the properties of the item's style (#StyleValueUpdate).
+ */
+class DrawingItemUpdate
+{
+public:
+	//! \brief Enum representing the type of change described by the update.
+	enum Type
+	{
+		PositionUpdate,				//!< Sets the item's position using DrawingItem::setPosition()
+		StyleValueUpdate			//!< Sets a style value using DrawingItemStyle::setValue()
+	};
+
+private:
+	quint64 mItemId;
+	Type mType;
+	QPointF mPosition;
+	DrawingItemStyle::Property mProperty;
+	QVariant mValue;
+
+public:
+	//! \brief Create an empty update that does not refer to any item.
+	DrawingItemUpdate();
+
+	/*! \brief Create an update that sets the position of the specified item.
+	 *
+	 * The position is given in parent coordinates, or in scene coordinates for top-level items.
+	 */
+	DrawingItemUpdate(quint64 itemId, const QPointF& position);
+
+	//! \brief Create an update that sets the value of a style property of the specified item.
+	DrawingItemUpdate(quint64 itemId, DrawingItemStyle::Property property, const QVariant& value);
+
+	//! \brief Delete an existing DrawingItemUpdate object.
+	~DrawingItemUpdate();
+
+
+	//! \brief Returns the id of the item that this update applies to.
+	quint64 itemId() const;
+
+	//! \brief Returns the type of change described by this update.
+	Type type() const;
+
+	//! \brief Returns the new position for a #PositionUpdate.
+	QPointF position() const;
+
+	//! \brief Returns the style property changed by a #StyleValueUpdate.
+	DrawingItemStyle::Property property() const;
+
+	//! \brief Returns the new style value for a #StyleValueUpdate.
+	QVariant value() const;
+};
+
+#endif
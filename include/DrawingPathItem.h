@@ -240,6 +240,13 @@ public:
 	 */
 	virtual void render(QPainter* painter);
 
+
+	//! \brief Writes the state of the path item, including its name and path, to the stream.
+	virtual void writeState(QDataStream& stream) const;
+
+	//! \brief Restores the state of the path item, including its name and path, from the stream.
+	virtual void readState(QDataStream& stream);
+
 protected:
 	/*! \brief Resizes the item within the scene.
 	 *
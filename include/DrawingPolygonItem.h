@@ -152,6 +152,15 @@ public:
 	 */
 	virtual DrawingItemPoint* itemPointToRemove(const QPointF& itemPos);
 
+protected:
+	/*! \brief Resizes the item within the scene by moving several of its item points at once.
+	 *
+	 * All of the points are moved first, and then the item's position is adjusted once, instead
+	 * of once per point as when calling resizeEvent() for each point.
+	 */
+	virtual void resizePointsEvent(const QVector<DrawingItemPoint*>& itemPoints,
+		const QVector<QPointF>& parentPos);
+
 private:
 	qreal distanceFromPointToLineSegment(const QPointF& point, const QLineF& line) const;
 };
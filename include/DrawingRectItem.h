@@ -160,6 +160,13 @@ public:
 	 */
 	virtual void render(QPainter* painter);
 
+
+	//! \brief Writes the state of the rect item, including its corner radii, to the stream.
+	virtual void writeState(QDataStream& stream) const;
+
+	//! \brief Restores the state of the rect item, including its corner radii, from the stream.
+	virtual void readState(QDataStream& stream);
+
 protected:
 	/*! \brief Resizes the item within the scene.
 	 *
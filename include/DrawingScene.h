@@ -22,10 +22,15 @@
 #define DRAWINGSCENE_H
 
 #include <QtGui>
+#include <DrawingItemUpdate.h>
 
 class DrawingView;
 class DrawingItem;
 class DrawingItemPoint;
+class DrawingItemSource;
+class DrawingArena;
+class DrawingStyleDefaults;
+class DrawingCache;
 
 /*! \brief Surface for managing a large number of two-dimensional DrawingItem objects.
  *
@@ -50,12 +55,77 @@ class DrawingItemPoint;
  * item (if any) was clicked on by the user.
  *
  * The contents of the scene are painted using the render() function.
+ *
+ * \section sceneVirtual Virtualized Scenes
+ *
+ * For very large drawings, the scene can also draw items from a DrawingItemSource set using
+ * setItemSource().  The source's records are drawn beneath the scene's regular items().  Real
+ * DrawingItem objects are only created for records that are painted or hit-tested, and are
+ * deleted again once more than materializedItemBudget() of them exist, unless they are selected,
+ * pinned, or have been edited.  Edited items are kept until commitMaterializedItems() writes them
+ * back to the source.  Records are materialized and drawn in fixed-size batches, so the number of
+ * materialized items stays near the budget even when every record of the source is in view.
+ *
+ * Anything that keeps a pointer to a materialized item beyond the current call must pin the item
+ * with pinItems() until it no longer needs it.  The undo commands and DrawingView do this for the
+ * items they refer to.
+ *
+ * \section sceneIndex Item Index
+ *
+ * By default, the scene paints every visible item and hit-tests every visible item.  When the
+ * itemIndexMethod() is set to #BoundsTableIndex, the scene also keeps the scene bounds of its
+ * top-level items in a flat table that is culled against the painted area or the hit-test area
+ * first, using SIMD instructions where available.  Moving an item through the scene's slots
+ * updates its entry in place, so the table remains cheap to maintain even when thousands of items
+ * move each frame.  Adding, removing, or reordering items rebuilds the table the next time it is
+ * used.
+ *
+ * Changes made directly to an item (for example, by calling DrawingItem::setPosition()) are not
+ * seen by the table until the item is next changed through the scene, so such changes should be
+ * made through the scene's slots or postItemUpdates() when the index is in use.
+ *
+ * \section sceneArena Item Arena
+ *
+ * By default, items are allocated individually on the heap.  When setItemArenaEnabled() is
+ * called, the scene creates a DrawingArena for its items.  Items that are created within a
+ * DrawingArenaScope for the itemArena() (as DrawingView does when pasting items) are then stored
+ * contiguously in the order they are created, and their memory is released in whole slabs when
+ * they are deleted, for example by clearItems().
+ *
+ * As items are added, removed, and reordered, their layout in memory drifts away from their
+ * z-order.  compactItems() copies the items into the arena again in z-order and replaces the
+ * originals, and is called automatically once the scene has been idle for a second after a
+ * quarter of its items have changed.  Selected and pinned items are left in place, since the
+ * views and undo commands refer to them by pointer; anything else that keeps a pointer to an item
+ * must pin it with pinItems() or follow the itemsCompacted() signal.
+ *
+ * \section sceneCaches Cache Budget
+ *
+ * The item index table and the items materialized from an item source are registered as
+ * DrawingCache objects with the DrawingCacheManager.  When the manager needs to free memory, an
+ * index table that has not been used since the previous request is discarded and rebuilt the next
+ * time it is used, and unselected, unpinned, unedited materialized items are deleted before
+ * materializedItemBudget() is reached.  An index table in active use is kept even when it alone
+ * exceeds the budget, since it would otherwise be rebuilt on every paint.
  */
 class DrawingScene : public QObject
 {
 	Q_OBJECT
 
 	friend class DrawingView;
+	friend class DrawingItem;
+
+public:
+	/*! \brief Enum used to select how the scene finds the items within an area of the scene.
+	 *
+	 * See the \ref sceneIndex section above for more information.
+	 */
+	enum ItemIndexMethod
+	{
+		NoIndex,			//!< Every visible item is painted and hit-tested.
+		BoundsTableIndex	//!< Items are culled against a table of their scene bounds before
+							//!< they are painted or hit-tested.
+	};
 
 private:
 	QRectF mSceneRect;
@@ -63,6 +133,62 @@ private:
 	QBrush mBackgroundBrush;
 
 	QList<DrawingItem*> mItems;
+	QHash<quint64,DrawingItem*> mItemsById;
+	quint64 mNextItemId;
+
+	// Scene bounds of each visible top-level item, with the edges of all bounds counted in sorted
+	// maps so that the extent of the items can be updated without visiting every item
+	QHash<DrawingItem*,QRectF> mItemBounds;
+	QMap<qreal,int> mItemLeftEdges, mItemTopEdges, mItemRightEdges, mItemBottomEdges;
+	QRectF mItemsBoundingRect;
+
+	// Geometry of each visible top-level item, without pen widths and arrows, with its edges and
+	// centers counted in sorted maps for itemEdges()
+	QHash<DrawingItem*,QRectF> mItemGeometry;
+	QMap<qreal,int> mAlignmentLeftEdges, mAlignmentTopEdges, mAlignmentRightEdges, mAlignmentBottomEdges;
+	QMap<qreal,int> mAlignmentCenterXEdges, mAlignmentCenterYEdges;
+
+	// Scene bounds of the top-level items in z-order, stored in separate arrays so that
+	// cullItems() can test several items at once.  Entries for hidden items are NaN.  The table is
+	// rebuilt lazily under the mutex, since several threads may render the scene at once.
+	ItemIndexMethod mItemIndexMethod;
+	mutable QVector<float> mIndexMinX, mIndexMinY, mIndexMaxX, mIndexMaxY;
+	mutable QVector<DrawingItem*> mIndexItems;
+	mutable QHash<DrawingItem*,int> mIndexPositions;
+	mutable bool mItemIndexDirty;
+	mutable bool mItemIndexUsed;
+	mutable QMutex mItemIndexMutex;
+	DrawingCache* mItemIndexCache;
+
+	DrawingArena* mItemArena;
+	QHash<DrawingItem*,int> mPinnedItems;
+	int mItemLayoutChanges;
+	QTimer* mItemCompactionTimer;
+	DrawingStyleDefaults* mStyleDefaults;
+
+	struct MaterializedItem
+	{
+		DrawingItem* item;
+		quint64 lastUsed;
+		bool edited;
+		int pinCount;
+	};
+
+	DrawingItemSource* mItemSource;
+	int mMaterializedItemBudget;
+	mutable QHash<quint64,MaterializedItem> mMaterializedItems;
+	mutable quint64 mMaterializeCount;
+	DrawingCache* mMaterializedItemCache;
+
+	struct ItemUpdateBatch
+	{
+		QVector<DrawingItemUpdate> updates;
+		ItemUpdateBatch* next;
+	};
+
+	QAtomicPointer<ItemUpdateBatch> mPendingItemUpdates;
+	QAtomicInt mItemUpdatesScheduled;
+	int mItemUpdateInterval;
 
 public:
 	/*! \brief Create a new DrawingScene with default settings.
@@ -158,6 +284,10 @@ public:
 	 *
 	 * This function removes and deletes all of the scene's items() from memory.
 	 *
+	 * The items are deleted in the order they were added to the scene, so that items allocated
+	 * from the itemArena() release their slabs in turn.  The arena's empty slabs are then returned
+	 * to the heap.
+	 *
 	 * \sa removeItem()
 	 */
 	void clearItems();
@@ -180,11 +310,226 @@ public:
 	 */
 	QList<DrawingItem*> items() const;
 
+	/*! \brief Returns the item in the scene with the specified id, or nullptr if no such item
+	 * exists.
+	 *
+	 * DrawingScene keeps a table of the ids of all of its items and their children, so this
+	 * lookup does not need to search through the scene's items.  Children added to an item after
+	 * the item was added to the scene are not included in the table.
+	 *
+	 * \sa DrawingItem::id()
+	 */
+	DrawingItem* itemFromId(quint64 id) const;
+
+	/*! \brief Returns the union of the scene bounds of all visible items in the scene.
+	 *
+	 * Unlike sceneRect(), this rect follows the actual contents of the scene and may extend past
+	 * the sceneRect().  It includes each item's pen width and arrows, as well as the
+	 * DrawingItemSource::boundingRect() of the itemSource(), if any.  Returns a null rect if the
+	 * scene is empty.
+	 *
+	 * The extent is updated incrementally as items are added, removed, and changed through the
+	 * scene's slots, so calling this function does not iterate over the scene's items.  Changes
+	 * made directly to an item (for example, by calling DrawingItem::setPosition()) are not
+	 * included until the item is next changed through the scene.
+	 *
+	 * \sa itemsBoundingRectChanged()
+	 */
+	QRectF itemsBoundingRect() const;
+
+	/*! \brief Returns the sorted coordinates of the item edges within the specified range.
+	 *
+	 * If orientation is Qt::Horizontal, the left, center, and right x-coordinates of the visible
+	 * top-level items are searched; otherwise the top, center, and bottom y-coordinates are
+	 * searched.  The edges are those of the items' bounding rects mapped to the scene, without
+	 * the pen widths and arrows that are included in itemsBoundingRect(), so items with
+	 * different pens line up.  Each coordinate is returned once.  Edges that belong only to
+	 * the top-level items of excludedItems are not returned.
+	 *
+	 * The edges are kept in sorted indexes that are updated along with itemsBoundingRect(), so
+	 * this function only visits the edges within the range.  DrawingView uses this function to
+	 * find alignment guides while items are moved.
+	 */
+	QList<qreal> itemEdges(Qt::Orientation orientation, qreal minimum, qreal maximum,
+		const QList<DrawingItem*>& excludedItems = QList<DrawingItem*>()) const;
+
+
+	/*! \brief Sets the method used to find the items within an area of the scene.
+	 *
+	 * The default method is #NoIndex.
+	 *
+	 * \sa itemIndexMethod()
+	 */
+	void setItemIndexMethod(ItemIndexMethod method);
+
+	/*! \brief Returns the method used to find the items within an area of the scene.
+	 *
+	 * \sa setItemIndexMethod()
+	 */
+	ItemIndexMethod itemIndexMethod() const;
+
+
+	/*! \brief Sets whether the scene provides a DrawingArena for allocating its items.
+	 *
+	 * When enabled, the scene creates a new itemArena() and compacts its items into it with
+	 * compactItems() from time to time.  When disabled, the arena is deleted; items already
+	 * allocated from it remain valid.  The arena is disabled by default.
+	 *
+	 * \sa isItemArenaEnabled(), itemArena()
+	 */
+	void setItemArenaEnabled(bool enabled);
+
+	/*! \brief Returns whether the scene provides a DrawingArena for allocating its items.
+	 *
+	 * \sa setItemArenaEnabled()
+	 */
+	bool isItemArenaEnabled() const;
+
+	/*! \brief Returns the arena to be used for allocating the scene's items, or nullptr if the
+	 * arena is not enabled.
+	 *
+	 * Items are only allocated from the arena within a DrawingArenaScope; the returned pointer can
+	 * be passed directly to the DrawingArenaScope constructor.
+	 *
+	 * \sa setItemArenaEnabled()
+	 */
+	DrawingArena* itemArena() const;
+
+	/*! \brief Returns the default item style values used by the scene.
+	 *
+	 * The context is made current by a DrawingStyleDefaultsScope while the scene renders and
+	 * while new items are created for the scene, so that each scene can be loaded and drawn with
+	 * its own defaults on its own thread.  Properties without a value in the scene's context fall
+	 * back to the global defaults set through DrawingItemStyle::setDefaultValue().  The returned
+	 * context is owned by the scene.
+	 *
+	 * Item constructors copy the defaults that are current when they run, so an item constructed
+	 * outside a DrawingStyleDefaultsScope for the scene takes the global defaults.  Use createItem()
+	 * to create an item with the scene's defaults.
+	 *
+	 * \sa createItem()
+	 */
+	DrawingStyleDefaults* styleDefaults() const;
+
+	/*! \brief Creates a new item of the specified type using the scene's default style values.
+	 *
+	 * The item is created by DrawingItemFactory::createItem() while styleDefaults() is current, so
+	 * items of classes registered with a create function take the scene's defaults and the global
+	 * defaults as they are at the time of the call.  For classes registered with a prototype, each
+	 * style property that the item and its children use is then set from styleDefaults() if the
+	 * scene has a value for it.  The item is not added to the scene.  Returns nullptr if the type
+	 * has not been registered.
+	 *
+	 * \sa styleDefaults()
+	 */
+	DrawingItem* createItem(const QString& typeName) const;
+
+
+	/*! \brief Sets the source of virtual items drawn by the scene.
+	 *
+	 * Any items materialized from the previous source are written back to it (if edited) and
+	 * deleted, even if they are pinned, so any undo history that refers to them must be cleared
+	 * first.  DrawingScene does not take ownership of the source; the source must remain valid
+	 * until it is replaced or the scene is deleted.  Pass nullptr to stop using an item source.
+	 *
+	 * Items already in the scene whose ids are used by records of the new source (see
+	 * DrawingItemSource::containsRecord()) are given new ids.
+	 *
+	 * \sa itemSource(), setMaterializedItemBudget()
+	 */
+	void setItemSource(DrawingItemSource* source);
+
+	/*! \brief Returns the scene's item source, or nullptr if no item source is set.
+	 *
+	 * \sa setItemSource()
+	 */
+	DrawingItemSource* itemSource() const;
+
+	/*! \brief Sets the number of materialized items that the scene keeps in memory.
+	 *
+	 * When more items than this have been materialized from the itemSource(), the least recently
+	 * used items are deleted after each batch of items is painted.  Items that are selected, pinned,
+	 * or have been edited are never deleted, and neither are the items of the batch painted most
+	 * recently, so the actual number of materialized items can exceed the budget.
+	 *
+	 * The default budget is 10000 items.
+	 *
+	 * \sa materializedItemBudget(), commitMaterializedItems()
+	 */
+	void setMaterializedItemBudget(int budget);
+
+	/*! \brief Returns the number of materialized items that the scene keeps in memory.
+	 *
+	 * \sa setMaterializedItemBudget()
+	 */
+	int materializedItemBudget() const;
+
+	/*! \brief Returns a list of all items currently materialized from the itemSource().
+	 *
+	 * \sa setItemSource()
+	 */
+	QList<DrawingItem*> materializedItems() const;
+
+	/*! \brief Writes all edited materialized items back to the itemSource().
+	 *
+	 * After this function is called, the items are treated as unedited again and may be deleted
+	 * once they are no longer selected or pinned.
+	 *
+	 * \sa setMaterializedItemBudget(), pinItems()
+	 */
+	void commitMaterializedItems();
+
+	/*! \brief Keeps the specified items from being deleted or moved by the scene.
+	 *
+	 * Each call must be balanced by a call to unpinItems() with the same items.  Child items pin
+	 * their top-level item.  Pinned materialized items are not deleted, and pinned items are not
+	 * moved by compactItems().
+	 *
+	 * \sa unpinItems()
+	 */
+	void pinItems(const QList<DrawingItem*>& items);
+
+	/*! \brief Releases items pinned by pinItems().
+	 *
+	 * \sa pinItems()
+	 */
+	void unpinItems(const QList<DrawingItem*>& items);
+
+
+	/*! \brief Posts a batch of item updates to be applied to the scene.
+	 *
+	 * This function is thread-safe and may be called from any thread.  It does not block and does
+	 * not touch any items; the updates are appended to a lock-free queue and applied later on the
+	 * scene's thread by applyItemUpdates().  Updates posted within the same itemUpdateInterval()
+	 * are applied together, so high-rate data sources cause at most one repaint per interval.
+	 *
+	 * Updates for items that no longer exist in the scene when the batch is applied are ignored.
+	 *
+	 * \sa applyItemUpdates(), setItemUpdateInterval()
+	 */
+	void postItemUpdates(const QVector<DrawingItemUpdate>& updates);
+
+	/*! \brief Sets the minimum interval, in milliseconds, between applying posted item updates.
+	 *
+	 * The default interval is 16 ms, i.e. item updates are applied at most once per frame at
+	 * 60 Hz.
+	 *
+	 * \sa itemUpdateInterval(), postItemUpdates()
+	 */
+	void setItemUpdateInterval(int milliseconds);
+
+	/*! \brief Returns the minimum interval, in milliseconds, between applying posted item updates.
+	 *
+	 * \sa setItemUpdateInterval()
+	 */
+	int itemUpdateInterval() const;
+
 
 	/*! \brief Returns a list of all currently visible items in the scene.
 	 *
 	 * Unlike the items() function, this functions searches recursively and may include items and
-	 * their children.
+	 * their children.  Items from the itemSource() are only included if they are currently
+	 * materialized.
 	 *
 	 * \sa visibleItems(const QPointF&) const, visibleItems(const QRectF&, Qt::ItemSelectionMode) const
 	 */
@@ -269,6 +614,20 @@ public:
 	virtual void render(QPainter* painter);
 
 public slots:
+	/*! \brief Lays the scene's items out contiguously in the itemArena() in z-order.
+	 *
+	 * Each top-level item that is neither selected nor pinned is replaced by a copy allocated from
+	 * the itemArena(), in the order of items().  The copies keep the ids, visibility, and point
+	 * connections of the originals.  The itemsCompacted() signal is emitted before the originals
+	 * are deleted, and the arena's empty slabs are then returned to the heap.
+	 *
+	 * This function does nothing if the arena is not enabled.  Like removing items, it must not be
+	 * called while the scene is being rendered on another thread.
+	 *
+	 * \sa setItemArenaEnabled(), pinItems()
+	 */
+	void compactItems();
+
 	/*! \brief Adds the specified items to the scene.
 	 *
 	 * This function calls addItem() for each of the specified items.  It emits the
@@ -304,6 +663,21 @@ public slots:
 	 */
 	virtual void setItemsVisibility(const QList<DrawingItem*>& items, const QHash<DrawingItem*,bool>& visibility);
 
+	/*! \brief Sets style values on each of the specified items within the scene.
+	 *
+	 * The values are given as a table of distinct values so that many items can share the same
+	 * value without storing it once per item.  For each item, valueIndices holds one index into
+	 * values for each of the specified properties, in item-major order, so valueIndices must have
+	 * items.size() * properties.size() entries.  If valueIndices is empty, then values[i] is
+	 * applied to properties[i] on every item.  An invalid QVariant in the table unsets the
+	 * property on the item's DrawingItem::style().
+	 *
+	 * This function emits the itemsStyleChanged() signal once when all changes are complete.
+	 */
+	virtual void setItemsStyleValues(const QList<DrawingItem*>& items,
+		const QVector<DrawingItemStyle::Property>& properties, const QVector<QVariant>& values,
+		const QVector<int>& valueIndices = QVector<int>());
+
 
 	/*! \brief Moves each of the specified items within the scene.
 	 *
@@ -323,6 +697,18 @@ public slots:
 	 */
 	virtual void resizeItem(DrawingItemPoint* point, const QPointF& parentPos);
 
+	/*! \brief Resizes one or more items within the scene by moving several of their item points.
+	 *
+	 * Each point in points is moved to the position at the same index in parentPos, which is in
+	 * the coordinate system of the point's item's parent.  The points are grouped by item, and
+	 * DrawingItem::resizePointsEvent() is called once for each item with all of its points in the
+	 * order given.  It emits the itemsGeometryChanged() signal once when all items have been
+	 * resized.
+	 *
+	 * \sa resizeItem()
+	 */
+	virtual void resizeItemPoints(const QVector<DrawingItemPoint*>& points, const QVector<QPointF>& parentPos);
+
 
 	/*! \brief Rotates each of the specified items within the scene about the specified position.
 	 *
@@ -393,6 +779,19 @@ public slots:
 	virtual void disconnectItemPoints(DrawingItemPoint* point1, DrawingItemPoint* point2);
 
 
+	/*! \brief Applies all item updates posted using postItemUpdates() so far.
+	 *
+	 * This function is called automatically on the scene's thread after updates have been
+	 * posted.  It may also be called directly to flush the queue immediately.  All updates are
+	 * applied in the order they were posted.
+	 *
+	 * When complete, this function emits the itemsPositionChanged() and itemsStyleChanged()
+	 * signals once for all affected items, and the changed() signal with the regions of the scene
+	 * that need to be repainted.
+	 */
+	virtual void applyItemUpdates();
+
+
 signals:
 	/*! \brief Emitted whenever the number of items in the scene changes.
 	 *
@@ -404,6 +803,36 @@ signals:
 	 */
 	void numberOfItemsChanged(int itemCount);
 
+	/*! \brief Emitted whenever items are added to the scene.
+	 *
+	 * This signal is emitted whenever the user adds items using addItems() or insertItems().
+	 *
+	 * This signal is not emitted when using the addItem() or insertItem() functions directly.
+	 */
+	void itemsAdded(const QList<DrawingItem*>& items);
+
+	/*! \brief Emitted whenever items are removed from the scene.
+	 *
+	 * This signal is emitted whenever the user removes items using removeItems().  The items are
+	 * no longer part of the scene when the signal is emitted, but have not been deleted.
+	 *
+	 * This signal is not emitted when using the removeItem() or clearItems() functions directly.
+	 */
+	void itemsRemoved(const QList<DrawingItem*>& items);
+
+	/*! \brief Emitted whenever the list of top-level items is replaced using setItems().
+	 *
+	 * This happens most often when items are reordered within the scene.
+	 */
+	void itemsReordered(const QList<DrawingItem*>& items);
+
+	/*! \brief Emitted by compactItems() with the items that were replaced by copies.
+	 *
+	 * Each original item is mapped to its replacement.  The originals are deleted once the
+	 * signal returns.
+	 */
+	void itemsCompacted(const QHash<DrawingItem*,DrawingItem*>& replacedItems);
+
 	/*! \brief Emitted whenever any items' position changes.
 	 *
 	 * This signal is emitted whenever the user changes the position of items using moveItems().
@@ -443,6 +872,36 @@ signals:
 	 */
 	void itemsVisibilityChanged(const QList<DrawingItem*>& items);
 
+	/*! \brief Emitted whenever two item points are connected using connectItemPoints().
+	 */
+	void itemPointsConnected(DrawingItemPoint* point1, DrawingItemPoint* point2);
+
+	/*! \brief Emitted whenever two item points are disconnected using disconnectItemPoints().
+	 */
+	void itemPointsDisconnected(DrawingItemPoint* point1, DrawingItemPoint* point2);
+
+	/*! \brief Emitted whenever any items' style changes.
+	 *
+	 * This signal is emitted whenever item styles are changed through applyItemUpdates().
+	 *
+	 * This signal is not emitted when using functions in DrawingItemStyle to directly manipulate
+	 * the style of the item.
+	 */
+	void itemsStyleChanged(const QList<DrawingItem*>& items);
+
+	/*! \brief Emitted when only parts of the scene need to be repainted.
+	 *
+	 * The sceneRects are given in scene coordinates.  DrawingView uses this signal to repaint just
+	 * the affected regions of its viewport.
+	 */
+	void changed(const QList<QRectF>& sceneRects);
+
+	/*! \brief Emitted whenever the itemsBoundingRect() of the scene changes.
+	 *
+	 * This signal does not reflect changes to the bounds of the itemSource().
+	 */
+	void itemsBoundingRectChanged(const QRectF& rect);
+
 
 protected:
 	/*! \brief Renders the background of the scene using the specified painter.
@@ -481,6 +940,27 @@ protected:
 	virtual void drawForeground(QPainter* painter);
 
 private:
+	void registerItem(DrawingItem* item);
+	void registerChildItem(DrawingItem* item);
+	bool isItemIdUsed(quint64 id) const;
+	void unregisterItem(DrawingItem* item);
+
+	QList<DrawingItem*> materializeItems(const QList<quint64>& records) const;
+	void evictMaterializedItems(int budget) const;
+	void releaseMaterializedItems();
+	void markItemsChanged(const QList<DrawingItem*>& items);
+	void addItemBounds(DrawingItem* item);
+	void removeItemBounds(DrawingItem* item);
+	void noteItemLayoutChanges(int count);
+	void updateItemsBoundingRect();
+	QList<DrawingItem*> candidateItems(const QRectF& sceneRect) const;
+	QList<DrawingItem*> cullItems(const QRectF& sceneRect) const;
+	void updateItemIndex(DrawingItem* item) const;
+	void rebuildItemIndex() const;
+	QRectF paintedRect(QPainter* painter) const;
+	QRectF itemSceneBounds(DrawingItem* item) const;
+	QRectF itemSceneGeometry(DrawingItem* item) const;
+
 	void findItems(const QList<DrawingItem*>& items, QList<DrawingItem*>& foundItems) const;
 	void drawItems(QPainter* painter, const QList<DrawingItem*>& items);
 
@@ -488,6 +968,12 @@ private:
 	bool itemMatchesRect(const DrawingView* view, DrawingItem* item, const QRectF& rect, Qt::ItemSelectionMode mode) const;
 	bool itemMatchesPath(const DrawingView* view, DrawingItem* item, const QPainterPath& path, Qt::ItemSelectionMode mode) const;
 	QPainterPath itemAdjustedShape(const DrawingView* view, DrawingItem* item) const;
+
+private slots:
+	void scheduleItemUpdates();
+	void releaseItemIndex();
+	void updateItemIndexCost();
+	void releaseMaterializedItemCache(qint64 bytes);
 };
 
 #endif
@@ -0,0 +1,179 @@
+/* DrawingSceneDiff.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGSCENEDIFF_H
+#define DRAWINGSCENEDIFF_H
+
+#include <QtWidgets>
+
+class DrawingScene;
+class DrawingView;
+class DrawingItem;
+
+/*! \brief Computes the structural differences between two revisions of a DrawingScene.
+ *
+ * compare() matches each top-level item of the old scene with at most one top-level item of the
+ * new scene and classifies each pair by what changed between them.  Items are matched in three
+ * passes:
+ * \li Items with the same DrawingItem::id() are matched first.
+ * \li Remaining items are matched by a hash of their content, which covers everything in
+ * DrawingItemFactory::canonicalState() except the item's position.  Child item ids are not part of
+ * the content.  This finds items that were deleted and
+ * re-created, for example by cut and paste.  If several items share the same content, the
+ * nearest one within matchDistance() is chosen.
+ * \li Remaining items are matched by a hash of their type and geometry, which finds re-created
+ * items that were also restyled.  These items must be within matchDistance() of each other.
+ *
+ * Items left over are reported as added or removed.  Each pass is linear in the number of items
+ * and the per-item hashes are computed in parallel, so scenes with millions of items can be
+ * compared in a few seconds.
+ *
+ * The results are available from changes().  Unchanged items are not reported.  Call
+ * highlightChanges() to show the differences in a DrawingView.
+ *
+ * The scenes must not be modified while compare() is running, and the changes refer to items
+ * owned by the scenes, so they are only valid while both scenes are unchanged.
+ */
+class DrawingSceneDiff
+{
+public:
+	//! \brief Enum representing the ways in which an item can change between two scenes.
+	enum ChangeType
+	{
+		ItemAdded = 0x01,			//!< The item only exists in the new scene.
+		ItemRemoved = 0x02,			//!< The item only exists in the old scene.
+		ItemMoved = 0x04,			//!< The item's position changed.
+		ItemReshaped = 0x08,		//!< The item's geometry or other content changed.
+		ItemRestyled = 0x10,		//!< The item's style properties changed.
+		ItemReconnected = 0x20		//!< The connections to the item's points changed.
+	};
+	Q_DECLARE_FLAGS(ChangeTypes, ChangeType)
+
+	//! \brief Describes the changes to a single item.
+	struct Change
+	{
+		ChangeTypes types;			//!< The ways in which the item changed
+		DrawingItem* oldItem;		//!< The item in the old scene, or nullptr if the item was added
+		DrawingItem* newItem;		//!< The item in the new scene, or nullptr if the item was removed
+		QRectF oldRect;				//!< The old item's bounding rect in scene coordinates
+		QRectF newRect;				//!< The new item's bounding rect in scene coordinates
+	};
+
+private:
+	struct Record
+	{
+		DrawingItem* item;
+		QPointF position;
+		quint64 contentHash;
+		quint64 geometryHash;
+		quint64 styleHash;
+		int match;
+	};
+
+	QVector<Change> mChanges;
+	int mUnchangedCount;
+
+	qreal mMatchDistance;
+	int mMaximumThreadCount;
+
+public:
+	//! \brief Create a new DrawingSceneDiff with no changes.
+	DrawingSceneDiff();
+
+	//! \brief Delete an existing DrawingSceneDiff object.
+	~DrawingSceneDiff();
+
+
+	/*! \brief Sets the maximum distance, in scene coordinates, between the positions of two items
+	 * with different ids for them to be considered the same item.
+	 *
+	 * The default distance is 100.
+	 *
+	 * \sa matchDistance()
+	 */
+	void setMatchDistance(qreal distance);
+
+	/*! \brief Returns the maximum distance between the positions of two items with different ids
+	 * for them to be considered the same item.
+	 *
+	 * \sa setMatchDistance()
+	 */
+	qreal matchDistance() const;
+
+	/*! \brief Sets the maximum number of threads used to compute item hashes.
+	 *
+	 * The default is QThread::idealThreadCount().
+	 *
+	 * \sa maximumThreadCount()
+	 */
+	void setMaximumThreadCount(int count);
+
+	/*! \brief Returns the maximum number of threads used to compute item hashes.
+	 *
+	 * \sa setMaximumThreadCount()
+	 */
+	int maximumThreadCount() const;
+
+
+	/*! \brief Compares the top-level items of two scenes and replaces the current changes with
+	 * the differences between them.
+	 *
+	 * Either scene may be nullptr, in which case it is treated as an empty scene.
+	 *
+	 * \sa changes()
+	 */
+	void compare(DrawingScene* oldScene, DrawingScene* newScene);
+
+	//! \brief Removes all changes.
+	void clear();
+
+	/*! \brief Returns the changes found by the last call to compare().
+	 *
+	 * Changes are ordered by their item's index in the new scene, followed by the removed items in
+	 * their order in the old scene.
+	 */
+	QVector<Change> changes() const;
+
+	//! \brief Returns the number of changed items whose changes include the specified type.
+	int changeCount(ChangeType type) const;
+
+	//! \brief Returns the number of items that were matched and did not change.
+	int unchangedCount() const;
+
+
+	/*! \brief Highlights the changes in the view, which is normally showing the new scene.
+	 *
+	 * Existing highlights in the view are replaced.  Added items are highlighted in green,
+	 * removed items in red at their old location, and all other changes in orange.  Moved items
+	 * also have their old location highlighted in blue.
+	 *
+	 * \sa DrawingView::addHighlight(), DrawingView::clearHighlights()
+	 */
+	void highlightChanges(DrawingView* view) const;
+
+private:
+	void computeRecords(DrawingScene* scene, QVector<Record>& records) const;
+	void matchByHash(QVector<Record>& oldRecords, QVector<Record>& newRecords,
+		quint64 Record::*hash, bool requireProximity) const;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(DrawingSceneDiff::ChangeTypes)
+
+#endif
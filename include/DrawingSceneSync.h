@@ -0,0 +1,275 @@
+/* DrawingSceneSync.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGSCENESYNC_H
+#define DRAWINGSCENESYNC_H
+
+#include <QtGui>
+#include <QtNetwork>
+
+class DrawingScene;
+class DrawingItem;
+class DrawingItemPoint;
+
+/*! \brief Publishes the changes made to a DrawingScene as a compact stream of deltas.
+ *
+ * DrawingScenePublisher mirrors a scene into other processes.  It observes the signals that
+ * DrawingScene emits whenever it is modified through its public slots, which is how every
+ * DrawingUndoCommand applies and reverts its changes.  Changes are coalesced for
+ * flushInterval() milliseconds and then encoded as a single delta: repeated changes to the same
+ * item are sent once, items that are added and removed again are not sent at all, moved
+ * items only send their new position, and reordering the scene only sends the items whose order
+ * changed.  The size of each delta is therefore proportional to the
+ * number of items changed rather than to the size of the scene.
+ *
+ * After listen() is called, subscribers can connect over a QLocalSocket.  Each new subscriber
+ * first receives a snapshot() of the entire scene, followed by every later delta.  Deltas are
+ * also available to other transports through the deltaReady() signal.
+ *
+ * Items are encoded using DrawingItemFactory, so custom item classes must be registered with
+ * DrawingItemFactory::registerItem().  Records of a DrawingItemSource are not mirrored.
+ *
+ * \sa DrawingSceneSubscriber
+ */
+class DrawingScenePublisher : public QObject
+{
+	Q_OBJECT
+
+private:
+	enum ChangeFlag { PositionChange = 0x01, StyleChange = 0x02, StateChange = 0x04 };
+
+	struct ConnectionChange
+	{
+		quint64 itemId1;
+		int pointIndex1;
+		quint64 itemId2;
+		int pointIndex2;
+		bool connected;
+	};
+
+	DrawingScene* mScene;
+
+	QLocalServer* mServer;
+	QList<QLocalSocket*> mSockets;
+
+	QTimer* mFlushTimer;
+
+	QSet<quint64> mPublishedItems;
+	QList<quint64> mAddedItems;
+	QSet<quint64> mRemovedItems;
+	QHash<quint64,quint8> mChangedItems;
+	QList<ConnectionChange> mConnectionChanges;
+	bool mItemsReordered;
+
+	// Item order as of the last delta, shared with the scene's list until the scene changes it
+	QList<DrawingItem*> mPublishedOrder;
+
+public:
+	/*! \brief Create a new DrawingScenePublisher for the specified scene.
+	 *
+	 * All items currently in the scene are considered to be published already.
+	 */
+	DrawingScenePublisher(DrawingScene* scene, QObject* parent = nullptr);
+
+	//! \brief Delete an existing DrawingScenePublisher object.
+	virtual ~DrawingScenePublisher();
+
+
+	//! \brief Returns the scene whose changes are published.
+	DrawingScene* scene() const;
+
+	/*! \brief Starts accepting subscribers on a local socket with the specified name.
+	 *
+	 * Returns true on success, false otherwise.
+	 *
+	 * \sa close(), errorString()
+	 */
+	bool listen(const QString& serverName);
+
+	/*! \brief Stops accepting subscribers and disconnects all existing subscribers.
+	 *
+	 * \sa listen()
+	 */
+	void close();
+
+	//! \brief Returns true if the publisher is accepting subscribers.
+	bool isListening() const;
+
+	//! \brief Returns a description of the last error that occurred in listen().
+	QString errorString() const;
+
+	/*! \brief Sets the interval, in milliseconds, over which changes are coalesced into one delta.
+	 *
+	 * The default interval is 50 ms.
+	 *
+	 * \sa flushInterval(), flush()
+	 */
+	void setFlushInterval(int milliseconds);
+
+	/*! \brief Returns the interval, in milliseconds, over which changes are coalesced into one delta.
+	 *
+	 * \sa setFlushInterval()
+	 */
+	int flushInterval() const;
+
+
+	/*! \brief Returns a delta that recreates the entire scene.
+	 *
+	 * When applied, the snapshot replaces the contents of the subscriber's scene.
+	 */
+	QByteArray snapshot();
+
+	/*! \brief Returns a delta containing all changes recorded since the last delta was taken.
+	 *
+	 * Returns an empty QByteArray if there are no changes.  The recorded changes are cleared.
+	 *
+	 * \sa flush()
+	 */
+	QByteArray takeDelta();
+
+public slots:
+	/*! \brief Sends all changes recorded so far to all subscribers.
+	 *
+	 * This function is called automatically flushInterval() milliseconds after a change is
+	 * recorded.  It emits deltaReady() if there were any changes.
+	 */
+	void flush();
+
+signals:
+	/*! \brief Emitted whenever a new delta has been sent to subscribers.
+	 */
+	void deltaReady(const QByteArray& delta);
+
+private slots:
+	void recordAddedItems(const QList<DrawingItem*>& items);
+	void recordRemovedItems(const QList<DrawingItem*>& items);
+	void recordReorderedItems();
+	void recordCompactedItems(const QHash<DrawingItem*,DrawingItem*>& replacedItems);
+	void recordPositionChanges(const QList<DrawingItem*>& items);
+	void recordStyleChanges(const QList<DrawingItem*>& items);
+	void recordStateChanges(const QList<DrawingItem*>& items);
+	void recordConnection(DrawingItemPoint* point1, DrawingItemPoint* point2);
+	void recordDisconnection(DrawingItemPoint* point1, DrawingItemPoint* point2);
+
+	void acceptSubscriber();
+	void releaseSubscriber();
+
+private:
+	void recordChange(DrawingItem* item, quint8 change);
+	void writeMovedItems(QDataStream& stream, int& operationCount, const QList<DrawingItem*>& items,
+		const QSet<DrawingItem*>& addedItems) const;
+	void recordConnectionChange(DrawingItemPoint* point1, DrawingItemPoint* point2, bool connected);
+	void writeItemConnections(QDataStream& stream, int& operationCount, DrawingItem* item,
+		const QSet<quint64>& writtenItems) const;
+	void sendDelta(QLocalSocket* socket, const QByteArray& delta);
+};
+
+//==================================================================================================
+
+/*! \brief Applies the deltas published by a DrawingScenePublisher to a DrawingScene.
+ *
+ * DrawingSceneSubscriber connects to a DrawingScenePublisher over a QLocalSocket and applies
+ * each delta it receives to its own scene.  Deltas received through other transports can be
+ * applied directly using applyDelta().
+ *
+ * The subscriber's scene is expected to be a read-only mirror of the publisher's scene.  After
+ * each delta is applied, the deltaApplied() signal is emitted so that any views of the scene can
+ * be repainted.  If a delta received from the publisher cannot be applied, the scene no longer
+ * matches the publisher's scene, so the subscriber reconnects to receive a new snapshot.  A delta
+ * larger than maximumDeltaSize() closes the connection.
+ *
+ * \sa DrawingScenePublisher
+ */
+class DrawingSceneSubscriber : public QObject
+{
+	Q_OBJECT
+
+private:
+	DrawingScene* mScene;
+
+	QLocalSocket* mSocket;
+	QByteArray mBuffer;
+	int mMaximumDeltaSize;
+
+public:
+	//! \brief Create a new DrawingSceneSubscriber that applies deltas to the specified scene.
+	DrawingSceneSubscriber(DrawingScene* scene, QObject* parent = nullptr);
+
+	//! \brief Delete an existing DrawingSceneSubscriber object.
+	virtual ~DrawingSceneSubscriber();
+
+
+	//! \brief Returns the scene that deltas are applied to.
+	DrawingScene* scene() const;
+
+	/*! \brief Connects to the publisher listening on the local socket with the specified name.
+	 *
+	 * \sa disconnectFromPublisher()
+	 */
+	void connectToPublisher(const QString& serverName);
+
+	/*! \brief Disconnects from the publisher.
+	 *
+	 * \sa connectToPublisher()
+	 */
+	void disconnectFromPublisher();
+
+	//! \brief Returns true if the subscriber is connected to a publisher.
+	bool isConnected() const;
+
+	/*! \brief Sets the size in bytes of the largest delta accepted from the publisher.
+	 *
+	 * The connection is closed when the publisher announces a larger delta, so that a corrupt
+	 * stream cannot make the subscriber buffer an unbounded amount of data.  The default maximum
+	 * is 256 MB.
+	 *
+	 * \sa maximumDeltaSize()
+	 */
+	void setMaximumDeltaSize(int bytes);
+
+	/*! \brief Returns the size in bytes of the largest delta accepted from the publisher.
+	 *
+	 * \sa setMaximumDeltaSize()
+	 */
+	int maximumDeltaSize() const;
+
+
+	/*! \brief Applies a delta created by DrawingScenePublisher to the scene.
+	 *
+	 * Returns true if the entire delta was applied, or false if it is malformed.
+	 */
+	bool applyDelta(const QByteArray& delta);
+
+signals:
+	//! \brief Emitted after each delta has been applied to the scene.
+	void deltaApplied();
+
+	//! \brief Emitted when the connection to the publisher is closed.
+	void disconnected();
+
+private slots:
+	void readDeltas();
+
+private:
+	void applyState(DrawingItem* item, const QByteArray& state);
+	DrawingItemPoint* itemPoint(quint64 itemId, int pointIndex) const;
+};
+
+#endif
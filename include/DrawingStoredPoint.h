@@ -0,0 +1,81 @@
+/* DrawingStoredPoint.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGSTOREDPOINT_H
+#define DRAWINGSTOREDPOINT_H
+
+#include <QtCore>
+
+/*! \brief Storage type used for the positions of DrawingItem and DrawingItemPoint objects.
+ *
+ * By default, coordinates are stored as qreal and DrawingStoredPoint behaves exactly like a
+ * QPointF.  If the library is built with JADE_SINGLE_PRECISION_GEOMETRY defined, coordinates
+ * are stored as float instead.  This halves the memory used by item positions and item points,
+ * which is worthwhile for very large drawings whose coordinates stay within a range that a float
+ * can represent exactly enough (a few hundred thousand units).
+ *
+ * Coordinates are widened back to qreal whenever they are read, so all public DrawingItem and
+ * DrawingItemPoint functions continue to use QPointF.
+ */
+class DrawingStoredPoint
+{
+public:
+#ifdef JADE_SINGLE_PRECISION_GEOMETRY
+	typedef float Coordinate;
+#else
+	typedef qreal Coordinate;
+#endif
+
+private:
+	Coordinate mX, mY;
+
+public:
+	//! \brief Create a new point at (0, 0).
+	DrawingStoredPoint() : mX(0), mY(0) { }
+
+	//! \brief Create a new point from an existing QPointF.
+	DrawingStoredPoint(const QPointF& point) :
+		mX(static_cast<Coordinate>(point.x())), mY(static_cast<Coordinate>(point.y())) { }
+
+	//! \brief Assigns the coordinates of an existing QPointF to the point.
+	DrawingStoredPoint& operator=(const QPointF& point)
+	{
+		mX = static_cast<Coordinate>(point.x());
+		mY = static_cast<Coordinate>(point.y());
+		return *this;
+	}
+
+	//! \brief Sets the x-coordinate of the point.
+	void setX(qreal x) { mX = static_cast<Coordinate>(x); }
+
+	//! \brief Sets the y-coordinate of the point.
+	void setY(qreal y) { mY = static_cast<Coordinate>(y); }
+
+	//! \brief Returns the x-coordinate of the point.
+	qreal x() const { return mX; }
+
+	//! \brief Returns the y-coordinate of the point.
+	qreal y() const { return mY; }
+
+	//! \brief Returns the point as a QPointF.
+	QPointF toPointF() const { return QPointF(mX, mY); }
+};
+
+#endif
@@ -0,0 +1,174 @@
+/* DrawingStyleDefaults.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGSTYLEDEFAULTS_H
+#define DRAWINGSTYLEDEFAULTS_H
+
+#include <DrawingItemStyle.h>
+
+/*! \brief Thread-safe set of default item style property values.
+ *
+ * DrawingItemStyle::valueLookup() uses the default values of the current DrawingStyleDefaults
+ * context for any property that is not set on the style itself.  The context is chosen per thread
+ * by DrawingStyleDefaultsScope.  If no scope is active, the global() context is used; this is the
+ * context modified by the static DrawingItemStyle::setDefaultValue() functions.
+ *
+ * Each DrawingScene has its own DrawingStyleDefaults context, available from
+ * DrawingScene::styleDefaults(), which is current while the scene renders and while new items are
+ * created for the scene (as when a page is loaded or items are pasted).  Documents processed on
+ * separate threads can therefore use different defaults without affecting each other.
+ *
+ * Any property without a value in a context falls back to the value in the global() context, so a
+ * new context initially behaves exactly like the global one.
+ *
+ * Values are stored as an immutable snapshot.  Reading a value never blocks and writes nothing
+ * that other threads share: the reader publishes the snapshot it is about to read in a hazard slot
+ * owned by its thread, and writers replace the whole snapshot under a mutex.  A replaced snapshot
+ * is deleted by the next writer that finds it in no thread's hazard slot, or when the context is
+ * deleted.
+ *
+ * \sa DrawingStyleDefaultsScope
+ */
+class DrawingStyleDefaults
+{
+private:
+	struct Snapshot
+	{
+		QHash<DrawingItemStyle::Property,QVariant> values;
+	};
+
+	QAtomicPointer<Snapshot> mSnapshot;
+
+	QMutex mMutex;
+	QList<Snapshot*> mRetiredSnapshots;
+
+public:
+	//! \brief Create a new DrawingStyleDefaults context with no values of its own.
+	DrawingStyleDefaults();
+
+	/*! \brief Delete an existing DrawingStyleDefaults object.
+	 *
+	 * The context must not be current on any thread when it is deleted.
+	 */
+	~DrawingStyleDefaults();
+
+
+	/*! \brief Set the default properties and values of this context.
+	 *
+	 * Existing values are cleared to make way for the new values.
+	 *
+	 * \sa setValue(), values()
+	 */
+	void setValues(const QHash<DrawingItemStyle::Property,QVariant>& values);
+
+	/*! \brief Return the default properties and values set on this context.
+	 *
+	 * Values inherited from the global() context are not included.
+	 *
+	 * \sa setValues(), value()
+	 */
+	QHash<DrawingItemStyle::Property,QVariant> values() const;
+
+
+	/*! \brief Set the default value of the specified property to value.
+	 *
+	 * \sa setValues(), unsetValue(), value()
+	 */
+	void setValue(DrawingItemStyle::Property index, const QVariant& value);
+
+	/*! \brief Unset the default value of the specified property.
+	 *
+	 * The value from the global() context is used for the property afterwards.
+	 *
+	 * \sa setValue(), clearValues()
+	 */
+	void unsetValue(DrawingItemStyle::Property index);
+
+	/*! \brief Clear all default values set on this context.
+	 *
+	 * \sa unsetValue()
+	 */
+	void clearValues();
+
+	/*! \brief Returns true if this context or the global() context has a default value for the
+	 * specified property, false otherwise.
+	 *
+	 * \sa value()
+	 */
+	bool hasValue(DrawingItemStyle::Property index) const;
+
+	/*! \brief Return the default value for the specified property.
+	 *
+	 * If this context has no value for the property, the value from the global() context is
+	 * returned.  If neither context has a value, the specified fallback value is returned.
+	 *
+	 * \sa setValue(), hasValue()
+	 */
+	QVariant value(DrawingItemStyle::Property index, const QVariant& fallbackValue = QVariant()) const;
+
+
+	//! \brief Returns the context used when no DrawingStyleDefaultsScope is active.
+	static DrawingStyleDefaults* global();
+
+	/*! \brief Returns the context of the calling thread's innermost DrawingStyleDefaultsScope, or
+	 * the global() context if no scope is active.
+	 */
+	static DrawingStyleDefaults* current();
+
+private:
+	bool lookup(DrawingItemStyle::Property index, QVariant& value) const;
+	const Snapshot* acquireSnapshot() const;
+	void releaseSnapshot() const;
+	void replaceSnapshot(Snapshot* snapshot);
+
+	Q_DISABLE_COPY(DrawingStyleDefaults)
+};
+
+//==================================================================================================
+
+/*! \brief Makes a DrawingStyleDefaults context current on the calling thread.
+ *
+ * While the scope exists, DrawingItemStyle::valueLookup() on the same thread uses the defaults of
+ * the specified context.  Scopes may be nested; the previous context is restored when the scope is
+ * destroyed.  Passing nullptr makes the global context current.
+ *
+ * \code
+ * DrawingStyleDefaultsScope defaultsScope(scene->styleDefaults());
+ * for(...) items.append(createItem(...));
+ * scene->addItems(items);
+ * \endcode
+ */
+class DrawingStyleDefaultsScope
+{
+private:
+	DrawingStyleDefaults* mPreviousDefaults;
+
+public:
+	//! \brief Create a new DrawingStyleDefaultsScope that makes the specified context current.
+	DrawingStyleDefaultsScope(DrawingStyleDefaults* defaults);
+
+	//! \brief Restores the context that was current before this scope was created.
+	~DrawingStyleDefaultsScope();
+
+private:
+	Q_DISABLE_COPY(DrawingStyleDefaultsScope)
+};
+
+#endif
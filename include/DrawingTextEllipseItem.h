@@ -167,6 +167,13 @@ public:
 	 */
 	virtual void render(QPainter* painter);
 
+
+	//! \brief Writes the state of the item, including its caption, to the stream.
+	virtual void writeState(QDataStream& stream) const;
+
+	//! \brief Restores the state of the item, including its caption, from the stream.
+	virtual void readState(QDataStream& stream);
+
 protected:
 	/*! \brief Resizes the item within the scene.
 	 *
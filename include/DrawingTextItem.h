@@ -138,6 +138,13 @@ public:
 	 */
 	virtual void render(QPainter* painter);
 
+
+	//! \brief Writes the state of the text item, including its caption, to the stream.
+	virtual void writeState(QDataStream& stream) const;
+
+	//! \brief Restores the state of the text item, including its caption, from the stream.
+	virtual void readState(QDataStream& stream);
+
 private:
 	QRectF calculateTextRect(const QString& caption, const QFont& font,
 		Qt::Alignment textAlignment) const;
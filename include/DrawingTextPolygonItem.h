@@ -161,6 +161,13 @@ public:
 	virtual void render(QPainter* painter);
 
 
+	//! \brief Writes the state of the item, including its caption, to the stream.
+	virtual void writeState(QDataStream& stream) const;
+
+	//! \brief Restores the state of the item, including its caption, from the stream.
+	virtual void readState(QDataStream& stream);
+
+
 	/*! \brief Creates a new DrawingItemPoint to be inserted in the item and determines the
 	 * appropriate location in the item's point list to insert the new point.
 	 *
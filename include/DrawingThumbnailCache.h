@@ -0,0 +1,205 @@
+/* DrawingThumbnailCache.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGTHUMBNAILCACHE_H
+#define DRAWINGTHUMBNAILCACHE_H
+
+#include <QtGui>
+
+class DrawingScene;
+
+/*! \brief Generates thumbnails of drawing files and keeps them in a size-bounded disk cache.
+ *
+ * DrawingThumbnailCache is intended for document browsers that show thumbnails of many drawings.
+ * Thumbnails are rendered using DrawingScene::render() and stored as PNG files in
+ * cacheDirectory(), named after a SHA-1 hash of the drawing file's contents.  A drawing that is
+ * copied, renamed, or saved again without changes therefore reuses its existing thumbnail.
+ *
+ * The thumbnail() function never blocks on loading or rendering a scene.  It returns the cached
+ * thumbnail if one exists and schedules a rebuild on a background thread pool if the file has
+ * changed since the thumbnail was made, or if no thumbnail exists yet.  When a rebuild is
+ * complete, the thumbnailReady() signal is emitted.  The hash of each file is remembered along
+ * with its size and modification time in an index that is saved in the cache directory, so that
+ * browsing a folder again is instant without rereading any files.
+ *
+ * By default, drawing files are loaded as files saved by DrawingDocument::save() and the
+ * thumbnail shows the first page.  Applications with their own file format derive from
+ * DrawingThumbnailCache and reimplement loadScene().
+ *
+ * The total size of the cached thumbnails is kept below maximumCacheSize() by deleting the
+ * least-recently used thumbnails.
+ */
+class DrawingThumbnailCache : public QObject
+{
+	Q_OBJECT
+
+	friend class DrawingThumbnailJob;
+
+private:
+	struct IndexEntry
+	{
+		qint64 fileSize;
+		QDateTime lastModified;
+		QByteArray hash;
+		qint64 lastUsed;
+	};
+
+	QString mCacheDirectory;
+	QSize mThumbnailSize;
+	qint64 mMaximumCacheSize;
+
+	QHash<QString,IndexEntry> mIndex;
+	QSet<QString> mPendingFiles;
+	qint64 mCacheSize;
+
+	QThreadPool mThreadPool;
+
+public:
+	/*! \brief Create a new DrawingThumbnailCache that stores thumbnails in the specified directory.
+	 *
+	 * The directory is created if it does not exist yet.
+	 */
+	DrawingThumbnailCache(const QString& cacheDirectory, QObject* parent = nullptr);
+
+	/*! \brief Delete an existing DrawingThumbnailCache object.
+	 *
+	 * Waits for any thumbnails currently being rendered and saves the cache index.
+	 */
+	virtual ~DrawingThumbnailCache();
+
+
+	/*! \brief Returns the directory in which thumbnails are stored.
+	 */
+	QString cacheDirectory() const;
+
+	/*! \brief Sets the maximum size of the thumbnails.
+	 *
+	 * Thumbnails keep the aspect ratio of the scene's DrawingScene::sceneRect() and fit within
+	 * this size.  Thumbnails of different sizes are cached separately.  The default size is
+	 * 256 x 256 pixels.
+	 *
+	 * \sa thumbnailSize()
+	 */
+	void setThumbnailSize(const QSize& size);
+
+	/*! \brief Returns the maximum size of the thumbnails.
+	 *
+	 * \sa setThumbnailSize()
+	 */
+	QSize thumbnailSize() const;
+
+	/*! \brief Sets the maximum total size of the cached thumbnails in bytes.
+	 *
+	 * The default maximum is 64 MB.
+	 *
+	 * \sa maximumCacheSize()
+	 */
+	void setMaximumCacheSize(qint64 bytes);
+
+	/*! \brief Returns the maximum total size of the cached thumbnails in bytes.
+	 *
+	 * \sa setMaximumCacheSize()
+	 */
+	qint64 maximumCacheSize() const;
+
+	/*! \brief Sets the maximum number of threads used to rebuild thumbnails.
+	 *
+	 * The default is QThread::idealThreadCount().
+	 *
+	 * \sa maximumThreadCount()
+	 */
+	void setMaximumThreadCount(int count);
+
+	/*! \brief Returns the maximum number of threads used to rebuild thumbnails.
+	 *
+	 * \sa setMaximumThreadCount()
+	 */
+	int maximumThreadCount() const;
+
+
+	/*! \brief Returns the thumbnail of the specified drawing file.
+	 *
+	 * If the file has not changed since its thumbnail was last made, the cached thumbnail is
+	 * returned.  Otherwise, the thumbnail is rebuilt in the background and thumbnailReady() is
+	 * emitted when it is done.  In the meantime, this function returns the previous thumbnail of
+	 * the file if one is still cached, or a null QImage.
+	 */
+	QImage thumbnail(const QString& fileName);
+
+	/*! \brief Removes all thumbnails from the cache.
+	 */
+	void clear();
+
+	/*! \brief Waits until the thumbnails being rebuilt in the background are finished.
+	 *
+	 * Rebuilds that have not started yet are canceled.  Classes derived from
+	 * DrawingThumbnailCache must call this function in their destructor, since loadScene() could
+	 * otherwise be called on a partially destroyed object.
+	 */
+	void waitForDone();
+
+
+	/*! \brief Renders the scene into a new image that fits within the specified size.
+	 *
+	 * The scene's DrawingScene::sceneRect() is scaled to fit the size while keeping its aspect
+	 * ratio.
+	 */
+	static QImage renderThumbnail(DrawingScene* scene, const QSize& size);
+
+	/*! \brief Returns the SHA-1 hash of the contents of the specified file.
+	 *
+	 * Returns an empty QByteArray if the file cannot be read.
+	 */
+	static QByteArray fileHash(const QString& fileName);
+
+signals:
+	/*! \brief Emitted when the thumbnail of a file has been rebuilt.
+	 *
+	 * The image is null if the file could not be loaded using loadScene().
+	 */
+	void thumbnailReady(const QString& fileName, const QImage& image);
+
+protected:
+	/*! \brief Loads the drawing in the specified file into a new DrawingScene.
+	 *
+	 * This function is called on the threads of the cache's thread pool, never on the thread that
+	 * owns the cache, so it must be thread-safe and must not use any widgets.  The returned scene
+	 * is rendered and deleted on the same pool thread.  Returns nullptr if the file cannot be
+	 * loaded.
+	 *
+	 * The default implementation opens the file with DrawingDocument::open() and returns a new
+	 * scene with the items of the document's first page.
+	 */
+	virtual DrawingScene* loadScene(const QString& fileName) const;
+
+private slots:
+	void finishThumbnail(const QString& fileName, const QByteArray& hash, qint64 fileSize,
+		const QDateTime& lastModified, qint64 bytesWritten, const QImage& image);
+
+private:
+	void trimCache();
+
+	void readIndex();
+	void writeIndex() const;
+
+	static QString thumbnailFilePath(const QString& directory, const QByteArray& hash, const QSize& size);
+};
+
+#endif
@@ -22,6 +22,7 @@
 #define DRAWINGUNDO_H
 
 #include <QtWidgets>
+#include <DrawingItemStyle.h>
 
 class DrawingView;
 class DrawingScene;
@@ -33,9 +34,9 @@ class DrawingUndoCommand : public QUndoCommand
 public:
 	enum Type { AddItemsType, RemoveItemsType, MoveItemsType,
 		RotateItemsType, RotateBackItemsType, FlipItemsHorizontalType, FlipItemsVerticalType,
-		ItemResizeType, ReorderItemsType, SelectItemsType,
+		ItemResizeType, ItemPointsResizeType, ReorderItemsType, SelectItemsType,
 		InsertItemPointType, RemoveItemPointType,
-		PointConnectType, PointDisconnectType, SetItemsVisibilityType,
+		PointConnectType, PointDisconnectType, SetItemsVisibilityType, SetItemsStyleType,
 		UpdateItemPropertiesType, UpdatePropertiesType, NumberOfCommands };
 
 public:
@@ -45,6 +46,13 @@ public:
 
 protected:
 	virtual void mergeChildren(const QUndoCommand* command);
+
+	// Keeps items materialized from the scene's item source alive for the life of the command
+	void pinItems(DrawingScene* scene, const QList<DrawingItem*>& items);
+
+private:
+	QPointer<DrawingScene> mPinScene;
+	QList<DrawingItem*> mPinnedItems;
 };
 
 //==================================================================================================
@@ -136,6 +144,29 @@ public:
 
 //==================================================================================================
 
+class DrawingResizeItemPointsCommand : public DrawingUndoCommand
+{
+private:
+	DrawingScene* mScene;
+	QVector<DrawingItemPoint*> mPoints;
+	QVector<QPointF> mNewPos;
+	QVector<QPointF> mOriginalPos;
+	bool mFinalResize;
+
+public:
+	DrawingResizeItemPointsCommand(DrawingScene* scene, const QVector<DrawingItemPoint*>& points,
+		const QVector<QPointF>& scenePos, bool finalResize, QUndoCommand* parent = nullptr);
+	~DrawingResizeItemPointsCommand();
+
+	int id() const;
+	bool mergeWith(const QUndoCommand* command);
+
+	void redo();
+	void undo();
+};
+
+//==================================================================================================
+
 class DrawingRotateItemsCommand : public DrawingUndoCommand
 {
 private:
@@ -365,4 +396,83 @@ public:
 	void undo();
 };
 
+//==================================================================================================
+
+class DrawingSetStyleCommand : public DrawingUndoCommand
+{
+private:
+	DrawingScene* mScene;
+	QList<DrawingItem*> mItems;
+	QVector<DrawingItemStyle::Property> mProperties;
+	QVector<QVariant> mValues;
+
+	// Distinct original values, with one index into the table per item and property
+	QVector<QVariant> mOriginalValues;
+	QVector<int> mOriginalValueIndices;
+
+	bool mFinalChange;
+
+public:
+	DrawingSetStyleCommand(DrawingScene* scene, const QList<DrawingItem*>& items,
+		const QHash<DrawingItemStyle::Property,QVariant>& values, bool finalChange,
+		QUndoCommand* parent = nullptr);
+	~DrawingSetStyleCommand();
+
+	int id() const;
+	bool mergeWith(const QUndoCommand* command);
+
+	void redo();
+	void undo();
+};
+
+//==================================================================================================
+
+// Undo history with the parts of QUndoStack used by DrawingView.  Unlike QUndoStack, the limit can
+// be changed and the oldest commands dropped while the history is not empty.
+class DrawingUndoStack : public QObject
+{
+	Q_OBJECT
+
+private:
+	QList<QUndoCommand*> mCommands;
+	int mIndex;
+	int mCleanIndex;
+	int mUndoLimit;
+
+public:
+	DrawingUndoStack(QObject* parent = nullptr);
+	~DrawingUndoStack();
+
+	void push(QUndoCommand* command);
+	void undo();
+	void redo();
+	void clear();
+
+	void setUndoLimit(int limit);
+	int undoLimit() const;
+
+	// Deletes up to count commands, oldest first, followed by the newest redoable commands
+	void dropCommands(int count);
+	int count() const;
+
+	void setClean();
+	bool isClean() const;
+
+	bool canUndo() const;
+	bool canRedo() const;
+	QString undoText() const;
+	QString redoText() const;
+
+signals:
+	void indexChanged(int index);
+	void cleanChanged(bool clean);
+	void canUndoChanged(bool canUndo);
+	void canRedoChanged(bool canRedo);
+
+private:
+	void deleteCommands(int first, int last);
+	void deleteOldestCommands(int count);
+	void emitChanges(bool wasClean, bool couldUndo, bool couldRedo);
+};
+
 #endif
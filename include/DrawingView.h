@@ -22,10 +22,13 @@
 #define DRAWINGVIEW_H
 
 #include <QtWidgets>
+#include <DrawingItemStyle.h>
+#include <DrawingUndo.h>
 
 class DrawingScene;
 class DrawingItem;
 class DrawingItemPoint;
+class DrawingCache;
 
 /*! \brief Widget for viewing the contents of a DrawingScene.
  *
@@ -43,7 +46,9 @@ class DrawingItemPoint;
  *
  * The user can zoom in and out on the viewport through zoomIn() and zoomOut().  By default, these
  * functions zoom in or out by a factor of sqrt(2).  The user can zoom out to fit the entire scene
- * in the viewport by calling zoomFit().
+ * in the viewport by calling zoomFit(), or to fit just the scene's items by calling zoomFitItems().
+ * If the #ScrollRangeFollowsItems flag is set, the scrollable area also grows to include any items
+ * outside of the scene's DrawingScene::sceneRect().
  *
  * \section widget_events Event Handling
  *
@@ -95,7 +100,8 @@ class DrawingItemPoint;
  * \li Adding items to the widget using #PlaceMode
  * \li Deleting items using deleteSelection()
  * \li Moving items around the scene using mouse events or moveSelection()
- * \li Resizing items within the scene using mouse events or resizeSelection()
+ * \li Resizing items within the scene using mouse events, resizeSelection(), or
+ *     resizeSelectionPoints()
  * \li Rotating or flipping items in the scene using rotateSelection(), rotateBackSelection(),
  *     flipSelectionHorizontal(), and flipSelectionVertical().
  * \li Cut/copy/paste of items using cut(), copy(), and paste()
@@ -103,6 +109,7 @@ class DrawingItemPoint;
  *     sendToBack()
  * \li Inserting and removing item points using insertItemPoint() and removeItemPoint()
  * \li Grouping and ungrouping items using group() and ungroup()
+ * \li Changing the style of the selected items using setSelectionStyleValues()
  *
  * If the #UndoableSelectCommands flag is set, then the following additional operations are undoable:
  * \li Selecting items using mouse events or selectAll(), selectArea(), or selectNone()
@@ -111,6 +118,11 @@ class DrawingItemPoint;
  * isClean() to determine the current clean status.
  *
  * Custom undo events may be pushed on to the internal undo stack by calling pushUndoCommand().
+ *
+ * The undo stack and the preview image of the newItems() are registered as DrawingCache objects
+ * with the DrawingCacheManager.  The undo history has the highest priority of the library's
+ * caches, but is cleared if the manager still needs memory after the other caches have been
+ * released.
  */
 class DrawingView : public QAbstractScrollArea
 {
@@ -142,11 +154,43 @@ public:
 											//!< for the scene.
 		UndoableSelectCommands = 0x0002,	//!< Selecting and deselecting items are commands that
 											//!< the user can undo() and redo().
-		SendsMouseMoveInfo = 0x0004			//!< Emits the mouseInfoChanged() signal when the mouse
+		SendsMouseMoveInfo = 0x0004,		//!< Emits the mouseInfoChanged() signal when the mouse
 											//!< is moved within the scene.
+		InteractiveQuality = 0x0008,		//!< Renders without antialiasing, with hairline pens,
+											//!< and with simplified text while the user drags,
+											//!< zooms, or pans.  See setInteractiveQualityDelay().
+		AdaptiveQuality = 0x0010,			//!< Lowers the qualityLevel() automatically when
+											//!< painting exceeds the frameBudget().
+		ScrollRangeFollowsItems = 0x0020,	//!< The scrollable area grows to include the
+											//!< DrawingScene::itemsBoundingRect() when items
+											//!< extend past the DrawingScene::sceneRect().
+		AlignmentGuides = 0x0040,			//!< Shows guide lines while items are moved or placed
+											//!< when the edges or centers of the items line up
+											//!< with those of other items in the scene.
+		SnapToAlignmentGuides = 0x0080,		//!< Moves items onto the nearest alignment guide
+											//!< within a few pixels.  The snap is applied after
+											//!< the move is rounded to the grid, so it takes
+											//!< precedence and may leave items off the grid.
+											//!< Requires #AlignmentGuides.
+		ShowsGrid = 0x0100					//!< Draws the grid() over the scene background.  See
+											//!< setGridColor().
 	};
 	Q_DECLARE_FLAGS(Flags, Flag)
 
+	/*! \brief Enum representing how much rendering quality the view gives up to paint faster.
+	 *
+	 * Each level includes all of the reductions of the levels before it.  See setFrameBudget().
+	 */
+	enum QualityLevel
+	{
+		FullQuality,		//!< The view is rendered at full quality.
+		NoAntialiasing,		//!< The view is rendered without antialiasing.
+		BoundingBoxText,	//!< All text is drawn as a placeholder box.
+		SkipTinyItems,		//!< Items that would cover less than two pixels are not drawn.
+		AggregateHandles	//!< When several items are selected, a single outline around the
+							//!< selection is drawn instead of the points of each item.
+	};
+
 private:
 	enum MouseState { MouseReady, MouseSelect, MouseMoveItems, MouseResizeItem, MouseRubberBand };
 
@@ -156,8 +200,18 @@ private:
 	Flags mFlags;
 	Qt::ItemSelectionMode mItemSelectionMode;
 	qreal mGrid;
+	QColor mGridColor;
+	int mMajorGridInterval;
 
-	QUndoStack mUndoStack;
+	// Single tile of the grid pattern at the current scale, used as a brush to fill the background
+	QImage mGridTile;
+	qreal mGridTileSpacing;
+	int mGridTileInterval;
+	QColor mGridTileColor;
+	DrawingCache* mGridTileCacheBudget;
+
+	DrawingUndoStack mUndoStack;
+	DrawingCache* mUndoStackCacheBudget;
 
 	Mode mMode;
 	qreal mScale;
@@ -166,13 +220,37 @@ private:
 	DrawingItemPoint* mSelectedItemPoint;
 	QPointF mSelectionCenter;
 
+	struct PointRect
+	{
+		DrawingItemPoint* point;
+		QRect rect;
+	};
+
+	// Rects of the points of the selected items in content coordinates (so that they remain valid
+	// while scrolling), with a coarse grid over the rects for hit-testing
+	mutable QVector<PointRect> mPointRects;
+	mutable QHash<DrawingItem*,QPair<int,int>> mPointRectRanges;
+	mutable QHash<quint64,QVector<int>> mPointRectGrid;
+	mutable QTransform mPointRectsTransform;
+	mutable bool mPointRectsDirty;
+
 	QList<DrawingItem*> mNewItems;
+	QPointF mNewItemsCenter;
+	QPointF mNewItemsOffset;
+	QRectF mNewItemsBounds;
+	QImage mNewItemsCache;
+	QRectF mNewItemsCacheRect;
+	qreal mNewItemsCacheScale;
+	int mNewItemsCacheRenderFlags;
+	QPainter::RenderHints mNewItemsCacheRenderHints;
+	DrawingCache* mNewItemsCacheBudget;
 	DrawingItem* mMouseDownItem;
 	DrawingItem* mFocusItem;
 	QList<DrawingItem*> mClipboardItems;
 
 	QTransform mViewportTransform;
 	QTransform mSceneTransform;
+	QTransform mPaintTransform;
 
 	QPoint mButtonDownPos;
 	QPointF mButtonDownScenePos, mScenePos;
@@ -182,6 +260,18 @@ private:
 	MouseState mDefaultMouseState;
 	QHash<DrawingItem*,QPointF> mDefaultInitialPositions;
 	QPointF mDefaultSelectedItemPointOriginalPos;
+	QRectF mDefaultInitialBounds;
+
+	QList<qreal> mVerticalGuides;
+	QList<qreal> mHorizontalGuides;
+
+	struct Highlight
+	{
+		QRectF rect;
+		QColor color;
+	};
+
+	QVector<Highlight> mHighlights;
 
 	int mScrollButtonDownHorizontalScrollValue;
 	int mScrollButtonDownVerticalScrollValue;
@@ -190,6 +280,15 @@ private:
 	QPoint mPanCurrentPos;
 	QTimer mPanTimer;
 
+	bool mInteracting;
+	QTimer mInteractiveQualityTimer;
+
+	QualityLevel mQualityLevel;
+	int mFrameBudget;
+	int mSlowFrameCount;
+	int mFastFrameCount;
+	QTimer mQualityRestoreTimer;
+
 public:
 	/*! \brief Create a new DrawingView with default settings.
 	 *
@@ -206,6 +305,9 @@ public:
 
 
 	/*! \brief Sets the current scene of the view.
+	 *
+	 * When switching to a different scene, the view's selection, undo stack, and highlights are
+	 * cleared since they refer to the previous scene.
 	 *
 	 * \sa scene()
 	 */
@@ -234,6 +336,62 @@ public:
 	 */
 	Flags flags() const;
 
+	/*! \brief Sets how long, in milliseconds, input must be idle before the view is repainted at
+	 * full quality.
+	 *
+	 * When the #InteractiveQuality flag is set, the view renders at reduced quality while the
+	 * user drags, zooms with the mouse wheel, or auto-pans.  Once no such input has been received
+	 * for the specified delay, the view is repainted once at full quality.
+	 *
+	 * The default delay is 150 ms.
+	 *
+	 * \sa interactiveQualityDelay(), isInteracting()
+	 */
+	void setInteractiveQualityDelay(int milliseconds);
+
+	/*! \brief Returns how long, in milliseconds, input must be idle before the view is repainted
+	 * at full quality.
+	 *
+	 * \sa setInteractiveQualityDelay()
+	 */
+	int interactiveQualityDelay() const;
+
+	/*! \brief Returns true if the view is currently rendering at reduced quality because the user
+	 * is interacting with it.
+	 *
+	 * \sa setInteractiveQualityDelay()
+	 */
+	bool isInteracting() const;
+
+	/*! \brief Sets the target time, in milliseconds, to paint the entire viewport.
+	 *
+	 * When the #AdaptiveQuality flag is set, the view measures how long each paint event takes.
+	 * After two consecutive frames over the budget, the qualityLevel() is lowered by one step.
+	 * After ten consecutive frames that take less than half of the budget, it is raised by one
+	 * step.  Frames in between leave the level unchanged, so the level does not oscillate around
+	 * the budget.  Paint events that cover less than half of the viewport are not measured.
+	 *
+	 * Once the view has not been painted for interactiveQualityDelay() at a reduced level, it is
+	 * restored to full quality and repainted, so a view that stops changing is left at full quality.
+	 *
+	 * The default budget is 25 ms.
+	 *
+	 * \sa frameBudget(), qualityLevel()
+	 */
+	void setFrameBudget(int milliseconds);
+
+	/*! \brief Returns the target time, in milliseconds, to paint the entire viewport.
+	 *
+	 * \sa setFrameBudget()
+	 */
+	int frameBudget() const;
+
+	/*! \brief Returns the quality level that the view is currently rendered at.
+	 *
+	 * \sa setFrameBudget(), qualityLevelChanged()
+	 */
+	QualityLevel qualityLevel() const;
+
 
 	/*! \brief Sets the view's item selection mode.
 	 *
@@ -266,7 +424,7 @@ public:
 	 *
 	 * Snap to grid is enabled when the grid is set to a value greater than 0.  With snap to grid,
 	 * DrawingView will force items to be aligned on a grid when moved around the scene or
-	 * resized.
+	 * resized.  If the #ShowsGrid flag is set, the grid is also drawn over the scene background.
 	 *
 	 * Set the grid to 0 (or a negative number) to disable snap to grid.
 	 *
@@ -298,15 +456,50 @@ public:
 	 */
 	QPointF roundToGrid(const QPointF& scenePos) const;
 
+	/*! \brief Sets the color used to draw the grid when the #ShowsGrid flag is set.
+	 *
+	 * Major grid lines are drawn in this color.  Minor grid lines are drawn in a more transparent
+	 * version of it.
+	 *
+	 * The default color is gray.
+	 *
+	 * \sa gridColor(), setMajorGridInterval()
+	 */
+	void setGridColor(const QColor& color);
+
+	/*! \brief Returns the color used to draw the grid when the #ShowsGrid flag is set.
+	 *
+	 * \sa setGridColor()
+	 */
+	QColor gridColor() const;
+
+	/*! \brief Sets how many grid lines apart the major grid lines are drawn.
+	 *
+	 * When the view is zoomed out far enough that the grid lines would be drawn less than a few
+	 * pixels apart, only every interval-th line is drawn and those lines become the minor lines.
+	 * This repeats as needed, so the drawn grid never becomes denser than about one line per
+	 * 8 pixels.  Snapping is always to the full grid().
+	 *
+	 * Set the interval to 1 to draw all grid lines the same.  The default interval is 5.
+	 *
+	 * \sa majorGridInterval(), setGridColor()
+	 */
+	void setMajorGridInterval(int interval);
+
+	/*! \brief Returns how many grid lines apart the major grid lines are drawn.
+	 *
+	 * \sa setMajorGridInterval()
+	 */
+	int majorGridInterval() const;
+
 
 	/*! \brief Set the maximum depth of the internal undo stack of the view.
 	 *
 	 * When the number of commands on the stack exceeds the undo limit, commands are deleted from
 	 * the bottom of the stack.
 	 *
-	 * This property may only be set when the undo stack is empty, since setting it on a non-empty
-	 * stack might delete the command at the current index. Calling setUndoLimit() on a non-empty
-	 * stack does nothing.
+	 * Lowering the limit below the number of commands that can be undone deletes the oldest
+	 * commands right away.
 	 *
 	 * The default undo limit is set to 64.
 	 *
@@ -428,6 +621,11 @@ public:
 	 * The new items are set when entering #PlaceMode.  It is used to place new items within the
 	 * scene.
 	 *
+	 * When more than one new item is set, the items are moved with the mouse as a single unit:
+	 * only a preview offset is updated on each mouse move, and a cached image of the items is
+	 * painted at that offset.  The positions of the new items themselves are only updated when
+	 * they are placed, rotated, or flipped.
+	 *
 	 * \sa setPlaceMode()
 	 */
 	QList<DrawingItem*> newItems() const;
@@ -584,9 +782,29 @@ public:
 	DrawingItem* visibleItemAt(const QPointF& scenePos) const;
 
 
+	/*! \brief Adds a highlighted rect to the view's overlay.
+	 *
+	 * Highlights are drawn above the scene's items and are used to point out areas of the scene,
+	 * such as the changes found by DrawingSceneDiff.  The rect is given in scene coordinates and is
+	 * drawn at least a few pixels wide so that small items remain visible when zoomed out.
+	 * Highlights are not part of the scene and are cleared when the view's scene changes.
+	 *
+	 * \sa clearHighlights()
+	 */
+	void addHighlight(const QRectF& sceneRect, const QColor& color);
+
+	/*! \brief Removes all highlighted rects from the view's overlay.
+	 *
+	 * \sa addHighlight()
+	 */
+	void clearHighlights();
+
+
 	/*! \brief Renders the scene using the specified painter.
 	 *
-	 * The default implementation simply calls DrawingScene::render().
+	 * The default implementation calls drawBackground(), drawItems(), and drawForeground() in
+	 * succession.  paintEvent() calls this function with the view's render flags and the scene's
+	 * style defaults already in effect.
 	 */
 	virtual void render(QPainter* painter);
 
@@ -619,6 +837,17 @@ public slots:
 	 */
 	void zoomFit();
 
+	/*! \brief Zooms to fit all of the scene's items within the view.
+	 *
+	 * Scales the view and scrolls the scroll bars to ensure that the
+	 * DrawingScene::itemsBoundingRect() fits inside the viewport, then sends the scaleChanged()
+	 * signal to indicate the new scale factor.  If the scene is empty, this function is
+	 * equivalent to zoomFit().
+	 *
+	 * \sa zoomFit(), scaleBy()
+	 */
+	void zoomFitItems();
+
 
 	/*! \brief Sets the current operating mode to #DefaultMode.
 	 *
@@ -892,6 +1121,24 @@ public slots:
 	 */
 	void resizeSelection(DrawingItemPoint* itemPoint, const QPointF& scenePos);
 
+	/*! \brief Moves each of the specified item points of the selected items by deltaScenePos.
+	 *
+	 * This function emits the itemsGeometryChanged() signal once after all of the items have been
+	 * resized.  The points may belong to any number of selected items, and all of them are moved
+	 * in a single undoable command, so that editing many vertices of a large polyline or polygon
+	 * does not cost one command and one geometry update per vertex.
+	 *
+	 * Points are only moved if their item is selected and has the CanResize flag set.  Other
+	 * points are ignored.  Connections to other items are maintained where possible, as with
+	 * resizeSelection().
+	 *
+	 * The resize operation is only performed if the mode() is #DefaultMode.  If the mode() is any
+	 * other mode, this function does nothing.
+	 *
+	 * \sa resizeSelection()
+	 */
+	void resizeSelectionPoints(const QList<DrawingItemPoint*>& itemPoints, const QPointF& deltaScenePos);
+
 	/*! \brief Rotates the selected items 90 degrees counter-clockwise.
 	 *
 	 * This function emits the itemsGeometryChanged() signal after the items have been rotated.
@@ -960,6 +1207,23 @@ public slots:
 	 */
 	void flipSelectionVertical();
 
+	/*! \brief Sets the specified style values on each selected item.
+	 *
+	 * This function emits the itemsStyleChanged() signal once after the items have been updated.
+	 * An invalid QVariant unsets the property on the items.
+	 *
+	 * The change is undoable.  The original values are stored once per distinct value rather than
+	 * once per item, so recoloring a large selection adds little to the undo stack.  Set
+	 * finalChange to false for intermediate values, such as while the user drags a slider; the
+	 * change is then merged with the next change to the same properties of the same items, and
+	 * undo restores the values from before the first change.
+	 *
+	 * The change is only performed if the mode() is #DefaultMode.  If the mode() is any other mode,
+	 * this function does nothing.
+	 */
+	void setSelectionStyleValues(const QHash<DrawingItemStyle::Property,QVariant>& values,
+		bool finalChange = true);
+
 
 	/*! \brief Brings each selected item forward in the scene's stacking order.
 	 *
@@ -1102,6 +1366,12 @@ signals:
 	 */
 	void modeChanged(DrawingView::Mode mode);
 
+	/*! \brief Emitted whenever the view's qualityLevel() changes.
+	 *
+	 * \sa setFrameBudget()
+	 */
+	void qualityLevelChanged(DrawingView::QualityLevel level);
+
 	/*! \brief Emitted whenever the stack enters or leaves the clean state.
 	 *
 	 * If clean is true, the stack is in a clean state; otherwise this signal indicates that it
@@ -1179,6 +1449,13 @@ signals:
 	 */
 	void itemsVisibilityChanged(const QList<DrawingItem*>& items);
 
+	/*! \brief Emitted whenever any items' style changes.
+	 *
+	 * This signal is forwarded from DrawingScene::itemsStyleChanged() and is emitted whenever
+	 * live updates posted using DrawingScene::postItemUpdates() change the style of items.
+	 */
+	void itemsStyleChanged(const QList<DrawingItem*>& items);
+
 
 	/*! \brief Emitted whenever the view's list of selectedItems() changes.
 	 *
@@ -1214,8 +1491,8 @@ signals:
 protected:
 	/*! \brief Handles paint events for the view.
 	 *
-	 * The default implementation calls drawBackground(), drawItems(), and drawForeground() in
-	 * succession.
+	 * The default implementation sets up the render flags for the current qualityLevel() and
+	 * calls render() for the exposed part of the viewport.
 	 */
 	virtual void paintEvent(QPaintEvent* event);
 
@@ -1296,7 +1573,8 @@ protected:
 
 	/*! \brief Renders the background of the scene using the specified painter.
 	 *
-	 * The default implementation simply calls DrawingScene::drawBackground().
+	 * The default implementation calls DrawingScene::drawBackground() and then draws the grid()
+	 * if the #ShowsGrid flag is set.
 	 *
 	 * This function may be overridden in a derived class to provide a custom rendering
 	 * implementation for the scene background.
@@ -1334,7 +1612,16 @@ protected:
 
 private slots:
 	void updateSelectionCenter();
+	void updateSceneRects(const QList<QRectF>& sceneRects);
 	void mousePanEvent();
+	void endInteraction();
+	void restoreFullQuality();
+	void updateScrollRange();
+	void invalidatePointRects();
+	void updateUndoStackCost();
+	void releaseUndoStack(qint64 bytes);
+	void releaseNewItemsCache();
+	void releaseGridTile();
 
 private:
 	void addItemsCommand(const QList<DrawingItem*>& items, bool place, QUndoCommand* command = nullptr);
@@ -1343,6 +1630,8 @@ private:
 		bool place, QUndoCommand* command = nullptr);
 	void resizeItemCommand(DrawingItemPoint* itemPoint, const QPointF& scenePos,
 		bool place, bool disconnect, QUndoCommand* command = nullptr);
+	void resizeItemPointsCommand(const QVector<DrawingItemPoint*>& itemPoints, const QVector<QPointF>& scenePos,
+		QUndoCommand* command = nullptr);
 	void rotateItemsCommand(const QList<DrawingItem*>& items, const QPointF& scenePos, QUndoCommand* command = nullptr);
 	void rotateBackItemsCommand(const QList<DrawingItem*>& items, const QPointF& scenePos, QUndoCommand* command = nullptr);
 	void flipItemsHorizontalCommand(const QList<DrawingItem*>& items, const QPointF& scenePos, QUndoCommand* command = nullptr);
@@ -1352,6 +1641,9 @@ private:
 	void connectItemPointsCommand(DrawingItemPoint* point1, DrawingItemPoint* point2, QUndoCommand* command = nullptr);
 	void disconnectItemPointsCommand(DrawingItemPoint* point1, DrawingItemPoint* point2, QUndoCommand* command = nullptr);
 	void hideItemsCommand(const QList<DrawingItem*>& items, QUndoCommand* command = nullptr);
+	void setItemsStyleCommand(const QList<DrawingItem*>& items,
+		const QHash<DrawingItemStyle::Property,QVariant>& values, bool finalChange,
+		QUndoCommand* command = nullptr);
 
 	void placeItems(const QList<DrawingItem*>& items, QUndoCommand* command);
 	void unplaceItems(const QList<DrawingItem*>& items, QUndoCommand* command);
@@ -1360,11 +1652,25 @@ private:
 	void disconnectAll(DrawingItemPoint* itemPoint, QUndoCommand* command);
 
 private:
+	void beginInteraction();
+	void setMouseDownItem(DrawingItem* item);
+	void applyNewItemsOffset();
+	void drawNewItems(QPainter* painter);
+	void clearNewItemsCache();
+	void drawGrid(QPainter* painter);
+	QRectF itemsSceneBounds(const QList<DrawingItem*>& items) const;
+	QPointF updateAlignmentGuides(const QRectF& sceneRect,
+		const QList<DrawingItem*>& excludedItems = QList<DrawingItem*>());
+	qreal alignEdges(Qt::Orientation orientation, const qreal values[3], qreal tolerance,
+		const QList<DrawingItem*>& excludedItems, QList<qreal>& guides) const;
+	void updateQualityLevel(qint64 paintTime);
 	void recalculateContentSize(const QRectF& targetSceneRect = QRectF());
 
 	qreal minimumPenWidth(DrawingItem* item) const;
 	QRect pointRect(DrawingItemPoint* point) const;
 	DrawingItemPoint* pointAt(DrawingItem* item, const QPointF& itemPos) const;
+	QVector<QRect> itemPointRects(DrawingItem* item) const;
+	void updatePointRects() const;
 
 	bool shouldConnect(DrawingItemPoint* point1, DrawingItemPoint* point2) const;
 	bool shouldDisconnect(DrawingItemPoint* point1, DrawingItemPoint* point2) const;
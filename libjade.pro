@@ -6,7 +6,14 @@ INCLUDEPATH += include
 
 CONFIG += release warn_on embed_manifest_dll c++11 qt staticlib
 CONFIG -= debug
-QT += widgets
+QT += widgets network
+
+# Store item positions and item point coordinates as float instead of qreal
+#DEFINES += JADE_SINGLE_PRECISION_GEOMETRY
+
+# DrawingImageExporter compresses PNG data with the zlib that Qt uses; applications linking
+# against a Qt built with the system zlib must also add LIBS += -lz
+qtConfig(system-zlib): DEFINES += JADE_SYSTEM_ZLIB
 
 !win32:MOC_DIR = release
 !win32:OBJECTS_DIR = release
@@ -16,11 +23,19 @@ QT += widgets
 
 SOURCES += \
 	source/DrawingArcItem.cpp \
+	source/DrawingArena.cpp \
+	source/DrawingCacheManager.cpp \
 	source/DrawingCurveItem.cpp \
+	source/DrawingDocument.cpp \
 	source/DrawingEllipseItem.cpp \
+	source/DrawingImageExporter.cpp \
+	source/DrawingImporter.cpp \
 	source/DrawingItem.cpp \
+	source/DrawingItemFactory.cpp \
 	source/DrawingItemGroup.cpp \
 	source/DrawingItemPoint.cpp \
+	source/DrawingItemSource.cpp \
+	source/DrawingItemUpdate.cpp \
 	source/DrawingItemStyle.cpp \
 	source/DrawingLineItem.cpp \
 	source/DrawingPathItem.cpp \
@@ -32,16 +47,28 @@ SOURCES += \
 	source/DrawingTextPolygonItem.cpp \
 	source/DrawingTextRectItem.cpp \
 	source/DrawingScene.cpp \
+	source/DrawingSceneDiff.cpp \
+	source/DrawingSceneSync.cpp \
+	source/DrawingStyleDefaults.cpp \
+	source/DrawingThumbnailCache.cpp \
 	source/DrawingUndo.cpp \
 	source/DrawingView.cpp
 
 HEADERS += \
 	include/DrawingArcItem.h \
+	include/DrawingArena.h \
+	include/DrawingCacheManager.h \
 	include/DrawingCurveItem.h \
+	include/DrawingDocument.h \
 	include/DrawingEllipseItem.h \
+	include/DrawingImageExporter.h \
+	include/DrawingImporter.h \
 	include/DrawingItem.h \
+	include/DrawingItemFactory.h \
 	include/DrawingItemGroup.h \
 	include/DrawingItemPoint.h \
+	include/DrawingItemSource.h \
+	include/DrawingItemUpdate.h \
 	include/DrawingItemStyle.h \
 	include/DrawingLineItem.h \
 	include/DrawingPathItem.h \
@@ -53,6 +80,11 @@ HEADERS += \
 	include/DrawingTextPolygonItem.h \
 	include/DrawingTextRectItem.h \
 	include/DrawingScene.h \
+	include/DrawingSceneDiff.h \
+	include/DrawingSceneSync.h \
+	include/DrawingStoredPoint.h \
+	include/DrawingStyleDefaults.h \
+	include/DrawingThumbnailCache.h \
 	include/DrawingUndo.h \
 	include/DrawingView.h \
     include/Drawing.h
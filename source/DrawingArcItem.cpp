@@ -176,7 +176,7 @@ void DrawingArcItem::render(QPainter* painter)
 		qreal arcStartAngle = DrawingArcItem::arcStartAngle();
 
 		DrawingItemStyle* style = DrawingItem::style();
-		QPen pen = style->pen();
+		QPen pen = renderPen(style->pen());
 		DrawingItemStyle::ArrowStyle startArrowStyle = style->startArrowStyle();
 		DrawingItemStyle::ArrowStyle endArrowStyle = style->endArrowStyle();
 		qreal startArrowSize = style->startArrowSize();
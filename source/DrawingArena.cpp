@@ -0,0 +1,255 @@
+/* DrawingArena.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingArena.h"
+#include <cstdlib>
+#include <new>
+
+// Objects within a slab keep the alignment of operator new
+static const size_t kAlignment = 2 * sizeof(void*);
+
+struct DrawingArena::Slab
+{
+	// One reference for each live object plus one held by the arena while the slab is in use
+	QAtomicInt refCount;
+	char* data;
+	int size;
+};
+
+// Address ranges of all live slabs, so that deallocate() can tell slab memory from heap memory
+// without storing anything in front of each object.  The registry is never deleted, since objects
+// may still be deleted while other static objects are destroyed.
+struct DrawingArenaSlabRegistry
+{
+	QReadWriteLock lock;
+	QMap<quintptr,void*> slabs;
+};
+
+static DrawingArenaSlabRegistry* slabRegistry()
+{
+	static DrawingArenaSlabRegistry* registry = new DrawingArenaSlabRegistry();
+	return registry;
+}
+
+// Number of live slabs in all arenas; while it is zero, deallocate() skips the registry entirely
+static QAtomicInt liveSlabCount;
+
+// Arena used by allocate() on each thread, set by DrawingArenaScope
+static thread_local DrawingArena* threadArena = nullptr;
+
+//==================================================================================================
+
+DrawingArena::DrawingArena(int slabSize)
+{
+	mSlabSize = qMax(slabSize, 1024);
+	mSlab = nullptr;
+	mSlabOffset = 0;
+	mSlabCount = 0;
+}
+
+DrawingArena::~DrawingArena()
+{
+	if (mSlab) releaseSlab(mSlab);
+
+	for(auto slabIter = mFilledSlabs.begin(); slabIter != mFilledSlabs.end(); slabIter++)
+		releaseSlab(*slabIter);
+}
+
+//==================================================================================================
+
+int DrawingArena::slabSize() const
+{
+	return mSlabSize;
+}
+
+int DrawingArena::slabCount() const
+{
+	return mSlabCount;
+}
+
+void DrawingArena::releaseUnusedSlabs()
+{
+	QMutexLocker locker(&mMutex);
+
+	for(auto slabIter = mFilledSlabs.begin(); slabIter != mFilledSlabs.end(); )
+	{
+		if (isSlabUnused(*slabIter))
+		{
+			releaseSlab(*slabIter);
+			slabIter = mFilledSlabs.erase(slabIter);
+		}
+		else slabIter++;
+	}
+
+	if (mSlab && isSlabUnused(mSlab))
+	{
+		releaseSlab(mSlab);
+		mSlab = nullptr;
+		mSlabOffset = 0;
+	}
+}
+
+//==================================================================================================
+
+void* DrawingArena::allocate(size_t size)
+{
+	void* ptr = nullptr;
+
+	DrawingArena* arena = threadArena;
+	if (arena) ptr = arena->allocateFromSlab(size);
+
+	if (ptr == nullptr) ptr = ::operator new(size);
+
+	return ptr;
+}
+
+void DrawingArena::deallocate(void* ptr)
+{
+	if (ptr)
+	{
+		Slab* slab = (liveSlabCount.loadAcquire() > 0) ? findSlab(ptr) : nullptr;
+
+		if (slab)
+			releaseSlab(slab);
+		else
+			::operator delete(ptr);
+	}
+}
+
+DrawingArena* DrawingArena::current()
+{
+	return threadArena;
+}
+
+//==================================================================================================
+
+void* DrawingArena::allocateFromSlab(size_t size)
+{
+	size_t blockSize = (size + kAlignment - 1) / kAlignment * kAlignment;
+	if (blockSize > static_cast<size_t>(mSlabSize / 4)) return nullptr;
+
+	QMutexLocker locker(&mMutex);
+
+	// Once every object in the current slab has been deleted, its memory is reused from the start
+	if (mSlab && isSlabUnused(mSlab)) mSlabOffset = 0;
+
+	if (mSlab == nullptr || mSlabOffset + blockSize > static_cast<size_t>(mSlabSize))
+	{
+		// The arena keeps its reference on filled slabs so that they can be reused once empty
+		if (mSlab) mFilledSlabs.append(mSlab);
+		mSlab = nullptr;
+
+		for(int index = 0; mSlab == nullptr && index < mFilledSlabs.size(); index++)
+		{
+			if (isSlabUnused(mFilledSlabs.at(index))) mSlab = mFilledSlabs.takeAt(index);
+		}
+
+		if (mSlab == nullptr)
+		{
+			mSlab = new Slab();
+			mSlab->refCount.store(1);
+			mSlab->data = static_cast<char*>(std::malloc(mSlabSize));
+			mSlab->size = mSlabSize;
+
+			if (mSlab->data == nullptr)
+			{
+				delete mSlab;
+				mSlab = nullptr;
+				throw std::bad_alloc();
+			}
+
+			DrawingArenaSlabRegistry* registry = slabRegistry();
+			registry->lock.lockForWrite();
+			registry->slabs.insert(reinterpret_cast<quintptr>(mSlab->data), mSlab);
+			registry->lock.unlock();
+
+			liveSlabCount.ref();
+			mSlabCount++;
+		}
+
+		mSlabOffset = 0;
+	}
+
+	void* ptr = mSlab->data + mSlabOffset;
+	mSlab->refCount.ref();
+	mSlabOffset += static_cast<int>(blockSize);
+
+	return ptr;
+}
+
+DrawingArena::Slab* DrawingArena::findSlab(void* ptr)
+{
+	Slab* slab = nullptr;
+	quintptr address = reinterpret_cast<quintptr>(ptr);
+
+	DrawingArenaSlabRegistry* registry = slabRegistry();
+	registry->lock.lockForRead();
+
+	// The slab containing the address is the one with the highest start address not above it
+	auto slabIter = registry->slabs.upperBound(address);
+	if (slabIter != registry->slabs.begin())
+	{
+		slabIter--;
+
+		Slab* candidate = static_cast<Slab*>(slabIter.value());
+		if (address < slabIter.key() + static_cast<quintptr>(candidate->size)) slab = candidate;
+	}
+
+	registry->lock.unlock();
+
+	return slab;
+}
+
+bool DrawingArena::isSlabUnused(Slab* slab)
+{
+	// Only the arena's own reference remains.  New references are only added while the arena's
+	// mutex is held, so an unused slab cannot become used again behind the caller's back.
+	return (slab->refCount.loadAcquire() == 1);
+}
+
+void DrawingArena::releaseSlab(Slab* slab)
+{
+	if (!slab->refCount.deref())
+	{
+		DrawingArenaSlabRegistry* registry = slabRegistry();
+		registry->lock.lockForWrite();
+		registry->slabs.remove(reinterpret_cast<quintptr>(slab->data));
+		registry->lock.unlock();
+
+		liveSlabCount.deref();
+
+		std::free(slab->data);
+		delete slab;
+	}
+}
+
+//==================================================================================================
+//==================================================================================================
+
+DrawingArenaScope::DrawingArenaScope(DrawingArena* arena)
+{
+	mPreviousArena = threadArena;
+	threadArena = arena;
+}
+
+DrawingArenaScope::~DrawingArenaScope()
+{
+	threadArena = mPreviousArena;
+}
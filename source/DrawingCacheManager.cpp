@@ -0,0 +1,228 @@
+/* DrawingCacheManager.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingCacheManager.h"
+#include <algorithm>
+
+DrawingCache::DrawingCache(const QString& name, int priority, QObject* parent) : QObject(parent)
+{
+	mName = name;
+	mPriority = priority;
+	mCost = 0;
+	mLastUsed = 0;
+
+	DrawingCacheManager::instance()->addCache(this);
+}
+
+DrawingCache::~DrawingCache()
+{
+	DrawingCacheManager::instance()->removeCache(this);
+}
+
+//==================================================================================================
+
+QString DrawingCache::name() const
+{
+	return mName;
+}
+
+void DrawingCache::setPriority(int priority)
+{
+	DrawingCacheManager* manager = DrawingCacheManager::instance();
+	QMutexLocker locker(&manager->mMutex);
+	mPriority = priority;
+}
+
+int DrawingCache::priority() const
+{
+	DrawingCacheManager* manager = DrawingCacheManager::instance();
+	QMutexLocker locker(&manager->mMutex);
+	return mPriority;
+}
+
+void DrawingCache::setCost(qint64 bytes)
+{
+	DrawingCacheManager::instance()->updateCost(this, qMax(bytes, Q_INT64_C(0)));
+}
+
+qint64 DrawingCache::cost() const
+{
+	DrawingCacheManager* manager = DrawingCacheManager::instance();
+	QMutexLocker locker(&manager->mMutex);
+	return mCost;
+}
+
+void DrawingCache::touch()
+{
+	DrawingCacheManager::instance()->touchCache(this);
+}
+
+//==================================================================================================
+//==================================================================================================
+
+DrawingCacheManager::DrawingCacheManager() : QObject()
+{
+	mBudget = Q_INT64_C(256) * 1024 * 1024;
+	mTotalCost = 0;
+	mUseCount = 0;
+	mTrimScheduled = false;
+}
+
+DrawingCacheManager::~DrawingCacheManager() { }
+
+DrawingCacheManager* DrawingCacheManager::instance()
+{
+	static DrawingCacheManager manager;
+
+	// Trims are scheduled on the main thread's event loop, even if the first cache is created on
+	// a worker thread
+	QCoreApplication* application = QCoreApplication::instance();
+	if (application && manager.thread() == QThread::currentThread() && manager.thread() != application->thread())
+		manager.moveToThread(application->thread());
+
+	return &manager;
+}
+
+//==================================================================================================
+
+void DrawingCacheManager::setBudget(qint64 bytes)
+{
+	QMutexLocker locker(&mMutex);
+
+	mBudget = qMax(bytes, Q_INT64_C(0));
+
+	if (mTotalCost > mBudget && !mTrimScheduled)
+	{
+		mTrimScheduled = true;
+		QMetaObject::invokeMethod(this, "trim", Qt::QueuedConnection);
+	}
+}
+
+qint64 DrawingCacheManager::budget() const
+{
+	QMutexLocker locker(&mMutex);
+	return mBudget;
+}
+
+qint64 DrawingCacheManager::totalCost() const
+{
+	QMutexLocker locker(&mMutex);
+	return mTotalCost;
+}
+
+QList<DrawingCache*> DrawingCacheManager::caches() const
+{
+	QMutexLocker locker(&mMutex);
+	return mCaches;
+}
+
+//==================================================================================================
+
+qint64 DrawingCacheManager::reduceTo(qint64 bytes)
+{
+	QList< QPointer<DrawingCache> > caches;
+
+	mMutex.lock();
+
+	QList<DrawingCache*> sortedCaches = mCaches;
+	std::sort(sortedCaches.begin(), sortedCaches.end(), [](DrawingCache* cache1, DrawingCache* cache2) {
+		return (cache1->mPriority != cache2->mPriority) ? (cache1->mPriority < cache2->mPriority) :
+			(cache1->mLastUsed < cache2->mLastUsed);
+	});
+
+	// Only caches on this thread can be released safely
+	for(auto cacheIter = sortedCaches.begin(); cacheIter != sortedCaches.end(); cacheIter++)
+	{
+		if ((*cacheIter)->mCost > 0 && (*cacheIter)->thread() == QThread::currentThread())
+			caches.append(QPointer<DrawingCache>(*cacheIter));
+	}
+
+	qint64 totalCost = mTotalCost;
+	mMutex.unlock();
+
+	// Releasing a cache may delete other caches, so the signal is only emitted for caches that
+	// still exist
+	for(auto cacheIter = caches.begin(); totalCost > bytes && cacheIter != caches.end(); cacheIter++)
+	{
+		if (*cacheIter)
+		{
+			emit (*cacheIter)->releaseRequested(totalCost - bytes);
+			totalCost = DrawingCacheManager::totalCost();
+		}
+	}
+
+	return totalCost;
+}
+
+void DrawingCacheManager::clear()
+{
+	reduceTo(0);
+}
+
+//==================================================================================================
+
+void DrawingCacheManager::trim()
+{
+	mMutex.lock();
+	mTrimScheduled = false;
+	qint64 budget = mBudget;
+	mMutex.unlock();
+
+	reduceTo(budget);
+}
+
+//==================================================================================================
+
+void DrawingCacheManager::addCache(DrawingCache* cache)
+{
+	QMutexLocker locker(&mMutex);
+
+	cache->mLastUsed = ++mUseCount;
+	mCaches.append(cache);
+}
+
+void DrawingCacheManager::removeCache(DrawingCache* cache)
+{
+	QMutexLocker locker(&mMutex);
+
+	mCaches.removeAll(cache);
+	mTotalCost -= cache->mCost;
+	cache->mCost = 0;
+}
+
+void DrawingCacheManager::updateCost(DrawingCache* cache, qint64 bytes)
+{
+	QMutexLocker locker(&mMutex);
+
+	mTotalCost += bytes - cache->mCost;
+	cache->mCost = bytes;
+
+	if (mTotalCost > mBudget && !mTrimScheduled)
+	{
+		mTrimScheduled = true;
+		QMetaObject::invokeMethod(this, "trim", Qt::QueuedConnection);
+	}
+}
+
+void DrawingCacheManager::touchCache(DrawingCache* cache)
+{
+	QMutexLocker locker(&mMutex);
+	cache->mLastUsed = ++mUseCount;
+}
@@ -176,7 +176,7 @@ void DrawingCurveItem::render(QPainter* painter)
 		qreal lineLength = qSqrt((p2.x() - p1.x()) * (p2.x() - p1.x()) + (p2.y() - p1.y()) * (p2.y() - p1.y()));
 
 		DrawingItemStyle* style = DrawingItem::style();
-		QPen pen = style->pen();
+		QPen pen = renderPen(style->pen());
 		DrawingItemStyle::ArrowStyle startArrowStyle = style->startArrowStyle();
 		DrawingItemStyle::ArrowStyle endArrowStyle = style->endArrowStyle();
 		qreal startArrowSize = style->startArrowSize();
@@ -0,0 +1,717 @@
+/* DrawingDocument.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingDocument.h"
+#include "DrawingScene.h"
+#include "DrawingView.h"
+#include "DrawingItem.h"
+#include "DrawingItemPoint.h"
+#include "DrawingItemFactory.h"
+#include "DrawingArena.h"
+#include "DrawingStyleDefaults.h"
+
+static const quint32 documentFileMagic = 0x4A444F43;	// "JDOC"
+static const quint32 documentFileVersion = 1;
+static const quint32 pageFormatVersion = 1;
+
+struct DrawingDocumentConnection
+{
+	quint64 itemId1;
+	qint32 pointIndex1;
+	quint64 itemId2;
+	qint32 pointIndex2;
+};
+
+// Stands in for an item whose type is not registered with DrawingItemFactory, so that its record
+// can be written back unchanged when the page is released
+class DrawingUnregisteredItem : public DrawingItem
+{
+private:
+	QString mTypeName;
+	QByteArray mState;
+
+public:
+	DrawingUnregisteredItem(const QString& typeName, const QByteArray& state) : DrawingItem()
+	{
+		setFlags(DrawingItem::Flags());
+		mTypeName = typeName;
+		mState = state;
+	}
+
+	DrawingUnregisteredItem(const DrawingUnregisteredItem& item) : DrawingItem(item)
+	{
+		mTypeName = item.mTypeName;
+		mState = item.mState;
+	}
+
+	DrawingItem* copy() const
+	{
+		return new DrawingUnregisteredItem(*this);
+	}
+
+	QRectF boundingRect() const
+	{
+		return QRectF();
+	}
+
+	void render(QPainter* painter)
+	{
+		Q_UNUSED(painter);
+	}
+
+	void writeRecord(QDataStream& stream) const
+	{
+		stream << mTypeName << id() << mState;
+	}
+};
+
+//==================================================================================================
+
+static DrawingItem* topLevelItem(DrawingItem* item)
+{
+	while (item && item->parent()) item = item->parent();
+	return item;
+}
+
+static void findConnections(DrawingScene* scene, DrawingItem* item, QVector<DrawingDocumentConnection>& connections)
+{
+	QList<DrawingItemPoint*> points = item->points();
+	QList<DrawingItemPoint*> pointConnections;
+	DrawingDocumentConnection connection;
+	DrawingItem* otherItem;
+	int otherIndex;
+
+	for(int index = 0; index < points.size(); index++)
+	{
+		pointConnections = points[index]->connections();
+
+		for(auto connectionIter = pointConnections.begin(); connectionIter != pointConnections.end(); connectionIter++)
+		{
+			otherItem = (*connectionIter)->item();
+			if (otherItem == nullptr || topLevelItem(otherItem)->scene() != scene) continue;
+
+			otherIndex = otherItem->points().indexOf(*connectionIter);
+
+			// Each connection is seen from both of its points; only keep it once
+			if (otherItem->id() < item->id() || (otherItem->id() == item->id() && otherIndex < index))
+				continue;
+
+			connection.itemId1 = item->id();
+			connection.pointIndex1 = index;
+			connection.itemId2 = otherItem->id();
+			connection.pointIndex2 = otherIndex;
+			connections.append(connection);
+		}
+	}
+
+	QList<DrawingItem*> children = item->children();
+	for(auto childIter = children.begin(); childIter != children.end(); childIter++)
+		findConnections(scene, *childIter, connections);
+}
+
+static DrawingItemPoint* itemPoint(DrawingScene* scene, quint64 itemId, int pointIndex)
+{
+	DrawingItemPoint* point = nullptr;
+
+	DrawingItem* item = scene->itemFromId(itemId);
+	if (item)
+	{
+		QList<DrawingItemPoint*> points = item->points();
+		if (0 <= pointIndex && pointIndex < points.size()) point = points[pointIndex];
+	}
+
+	return point;
+}
+
+//==================================================================================================
+
+DrawingPageVisitor::~DrawingPageVisitor() { }
+
+void DrawingPageVisitor::visitPage(int pageIndex, const QString& pageName)
+{
+	Q_UNUSED(pageIndex);
+	Q_UNUSED(pageName);
+}
+
+void DrawingPageVisitor::visitConnection(int pageIndex, quint64 itemId1, int pointIndex1,
+	quint64 itemId2, int pointIndex2)
+{
+	Q_UNUSED(pageIndex);
+	Q_UNUSED(itemId1);
+	Q_UNUSED(pointIndex1);
+	Q_UNUSED(itemId2);
+	Q_UNUSED(pointIndex2);
+}
+
+//==================================================================================================
+//==================================================================================================
+
+DrawingDocument::DrawingDocument(QObject* parent) : QObject(parent)
+{
+	mMappedFile = nullptr;
+}
+
+DrawingDocument::~DrawingDocument()
+{
+	blockSignals(true);
+
+	clearPages();
+	closeMappedFile();
+}
+
+//==================================================================================================
+
+int DrawingDocument::addPage(const QString& name)
+{
+	insertPage(mPages.size(), name);
+	return mPages.size() - 1;
+}
+
+void DrawingDocument::insertPage(int index, const QString& name)
+{
+	Page* page = new Page();
+	page->name = name;
+	page->scene = nullptr;
+	page->activeCount = 0;
+	page->activationCount = 0;
+	page->mapped = false;
+
+	if (index < 0 || index > mPages.size()) index = mPages.size();
+	mPages.insert(index, page);
+
+	emit pageCountChanged(mPages.size());
+}
+
+void DrawingDocument::removePage(int index)
+{
+	if (0 <= index && index < mPages.size())
+	{
+		deletePage(mPages.takeAt(index));
+		emit pageCountChanged(mPages.size());
+	}
+}
+
+void DrawingDocument::clearPages()
+{
+	if (!mPages.isEmpty())
+	{
+		while (!mPages.isEmpty()) deletePage(mPages.takeFirst());
+		emit pageCountChanged(0);
+	}
+}
+
+int DrawingDocument::pageCount() const
+{
+	return mPages.size();
+}
+
+void DrawingDocument::setPageName(int index, const QString& name)
+{
+	if (0 <= index && index < mPages.size()) mPages[index]->name = name;
+}
+
+QString DrawingDocument::pageName(int index) const
+{
+	return (0 <= index && index < mPages.size()) ? mPages[index]->name : QString();
+}
+
+//==================================================================================================
+
+void DrawingDocument::showPage(DrawingView* view, int index)
+{
+	if (view && 0 <= index && index < mPages.size())
+	{
+		Page* page = mPages[index];
+		Page* previousPage = mViewPages.value(view, nullptr);
+
+		if (page != previousPage)
+		{
+			activate(page);
+
+			// Setting the scene deletes the view's own scene before ViewOwnsScene is cleared
+			view->setScene(page->scene);
+			view->setFlags(view->flags() & (~DrawingView::ViewOwnsScene));
+			mViewPages.insert(view, page);
+
+			if (previousPage)
+				release(previousPage);
+			else
+				connect(view, SIGNAL(destroyed(QObject*)), this, SLOT(releaseDestroyedView(QObject*)));
+		}
+	}
+}
+
+void DrawingDocument::releaseView(DrawingView* view)
+{
+	Page* page = mViewPages.take(view);
+
+	if (page)
+	{
+		disconnect(view, SIGNAL(destroyed(QObject*)), this, SLOT(releaseDestroyedView(QObject*)));
+		view->setScene(nullptr);
+		release(page);
+	}
+}
+
+int DrawingDocument::shownPage(DrawingView* view) const
+{
+	Page* page = mViewPages.value(view, nullptr);
+	return (page) ? mPages.indexOf(page) : -1;
+}
+
+//==================================================================================================
+
+DrawingScene* DrawingDocument::activatePage(int index)
+{
+	DrawingScene* scene = nullptr;
+
+	if (0 <= index && index < mPages.size())
+	{
+		mPages[index]->activationCount++;
+		activate(mPages[index]);
+		scene = mPages[index]->scene;
+	}
+
+	return scene;
+}
+
+void DrawingDocument::deactivatePage(int index)
+{
+	// Only activations are released here; views release their pages through releaseView()
+	if (0 <= index && index < mPages.size() && mPages[index]->activationCount > 0)
+	{
+		mPages[index]->activationCount--;
+		release(mPages[index]);
+	}
+}
+
+bool DrawingDocument::isPageActive(int index) const
+{
+	return (0 <= index && index < mPages.size() && mPages[index]->scene);
+}
+
+DrawingScene* DrawingDocument::pageScene(int index) const
+{
+	return (0 <= index && index < mPages.size()) ? mPages[index]->scene : nullptr;
+}
+
+//==================================================================================================
+
+QByteArray DrawingDocument::pageData(int index) const
+{
+	QByteArray data;
+
+	if (0 <= index && index < mPages.size())
+	{
+		data = (mPages[index]->scene) ?
+			writeScene(mPages[index]->scene, mPages[index]->unresolvedConnections) : mPages[index]->data;
+	}
+
+	return data;
+}
+
+void DrawingDocument::visitPages(DrawingPageVisitor* visitor) const
+{
+	if (visitor)
+	{
+		for(int index = 0; index < mPages.size(); index++)
+		{
+			visitor->visitPage(index, mPages[index]->name);
+			readPage(visitor, index, pageData(index));
+		}
+	}
+}
+
+//==================================================================================================
+
+bool DrawingDocument::save(const QString& fileName)
+{
+	// The pages must not refer to a mapped file that is about to be replaced
+	if (mMappedFile && QFileInfo(mMappedFile->fileName()) == QFileInfo(fileName)) closeMappedFile();
+
+	QSaveFile file(fileName);
+	bool success = file.open(QIODevice::WriteOnly);
+
+	if (success)
+	{
+		QDataStream stream(&file);
+		stream.setVersion(QDataStream::Qt_5_0);
+
+		stream << documentFileMagic << documentFileVersion << static_cast<quint32>(mPages.size());
+
+		for(int index = 0; index < mPages.size(); index++)
+		{
+			QByteArray data = pageData(index);
+
+			stream << mPages[index]->name << static_cast<quint32>(data.size());
+			stream.writeRawData(data.constData(), data.size());
+		}
+
+		success = (stream.status() == QDataStream::Ok && file.commit());
+	}
+
+	mErrorString = (success) ? QString() : file.errorString();
+	return success;
+}
+
+bool DrawingDocument::open(const QString& fileName)
+{
+	clearPages();
+	closeMappedFile();
+
+	QFile* file = new QFile(fileName);
+	bool success = file->open(QIODevice::ReadOnly);
+
+	if (success)
+	{
+		const char* mappedData = reinterpret_cast<const char*>(file->map(0, file->size()));
+
+		QDataStream stream(file);
+		stream.setVersion(QDataStream::Qt_5_0);
+
+		quint32 magic = 0, version = 0, count = 0;
+		stream >> magic >> version >> count;
+
+		success = (magic == documentFileMagic && version == documentFileVersion);
+		if (!success) mErrorString = "Not a valid document file: " + fileName;
+
+		QString name;
+		quint32 size = 0;
+		qint64 offset;
+		Page* page;
+
+		for(quint32 index = 0; success && index < count; index++)
+		{
+			stream >> name >> size;
+			offset = file->pos();
+
+			page = new Page();
+			page->name = name;
+			page->scene = nullptr;
+			page->activeCount = 0;
+			page->activationCount = 0;
+			page->mapped = (mappedData && offset + size <= file->size());
+
+			// A corrupt size must not allocate more than the rest of the file
+			if (offset + size > file->size())
+			{
+				delete page;
+				mErrorString = "Unexpected end of document file: " + fileName;
+				success = false;
+				break;
+			}
+
+			if (page->mapped)
+			{
+				// Inactive pages refer directly to the mapped file until they are activated
+				page->data = QByteArray::fromRawData(mappedData + offset, size);
+				stream.skipRawData(size);
+			}
+			else
+			{
+				page->data.resize(size);
+				stream.readRawData(page->data.data(), size);
+			}
+
+			mPages.append(page);
+
+			success = (stream.status() == QDataStream::Ok);
+			if (!success) mErrorString = "Unexpected end of document file: " + fileName;
+		}
+
+		if (!success) clearPages();
+
+		if (success && mappedData)
+			mMappedFile = file;
+		else
+			delete file;
+	}
+	else
+	{
+		mErrorString = file->errorString();
+		delete file;
+	}
+
+	emit pageCountChanged(mPages.size());
+
+	return success;
+}
+
+QString DrawingDocument::errorString() const
+{
+	return mErrorString;
+}
+
+//==================================================================================================
+
+void DrawingDocument::releaseDestroyedView(QObject* object)
+{
+	// The view is already destroyed, so its page is found by address only
+	for(auto viewIter = mViewPages.begin(); viewIter != mViewPages.end(); viewIter++)
+	{
+		if (static_cast<QObject*>(viewIter.key()) == object)
+		{
+			Page* page = viewIter.value();
+			mViewPages.erase(viewIter);
+			release(page);
+			break;
+		}
+	}
+}
+
+//==================================================================================================
+
+void DrawingDocument::activate(Page* page)
+{
+	page->activeCount++;
+
+	if (page->scene == nullptr)
+	{
+		page->scene = readScene(page->data, page->unresolvedConnections);
+		emit pageActivated(mPages.indexOf(page));
+	}
+}
+
+void DrawingDocument::release(Page* page)
+{
+	page->activeCount--;
+
+	if (page->activeCount <= 0 && page->scene)
+	{
+		emit pageDeactivated(mPages.indexOf(page));
+
+		page->data = writeScene(page->scene, page->unresolvedConnections);
+		page->mapped = false;
+		page->activeCount = 0;
+
+		delete page->scene;
+		page->scene = nullptr;
+	}
+}
+
+void DrawingDocument::deletePage(Page* page)
+{
+	for(auto viewIter = mViewPages.begin(); viewIter != mViewPages.end(); )
+	{
+		if (viewIter.value() == page)
+		{
+			disconnect(viewIter.key(), SIGNAL(destroyed(QObject*)), this, SLOT(releaseDestroyedView(QObject*)));
+			viewIter.key()->setScene(nullptr);
+			viewIter = mViewPages.erase(viewIter);
+		}
+		else viewIter++;
+	}
+
+	delete page->scene;
+	delete page;
+}
+
+void DrawingDocument::closeMappedFile()
+{
+	if (mMappedFile)
+	{
+		// Copy any pages that still refer to the mapped file
+		for(auto pageIter = mPages.begin(); pageIter != mPages.end(); pageIter++)
+		{
+			if ((*pageIter)->mapped)
+			{
+				(*pageIter)->data = QByteArray((*pageIter)->data.constData(), (*pageIter)->data.size());
+				(*pageIter)->mapped = false;
+			}
+		}
+
+		delete mMappedFile;
+		mMappedFile = nullptr;
+	}
+}
+
+//==================================================================================================
+
+QByteArray DrawingDocument::writeScene(DrawingScene* scene, const QByteArray& unresolvedConnections)
+{
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	QList<DrawingItem*> items = scene->items();
+	QVector<DrawingDocumentConnection> connections;
+	DrawingUnregisteredItem* unregisteredItem;
+	bool hasUnregisteredItems = false;
+
+	stream << pageFormatVersion << scene->sceneRect() << scene->backgroundBrush();
+
+	stream << static_cast<quint32>(items.size());
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+	{
+		unregisteredItem = dynamic_cast<DrawingUnregisteredItem*>(*itemIter);
+		if (unregisteredItem)
+		{
+			unregisteredItem->writeRecord(stream);
+			hasUnregisteredItems = true;
+		}
+		else DrawingItemFactory::writeItem(stream, *itemIter);
+
+		findConnections(scene, *itemIter, connections);
+	}
+
+	// Connections to the points of unregistered items are kept for as long as any of them remain
+	QDataStream connectionStream(unresolvedConnections);
+	connectionStream.setVersion(QDataStream::Qt_5_0);
+	DrawingDocumentConnection connection;
+
+	while (hasUnregisteredItems && !connectionStream.atEnd())
+	{
+		connectionStream >> connection.itemId1 >> connection.pointIndex1 >> connection.itemId2 >> connection.pointIndex2;
+		if (connectionStream.status() == QDataStream::Ok) connections.append(connection);
+	}
+
+	stream << static_cast<quint32>(connections.size());
+	for(auto connectionIter = connections.begin(); connectionIter != connections.end(); connectionIter++)
+	{
+		stream << connectionIter->itemId1 << connectionIter->pointIndex1
+			<< connectionIter->itemId2 << connectionIter->pointIndex2;
+	}
+
+	return data;
+}
+
+DrawingScene* DrawingDocument::readScene(const QByteArray& data, QByteArray& unresolvedConnections)
+{
+	DrawingScene* scene = new DrawingScene();
+
+	// All of the page's items are released together when the page is deactivated
+	scene->setItemArenaEnabled(true);
+	DrawingArenaScope arenaScope(scene->itemArena());
+	DrawingStyleDefaultsScope defaultsScope(scene->styleDefaults());
+
+	QDataStream stream(data);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	quint32 version = 0;
+	stream >> version;
+
+	if (version == pageFormatVersion)
+	{
+		QRectF sceneRect;
+		QBrush backgroundBrush;
+		quint32 count = 0;
+		DrawingItem* item;
+
+		stream >> sceneRect >> backgroundBrush;
+		scene->setSceneRect(sceneRect);
+		scene->setBackgroundBrush(backgroundBrush);
+
+		// Items are read in the format written by DrawingItemFactory::writeItem()
+		QString typeName;
+		quint64 itemId = 0;
+		QByteArray state;
+
+		stream >> count;
+		for(quint32 index = 0; index < count && stream.status() == QDataStream::Ok; index++)
+		{
+			stream >> typeName >> itemId >> state;
+			if (stream.status() != QDataStream::Ok) break;
+
+			item = DrawingItemFactory::createItem(typeName);
+			if (item)
+			{
+				QDataStream stateStream(state);
+				stateStream.setVersion(stream.version());
+				item->readState(stateStream);
+			}
+			else item = new DrawingUnregisteredItem(typeName, state);
+
+			item->setId(itemId);
+			scene->addItem(item);
+		}
+
+		DrawingDocumentConnection connection;
+		DrawingItemPoint* point1;
+		DrawingItemPoint* point2;
+
+		QDataStream connectionStream(&unresolvedConnections, QIODevice::WriteOnly);
+		connectionStream.setVersion(QDataStream::Qt_5_0);
+
+		stream >> count;
+		for(quint32 index = 0; index < count && stream.status() == QDataStream::Ok; index++)
+		{
+			stream >> connection.itemId1 >> connection.pointIndex1 >> connection.itemId2 >> connection.pointIndex2;
+
+			point1 = itemPoint(scene, connection.itemId1, connection.pointIndex1);
+			point2 = itemPoint(scene, connection.itemId2, connection.pointIndex2);
+
+			if (point1 && point2)
+			{
+				if (!point1->isConnected(point2)) scene->connectItemPoints(point1, point2);
+			}
+			else if (stream.status() == QDataStream::Ok)
+			{
+				connectionStream << connection.itemId1 << connection.pointIndex1
+					<< connection.itemId2 << connection.pointIndex2;
+			}
+		}
+	}
+
+	return scene;
+}
+
+void DrawingDocument::readPage(DrawingPageVisitor* visitor, int pageIndex, const QByteArray& data)
+{
+	QDataStream stream(data);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	quint32 version = 0;
+	stream >> version;
+
+	if (version == pageFormatVersion)
+	{
+		QRectF sceneRect;
+		QBrush backgroundBrush;
+		quint32 count = 0;
+
+		stream >> sceneRect >> backgroundBrush;
+
+		// Items are read in the format written by DrawingItemFactory::writeItem()
+		QString typeName;
+		quint64 itemId = 0;
+		QByteArray state;
+
+		stream >> count;
+		for(quint32 index = 0; index < count && stream.status() == QDataStream::Ok; index++)
+		{
+			stream >> typeName >> itemId >> state;
+			if (stream.status() == QDataStream::Ok) visitor->visitItem(pageIndex, typeName, itemId, state);
+		}
+
+		DrawingDocumentConnection connection;
+
+		stream >> count;
+		for(quint32 index = 0; index < count && stream.status() == QDataStream::Ok; index++)
+		{
+			stream >> connection.itemId1 >> connection.pointIndex1 >> connection.itemId2 >> connection.pointIndex2;
+
+			if (stream.status() == QDataStream::Ok)
+			{
+				visitor->visitConnection(pageIndex, connection.itemId1, connection.pointIndex1,
+					connection.itemId2, connection.pointIndex2);
+			}
+		}
+	}
+}
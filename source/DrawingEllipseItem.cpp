@@ -145,7 +145,7 @@ void DrawingEllipseItem::render(QPainter* painter)
 		QPen scenePen = painter->pen();
 
 		DrawingItemStyle* style = DrawingItem::style();
-		QPen pen = style->pen();
+		QPen pen = renderPen(style->pen());
 		QBrush brush = style->brush();
 
 		// Draw ellipse
@@ -0,0 +1,689 @@
+/* DrawingImageExporter.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingImageExporter.h"
+#include "DrawingScene.h"
+
+#ifdef JADE_SYSTEM_ZLIB
+#include <zlib.h>
+#else
+#include <QtZlib/zlib.h>
+#endif
+
+class DrawingImageBandRenderer : public QRunnable
+{
+private:
+	DrawingScene* mScene;
+	QRectF mSceneRect;
+	QSize mImageSize;
+	int mTop, mHeight;
+	QColor mBackgroundColor;
+	bool mAlpha;
+
+	QImage* mBand;
+	QSemaphore* mReady;
+	const QAtomicInt* mCanceled;
+
+public:
+	DrawingImageBandRenderer(DrawingScene* scene, const QRectF& sceneRect, const QSize& imageSize,
+		int top, int height, bool alpha, QImage* band, QSemaphore* ready, const QAtomicInt* canceled)
+	{
+		mScene = scene;
+		mSceneRect = sceneRect;
+		mImageSize = imageSize;
+		mTop = top;
+		mHeight = height;
+		mBackgroundColor = scene->backgroundBrush().color();
+		mAlpha = alpha;
+		mBand = band;
+		mReady = ready;
+		mCanceled = canceled;
+	}
+
+	void run()
+	{
+		if (mCanceled->loadAcquire() == 0)
+		{
+			QImage image(mImageSize.width(), mHeight, QImage::Format_ARGB32_Premultiplied);
+
+			// A null band tells the writer that the band could not be allocated
+			if (!image.isNull())
+			{
+				image.fill(mBackgroundColor);
+
+				QPainter painter(&image);
+				painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing |
+					QPainter::SmoothPixmapTransform);
+				painter.translate(0, -mTop);
+				painter.scale(mImageSize.width() / mSceneRect.width(), mImageSize.height() / mSceneRect.height());
+				painter.translate(-mSceneRect.topLeft());
+
+				mScene->render(&painter);
+
+				painter.end();
+
+				*mBand = image.convertToFormat(mAlpha ? QImage::Format_RGBA8888 : QImage::Format_RGB888);
+			}
+		}
+
+		mReady->release();
+	}
+};
+
+//==================================================================================================
+
+class DrawingImageStreamWriter
+{
+protected:
+	QIODevice* mDevice;
+	QSize mImageSize;
+	bool mAlpha;
+	int mDotsPerInch;
+	int mRowsPerBand;
+
+public:
+	DrawingImageStreamWriter(QIODevice* device, const QSize& imageSize, bool alpha, int dpi, int rowsPerBand)
+	{
+		mDevice = device;
+		mImageSize = imageSize;
+		mAlpha = alpha;
+		mDotsPerInch = dpi;
+		mRowsPerBand = rowsPerBand;
+	}
+
+	virtual ~DrawingImageStreamWriter() { }
+
+	virtual bool writeHeader() = 0;
+	virtual bool writeBand(const QImage& band) = 0;
+	virtual bool writeTrailer() = 0;
+
+protected:
+	int bytesPerRow() const
+	{
+		return mImageSize.width() * (mAlpha ? 4 : 3);
+	}
+
+	bool write(const QByteArray& data)
+	{
+		return (mDevice->write(data) == data.size());
+	}
+
+	static void appendLittleEndian(QByteArray& data, quint64 value, int bytes)
+	{
+		for(int i = 0; i < bytes; i++) data.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+	}
+
+	static void appendBigEndian(QByteArray& data, quint64 value, int bytes)
+	{
+		for(int i = bytes - 1; i >= 0; i--) data.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+	}
+};
+
+//==================================================================================================
+
+class DrawingPngStreamWriter : public DrawingImageStreamWriter
+{
+private:
+	z_stream mStream;
+	bool mStreamValid;
+	int mRowsWritten;
+	QByteArray mPreviousRow;
+	QByteArray mFilteredRow;
+	QByteArray mOutput;
+
+public:
+	DrawingPngStreamWriter(QIODevice* device, const QSize& imageSize, bool alpha, int dpi, int rowsPerBand) :
+		DrawingImageStreamWriter(device, imageSize, alpha, dpi, rowsPerBand)
+	{
+		memset(&mStream, 0, sizeof(mStream));
+		mStreamValid = (deflateInit(&mStream, Z_DEFAULT_COMPRESSION) == Z_OK);
+		mRowsWritten = 0;
+	}
+
+	~DrawingPngStreamWriter()
+	{
+		if (mStreamValid) deflateEnd(&mStream);
+	}
+
+	bool writeHeader()
+	{
+		if (!mStreamValid) return false;
+
+		QByteArray header;
+		appendBigEndian(header, mImageSize.width(), 4);
+		appendBigEndian(header, mImageSize.height(), 4);
+		header.append(static_cast<char>(8));					// bit depth
+		header.append(static_cast<char>(mAlpha ? 6 : 2));		// color type: RGBA or RGB
+		header.append(static_cast<char>(0));					// compression method
+		header.append(static_cast<char>(0));					// filter method
+		header.append(static_cast<char>(0));					// interlace method
+
+		QByteArray physical;
+		quint32 pixelsPerMeter = static_cast<quint32>(qRound(mDotsPerInch / 0.0254));
+		appendBigEndian(physical, pixelsPerMeter, 4);
+		appendBigEndian(physical, pixelsPerMeter, 4);
+		physical.append(static_cast<char>(1));					// unit is meters
+
+		// Rows are filtered and compressed one at a time, so no buffer grows with the band size
+		const int rowSize = bytesPerRow();
+		mPreviousRow.fill(0, rowSize);
+		mFilteredRow.resize(rowSize + 1);
+		mOutput.resize(outputChunkSize);
+
+		return (write(QByteArray("\x89PNG\r\n\x1A\n", 8)) &&
+			writeChunk("IHDR", header) && writeChunk("pHYs", physical));
+	}
+
+	bool writeBand(const QImage& band)
+	{
+		const int rowSize = bytesPerRow();
+		bool success = true;
+
+		for(int y = 0; success && y < band.height(); y++)
+		{
+			// The Up filter stores each byte as the difference from the byte above it, which turns
+			// the large flat areas typical of drawings into runs of zeros
+			const quint8* row = band.constScanLine(y);
+			const quint8* previousRow = reinterpret_cast<const quint8*>(mPreviousRow.constData());
+			quint8* filteredRow = reinterpret_cast<quint8*>(mFilteredRow.data());
+
+			filteredRow[0] = 2;
+			for(int i = 0; i < rowSize; i++) filteredRow[i + 1] = static_cast<quint8>(row[i] - previousRow[i]);
+			memcpy(mPreviousRow.data(), row, rowSize);
+
+			mStream.next_in = filteredRow;
+			mStream.avail_in = static_cast<uInt>(rowSize + 1);
+			success = deflateData(Z_NO_FLUSH);
+		}
+
+		mRowsWritten += band.height();
+
+		// The image data of all bands forms a single zlib stream, which is only finished after
+		// the last row
+		if (success && mRowsWritten >= mImageSize.height()) success = deflateData(Z_FINISH);
+
+		return success;
+	}
+
+	bool writeTrailer()
+	{
+		return writeChunk("IEND", QByteArray());
+	}
+
+private:
+	static const int outputChunkSize = 0x10000;
+
+	bool deflateData(int flush)
+	{
+		bool success = true;
+		int result = Z_OK;
+
+		do
+		{
+			mStream.next_out = reinterpret_cast<Bytef*>(mOutput.data());
+			mStream.avail_out = static_cast<uInt>(mOutput.size());
+
+			result = deflate(&mStream, flush);
+			success = (result == Z_OK || result == Z_STREAM_END || result == Z_BUF_ERROR);
+
+			int outputSize = mOutput.size() - static_cast<int>(mStream.avail_out);
+			if (success && outputSize > 0) success = writeChunk("IDAT", mOutput.left(outputSize));
+		}
+		while (success && (mStream.avail_in > 0 || (flush == Z_FINISH && result != Z_STREAM_END)));
+
+		return success;
+	}
+
+	bool writeChunk(const char* type, const QByteArray& data)
+	{
+		QByteArray chunk;
+		chunk.reserve(data.size() + 12);
+		appendBigEndian(chunk, data.size(), 4);
+		chunk.append(type, 4);
+		chunk.append(data);
+		appendBigEndian(chunk, crc32(chunk.constData() + 4, chunk.size() - 4), 4);
+
+		return write(chunk);
+	}
+
+	static quint32 crc32(const char* data, int size)
+	{
+		static const QVector<quint32> table = crcTable();
+
+		quint32 crc = 0xFFFFFFFF;
+		for(int i = 0; i < size; i++)
+			crc = table[(crc ^ static_cast<quint8>(data[i])) & 0xFF] ^ (crc >> 8);
+
+		return crc ^ 0xFFFFFFFF;
+	}
+
+	static QVector<quint32> crcTable()
+	{
+		QVector<quint32> table(256);
+
+		for(quint32 n = 0; n < 256; n++)
+		{
+			quint32 c = n;
+			for(int k = 0; k < 8; k++) c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+			table[n] = c;
+		}
+
+		return table;
+	}
+};
+
+//==================================================================================================
+
+class DrawingTiffStreamWriter : public DrawingImageStreamWriter
+{
+private:
+	struct Entry
+	{
+		quint16 tag;
+		quint16 type;
+		quint64 count;
+		QByteArray value;
+	};
+
+	enum FieldType { Short = 3, Long = 4, Rational = 5, Long8 = 16 };
+
+public:
+	DrawingTiffStreamWriter(QIODevice* device, const QSize& imageSize, bool alpha, int dpi, int rowsPerBand) :
+		DrawingImageStreamWriter(device, imageSize, alpha, dpi, rowsPerBand) { }
+
+	bool writeHeader()
+	{
+		// The strip layout is known in advance because strips are uncompressed, so the entire
+		// header can be written before any image data is rendered.  BigTIFF is only used when the
+		// offsets would not fit into 32 bits.
+		quint64 stripCount = (mImageSize.height() + mRowsPerBand - 1) / mRowsPerBand;
+		quint64 dataSize = static_cast<quint64>(bytesPerRow()) * mImageSize.height();
+		bool bigTiff = (dataSize + stripCount * 16 + 4096 > Q_UINT64_C(0xFFFFFFFF));
+
+		QByteArray header = buildHeader(0, bigTiff);
+		return write(buildHeader(header.size(), bigTiff));
+	}
+
+	bool writeBand(const QImage& band)
+	{
+		const int rowSize = bytesPerRow();
+		bool success = true;
+
+		for(int y = 0; success && y < band.height(); y++)
+		{
+			success = (mDevice->write(reinterpret_cast<const char*>(band.constScanLine(y)), rowSize) == rowSize);
+		}
+
+		return success;
+	}
+
+	bool writeTrailer()
+	{
+		return true;
+	}
+
+private:
+	QByteArray buildHeader(quint64 dataOffset, bool bigTiff) const
+	{
+		const int samplesPerPixel = (mAlpha ? 4 : 3);
+		const quint64 rowSize = bytesPerRow();
+		const int stripCount = (mImageSize.height() + mRowsPerBand - 1) / mRowsPerBand;
+		const int offsetSize = (bigTiff ? 8 : 4);
+		QList<Entry> entries;
+		QByteArray value;
+
+		entries.append(entry(256, Long, mImageSize.width()));						// ImageWidth
+		entries.append(entry(257, Long, mImageSize.height()));						// ImageLength
+
+		value.clear();
+		for(int i = 0; i < samplesPerPixel; i++) appendLittleEndian(value, 8, 2);
+		entries.append(entry(258, Short, samplesPerPixel, value));	// BitsPerSample
+
+		entries.append(entry(259, Short, 1));										// Compression: none
+		entries.append(entry(262, Short, 2));										// Photometric: RGB
+
+		value.clear();
+		for(int i = 0; i < stripCount; i++)
+			appendLittleEndian(value, dataOffset + i * mRowsPerBand * rowSize, offsetSize);
+		entries.append(entry(273, bigTiff ? Long8 : Long, stripCount, value));	// StripOffsets
+
+		entries.append(entry(277, Short, samplesPerPixel));						// SamplesPerPixel
+		entries.append(entry(278, Long, mRowsPerBand));							// RowsPerStrip
+
+		value.clear();
+		for(int i = 0; i < stripCount; i++)
+			appendLittleEndian(value, qMin(mRowsPerBand, mImageSize.height() - i * mRowsPerBand) * rowSize, offsetSize);
+		entries.append(entry(279, bigTiff ? Long8 : Long, stripCount, value));	// StripByteCounts
+
+		value.clear();
+		appendLittleEndian(value, mDotsPerInch, 4);
+		appendLittleEndian(value, 1, 4);
+		entries.append(entry(282, Rational, 1, value));								// XResolution
+		entries.append(entry(283, Rational, 1, value));								// YResolution
+
+		entries.append(entry(284, Short, 1));										// PlanarConfiguration: chunky
+		entries.append(entry(296, Short, 2));										// ResolutionUnit: inch
+		if (mAlpha) entries.append(entry(338, Short, 2));							// ExtraSamples: unassociated alpha
+
+		// Header
+		QByteArray header("II", 2);
+		if (bigTiff)
+		{
+			appendLittleEndian(header, 43, 2);
+			appendLittleEndian(header, 8, 2);
+			appendLittleEndian(header, 0, 2);
+			appendLittleEndian(header, 16, 8);
+		}
+		else
+		{
+			appendLittleEndian(header, 42, 2);
+			appendLittleEndian(header, 8, 4);
+		}
+
+		// Image file directory, with values that do not fit into an entry stored after it
+		const int inlineSize = offsetSize;
+		const int entrySize = (bigTiff ? 20 : 12);
+		const int countSize = (bigTiff ? 8 : 2);
+		quint64 externalOffset = header.size() + countSize + entries.size() * entrySize + offsetSize;
+		QByteArray external;
+
+		appendLittleEndian(header, entries.size(), countSize);
+		for(auto entryIter = entries.begin(); entryIter != entries.end(); entryIter++)
+		{
+			appendLittleEndian(header, entryIter->tag, 2);
+			appendLittleEndian(header, entryIter->type, 2);
+			appendLittleEndian(header, entryIter->count, offsetSize);
+
+			if (entryIter->value.size() <= inlineSize)
+			{
+				header.append(entryIter->value);
+				header.append(QByteArray(inlineSize - entryIter->value.size(), 0));
+			}
+			else
+			{
+				appendLittleEndian(header, externalOffset + external.size(), offsetSize);
+				external.append(entryIter->value);
+				if (external.size() % 2 != 0) external.append(static_cast<char>(0));
+			}
+		}
+		appendLittleEndian(header, 0, offsetSize);
+
+		header.append(external);
+		return header;
+	}
+
+	static Entry entry(quint16 tag, FieldType type, quint64 count, const QByteArray& value)
+	{
+		Entry entry;
+		entry.tag = tag;
+		entry.type = static_cast<quint16>(type);
+		entry.count = count;
+		entry.value = value;
+		return entry;
+	}
+
+	static Entry entry(quint16 tag, FieldType type, quint32 value)
+	{
+		QByteArray data;
+		appendLittleEndian(data, value, (type == Short) ? 2 : 4);
+		return entry(tag, type, 1, data);
+	}
+};
+
+//==================================================================================================
+
+DrawingImageExporter::DrawingImageExporter(DrawingScene* scene, QObject* parent) : QObject(parent)
+{
+	mScene = scene;
+
+	mDotsPerInch = 96;
+
+	mBandHeight = 256;
+	mMaximumThreadCount = QThread::idealThreadCount();
+}
+
+DrawingImageExporter::~DrawingImageExporter() { }
+
+//==================================================================================================
+
+void DrawingImageExporter::setSceneRect(const QRectF& rect)
+{
+	mSceneRect = rect;
+}
+
+QRectF DrawingImageExporter::sceneRect() const
+{
+	return mSceneRect;
+}
+
+void DrawingImageExporter::setImageSize(const QSize& size)
+{
+	mImageSize = size;
+}
+
+QSize DrawingImageExporter::imageSize() const
+{
+	return mImageSize;
+}
+
+void DrawingImageExporter::setDotsPerInch(int dpi)
+{
+	mDotsPerInch = qMax(dpi, 1);
+}
+
+int DrawingImageExporter::dotsPerInch() const
+{
+	return mDotsPerInch;
+}
+
+//==================================================================================================
+
+void DrawingImageExporter::setBandHeight(int rows)
+{
+	mBandHeight = qMax(rows, 1);
+}
+
+int DrawingImageExporter::bandHeight() const
+{
+	return mBandHeight;
+}
+
+void DrawingImageExporter::setMaximumThreadCount(int count)
+{
+	mMaximumThreadCount = qMax(count, 1);
+}
+
+int DrawingImageExporter::maximumThreadCount() const
+{
+	return mMaximumThreadCount;
+}
+
+//==================================================================================================
+
+bool DrawingImageExporter::exportImage(const QString& fileName, Format format)
+{
+	QSaveFile file(fileName);
+	bool success = file.open(QIODevice::WriteOnly);
+
+	if (success)
+	{
+		success = exportImage(&file, format);
+		if (success)
+		{
+			success = file.commit();
+			if (!success) mErrorString = file.errorString();
+		}
+	}
+	else mErrorString = file.errorString();
+
+	return success;
+}
+
+bool DrawingImageExporter::exportImage(QIODevice* device, Format format)
+{
+	mCanceled.storeRelease(0);
+	mErrorString.clear();
+
+	if (!mScene)
+	{
+		mErrorString = tr("No scene to export");
+		return false;
+	}
+
+	if (!device || !device->isWritable())
+	{
+		mErrorString = tr("Device is not open for writing");
+		return false;
+	}
+
+	QRectF sceneRect = (mSceneRect.isNull()) ? mScene->sceneRect() : mSceneRect.normalized();
+	QSize imageSize = (mImageSize.isEmpty()) ?
+		QSize(qCeil(sceneRect.width()), qCeil(sceneRect.height())) : mImageSize;
+
+	if (sceneRect.isEmpty() || imageSize.isEmpty())
+	{
+		mErrorString = tr("Export region is empty");
+		return false;
+	}
+
+	return exportBands(device, format, sceneRect, imageSize);
+}
+
+QString DrawingImageExporter::errorString() const
+{
+	return mErrorString;
+}
+
+bool DrawingImageExporter::isCanceled() const
+{
+	return (mCanceled.loadAcquire() != 0);
+}
+
+//==================================================================================================
+
+void DrawingImageExporter::cancel()
+{
+	mCanceled.storeRelease(1);
+}
+
+//==================================================================================================
+
+bool DrawingImageExporter::exportBands(QIODevice* device, Format format, const QRectF& sceneRect, const QSize& imageSize)
+{
+	const int bandHeight = qMin(mBandHeight, imageSize.height());
+	const int bandCount = (imageSize.height() + bandHeight - 1) / bandHeight;
+	const bool alpha = (mScene->backgroundBrush().color().alpha() < 255);
+
+	// Materializing items from an item source is not thread-safe, so such scenes are rendered on
+	// the calling thread one band at a time.  That thread must be the scene's own thread, since
+	// the items are materialized and released there by the scene's timers.
+	const bool serial = (mScene->itemSource() != nullptr);
+	if (serial && QThread::currentThread() != mScene->thread())
+	{
+		mErrorString = tr("Scenes with an item source must be exported from the scene's thread");
+		return false;
+	}
+
+	const int bandSlots = (serial) ? 1 : qMin(mMaximumThreadCount, bandCount);
+
+	QScopedPointer<DrawingImageStreamWriter> writer;
+	if (format == TiffFormat)
+		writer.reset(new DrawingTiffStreamWriter(device, imageSize, alpha, mDotsPerInch, bandHeight));
+	else
+		writer.reset(new DrawingPngStreamWriter(device, imageSize, alpha, mDotsPerInch, bandHeight));
+
+	if (!writer->writeHeader())
+	{
+		mErrorString = device->errorString();
+		return false;
+	}
+
+	// Each band is rendered into one of bandSlots slots, which bounds the number of bands held in
+	// memory.  A slot is reused for the next band as soon as its current band has been written.
+	QThreadPool threadPool;
+	threadPool.setMaxThreadCount(bandSlots);
+
+	QVector<QImage> bands(bandSlots);
+	QImage* bandData = bands.data();
+	QScopedArrayPointer<QSemaphore> bandReady(new QSemaphore[bandSlots]);
+
+	auto startBand = [&](int band)
+	{
+		int top = band * bandHeight;
+		int slot = band % bandSlots;
+
+		DrawingImageBandRenderer* renderer = new DrawingImageBandRenderer(mScene, sceneRect, imageSize,
+			top, qMin(bandHeight, imageSize.height() - top), alpha, &bandData[slot], &bandReady[slot], &mCanceled);
+
+		if (serial)
+		{
+			renderer->run();
+			delete renderer;
+		}
+		else threadPool.start(renderer);
+	};
+
+	int nextBand = 0;
+	while (nextBand < bandSlots) startBand(nextBand++);
+
+	bool success = true;
+	for(int band = 0; success && band < bandCount; band++)
+	{
+		int slot = band % bandSlots;
+
+		bandReady[slot].acquire();
+
+		if (isCanceled())
+		{
+			mErrorString = tr("Export canceled");
+			success = false;
+		}
+		else if (bandData[slot].isNull())
+		{
+			mErrorString = tr("Not enough memory to render image band");
+			success = false;
+		}
+		else if (!writer->writeBand(bandData[slot]))
+		{
+			mErrorString = device->errorString();
+			success = false;
+		}
+
+		bandData[slot] = QImage();
+
+		if (success)
+		{
+			emit progressChanged(band + 1, bandCount);
+			if (nextBand < bandCount) startBand(nextBand++);
+		}
+	}
+
+	// Let any bands still being rendered after an error finish before their slots are released
+	if (!success) mCanceled.storeRelease(1);
+	threadPool.waitForDone();
+
+	if (success && !writer->writeTrailer())
+	{
+		mErrorString = device->errorString();
+		success = false;
+	}
+
+	return success;
+}
@@ -0,0 +1,1482 @@
+/* DrawingImporter.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingImporter.h"
+#include "DrawingScene.h"
+#include "DrawingArena.h"
+#include "DrawingStyleDefaults.h"
+#include "DrawingItemStyle.h"
+#include "DrawingLineItem.h"
+#include "DrawingPolylineItem.h"
+#include "DrawingPolygonItem.h"
+#include "DrawingPathItem.h"
+#include "DrawingTextItem.h"
+
+struct DrawingImportBatch
+{
+	QList<DrawingItem*> items;
+	qint64 position;
+};
+
+// Bounded queue of parsed batches between the worker thread and the calling thread
+class DrawingImportQueue
+{
+private:
+	QMutex mMutex;
+	QWaitCondition mNotEmpty, mNotFull;
+	QQueue<DrawingImportBatch> mBatches;
+	int mCapacity;
+	bool mFinished;
+
+public:
+	DrawingImportQueue(int capacity)
+	{
+		mCapacity = capacity;
+		mFinished = false;
+	}
+
+	void push(const DrawingImportBatch& batch)
+	{
+		QMutexLocker locker(&mMutex);
+		while (mBatches.size() >= mCapacity) mNotFull.wait(&mMutex);
+		mBatches.enqueue(batch);
+		mNotEmpty.wakeOne();
+	}
+
+	bool pop(DrawingImportBatch& batch)
+	{
+		QMutexLocker locker(&mMutex);
+		while (mBatches.isEmpty() && !mFinished) mNotEmpty.wait(&mMutex);
+		if (mBatches.isEmpty()) return false;
+
+		batch = mBatches.dequeue();
+		mNotFull.wakeOne();
+		return true;
+	}
+
+	void finish()
+	{
+		QMutexLocker locker(&mMutex);
+		mFinished = true;
+		mNotEmpty.wakeAll();
+	}
+};
+
+//==================================================================================================
+
+// Appends an elliptical arc to the path as cubic segments of at most 90 degrees.  Angles are in
+// radians, measured in the path's own coordinate system.
+static void appendArc(QPainterPath& path, const QPointF& center, qreal rx, qreal ry, qreal rotation,
+	qreal startAngle, qreal sweepAngle)
+{
+	const qreal cosRotation = qCos(rotation), sinRotation = qSin(rotation);
+	const int segmentCount = qMax(1, qCeil(qAbs(sweepAngle) / (M_PI / 2) - 1E-9));
+	const qreal segmentAngle = sweepAngle / segmentCount;
+	const qreal alpha = 4.0 / 3.0 * qTan(segmentAngle / 4);
+
+	auto pointAt = [&](qreal angle) {
+		return QPointF(center.x() + rx * qCos(angle) * cosRotation - ry * qSin(angle) * sinRotation,
+			center.y() + rx * qCos(angle) * sinRotation + ry * qSin(angle) * cosRotation);
+	};
+	auto derivativeAt = [&](qreal angle) {
+		return QPointF(-rx * qSin(angle) * cosRotation - ry * qCos(angle) * sinRotation,
+			-rx * qSin(angle) * sinRotation + ry * qCos(angle) * cosRotation);
+	};
+
+	qreal angle = startAngle;
+	for(int segment = 0; segment < segmentCount; segment++, angle += segmentAngle)
+	{
+		QPointF endPoint = pointAt(angle + segmentAngle);
+		path.cubicTo(pointAt(angle) + alpha * derivativeAt(angle),
+			endPoint - alpha * derivativeAt(angle + segmentAngle), endPoint);
+	}
+}
+
+//==================================================================================================
+
+class DrawingImportParser : public QRunnable
+{
+public:
+	enum ShapeType { LineShape, PolylineShape, PolygonShape, PathShape, TextShape };
+	typedef QHash<DrawingItemStyle::Property,QVariant> StyleValues;
+
+protected:
+	QIODevice* mDevice;
+	QTransform mTransform;
+	int mBatchSize;
+	DrawingArena* mArena;
+	DrawingStyleDefaults* mStyleDefaults;
+	DrawingImportQueue* mQueue;
+	const QAtomicInt* mCanceled;
+
+	DrawingImportBatch mBatch;
+	QHash<QByteArray,StyleValues> mStyles;
+	QString mErrorString;
+
+public:
+	DrawingImportParser(QIODevice* device, const QTransform& transform, int batchSize,
+		DrawingArena* arena, DrawingStyleDefaults* styleDefaults, DrawingImportQueue* queue, const QAtomicInt* canceled)
+	{
+		mDevice = device;
+		mTransform = transform;
+		mBatchSize = batchSize;
+		mArena = arena;
+		mStyleDefaults = styleDefaults;
+		mQueue = queue;
+		mCanceled = canceled;
+		mBatch.position = 0;
+
+		setAutoDelete(false);
+	}
+
+	virtual ~DrawingImportParser() { }
+
+	void run()
+	{
+		DrawingArenaScope arenaScope(mArena);
+		DrawingStyleDefaultsScope defaultsScope(mStyleDefaults);
+
+		if (parse() && !isCanceled()) pushBatch();
+
+		qDeleteAll(mBatch.items);
+		mBatch.items.clear();
+
+		mQueue->finish();
+	}
+
+	QString errorString() const
+	{
+		return mErrorString;
+	}
+
+protected:
+	virtual bool parse() = 0;
+
+	bool isCanceled() const
+	{
+		return (mCanceled->loadAcquire() != 0);
+	}
+
+	bool pushBatch()
+	{
+		if (!mBatch.items.isEmpty())
+		{
+			mBatch.position = mDevice->pos();
+			mQueue->push(mBatch);
+			mBatch.items.clear();
+		}
+
+		return !isCanceled();
+	}
+
+	bool addItem(DrawingItem* item, ShapeType type, const StyleValues& style)
+	{
+		item->style()->setValues(sharedStyle(item, type, style));
+		mBatch.items.append(item);
+		return (mBatch.items.size() < mBatchSize || pushBatch());
+	}
+
+	// Items of the same type with the same style values share one implicitly shared copy of the
+	// complete set of values
+	StyleValues sharedStyle(DrawingItem* item, ShapeType type, const StyleValues& style)
+	{
+		const int maximumStyleCount = 4096;
+
+		QByteArray key;
+		QDataStream stream(&key, QIODevice::WriteOnly);
+		stream << static_cast<qint32>(type);
+
+		for(int index = 0; index < DrawingItemStyle::NumberOfProperties; index++)
+		{
+			auto valueIter = style.find(static_cast<DrawingItemStyle::Property>(index));
+			if (valueIter != style.end()) stream << static_cast<qint32>(index) << valueIter.value();
+		}
+
+		auto styleIter = mStyles.find(key);
+		if (styleIter == mStyles.end())
+		{
+			if (mStyles.size() >= maximumStyleCount) mStyles.clear();
+
+			StyleValues values = item->style()->values();
+			for(auto valueIter = style.begin(); valueIter != style.end(); valueIter++)
+				values.insert(valueIter.key(), valueIter.value());
+
+			styleIter = mStyles.insert(key, values);
+		}
+
+		return styleIter.value();
+	}
+
+	// The following functions take geometry that is already mapped to scene coordinates
+
+	bool addLine(const QPointF& p1, const QPointF& p2, const StyleValues& style)
+	{
+		DrawingLineItem* item = new DrawingLineItem();
+		item->setPosition(p1);
+		item->setLine(QLineF(QPointF(0, 0), p2 - p1));
+		return addItem(item, LineShape, style);
+	}
+
+	bool addPolyline(const QPolygonF& polyline, const StyleValues& style)
+	{
+		if (polyline.size() < 2) return true;
+
+		DrawingPolylineItem* item = new DrawingPolylineItem();
+		item->setPosition(polyline.first());
+		item->setPolyline(polyline.translated(-polyline.first()));
+		return addItem(item, PolylineShape, style);
+	}
+
+	bool addPolygon(const QPolygonF& polygon, const StyleValues& style)
+	{
+		QPolygonF openPolygon = polygon;
+		if (openPolygon.size() > 3 && openPolygon.first() == openPolygon.last()) openPolygon.removeLast();
+		if (openPolygon.size() < 3) return true;
+
+		DrawingPolygonItem* item = new DrawingPolygonItem();
+		item->setPosition(openPolygon.first());
+		item->setPolygon(openPolygon.translated(-openPolygon.first()));
+		return addItem(item, PolygonShape, style);
+	}
+
+	bool addPath(const QPainterPath& path, const StyleValues& style)
+	{
+		if (path.isEmpty()) return true;
+
+		// The path rect is mapped onto the item's rect, so it cannot have a zero width or height
+		QRectF pathRect = path.boundingRect();
+		if (pathRect.width() <= 0) pathRect.adjust(-0.5, 0, 0.5, 0);
+		if (pathRect.height() <= 0) pathRect.adjust(0, -0.5, 0, 0.5);
+
+		DrawingPathItem* item = new DrawingPathItem();
+		item->setPosition(pathRect.center());
+		item->setRect(pathRect.translated(-pathRect.center()));
+		item->setPath(path, pathRect);
+		return addItem(item, PathShape, style);
+	}
+
+	bool addText(const QPointF& position, const QString& caption, const StyleValues& style)
+	{
+		if (caption.trimmed().isEmpty()) return true;
+
+		DrawingTextItem* item = new DrawingTextItem();
+		item->setPosition(position);
+		item->setCaption(caption);
+		return addItem(item, TextShape, style);
+	}
+};
+
+//==================================================================================================
+
+// Reads numbers, flags, and commands from SVG attribute values such as path data and point lists
+class DrawingSvgLexer
+{
+private:
+	const QString& mText;
+	int mPosition;
+
+public:
+	DrawingSvgLexer(const QString& text) : mText(text)
+	{
+		mPosition = 0;
+	}
+
+	bool atEnd()
+	{
+		skipSeparators();
+		return (mPosition >= mText.size());
+	}
+
+	bool nextIsCommand()
+	{
+		skipSeparators();
+		return (mPosition < mText.size() && mText[mPosition].isLetter() &&
+			mText[mPosition] != 'e' && mText[mPosition] != 'E');
+	}
+
+	QChar command()
+	{
+		return (nextIsCommand()) ? mText[mPosition++] : QChar();
+	}
+
+	bool number(qreal& value)
+	{
+		skipSeparators();
+
+		int start = mPosition;
+		if (mPosition < mText.size() && (mText[mPosition] == '-' || mText[mPosition] == '+')) mPosition++;
+		while (mPosition < mText.size() && mText[mPosition].isDigit()) mPosition++;
+		if (mPosition < mText.size() && mText[mPosition] == '.')
+		{
+			mPosition++;
+			while (mPosition < mText.size() && mText[mPosition].isDigit()) mPosition++;
+		}
+		if (mPosition < mText.size() && (mText[mPosition] == 'e' || mText[mPosition] == 'E'))
+		{
+			int exponentStart = mPosition++;
+			if (mPosition < mText.size() && (mText[mPosition] == '-' || mText[mPosition] == '+')) mPosition++;
+			if (mPosition < mText.size() && mText[mPosition].isDigit())
+			{
+				while (mPosition < mText.size() && mText[mPosition].isDigit()) mPosition++;
+			}
+			else mPosition = exponentStart;
+		}
+
+		bool ok = false;
+		value = mText.midRef(start, mPosition - start).toDouble(&ok);
+		if (!ok) mPosition = start;
+		return ok;
+	}
+
+	bool flag(bool& value)
+	{
+		skipSeparators();
+
+		bool ok = (mPosition < mText.size() && (mText[mPosition] == '0' || mText[mPosition] == '1'));
+		if (ok) value = (mText[mPosition++] == '1');
+		return ok;
+	}
+
+	QString unit()
+	{
+		int start = mPosition;
+		while (mPosition < mText.size() && (mText[mPosition].isLetter() || mText[mPosition] == '%')) mPosition++;
+		return mText.mid(start, mPosition - start);
+	}
+
+private:
+	void skipSeparators()
+	{
+		while (mPosition < mText.size() && (mText[mPosition].isSpace() || mText[mPosition] == ','))
+			mPosition++;
+	}
+};
+
+//==================================================================================================
+
+class DrawingSvgImportParser : public DrawingImportParser
+{
+private:
+	struct State
+	{
+		QTransform transform;
+		QHash<QString,QString> attributes;
+		qreal opacity;
+	};
+
+public:
+	DrawingSvgImportParser(QIODevice* device, const QTransform& transform, int batchSize,
+		DrawingArena* arena, DrawingStyleDefaults* styleDefaults, DrawingImportQueue* queue, const QAtomicInt* canceled)
+		: DrawingImportParser(device, transform, batchSize, arena, styleDefaults, queue, canceled) { }
+
+protected:
+	bool parse()
+	{
+		static const QSet<QString> skippedElements = QSet<QString>() << "defs" << "symbol" <<
+			"clipPath" << "mask" << "marker" << "pattern" << "linearGradient" << "radialGradient" <<
+			"filter" << "style" << "script" << "title" << "desc" << "metadata" << "foreignObject" <<
+			"use";
+
+		QXmlStreamReader reader(mDevice);
+		QVector<State> states;
+		int tokenCount = 0;
+
+		State rootState;
+		rootState.transform = mTransform;
+		rootState.opacity = 1.0;
+		states.append(rootState);
+
+		while (!reader.atEnd())
+		{
+			QXmlStreamReader::TokenType token = reader.readNext();
+
+			if (++tokenCount % 256 == 0 && isCanceled()) return false;
+
+			if (token == QXmlStreamReader::StartElement)
+			{
+				QString name = reader.name().toString();
+				if (skippedElements.contains(name))
+				{
+					reader.skipCurrentElement();
+					continue;
+				}
+
+				QXmlStreamAttributes attributes = reader.attributes();
+				State state = states.last();
+				applyAttributes(state, attributes);
+
+				// The outermost svg element is placed at the origin; nested ones at their x and y
+				if (name == "svg") state.transform = viewportTransform(attributes, states.size() == 1) * state.transform;
+
+				if (state.attributes.value("display") == "none")
+				{
+					reader.skipCurrentElement();
+					continue;
+				}
+
+				// The text element is read in full here, so it never reaches the EndElement case
+				if (name == "text")
+				{
+					QString caption = reader.readElementText(QXmlStreamReader::IncludeChildElements).simplified();
+					QPointF position(firstNumber(attributes.value("x").toString()),
+						firstNumber(attributes.value("y").toString()));
+
+					if (isVisible(state) &&
+						!addText(state.transform.map(position), caption, styleValues(state, TextShape)))
+					{
+						return false;
+					}
+					continue;
+				}
+
+				states.append(state);
+
+				if (isVisible(state) && !addShape(name, attributes, state)) return false;
+			}
+			else if (token == QXmlStreamReader::EndElement)
+			{
+				if (states.size() > 1) states.removeLast();
+			}
+		}
+
+		if (reader.hasError())
+		{
+			mErrorString = DrawingImporter::tr("%1 at line %2").arg(reader.errorString()).arg(reader.lineNumber());
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	bool addShape(const QString& name, const QXmlStreamAttributes& attributes, const State& state)
+	{
+		auto value = [&attributes](const char* attribute) {
+			return length(attributes.value(attribute).toString());
+		};
+
+		bool success = true;
+
+		if (name == "line")
+		{
+			success = addLine(state.transform.map(QPointF(value("x1"), value("y1"))),
+				state.transform.map(QPointF(value("x2"), value("y2"))), styleValues(state, LineShape));
+		}
+		else if (name == "polyline" || name == "polygon")
+		{
+			QString pointsText = attributes.value("points").toString();
+			DrawingSvgLexer lexer(pointsText);
+			QPolygonF polygon;
+			qreal x, y;
+
+			while (lexer.number(x) && lexer.number(y)) polygon.append(QPointF(x, y));
+
+			if (name == "polyline")
+				success = addPolyline(state.transform.map(polygon), styleValues(state, PolylineShape));
+			else
+				success = addPolygon(state.transform.map(polygon), styleValues(state, PolygonShape));
+		}
+		else if (name == "rect")
+		{
+			QRectF rect(value("x"), value("y"), value("width"), value("height"));
+			qreal rx = value("rx"), ry = value("ry");
+			if (rx <= 0) rx = ry;
+			if (ry <= 0) ry = rx;
+
+			if (rect.isEmpty())
+				success = true;
+			else if (rx > 0)
+			{
+				QPainterPath path;
+				path.addRoundedRect(rect, qMin(rx, rect.width() / 2), qMin(ry, rect.height() / 2));
+				success = addPath(state.transform.map(path), styleValues(state, PathShape));
+			}
+			else success = addPolygon(state.transform.map(QPolygonF(rect)), styleValues(state, PolygonShape));
+		}
+		else if (name == "circle" || name == "ellipse")
+		{
+			qreal rx = (name == "circle") ? value("r") : value("rx");
+			qreal ry = (name == "circle") ? value("r") : value("ry");
+
+			if (rx > 0 && ry > 0)
+			{
+				QPainterPath path;
+				path.addEllipse(QPointF(value("cx"), value("cy")), rx, ry);
+				success = addPath(state.transform.map(path), styleValues(state, PathShape));
+			}
+		}
+		else if (name == "path")
+		{
+			QPainterPath path = pathData(attributes.value("d").toString());
+			success = addPath(state.transform.map(path), styleValues(state, PathShape));
+		}
+
+		return success;
+	}
+
+	void applyAttributes(State& state, const QXmlStreamAttributes& attributes)
+	{
+		static const QStringList inheritedAttributes = QStringList() << "stroke" << "stroke-width" <<
+			"stroke-opacity" << "stroke-linecap" << "stroke-linejoin" << "stroke-dasharray" <<
+			"fill" << "fill-opacity" << "font-family" << "font-size" << "font-weight" <<
+			"font-style" << "text-anchor" << "visibility";
+
+		// Neither display nor opacity is inherited, but both apply to the whole element subtree, so
+		// the parent's values are cleared before the element's own attributes are merged
+		state.attributes.remove("display");
+		state.attributes.remove("opacity");
+
+		for(auto attributeIter = attributes.begin(); attributeIter != attributes.end(); attributeIter++)
+		{
+			QString name = attributeIter->name().toString();
+			if (inheritedAttributes.contains(name) || name == "display" || name == "opacity")
+				state.attributes.insert(name, attributeIter->value().toString().trimmed());
+		}
+
+		// Style properties take precedence over presentation attributes
+		QStringList declarations = attributes.value("style").toString().split(';', QString::SkipEmptyParts);
+		for(auto declarationIter = declarations.begin(); declarationIter != declarations.end(); declarationIter++)
+		{
+			int colon = declarationIter->indexOf(':');
+			if (colon > 0)
+			{
+				state.attributes.insert(declarationIter->left(colon).trimmed(),
+					declarationIter->mid(colon + 1).trimmed());
+			}
+		}
+
+		// The merged display value is checked by parse(); opacity is folded into the state
+		if (state.attributes.contains("opacity"))
+			state.opacity *= qBound(0.0, firstNumber(state.attributes.take("opacity")), 1.0);
+
+		if (attributes.hasAttribute("transform"))
+			state.transform = transformData(attributes.value("transform").toString()) * state.transform;
+	}
+
+	QTransform viewportTransform(const QXmlStreamAttributes& attributes, bool outermost) const
+	{
+		QTransform transform;
+		if (!outermost) transform.translate(length(attributes.value("x").toString()), length(attributes.value("y").toString()));
+
+		QString viewBoxText = attributes.value("viewBox").toString();
+		DrawingSvgLexer lexer(viewBoxText);
+		qreal viewBox[4];
+		int viewBoxCount = 0;
+		while (viewBoxCount < 4 && lexer.number(viewBox[viewBoxCount])) viewBoxCount++;
+
+		if (viewBoxCount == 4 && viewBox[2] > 0 && viewBox[3] > 0)
+		{
+			// Percentages are relative to a viewport outside the file, so they keep the viewBox size
+			QString widthText = attributes.value("width").toString().trimmed();
+			QString heightText = attributes.value("height").toString().trimmed();
+			qreal width = (widthText.endsWith('%') || length(widthText) <= 0) ? viewBox[2] : length(widthText);
+			qreal height = (heightText.endsWith('%') || length(heightText) <= 0) ? viewBox[3] : length(heightText);
+
+			qreal scaleX = width / viewBox[2], scaleY = height / viewBox[3];
+			qreal dx = 0, dy = 0;
+
+			QStringList aspectRatio = attributes.value("preserveAspectRatio").toString().simplified().split(' ');
+			if (aspectRatio.first() == "defer") aspectRatio.removeFirst();
+			QString align = (aspectRatio.isEmpty() || aspectRatio.first().isEmpty()) ? "xMidYMid" : aspectRatio.first();
+
+			if (align != "none")
+			{
+				qreal scale = (aspectRatio.contains("slice")) ? qMax(scaleX, scaleY) : qMin(scaleX, scaleY);
+				scaleX = scale;
+				scaleY = scale;
+
+				if (align.startsWith("xMid")) dx = (width - viewBox[2] * scale) / 2;
+				else if (align.startsWith("xMax")) dx = width - viewBox[2] * scale;
+				if (align.endsWith("YMid")) dy = (height - viewBox[3] * scale) / 2;
+				else if (align.endsWith("YMax")) dy = height - viewBox[3] * scale;
+			}
+
+			transform.translate(dx, dy).scale(scaleX, scaleY).translate(-viewBox[0], -viewBox[1]);
+		}
+
+		return transform;
+	}
+
+	bool isVisible(const State& state) const
+	{
+		QString visibility = state.attributes.value("visibility");
+		return (visibility != "hidden" && visibility != "collapse");
+	}
+
+	StyleValues styleValues(const State& state, ShapeType type) const
+	{
+		StyleValues values;
+		qreal scale = qSqrt(qAbs(state.transform.determinant()));
+		if (scale <= 0) scale = 1.0;
+
+		if (type == TextShape)
+		{
+			QString fill = state.attributes.value("fill", "black");
+			values.insert(DrawingItemStyle::TextColor, color(fill));
+			values.insert(DrawingItemStyle::TextOpacity, (fill == "none") ? 0.0 :
+				qBound(0.0, firstNumber(state.attributes.value("fill-opacity", "1")), 1.0) * state.opacity);
+
+			QString fontFamily = state.attributes.value("font-family").section(',', 0, 0).trimmed();
+			fontFamily.remove('\'');
+			fontFamily.remove('"');
+			if (!fontFamily.isEmpty()) values.insert(DrawingItemStyle::FontName, fontFamily);
+
+			values.insert(DrawingItemStyle::FontSize, length(state.attributes.value("font-size", "16")) * scale);
+
+			QString fontWeight = state.attributes.value("font-weight");
+			values.insert(DrawingItemStyle::FontBold, fontWeight == "bold" || fontWeight == "bolder" ||
+				fontWeight.toInt() >= 600);
+			QString fontStyle = state.attributes.value("font-style");
+			values.insert(DrawingItemStyle::FontItalic, fontStyle == "italic" || fontStyle == "oblique");
+
+			QString textAnchor = state.attributes.value("text-anchor");
+			Qt::Alignment alignment = Qt::AlignLeft;
+			if (textAnchor == "middle") alignment = Qt::AlignHCenter;
+			else if (textAnchor == "end") alignment = Qt::AlignRight;
+			values.insert(DrawingItemStyle::TextHorizontalAlignment, (uint)alignment);
+			values.insert(DrawingItemStyle::TextVerticalAlignment, (uint)Qt::AlignBottom);
+		}
+		else
+		{
+			QString stroke = state.attributes.value("stroke", "none");
+			if (stroke == "none")
+				values.insert(DrawingItemStyle::PenStyle, (uint)Qt::NoPen);
+			else
+			{
+				QString dashArray = state.attributes.value("stroke-dasharray", "none");
+				values.insert(DrawingItemStyle::PenStyle, (uint)((dashArray == "none") ? Qt::SolidLine : Qt::DashLine));
+				values.insert(DrawingItemStyle::PenColor, color(stroke));
+				values.insert(DrawingItemStyle::PenOpacity,
+					qBound(0.0, firstNumber(state.attributes.value("stroke-opacity", "1")), 1.0) * state.opacity);
+				values.insert(DrawingItemStyle::PenWidth, length(state.attributes.value("stroke-width", "1")) * scale);
+
+				QString lineCap = state.attributes.value("stroke-linecap");
+				Qt::PenCapStyle capStyle = Qt::FlatCap;
+				if (lineCap == "round") capStyle = Qt::RoundCap;
+				else if (lineCap == "square") capStyle = Qt::SquareCap;
+				values.insert(DrawingItemStyle::PenCapStyle, (uint)capStyle);
+
+				QString lineJoin = state.attributes.value("stroke-linejoin");
+				Qt::PenJoinStyle joinStyle = Qt::MiterJoin;
+				if (lineJoin == "round") joinStyle = Qt::RoundJoin;
+				else if (lineJoin == "bevel") joinStyle = Qt::BevelJoin;
+				values.insert(DrawingItemStyle::PenJoinStyle, (uint)joinStyle);
+			}
+
+			if (type == PolygonShape || type == PathShape)
+			{
+				QString fill = state.attributes.value("fill", "black");
+				if (fill == "none")
+					values.insert(DrawingItemStyle::BrushStyle, (uint)Qt::NoBrush);
+				else
+				{
+					values.insert(DrawingItemStyle::BrushStyle, (uint)Qt::SolidPattern);
+					values.insert(DrawingItemStyle::BrushColor, color(fill));
+					values.insert(DrawingItemStyle::BrushOpacity,
+						qBound(0.0, firstNumber(state.attributes.value("fill-opacity", "1")), 1.0) * state.opacity);
+				}
+			}
+		}
+
+		return values;
+	}
+
+	//==============================================================================================
+
+	static qreal firstNumber(const QString& text)
+	{
+		DrawingSvgLexer lexer(text);
+		qreal value = 0;
+		lexer.number(value);
+		return value;
+	}
+
+	static qreal length(const QString& text)
+	{
+		DrawingSvgLexer lexer(text);
+		qreal value = 0;
+
+		if (lexer.number(value))
+		{
+			QString unit = lexer.unit();
+			if (unit == "pt") value *= 1.25;
+			else if (unit == "pc") value *= 15;
+			else if (unit == "mm") value *= 3.543307;
+			else if (unit == "cm") value *= 35.43307;
+			else if (unit == "in") value *= 90;
+			else if (unit == "em") value *= 16;
+		}
+
+		return value;
+	}
+
+	static QColor color(const QString& text)
+	{
+		QColor result;
+
+		if (text.startsWith("rgb("))
+		{
+			QString components = text.mid(4).section(')', 0, 0);
+			DrawingSvgLexer lexer(components);
+			int rgb[3] = { 0, 0, 0 };
+			qreal value;
+
+			for(int index = 0; index < 3 && lexer.number(value); index++)
+				rgb[index] = qBound(0, qRound((lexer.unit() == "%") ? value * 2.55 : value), 255);
+
+			result = QColor(rgb[0], rgb[1], rgb[2]);
+		}
+		else if (text.startsWith("url("))
+		{
+			// Gradients and patterns are not imported, so the fallback color is used if given
+			QString fallback = text.section(')', 1).trimmed();
+			result = (fallback.isEmpty() || fallback == "none") ? QColor(Qt::gray) : color(fallback);
+		}
+		else if (text != "currentColor")
+			result = QColor(text);
+
+		return (result.isValid()) ? result : QColor(Qt::black);
+	}
+
+	static QTransform transformData(const QString& text)
+	{
+		QTransform result;
+		int position = 0;
+
+		while (position < text.size())
+		{
+			int open = text.indexOf('(', position);
+			int close = text.indexOf(')', open);
+			if (open < 0 || close < 0) break;
+
+			QString name = text.mid(position, open - position).trimmed();
+			if (name.startsWith(',')) name = name.mid(1).trimmed();
+
+			QString argumentText = text.mid(open + 1, close - open - 1);
+			DrawingSvgLexer lexer(argumentText);
+			QVector<qreal> arguments;
+			qreal value;
+			while (lexer.number(value)) arguments.append(value);
+			int argumentCount = arguments.size();
+			arguments.resize(6);
+
+			QTransform transform;
+			if (name == "matrix")
+				transform = QTransform(arguments[0], arguments[1], arguments[2], arguments[3], arguments[4], arguments[5]);
+			else if (name == "translate")
+				transform = QTransform::fromTranslate(arguments[0], arguments[1]);
+			else if (name == "scale")
+				transform = QTransform::fromScale(arguments[0], (argumentCount > 1) ? arguments[1] : arguments[0]);
+			else if (name == "rotate")
+				transform.translate(arguments[1], arguments[2]).rotate(arguments[0]).translate(-arguments[1], -arguments[2]);
+			else if (name == "skewX")
+				transform.shear(qTan(qDegreesToRadians(arguments[0])), 0);
+			else if (name == "skewY")
+				transform.shear(0, qTan(qDegreesToRadians(arguments[0])));
+
+			// Each transform in the list applies before the ones to its left
+			result = transform * result;
+			position = close + 1;
+		}
+
+		return result;
+	}
+
+	static QPainterPath pathData(const QString& text)
+	{
+		QPainterPath path;
+		DrawingSvgLexer lexer(text);
+		QPointF current, subpathStart, lastControl;
+		QChar command, previousCommand;
+		qreal x, y, x1, y1, x2, y2, rx, ry, rotation;
+		bool largeArc, sweep, ok = true;
+
+		while (ok && !lexer.atEnd())
+		{
+			if (lexer.nextIsCommand()) command = lexer.command();
+			else if (command.isNull()) break;
+
+			QChar upperCommand = command.toUpper();
+			QPointF origin = (command.isLower()) ? current : QPointF(0, 0);
+
+			switch (upperCommand.toLatin1())
+			{
+			case 'M':
+				ok = (lexer.number(x) && lexer.number(y));
+				if (ok)
+				{
+					current = origin + QPointF(x, y);
+					subpathStart = current;
+					path.moveTo(current);
+
+					// Additional coordinate pairs after a move are treated as line segments
+					command = (command.isLower()) ? 'l' : 'L';
+				}
+				break;
+			case 'L':
+				ok = (lexer.number(x) && lexer.number(y));
+				if (ok)
+				{
+					current = origin + QPointF(x, y);
+					path.lineTo(current);
+				}
+				break;
+			case 'H':
+				ok = lexer.number(x);
+				if (ok)
+				{
+					current.setX(origin.x() + x);
+					path.lineTo(current);
+				}
+				break;
+			case 'V':
+				ok = lexer.number(y);
+				if (ok)
+				{
+					current.setY(origin.y() + y);
+					path.lineTo(current);
+				}
+				break;
+			case 'C':
+			case 'S':
+				if (upperCommand == 'C')
+				{
+					ok = (lexer.number(x1) && lexer.number(y1));
+					x1 += origin.x();
+					y1 += origin.y();
+				}
+				else if (previousCommand == 'C' || previousCommand == 'S')
+				{
+					x1 = 2 * current.x() - lastControl.x();
+					y1 = 2 * current.y() - lastControl.y();
+				}
+				else
+				{
+					x1 = current.x();
+					y1 = current.y();
+				}
+
+				ok = (ok && lexer.number(x2) && lexer.number(y2) && lexer.number(x) && lexer.number(y));
+				if (ok)
+				{
+					lastControl = origin + QPointF(x2, y2);
+					current = origin + QPointF(x, y);
+					path.cubicTo(QPointF(x1, y1), lastControl, current);
+				}
+				break;
+			case 'Q':
+			case 'T':
+				if (upperCommand == 'Q')
+				{
+					ok = (lexer.number(x1) && lexer.number(y1));
+					lastControl = origin + QPointF(x1, y1);
+				}
+				else if (previousCommand == 'Q' || previousCommand == 'T')
+					lastControl = 2 * current - lastControl;
+				else
+					lastControl = current;
+
+				ok = (ok && lexer.number(x) && lexer.number(y));
+				if (ok)
+				{
+					current = origin + QPointF(x, y);
+					path.quadTo(lastControl, current);
+				}
+				break;
+			case 'A':
+				ok = (lexer.number(rx) && lexer.number(ry) && lexer.number(rotation) &&
+					lexer.flag(largeArc) && lexer.flag(sweep) && lexer.number(x) && lexer.number(y));
+				if (ok)
+				{
+					QPointF endPoint = origin + QPointF(x, y);
+					appendSvgArc(path, current, endPoint, rx, ry, rotation, largeArc, sweep);
+					current = endPoint;
+				}
+				break;
+			case 'Z':
+				path.closeSubpath();
+				current = subpathStart;
+
+				// Numbers may not follow a close command without a new command
+				command = QChar();
+				break;
+			default:
+				ok = false;
+				break;
+			}
+
+			previousCommand = upperCommand;
+		}
+
+		return path;
+	}
+
+	// Converts an SVG endpoint arc to center parameterization (SVG 1.1, appendix F.6.5)
+	static void appendSvgArc(QPainterPath& path, const QPointF& start, const QPointF& end,
+		qreal rx, qreal ry, qreal rotation, bool largeArc, bool sweep)
+	{
+		if (start == end) return;
+
+		rx = qAbs(rx);
+		ry = qAbs(ry);
+		if (rx == 0 || ry == 0)
+		{
+			path.lineTo(end);
+			return;
+		}
+
+		qreal phi = qDegreesToRadians(rotation);
+		qreal cosPhi = qCos(phi), sinPhi = qSin(phi);
+		qreal dx = (start.x() - end.x()) / 2, dy = (start.y() - end.y()) / 2;
+		qreal x1 = cosPhi * dx + sinPhi * dy;
+		qreal y1 = -sinPhi * dx + cosPhi * dy;
+
+		qreal lambda = (x1 * x1) / (rx * rx) + (y1 * y1) / (ry * ry);
+		if (lambda > 1)
+		{
+			rx *= qSqrt(lambda);
+			ry *= qSqrt(lambda);
+		}
+
+		qreal numerator = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+		qreal denominator = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+		qreal coefficient = (denominator > 0) ? qSqrt(qMax(0.0, numerator / denominator)) : 0;
+		if (largeArc == sweep) coefficient = -coefficient;
+
+		qreal cx1 = coefficient * rx * y1 / ry;
+		qreal cy1 = -coefficient * ry * x1 / rx;
+		QPointF center(cosPhi * cx1 - sinPhi * cy1 + (start.x() + end.x()) / 2,
+			sinPhi * cx1 + cosPhi * cy1 + (start.y() + end.y()) / 2);
+
+		qreal startAngle = qAtan2((y1 - cy1) / ry, (x1 - cx1) / rx);
+		qreal sweepAngle = qAtan2((-y1 - cy1) / ry, (-x1 - cx1) / rx) - startAngle;
+		if (!sweep && sweepAngle > 0) sweepAngle -= 2 * M_PI;
+		else if (sweep && sweepAngle < 0) sweepAngle += 2 * M_PI;
+
+		appendArc(path, center, rx, ry, phi, startAngle, sweepAngle);
+	}
+};
+
+//==================================================================================================
+
+class DrawingDxfImportParser : public DrawingImportParser
+{
+private:
+	struct Entity
+	{
+		QString type;
+		QString layer;
+		int color;
+		int flags;
+		qreal width;
+		QPointF point1, point2;
+		qreal radius;
+		qreal startAngle, endAngle;
+		qreal bulge;
+		QPolygonF points;
+		QVector<qreal> bulges;
+		QString text;
+
+		Entity() : color(256), flags(0), width(0), radius(0), startAngle(0), endAngle(360), bulge(0) { }
+	};
+
+	QHash<QString,int> mLayerColors;
+	QSet<QString> mHiddenLayers;
+	Entity mPolyline;
+	bool mInPolyline;
+	qint64 mLineNumber;
+
+public:
+	DrawingDxfImportParser(QIODevice* device, const QTransform& transform, int batchSize,
+		DrawingArena* arena, DrawingStyleDefaults* styleDefaults, DrawingImportQueue* queue, const QAtomicInt* canceled)
+		: DrawingImportParser(device, transform, batchSize, arena, styleDefaults, queue, canceled)
+	{
+		// DXF drawings use a y-axis that points up
+		mTransform = QTransform::fromScale(1, -1) * mTransform;
+		mInPolyline = false;
+		mLineNumber = 0;
+	}
+
+protected:
+	bool parse()
+	{
+		if (mDevice->peek(18) == "AutoCAD Binary DXF")
+		{
+			mErrorString = DrawingImporter::tr("Binary DXF files are not supported");
+			return false;
+		}
+
+		QString section, value;
+		Entity entity;
+		bool inEntity = false, sectionNamePending = false;
+		int code, pairCount = 0;
+
+		while (readPair(code, value))
+		{
+			if (++pairCount % 1024 == 0 && isCanceled()) return false;
+
+			if (code == 0)
+			{
+				if (inEntity && !finishEntity(entity)) return false;
+				inEntity = false;
+
+				if (value == "SECTION")
+					sectionNamePending = true;
+				else if (value == "ENDSEC")
+					section.clear();
+				else if (value == "EOF")
+					break;
+				else if (section == "ENTITIES" || (section == "TABLES" && value == "LAYER"))
+				{
+					entity = Entity();
+					entity.type = value;
+					inEntity = true;
+				}
+			}
+			else if (code == 2 && sectionNamePending)
+			{
+				section = value;
+				sectionNamePending = false;
+			}
+			else if (inEntity) applyPair(entity, code, value);
+		}
+
+		if (!mErrorString.isEmpty()) return false;
+
+		return (!inEntity || finishEntity(entity));
+	}
+
+private:
+	bool readPair(int& code, QString& value)
+	{
+		QByteArray codeLine = mDevice->readLine();
+		QByteArray valueLine = mDevice->readLine();
+		if (codeLine.isEmpty() || valueLine.isEmpty()) return false;
+
+		mLineNumber += 2;
+
+		bool ok = false;
+		code = codeLine.trimmed().toInt(&ok);
+		if (!ok)
+		{
+			mErrorString = DrawingImporter::tr("Invalid group code at line %1").arg(mLineNumber - 1);
+			return false;
+		}
+
+		// Leading spaces are significant in text values
+		value = QString::fromUtf8(valueLine);
+		while (value.endsWith('\n') || value.endsWith('\r')) value.chop(1);
+		if (code != 1 && code != 3) value = value.trimmed();
+
+		return true;
+	}
+
+	void applyPair(Entity& entity, int code, const QString& value)
+	{
+		switch (code)
+		{
+		case 1:
+		case 3:
+			entity.text += value;
+			break;
+		case 2:
+			if (entity.type == "LAYER") entity.layer = value;
+			break;
+		case 8:
+			entity.layer = value;
+			break;
+		case 10:
+			if (entity.type == "LWPOLYLINE")
+			{
+				entity.points.append(QPointF(value.toDouble(), 0));
+				entity.bulges.append(0);
+			}
+			else entity.point1.setX(value.toDouble());
+			break;
+		case 20:
+			if (entity.type == "LWPOLYLINE")
+			{
+				if (!entity.points.isEmpty()) entity.points.last().setY(value.toDouble());
+			}
+			else entity.point1.setY(value.toDouble());
+			break;
+		case 11:
+			entity.point2.setX(value.toDouble());
+			break;
+		case 21:
+			entity.point2.setY(value.toDouble());
+			break;
+		case 40:
+			entity.radius = value.toDouble();
+			break;
+		case 42:
+			if (entity.type == "LWPOLYLINE")
+			{
+				if (!entity.bulges.isEmpty()) entity.bulges.last() = value.toDouble();
+			}
+			else entity.bulge = value.toDouble();
+			break;
+		case 43:
+			entity.width = value.toDouble();
+			break;
+		case 50:
+			entity.startAngle = value.toDouble();
+			break;
+		case 51:
+			entity.endAngle = value.toDouble();
+			break;
+		case 62:
+			entity.color = value.toInt();
+			break;
+		case 70:
+			entity.flags = value.toInt();
+			break;
+		default:
+			break;
+		}
+	}
+
+	bool finishEntity(const Entity& entity)
+	{
+		bool success = true;
+
+		if (entity.type == "LAYER")
+		{
+			mLayerColors.insert(entity.layer, qAbs(entity.color));
+			if (entity.color < 0) mHiddenLayers.insert(entity.layer);
+		}
+		else if (entity.type == "POLYLINE")
+		{
+			// Vertices follow as separate entities until SEQEND.  Polyface and polygon meshes are
+			// not imported.
+			mPolyline = entity;
+			mInPolyline = ((entity.flags & (16 | 64)) == 0);
+		}
+		else if (entity.type == "VERTEX")
+		{
+			if (mInPolyline && (entity.flags & 16) == 0)
+			{
+				mPolyline.points.append(entity.point1);
+				mPolyline.bulges.append(entity.bulge);
+			}
+		}
+		else if (entity.type == "SEQEND")
+		{
+			if (mInPolyline && !mHiddenLayers.contains(mPolyline.layer))
+				success = addPolylineEntity(mPolyline);
+			mInPolyline = false;
+		}
+		else if (!mHiddenLayers.contains(entity.layer))
+		{
+			if (entity.type == "LINE")
+			{
+				success = addLine(mTransform.map(entity.point1), mTransform.map(entity.point2),
+					styleValues(entity, LineShape));
+			}
+			else if (entity.type == "LWPOLYLINE")
+				success = addPolylineEntity(entity);
+			else if (entity.type == "CIRCLE" && entity.radius > 0)
+			{
+				QPainterPath path;
+				path.addEllipse(entity.point1, entity.radius, entity.radius);
+				success = addPath(mTransform.map(path), styleValues(entity, PathShape));
+			}
+			else if (entity.type == "ARC" && entity.radius > 0)
+			{
+				qreal sweepAngle = entity.endAngle - entity.startAngle;
+				while (sweepAngle <= 0) sweepAngle += 360;
+
+				QPainterPath path;
+				qreal startAngle = qDegreesToRadians(entity.startAngle);
+				path.moveTo(entity.point1 + entity.radius * QPointF(qCos(startAngle), qSin(startAngle)));
+				appendArc(path, entity.point1, entity.radius, entity.radius, 0, startAngle, qDegreesToRadians(sweepAngle));
+				success = addPath(mTransform.map(path), styleValues(entity, PathShape));
+			}
+			else if (entity.type == "TEXT")
+				success = addText(mTransform.map(entity.point1), entity.text, styleValues(entity, TextShape));
+			else if (entity.type == "MTEXT")
+				success = addText(mTransform.map(entity.point1), plainText(entity.text), styleValues(entity, TextShape));
+		}
+
+		return success;
+	}
+
+	bool addPolylineEntity(const Entity& entity)
+	{
+		const qreal maximumSegmentAngle = M_PI / 18;
+
+		bool closed = ((entity.flags & 1) != 0);
+		int vertexCount = entity.points.size();
+		QPolygonF polygon;
+
+		// Bulged segments are circular arcs, which are approximated by additional vertices
+		for(int index = 0; index < vertexCount; index++)
+		{
+			QPointF p1 = entity.points[index];
+			polygon.append(p1);
+
+			qreal bulge = entity.bulges.value(index);
+			if (bulge == 0 || (!closed && index == vertexCount - 1)) continue;
+
+			QPointF p2 = entity.points[(index + 1) % vertexCount];
+			qreal chord = QLineF(p1, p2).length();
+			if (chord == 0) continue;
+
+			qreal includedAngle = 4 * qAtan(bulge);
+			qreal distance = (chord / 2) / qTan(includedAngle / 2);
+			QPointF normal(-(p2.y() - p1.y()) / chord, (p2.x() - p1.x()) / chord);
+			QPointF center = (p1 + p2) / 2 + normal * distance;
+			qreal radius = QLineF(center, p1).length();
+			qreal startAngle = qAtan2(p1.y() - center.y(), p1.x() - center.x());
+
+			int segmentCount = qMax(1, qCeil(qAbs(includedAngle) / maximumSegmentAngle));
+			for(int segment = 1; segment < segmentCount; segment++)
+			{
+				qreal angle = startAngle + includedAngle * segment / segmentCount;
+				polygon.append(center + radius * QPointF(qCos(angle), qSin(angle)));
+			}
+		}
+
+		if (closed)
+			return addPolygon(mTransform.map(polygon), styleValues(entity, PolygonShape));
+
+		return addPolyline(mTransform.map(polygon), styleValues(entity, PolylineShape));
+	}
+
+	StyleValues styleValues(const Entity& entity, ShapeType type) const
+	{
+		StyleValues values;
+		qreal scale = qSqrt(qAbs(mTransform.determinant()));
+
+		// Color 256 is BYLAYER and color 0 is BYBLOCK; blocks are not imported
+		int colorIndex = entity.color;
+		if (colorIndex == 256) colorIndex = mLayerColors.value(entity.layer, 7);
+		else if (colorIndex == 0) colorIndex = 7;
+		QColor color = aciColor(colorIndex);
+
+		if (type == TextShape)
+		{
+			values.insert(DrawingItemStyle::TextColor, color);
+			if (entity.radius > 0) values.insert(DrawingItemStyle::FontSize, entity.radius * scale);
+			values.insert(DrawingItemStyle::TextHorizontalAlignment, (uint)Qt::AlignLeft);
+			values.insert(DrawingItemStyle::TextVerticalAlignment, (uint)Qt::AlignBottom);
+		}
+		else
+		{
+			values.insert(DrawingItemStyle::PenStyle, (uint)Qt::SolidLine);
+			values.insert(DrawingItemStyle::PenColor, color);
+			if (entity.width > 0) values.insert(DrawingItemStyle::PenWidth, entity.width * scale);
+
+			if (type == PolygonShape || type == PathShape)
+				values.insert(DrawingItemStyle::BrushStyle, (uint)Qt::NoBrush);
+		}
+
+		return values;
+	}
+
+	// Approximates the AutoCAD Color Index palette
+	static QColor aciColor(int index)
+	{
+		static const QRgb standardColors[] = { qRgb(0, 0, 0), qRgb(255, 0, 0), qRgb(255, 255, 0),
+			qRgb(0, 255, 0), qRgb(0, 255, 255), qRgb(0, 0, 255), qRgb(255, 0, 255), qRgb(0, 0, 0),
+			qRgb(128, 128, 128), qRgb(192, 192, 192) };
+		static const int grayLevels[] = { 51, 80, 105, 130, 190, 255 };
+		static const int values[] = { 255, 255, 204, 204, 153, 153, 127, 127, 76, 76 };
+
+		QColor color(standardColors[7]);
+
+		if (index >= 0 && index <= 9)
+			color = QColor(standardColors[index]);
+		else if (index >= 250 && index <= 255)
+			color = QColor(grayLevels[index - 250], grayLevels[index - 250], grayLevels[index - 250]);
+		else if (index >= 10 && index < 250)
+		{
+			int hue = ((index - 10) / 10) * 15;
+			int shade = index % 10;
+			color = QColor::fromHsv(hue, (shade % 2 == 0) ? 255 : 127, values[shade]);
+		}
+
+		return color;
+	}
+
+	// Removes MTEXT formatting codes, leaving paragraph breaks as new lines
+	static QString plainText(const QString& text)
+	{
+		static const QRegularExpression formatCodes("\\\\[ACcFfHhQTWp][^;]*;|\\\\[LlOoKk]|[{}]");
+
+		QString result = text;
+		result.replace("\\P", "\n");
+		result.remove(formatCodes);
+		return result;
+	}
+};
+
+//==================================================================================================
+
+DrawingImporter::DrawingImporter(DrawingScene* scene, QObject* parent) : QObject(parent)
+{
+	mScene = scene;
+
+	mBatchSize = 1000;
+	mMaximumQueuedBatches = 4;
+
+	mItemCount = 0;
+}
+
+DrawingImporter::~DrawingImporter() { }
+
+//==================================================================================================
+
+void DrawingImporter::setTransform(const QTransform& transform)
+{
+	mTransform = transform;
+}
+
+QTransform DrawingImporter::transform() const
+{
+	return mTransform;
+}
+
+void DrawingImporter::setBatchSize(int count)
+{
+	mBatchSize = qMax(count, 1);
+}
+
+int DrawingImporter::batchSize() const
+{
+	return mBatchSize;
+}
+
+void DrawingImporter::setMaximumQueuedBatches(int count)
+{
+	mMaximumQueuedBatches = qMax(count, 1);
+}
+
+int DrawingImporter::maximumQueuedBatches() const
+{
+	return mMaximumQueuedBatches;
+}
+
+//==================================================================================================
+
+bool DrawingImporter::importFile(const QString& fileName, Format format)
+{
+	QFile file(fileName);
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		mErrorString = file.errorString();
+		return false;
+	}
+
+	return importDevice(&file, format);
+}
+
+bool DrawingImporter::importDevice(QIODevice* device, Format format)
+{
+	mCanceled.storeRelease(0);
+	mErrorString.clear();
+	mItemCount = 0;
+
+	if (!mScene)
+	{
+		mErrorString = tr("No scene to import into");
+		return false;
+	}
+
+	if (!device || !device->isReadable())
+	{
+		mErrorString = tr("Device is not open for reading");
+		return false;
+	}
+
+	DrawingImportQueue queue(mMaximumQueuedBatches);
+	QScopedPointer<DrawingImportParser> parser;
+
+	if (format == DxfFormat)
+	{
+		parser.reset(new DrawingDxfImportParser(device, mTransform, mBatchSize, mScene->itemArena(),
+			mScene->styleDefaults(), &queue, &mCanceled));
+	}
+	else
+	{
+		parser.reset(new DrawingSvgImportParser(device, mTransform, mBatchSize, mScene->itemArena(),
+			mScene->styleDefaults(), &queue, &mCanceled));
+	}
+
+	// The file is parsed on the worker thread while the previous batch is added to the scene
+	QThreadPool threadPool;
+	threadPool.setMaxThreadCount(1);
+	threadPool.start(parser.data());
+
+	const qint64 totalBytes = (device->isSequential()) ? 0 : device->size();
+	QList<DrawingItem*> importedItems;
+	DrawingImportBatch batch;
+
+	while (queue.pop(batch))
+	{
+		// Batches still queued after a cancel are discarded, which also lets the parser finish
+		if (isCanceled())
+			qDeleteAll(batch.items);
+		else
+		{
+			mScene->addItems(batch.items);
+			importedItems.append(batch.items);
+			emit progressChanged(batch.position, totalBytes);
+		}
+	}
+
+	threadPool.waitForDone();
+
+	bool success = !isCanceled() && parser->errorString().isEmpty();
+	if (success)
+		mItemCount = importedItems.size();
+	else
+	{
+		mErrorString = (isCanceled()) ? tr("Import canceled") : parser->errorString();
+
+		mScene->removeItems(importedItems);
+		qDeleteAll(importedItems);
+	}
+
+	return success;
+}
+
+int DrawingImporter::itemCount() const
+{
+	return mItemCount;
+}
+
+QString DrawingImporter::errorString() const
+{
+	return mErrorString;
+}
+
+bool DrawingImporter::isCanceled() const
+{
+	return (mCanceled.loadAcquire() != 0);
+}
+
+//==================================================================================================
+
+void DrawingImporter::cancel()
+{
+	mCanceled.storeRelease(1);
+}
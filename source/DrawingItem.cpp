@@ -21,10 +21,31 @@
 #include "DrawingItem.h"
 #include "DrawingItemPoint.h"
 #include "DrawingItemStyle.h"
+#include "DrawingItemFactory.h"
+#include "DrawingArena.h"
+
+struct DrawingItem::TransformData
+{
+	QTransform transform;
+	QTransform inverse;
+};
+
+// Matrix elements (m11, m12, m21, m22) for each of the axis-aligned orientations
+static const qint8 kOrientationMatrix[8][4] = {
+	{ 1, 0, 0, 1 }, { 0, 1, -1, 0 }, { -1, 0, 0, -1 }, { 0, -1, 1, 0 },
+	{ -1, 0, 0, 1 }, { 0, -1, -1, 0 }, { 1, 0, 0, -1 }, { 0, 1, 1, 0 }
+};
+
+// Render flags set by DrawingItem::setRenderFlags(), kept per thread
+static thread_local int threadRenderFlags = 0;
 
 DrawingItem::DrawingItem()
 {
 	mScene = nullptr;
+	mId = 0;
+
+	mOrientation = Rotate0;
+	mTransform = nullptr;
 
 	mFlags = (CanMove | CanResize | CanRotate | CanFlip | CanSelect);
 	mStyle = new DrawingItemStyle();
@@ -38,10 +59,11 @@ DrawingItem::DrawingItem()
 DrawingItem::DrawingItem(const DrawingItem& item)
 {
 	mScene = nullptr;
+	mId = 0;
 
 	mPosition = item.mPosition;
-	mTransform = item.mTransform;
-	mTransformInverse = item.mTransformInverse;
+	mOrientation = item.mOrientation;
+	mTransform = (item.mTransform) ? new TransformData(*item.mTransform) : nullptr;
 
 	mFlags = item.mFlags;
 	mStyle = new DrawingItemStyle(*item.mStyle);
@@ -62,12 +84,25 @@ DrawingItem::~DrawingItem()
 	clearPoints();
 	clearChildren();
 	delete mStyle;
+	delete mTransform;
 	mParent = nullptr;
 	mScene = nullptr;
 }
 
 //==================================================================================================
 
+void* DrawingItem::operator new(size_t size)
+{
+	return DrawingArena::allocate(size);
+}
+
+void DrawingItem::operator delete(void* ptr)
+{
+	DrawingArena::deallocate(ptr);
+}
+
+//==================================================================================================
+
 DrawingScene* DrawingItem::scene() const
 {
 	return mScene;
@@ -75,6 +110,18 @@ DrawingScene* DrawingItem::scene() const
 
 //==================================================================================================
 
+void DrawingItem::setId(quint64 id)
+{
+	if (mScene == nullptr) mId = id;
+}
+
+quint64 DrawingItem::id() const
+{
+	return mId;
+}
+
+//==================================================================================================
+
 void DrawingItem::setPosition(const QPointF& pos)
 {
 	mPosition = pos;
@@ -98,7 +145,7 @@ void DrawingItem::setY(qreal y)
 
 QPointF DrawingItem::position() const
 {
-	return mPosition;
+	return mPosition.toPointF();
 }
 
 qreal DrawingItem::x() const
@@ -115,20 +162,23 @@ qreal DrawingItem::y() const
 
 void DrawingItem::setTransform(const QTransform& transform, bool combine)
 {
-	if (combine) mTransform = mTransform * transform;
-	else mTransform = transform;
-
-	mTransformInverse = mTransform.inverted();
+	if (combine) setTransformData(this->transform() * transform);
+	else setTransformData(transform);
 }
 
 QTransform DrawingItem::transform() const
 {
-	return mTransform;
+	return (mTransform) ? mTransform->transform : orientationTransform(mOrientation);
 }
 
 QTransform DrawingItem::transformInverted() const
 {
-	return mTransformInverse;
+	return (mTransform) ? mTransform->inverse : orientationTransform(mOrientation).transposed();
+}
+
+DrawingItem::Orientation DrawingItem::orientation() const
+{
+	return (mTransform) ? CustomOrientation : static_cast<Orientation>(mOrientation);
 }
 
 //==================================================================================================
@@ -267,19 +317,18 @@ DrawingItemPoint* DrawingItem::itemPointToRemove(const QPointF& itemPos)
 
 void DrawingItem::addChild(DrawingItem* item)
 {
-	if (item && item->mParent == nullptr)
-	{
-		mChildren.append(item);
-		item->mParent = this;
-	}
+	insertChild(mChildren.size(), item);
 }
 
 void DrawingItem::insertChild(int index, DrawingItem* item)
 {
-	if (item && item->mParent == nullptr)
+	if (item && item->mParent == nullptr && item->mScene == nullptr)
 	{
 		mChildren.insert(index, item);
 		item->mParent = this;
+
+		// Children added after the item joined a scene are registered so that their ids resolve
+		if (mScene) mScene->registerChildItem(item);
 	}
 }
 
@@ -287,6 +336,8 @@ void DrawingItem::removeChild(DrawingItem* item)
 {
 	if (item && item->mParent == this)
 	{
+		if (mScene) mScene->unregisterItem(item);
+
 		mChildren.removeAll(item);
 		item->mParent = nullptr;
 	}
@@ -296,7 +347,7 @@ void DrawingItem::clearChildren()
 {
 	DrawingItem* item = nullptr;
 
-	while (!mPoints.empty())
+	while (!mChildren.empty())
 	{
 		item = mChildren.first();
 		removeChild(item);
@@ -341,7 +392,8 @@ bool DrawingItem::isSelected() const
 
 QPointF DrawingItem::mapFromParent(const QPointF& point) const
 {
-	return mTransform.map(point - mPosition);
+	if (mTransform) return mTransform->transform.map(point - mPosition.toPointF());
+	return mapByOrientation(mOrientation, point - mPosition.toPointF());
 }
 
 QPolygonF DrawingItem::mapFromParent(const QRectF& rect) const
@@ -352,20 +404,26 @@ QPolygonF DrawingItem::mapFromParent(const QRectF& rect) const
 QPolygonF DrawingItem::mapFromParent(const QPolygonF& polygon) const
 {
 	QPolygonF poly = polygon;
-	poly.translate(-mPosition);
-	return mTransform.map(poly);
+	poly.translate(-mPosition.toPointF());
+	if (mTransform) return mTransform->transform.map(poly);
+
+	for(auto pointIter = poly.begin(); pointIter != poly.end(); pointIter++)
+		*pointIter = mapByOrientation(mOrientation, *pointIter);
+	return poly;
 }
 
 QPainterPath DrawingItem::mapFromParent(const QPainterPath& path) const
 {
 	QPainterPath painterPath = path;
-	painterPath.translate(-mPosition);
-	return mTransform.map(painterPath);
+	painterPath.translate(-mPosition.toPointF());
+	if (mTransform) return mTransform->transform.map(painterPath);
+	return (mOrientation == Rotate0) ? painterPath : orientationTransform(mOrientation).map(painterPath);
 }
 
 QPointF DrawingItem::mapToParent(const QPointF& point) const
 {
-	return mTransformInverse.map(point) + mPosition;
+	if (mTransform) return mTransform->inverse.map(point) + mPosition.toPointF();
+	return mapByOrientationInverted(mOrientation, point) + mPosition.toPointF();
 }
 
 QPolygonF DrawingItem::mapToParent(const QRectF& rect) const
@@ -375,15 +433,29 @@ QPolygonF DrawingItem::mapToParent(const QRectF& rect) const
 
 QPolygonF DrawingItem::mapToParent(const QPolygonF& polygon) const
 {
-	QPolygonF poly = mTransformInverse.map(polygon);
-	poly.translate(mPosition);
+	QPolygonF poly;
+
+	if (mTransform) poly = mTransform->inverse.map(polygon);
+	else
+	{
+		poly = polygon;
+		for(auto pointIter = poly.begin(); pointIter != poly.end(); pointIter++)
+			*pointIter = mapByOrientationInverted(mOrientation, *pointIter);
+	}
+
+	poly.translate(mPosition.toPointF());
 	return poly;
 }
 
 QPainterPath DrawingItem::mapToParent(const QPainterPath& path) const
 {
-	QPainterPath painterPath = mTransformInverse.map(path);
-	painterPath.translate(mPosition);
+	QPainterPath painterPath;
+
+	if (mTransform) painterPath = mTransform->inverse.map(path);
+	else if (mOrientation == Rotate0) painterPath = path;
+	else painterPath = orientationTransform(mOrientation).transposed().map(path);
+
+	painterPath.translate(mPosition.toPointF());
 	return painterPath;
 }
 
@@ -450,6 +522,107 @@ bool DrawingItem::isValid() const
 
 //==================================================================================================
 
+void DrawingItem::writeState(QDataStream& stream) const
+{
+	stream << mPosition.toPointF() << (mTransform != nullptr);
+	if (mTransform) stream << mTransform->transform;
+	else stream << mOrientation;
+	stream << static_cast<quint32>(mFlags) << mVisible;
+
+	stream << static_cast<quint32>(mPoints.size());
+	for(auto pointIter = mPoints.begin(); pointIter != mPoints.end(); pointIter++)
+		stream << (*pointIter)->position() << static_cast<quint32>((*pointIter)->flags());
+
+	QHash<DrawingItemStyle::Property,QVariant> styleValues;
+	if (mStyle) styleValues = mStyle->values();
+
+	// Style values are written in property order, so that equal styles give equal states
+	stream << static_cast<quint32>(styleValues.size());
+	for(int property = 0; property < DrawingItemStyle::NumberOfProperties; property++)
+	{
+		auto valueIter = styleValues.constFind(static_cast<DrawingItemStyle::Property>(property));
+		if (valueIter != styleValues.constEnd())
+			stream << static_cast<quint32>(property) << valueIter.value();
+	}
+
+	stream << static_cast<quint32>(mChildren.size());
+	for(auto childIter = mChildren.begin(); childIter != mChildren.end(); childIter++)
+		DrawingItemFactory::writeItem(stream, *childIter);
+}
+
+void DrawingItem::readState(QDataStream& stream)
+{
+	QPointF position;
+	bool customTransform = false;
+	QTransform transform;
+	quint8 orientation = Rotate0;
+	quint32 flags = 0, count = 0;
+	bool visible = true;
+
+	stream >> position >> customTransform;
+	if (customTransform) stream >> transform;
+	else stream >> orientation;
+	stream >> flags >> visible;
+
+	mPosition = position;
+	setTransformData((customTransform) ? transform : orientationTransform(orientation % 8));
+	mFlags = Flags(flags);
+	mVisible = visible;
+
+	// Item points
+	QPointF pointPosition;
+	quint32 pointFlags = 0;
+	DrawingItemPoint* itemPoint;
+
+	stream >> count;
+	for(quint32 index = 0; index < count && stream.status() == QDataStream::Ok; index++)
+	{
+		stream >> pointPosition >> pointFlags;
+
+		if (index < static_cast<quint32>(mPoints.size()))
+		{
+			mPoints[index]->setPosition(pointPosition);
+			mPoints[index]->setFlags(DrawingItemPoint::Flags(pointFlags));
+		}
+		else addPoint(new DrawingItemPoint(pointPosition, DrawingItemPoint::Flags(pointFlags)));
+	}
+
+	while (static_cast<quint32>(mPoints.size()) > count)
+	{
+		itemPoint = mPoints.last();
+		removePoint(itemPoint);
+		delete itemPoint;
+	}
+
+	// Style
+	QHash<DrawingItemStyle::Property,QVariant> styleValues;
+	quint32 property = 0;
+	QVariant value;
+
+	stream >> count;
+	for(quint32 index = 0; index < count && stream.status() == QDataStream::Ok; index++)
+	{
+		stream >> property >> value;
+		styleValues.insert(static_cast<DrawingItemStyle::Property>(property), value);
+	}
+
+	if (mStyle) mStyle->setValues(styleValues);
+
+	// Children
+	DrawingItem* child;
+
+	clearChildren();
+
+	stream >> count;
+	for(quint32 index = 0; index < count && stream.status() == QDataStream::Ok; index++)
+	{
+		child = DrawingItemFactory::readItem(stream);
+		if (child) addChild(child);
+	}
+}
+
+//==================================================================================================
+
 void DrawingItem::moveEvent(const QPointF& parentPos)
 {
 	QHash<DrawingItem*,QPointF> originalScenePos;
@@ -469,34 +642,26 @@ void DrawingItem::resizeEvent(DrawingItemPoint* itemPoint, const QPointF& parent
 	if (itemPoint)
 	{
 		itemPoint->setPosition(mapFromParent(parentPos));
-
-		if (mFlags & AdjustPositionOnResize)
-		{
-			// Adjust position of item and item points so that point(0)->position() == QPointF(0, 0)
-			QPointF deltaPos = -mPoints.first()->position();
-			QPointF pointParentPos = mapToParent(mPoints.first()->position());
-
-			for(auto pointIter = mPoints.begin(); pointIter != mPoints.end(); pointIter++)
-				(*pointIter)->setPosition((*pointIter)->position() + deltaPos);
-
-			for(auto childIter = mChildren.begin(); childIter != mChildren.end(); childIter++)
-				(*childIter)->setPosition((*childIter)->position() + deltaPos);
-
-			setPosition(pointParentPos);
-		}
+		if (mFlags & AdjustPositionOnResize) adjustPositionToFirstPoint();
 	}
 }
 
+void DrawingItem::resizePointsEvent(const QVector<DrawingItemPoint*>& itemPoints,
+	const QVector<QPointF>& parentPos)
+{
+	for(int index = 0; index < itemPoints.size() && index < parentPos.size(); index++)
+		resizeEvent(itemPoints[index], parentPos[index]);
+}
+
 void DrawingItem::rotateEvent(const QPointF& parentPos)
 {
-	QPointF difference(mPosition - parentPos);
+	QPointF difference(mPosition.toPointF() - parentPos);
 
 	// Calculate new position of reference point
 	mPosition = QPointF(parentPos.x() + difference.y(), parentPos.y() - difference.x());
 
 	// Update orientation
-	mTransform.rotate(90);
-	mTransformInverse = mTransform.inverted();
+	combineOrientation(Rotate90);
 
 	// Don't apply rotation to children
 	for(auto childIter = mChildren.begin(); childIter != mChildren.end(); childIter++)
@@ -505,14 +670,13 @@ void DrawingItem::rotateEvent(const QPointF& parentPos)
 
 void DrawingItem::rotateBackEvent(const QPointF& parentPos)
 {
-	QPointF difference(mPosition - parentPos);
+	QPointF difference(mPosition.toPointF() - parentPos);
 
 	// Calculate new position of reference point
 	mPosition = QPointF(parentPos.x() - difference.y(), parentPos.y() + difference.x());
 
 	// Update orientation
-	mTransform.rotate(-90);
-	mTransformInverse = mTransform.inverted();
+	combineOrientation(Rotate270);
 
 	// Don't apply rotation to children
 	for(auto childIter = mChildren.begin(); childIter != mChildren.end(); childIter++)
@@ -525,8 +689,7 @@ void DrawingItem::flipHorizontalEvent(const QPointF& parentPos)
 	mPosition.setX(2 * parentPos.x() - mPosition.x());
 
 	// Update orientation
-	mTransform.scale(-1, 1);
-	mTransformInverse = mTransform.inverted();
+	combineOrientation(FlipRotate0);
 
 	// Don't apply flip to children
 	for(auto childIter = mChildren.begin(); childIter != mChildren.end(); childIter++)
@@ -539,8 +702,7 @@ void DrawingItem::flipVerticalEvent(const QPointF& parentPos)
 	mPosition.setY(2 * parentPos.y() - mPosition.y());
 
 	// Update orientation
-	mTransform.scale(1, -1);
-	mTransformInverse = mTransform.inverted();
+	combineOrientation(FlipRotate180);
 
 	// Don't apply flip to children
 	for(auto childIter = mChildren.begin(); childIter != mChildren.end(); childIter++)
@@ -559,6 +721,24 @@ void DrawingItem::keyReleaseEvent(QKeyEvent* event)
 
 //==================================================================================================
 
+void DrawingItem::adjustPositionToFirstPoint()
+{
+	if (!mPoints.isEmpty())
+	{
+		// Adjust position of item and item points so that point(0)->position() == QPointF(0, 0)
+		QPointF deltaPos = -mPoints.first()->position();
+		QPointF pointParentPos = mapToParent(mPoints.first()->position());
+
+		for(auto pointIter = mPoints.begin(); pointIter != mPoints.end(); pointIter++)
+			(*pointIter)->setPosition((*pointIter)->position() + deltaPos);
+
+		for(auto childIter = mChildren.begin(); childIter != mChildren.end(); childIter++)
+			(*childIter)->setPosition((*childIter)->position() + deltaPos);
+
+		setPosition(pointParentPos);
+	}
+}
+
 QPainterPath DrawingItem::strokePath(const QPainterPath& path, const QPen& pen) const
 {
 	if (path == QPainterPath()) return path;
@@ -581,11 +761,133 @@ QPainterPath DrawingItem::strokePath(const QPainterPath& path, const QPen& pen)
 	return ps.createStroke(path);
 }
 
+QPen DrawingItem::renderPen(const QPen& pen) const
+{
+	QPen renderPen = pen;
+
+	if ((threadRenderFlags & DraftPens) && pen.style() != Qt::NoPen)
+	{
+		// A pen width of 0 draws a cosmetic one-pixel line, which is the fastest stroke available
+		renderPen.setWidthF(0);
+		renderPen.setCosmetic(true);
+	}
+
+	return renderPen;
+}
+
+void DrawingItem::renderText(QPainter* painter, const QRectF& rect, int flags, const QString& text) const
+{
+	if (threadRenderFlags & (DraftText | BoundingBoxText))
+	{
+		qreal scale = qSqrt(qAbs(painter->transform().determinant()));
+		qreal pixelHeight = QFontMetricsF(painter->font()).height() * scale;
+
+		if ((threadRenderFlags & BoundingBoxText) || pixelHeight < 6)
+		{
+			// Text this small is not legible anyway, so skip laying it out
+			QColor color = painter->pen().color();
+			color.setAlphaF(color.alphaF() / 3);
+			painter->fillRect(rect, color);
+		}
+		else
+		{
+			QFont sceneFont = painter->font();
+			QFont draftFont = sceneFont;
+			draftFont.setStyleStrategy(QFont::NoAntialias);
+
+			painter->setFont(draftFont);
+			painter->drawText(rect, flags, text);
+			painter->setFont(sceneFont);
+		}
+	}
+	else painter->drawText(rect, flags, text);
+}
+
+//==================================================================================================
+
+void DrawingItem::setTransformData(const QTransform& transform)
+{
+	int orientation = -1;
+
+	if (transform.isAffine() && transform.dx() == 0 && transform.dy() == 0)
+	{
+		for(int index = 0; orientation < 0 && index < 8; index++)
+		{
+			if (transform.m11() == kOrientationMatrix[index][0] && transform.m12() == kOrientationMatrix[index][1] &&
+				transform.m21() == kOrientationMatrix[index][2] && transform.m22() == kOrientationMatrix[index][3])
+			{
+				orientation = index;
+			}
+		}
+	}
+
+	if (orientation >= 0)
+	{
+		mOrientation = static_cast<quint8>(orientation);
+		delete mTransform;
+		mTransform = nullptr;
+	}
+	else
+	{
+		if (mTransform == nullptr) mTransform = new TransformData();
+		mTransform->transform = transform;
+		mTransform->inverse = transform.inverted();
+	}
+}
+
+void DrawingItem::combineOrientation(Orientation orientation)
+{
+	if (mTransform)
+	{
+		// Equivalent to QTransform::rotate() / QTransform::scale() on the current matrix
+		setTransformData(orientationTransform(orientation) * mTransform->transform);
+	}
+	else
+	{
+		const qint8* a = kOrientationMatrix[orientation];
+		const qint8* b = kOrientationMatrix[mOrientation];
+		const int m11 = a[0] * b[0] + a[1] * b[2];
+		const int m12 = a[0] * b[1] + a[1] * b[3];
+		const int m21 = a[2] * b[0] + a[3] * b[2];
+		const int m22 = a[2] * b[1] + a[3] * b[3];
+
+		for(int index = 0; index < 8; index++)
+		{
+			if (m11 == kOrientationMatrix[index][0] && m12 == kOrientationMatrix[index][1] &&
+				m21 == kOrientationMatrix[index][2] && m22 == kOrientationMatrix[index][3])
+			{
+				mOrientation = static_cast<quint8>(index);
+				break;
+			}
+		}
+	}
+}
+
+QPointF DrawingItem::mapByOrientation(quint8 orientation, const QPointF& point)
+{
+	const qint8* m = kOrientationMatrix[orientation];
+	return QPointF(m[0] * point.x() + m[2] * point.y(), m[1] * point.x() + m[3] * point.y());
+}
+
+QPointF DrawingItem::mapByOrientationInverted(quint8 orientation, const QPointF& point)
+{
+	// The inverse of an axis-aligned orientation matrix is its transpose
+	const qint8* m = kOrientationMatrix[orientation];
+	return QPointF(m[0] * point.x() + m[1] * point.y(), m[2] * point.x() + m[3] * point.y());
+}
+
+QTransform DrawingItem::orientationTransform(quint8 orientation)
+{
+	const qint8* m = kOrientationMatrix[orientation];
+	return QTransform(m[0], m[1], m[2], m[3], 0, 0);
+}
+
 //==================================================================================================
 
 QList<DrawingItem*> DrawingItem::copyItems(const QList<DrawingItem*>& items)
 {
 	QList<DrawingItem*> copiedItems;
+	QHash<DrawingItem*,int> copiedIndex;
 	QList<DrawingItemPoint*> itemPoints;
 	QList<DrawingItemPoint*> targetPoints;
 	DrawingItem* targetItem;
@@ -595,7 +897,10 @@ QList<DrawingItem*> DrawingItem::copyItems(const QList<DrawingItem*>& items)
 
 	// Copy items
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+	{
+		copiedIndex.insert(*itemIter, copiedItems.size());
 		copiedItems.append((*itemIter)->copy());
+	}
 
 	// Maintain connections to other items in this list
 	for(int itemIndex = 0; itemIndex < items.size(); itemIndex++)
@@ -607,12 +912,12 @@ QList<DrawingItem*> DrawingItem::copyItems(const QList<DrawingItem*>& items)
 			for(auto targetIter = targetPoints.begin(); targetIter != targetPoints.end(); targetIter++)
 			{
 				targetItem = (*targetIter)->item();
-				if (items.contains(targetItem))
+				if (copiedIndex.contains(targetItem))
 				{
 					// There is a connection here that must be maintained in the copied items
 					copiedPoint = copiedItems[itemIndex]->points().at(pointIndex);
 
-					copiedTargetItem = copiedItems[items.indexOf(targetItem)];
+					copiedTargetItem = copiedItems[copiedIndex.value(targetItem)];
 					copiedTargetPoint =
 						copiedTargetItem->points().at(targetItem->points().indexOf(*targetIter));
 
@@ -628,3 +933,15 @@ QList<DrawingItem*> DrawingItem::copyItems(const QList<DrawingItem*>& items)
 
 	return copiedItems;
 }
+
+//==================================================================================================
+
+void DrawingItem::setRenderFlags(RenderFlags flags)
+{
+	threadRenderFlags = static_cast<int>(flags);
+}
+
+DrawingItem::RenderFlags DrawingItem::renderFlags()
+{
+	return RenderFlags(threadRenderFlags);
+}
@@ -0,0 +1,222 @@
+/* DrawingItemFactory.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingItemFactory.h"
+#include "DrawingArena.h"
+#include "DrawingArcItem.h"
+#include "DrawingCurveItem.h"
+#include "DrawingEllipseItem.h"
+#include "DrawingItemGroup.h"
+#include "DrawingLineItem.h"
+#include "DrawingPathItem.h"
+#include "DrawingPolygonItem.h"
+#include "DrawingPolylineItem.h"
+#include "DrawingRectItem.h"
+#include "DrawingTextEllipseItem.h"
+#include "DrawingTextItem.h"
+#include "DrawingTextPolygonItem.h"
+#include "DrawingTextRectItem.h"
+#include <typeinfo>
+
+// Set by canonicalState() while child items are written without their ids
+static thread_local bool writeCanonicalItems = false;
+
+template<class T> static DrawingItem* constructItem()
+{
+	return new T();
+}
+
+//==================================================================================================
+
+struct DrawingItemFactoryRegistry
+{
+	QMutex mutex;
+	QHash<QString,DrawingItem*> prototypes;
+	QHash<QString,DrawingItemFactory::CreateFunction> createFunctions;
+	QHash<QByteArray,QString> typeNames;
+
+	DrawingItemFactoryRegistry()
+	{
+		add("arc", constructItem<DrawingArcItem>);
+		add("curve", constructItem<DrawingCurveItem>);
+		add("ellipse", constructItem<DrawingEllipseItem>);
+		add("group", constructItem<DrawingItemGroup>);
+		add("line", constructItem<DrawingLineItem>);
+		add("path", constructItem<DrawingPathItem>);
+		add("polygon", constructItem<DrawingPolygonItem>);
+		add("polyline", constructItem<DrawingPolylineItem>);
+		add("rect", constructItem<DrawingRectItem>);
+		add("textEllipse", constructItem<DrawingTextEllipseItem>);
+		add("text", constructItem<DrawingTextItem>);
+		add("textPolygon", constructItem<DrawingTextPolygonItem>);
+		add("textRect", constructItem<DrawingTextRectItem>);
+	}
+
+	~DrawingItemFactoryRegistry()
+	{
+		qDeleteAll(prototypes);
+	}
+
+	void add(const QString& typeName, DrawingItem* prototype)
+	{
+		remove(typeName);
+
+		prototypes.insert(typeName, prototype);
+		typeNames.insert(QByteArray(typeid(*prototype).name()), typeName);
+	}
+
+	void add(const QString& typeName, DrawingItemFactory::CreateFunction create)
+	{
+		// The registry may be used inside a scene's DrawingArenaScope; the item constructed to
+		// find the class name is deleted right away and must not be placed in one of its slabs
+		DrawingArenaScope arenaScope(nullptr);
+		DrawingItem* item = create();
+
+		remove(typeName);
+
+		createFunctions.insert(typeName, create);
+		typeNames.insert(QByteArray(typeid(*item).name()), typeName);
+
+		delete item;
+	}
+
+	void remove(const QString& typeName)
+	{
+		delete prototypes.take(typeName);
+		createFunctions.remove(typeName);
+	}
+
+	static DrawingItemFactoryRegistry& instance()
+	{
+		static DrawingItemFactoryRegistry registry;
+		return registry;
+	}
+};
+
+//==================================================================================================
+
+void DrawingItemFactory::registerItem(const QString& typeName, DrawingItem* prototype)
+{
+	if (prototype && !typeName.isEmpty())
+	{
+		DrawingItemFactoryRegistry& registry = DrawingItemFactoryRegistry::instance();
+		QMutexLocker locker(&registry.mutex);
+		registry.add(typeName, prototype);
+	}
+}
+
+void DrawingItemFactory::registerItem(const QString& typeName, CreateFunction create)
+{
+	if (create && !typeName.isEmpty())
+	{
+		DrawingItemFactoryRegistry& registry = DrawingItemFactoryRegistry::instance();
+		QMutexLocker locker(&registry.mutex);
+		registry.add(typeName, create);
+	}
+}
+
+DrawingItem* DrawingItemFactory::createItem(const QString& typeName)
+{
+	DrawingItemFactoryRegistry& registry = DrawingItemFactoryRegistry::instance();
+	DrawingItem* item = nullptr;
+
+	registry.mutex.lock();
+	CreateFunction create = registry.createFunctions.value(typeName, nullptr);
+	if (!create)
+	{
+		DrawingItem* prototype = registry.prototypes.value(typeName, nullptr);
+		if (prototype) item = prototype->copy();
+	}
+	registry.mutex.unlock();
+
+	// The item is constructed outside the mutex, since its constructor reads the current defaults
+	if (create) item = create();
+
+	return item;
+}
+
+QString DrawingItemFactory::typeName(const DrawingItem* item)
+{
+	QString typeName;
+
+	if (item)
+	{
+		DrawingItemFactoryRegistry& registry = DrawingItemFactoryRegistry::instance();
+		QMutexLocker locker(&registry.mutex);
+		typeName = registry.typeNames.value(QByteArray(typeid(*item).name()));
+	}
+
+	return typeName;
+}
+
+//==================================================================================================
+
+void DrawingItemFactory::writeItem(QDataStream& stream, const DrawingItem* item)
+{
+	QByteArray state;
+
+	if (item)
+	{
+		QDataStream stateStream(&state, QIODevice::WriteOnly);
+		stateStream.setVersion(stream.version());
+		item->writeState(stateStream);
+	}
+
+	stream << typeName(item) << ((item && !writeCanonicalItems) ? item->id() : Q_UINT64_C(0)) << state;
+}
+
+DrawingItem* DrawingItemFactory::readItem(QDataStream& stream)
+{
+	QString typeName;
+	quint64 id = 0;
+	QByteArray state;
+
+	stream >> typeName >> id >> state;
+
+	DrawingItem* item = (stream.status() == QDataStream::Ok) ? createItem(typeName) : nullptr;
+	if (item)
+	{
+		QDataStream stateStream(state);
+		stateStream.setVersion(stream.version());
+		item->readState(stateStream);
+		item->setId(id);
+	}
+
+	return item;
+}
+
+QByteArray DrawingItemFactory::canonicalState(const DrawingItem* item)
+{
+	QByteArray state;
+
+	if (item)
+	{
+		bool previousWriteCanonicalItems = writeCanonicalItems;
+		writeCanonicalItems = true;
+
+		QDataStream stream(&state, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_0);
+		item->writeState(stream);
+
+		writeCanonicalItems = previousWriteCanonicalItems;
+	}
+
+	return state;
+}
@@ -20,6 +20,7 @@
 
 #include "DrawingItemGroup.h"
 #include "DrawingItemPoint.h"
+#include "DrawingItemFactory.h"
 
 DrawingItemGroup::DrawingItemGroup() : DrawingItem()
 {
@@ -110,6 +111,35 @@ void DrawingItemGroup::render(QPainter* painter)
 
 //==================================================================================================
 
+void DrawingItemGroup::writeState(QDataStream& stream) const
+{
+	DrawingItem::writeState(stream);
+
+	stream << static_cast<quint32>(mItems.size());
+	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
+		DrawingItemFactory::writeItem(stream, *itemIter);
+}
+
+void DrawingItemGroup::readState(QDataStream& stream)
+{
+	DrawingItem::readState(stream);
+
+	QList<DrawingItem*> items;
+	DrawingItem* item;
+	quint32 count = 0;
+
+	stream >> count;
+	for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+	{
+		item = DrawingItemFactory::readItem(stream);
+		if (item) items.append(item);
+	}
+
+	setItems(items);
+}
+
+//==================================================================================================
+
 void DrawingItemGroup::recalculateContentsRect()
 {
 	// Update items rect
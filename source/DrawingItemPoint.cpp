@@ -20,6 +20,7 @@
 
 #include "DrawingItemPoint.h"
 #include "DrawingItem.h"
+#include "DrawingArena.h"
 
 DrawingItemPoint::DrawingItemPoint(const QPointF& position, Flags flags)
 {
@@ -42,6 +43,18 @@ DrawingItemPoint::~DrawingItemPoint()
 
 //==================================================================================================
 
+void* DrawingItemPoint::operator new(size_t size)
+{
+	return DrawingArena::allocate(size);
+}
+
+void DrawingItemPoint::operator delete(void* ptr)
+{
+	DrawingArena::deallocate(ptr);
+}
+
+//==================================================================================================
+
 DrawingItem* DrawingItemPoint::item() const
 {
 	return mItem;
@@ -72,7 +85,7 @@ void DrawingItemPoint::setY(qreal y)
 
 QPointF DrawingItemPoint::position() const
 {
-	return mPosition;
+	return mPosition.toPointF();
 }
 
 qreal DrawingItemPoint::x() const
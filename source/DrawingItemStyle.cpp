@@ -19,8 +19,8 @@
  */
 
 #include "DrawingItemStyle.h"
-
-QHash<DrawingItemStyle::Property,QVariant> DrawingItemStyle::mDefaultProperties;
+#include "DrawingArena.h"
+#include "DrawingStyleDefaults.h"
 
 DrawingItemStyle::DrawingItemStyle() { }
 
@@ -33,6 +33,18 @@ DrawingItemStyle::~DrawingItemStyle() { }
 
 //==================================================================================================
 
+void* DrawingItemStyle::operator new(size_t size)
+{
+	return DrawingArena::allocate(size);
+}
+
+void DrawingItemStyle::operator delete(void* ptr)
+{
+	DrawingArena::deallocate(ptr);
+}
+
+//==================================================================================================
+
 void DrawingItemStyle::setValues(const QHash<Property,QVariant>& values)
 {
 	mProperties = values;
@@ -74,22 +86,16 @@ QVariant DrawingItemStyle::value(Property index) const
 
 QVariant DrawingItemStyle::valueLookup(Property index) const
 {
-	QVariant value;
-
-	value = mDefaultProperties.value(index, value);
-	value = mProperties.value(index, value);
-
-	return value;
+	return valueLookup(index, QVariant());
 }
 
 QVariant DrawingItemStyle::valueLookup(Property index, const QVariant& fallbackValue) const
 {
-	QVariant value = fallbackValue;
-
-	value = mDefaultProperties.value(index, value);
-	value = mProperties.value(index, value);
+	// Most items set every property they use, so the defaults are only read when needed
+	auto valueIter = mProperties.constFind(index);
+	if (valueIter != mProperties.constEnd()) return valueIter.value();
 
-	return value;
+	return DrawingStyleDefaults::current()->value(index, fallbackValue);
 }
 
 //==================================================================================================
@@ -371,37 +377,37 @@ QPolygonF DrawingItemStyle::calculateArrowPoints(ArrowStyle style, qreal size,
 
 void DrawingItemStyle::setDefaultValues(const QHash<Property,QVariant>& values)
 {
-	mDefaultProperties = values;
+	DrawingStyleDefaults::global()->setValues(values);
 }
 
 QHash<DrawingItemStyle::Property,QVariant> DrawingItemStyle::defaultValues()
 {
-	return mDefaultProperties;
+	return DrawingStyleDefaults::global()->values();
 }
 
 //==================================================================================================
 
 void DrawingItemStyle::setDefaultValue(Property index, const QVariant& value)
 {
-	mDefaultProperties.insert(index, value);
+	DrawingStyleDefaults::global()->setValue(index, value);
 }
 
 void DrawingItemStyle::unsetDefaultValue(Property index)
 {
-	mDefaultProperties.remove(index);
+	DrawingStyleDefaults::global()->unsetValue(index);
 }
 
 void DrawingItemStyle::clearDefaultValues()
 {
-	mDefaultProperties.clear();
+	DrawingStyleDefaults::global()->clearValues();
 }
 
 bool DrawingItemStyle::hasDefaultValue(Property index)
 {
-	return mDefaultProperties.contains(index);
+	return DrawingStyleDefaults::global()->hasValue(index);
 }
 
 QVariant DrawingItemStyle::defaultValue(Property index)
 {
-	return mDefaultProperties.value(index, QVariant());
+	return DrawingStyleDefaults::global()->value(index);
 }
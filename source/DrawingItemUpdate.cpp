@@ -0,0 +1,73 @@
+/* DrawingItemUpdate.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingItemUpdate.h"
+
+DrawingItemUpdate::DrawingItemUpdate()
+{
+	mItemId = 0;
+	mType = PositionUpdate;
+	mProperty = DrawingItemStyle::PenStyle;
+}
+
+DrawingItemUpdate::DrawingItemUpdate(quint64 itemId, const QPointF& position)
+{
+	mItemId = itemId;
+	mType = PositionUpdate;
+	mPosition = position;
+	mProperty = DrawingItemStyle::PenStyle;
+}
+
+DrawingItemUpdate::DrawingItemUpdate(quint64 itemId, DrawingItemStyle::Property property, const QVariant& value)
+{
+	mItemId = itemId;
+	mType = StyleValueUpdate;
+	mProperty = property;
+	mValue = value;
+}
+
+DrawingItemUpdate::~DrawingItemUpdate() { }
+
+//==================================================================================================
+
+quint64 DrawingItemUpdate::itemId() const
+{
+	return mItemId;
+}
+
+DrawingItemUpdate::Type DrawingItemUpdate::type() const
+{
+	return mType;
+}
+
+QPointF DrawingItemUpdate::position() const
+{
+	return mPosition;
+}
+
+DrawingItemStyle::Property DrawingItemUpdate::property() const
+{
+	return mProperty;
+}
+
+QVariant DrawingItemUpdate::value() const
+{
+	return mValue;
+}
@@ -176,7 +176,7 @@ void DrawingLineItem::render(QPainter* painter)
 		qreal lineAngle = 180 * qAtan2(p2.y() - p1.y(), p2.x() - p1.x()) / 3.141592654;
 
 		DrawingItemStyle* style = DrawingItem::style();
-		QPen pen = style->pen();
+		QPen pen = renderPen(style->pen());
 		DrawingItemStyle::ArrowStyle startArrowStyle = style->startArrowStyle();
 		DrawingItemStyle::ArrowStyle endArrowStyle = style->endArrowStyle();
 		qreal startArrowSize = style->startArrowSize();
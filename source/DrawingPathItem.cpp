@@ -260,7 +260,7 @@ void DrawingPathItem::render(QPainter* painter)
 		QPen scenePen = painter->pen();
 
 		DrawingItemStyle* style = DrawingItem::style();
-		QPen pen = style->pen();
+		QPen pen = renderPen(style->pen());
 		QBrush brush = style->brush();
 
 		// Draw path
@@ -275,6 +275,37 @@ void DrawingPathItem::render(QPainter* painter)
 
 //==================================================================================================
 
+void DrawingPathItem::writeState(QDataStream& stream) const
+{
+	DrawingItem::writeState(stream);
+
+	QList<DrawingItemPoint*> points = DrawingPathItem::points();
+
+	stream << mName << mPath << mPathRect << static_cast<quint32>(mPathConnectionPoints.size());
+	for(auto keyIter = mPathConnectionPoints.begin(); keyIter != mPathConnectionPoints.end(); keyIter++)
+		stream << static_cast<quint32>(points.indexOf(keyIter.key())) << keyIter.value();
+}
+
+void DrawingPathItem::readState(QDataStream& stream)
+{
+	DrawingItem::readState(stream);
+
+	QList<DrawingItemPoint*> points = DrawingPathItem::points();
+	quint32 count = 0, pointIndex = 0;
+	QPointF pathPos;
+
+	stream >> mName >> mPath >> mPathRect >> count;
+
+	mPathConnectionPoints.clear();
+	for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+	{
+		stream >> pointIndex >> pathPos;
+		if (pointIndex < static_cast<quint32>(points.size())) mPathConnectionPoints[points[pointIndex]] = pathPos;
+	}
+}
+
+//==================================================================================================
+
 void DrawingPathItem::resizeEvent(DrawingItemPoint* itemPoint, const QPointF& parentPos)
 {
 	DrawingItem::resizeEvent(itemPoint, parentPos);
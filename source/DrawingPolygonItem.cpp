@@ -161,7 +161,7 @@ void DrawingPolygonItem::render(QPainter* painter)
 		QPen scenePen = painter->pen();
 
 		DrawingItemStyle* style = DrawingItem::style();
-		QPen pen = style->pen();
+		QPen pen = renderPen(style->pen());
 		QBrush brush = style->brush();
 
 		// Draw polygon
@@ -220,6 +220,19 @@ DrawingItemPoint* DrawingPolygonItem::itemPointToRemove(const QPointF& itemPos)
 
 //==================================================================================================
 
+void DrawingPolygonItem::resizePointsEvent(const QVector<DrawingItemPoint*>& itemPoints,
+	const QVector<QPointF>& parentPos)
+{
+	// The target positions do not depend on each other, so all points can be moved before the
+	// item's position is adjusted
+	for(int index = 0; index < itemPoints.size() && index < parentPos.size(); index++)
+		itemPoints[index]->setPosition(mapFromParent(parentPos[index]));
+
+	if (flags() & AdjustPositionOnResize) adjustPositionToFirstPoint();
+}
+
+//==================================================================================================
+
 qreal DrawingPolygonItem::distanceFromPointToLineSegment(const QPointF& point, const QLineF& line) const
 {
 	qreal distance = 1E10;
@@ -197,7 +197,7 @@ void DrawingPolylineItem::render(QPainter* painter)
 		qreal lastLineAngle = 180 * qAtan2(p3.y() - p2.y(), p3.x() - p2.x()) / 3.141592654;
 
 		DrawingItemStyle* style = DrawingItem::style();
-		QPen pen = style->pen();
+		QPen pen = renderPen(style->pen());
 		DrawingItemStyle::ArrowStyle startArrowStyle = style->startArrowStyle();
 		DrawingItemStyle::ArrowStyle endArrowStyle = style->endArrowStyle();
 		qreal startArrowSize = style->startArrowSize();
@@ -276,6 +276,19 @@ DrawingItemPoint* DrawingPolylineItem::itemPointToRemove(const QPointF& itemPos)
 
 //==================================================================================================
 
+void DrawingPolylineItem::resizePointsEvent(const QVector<DrawingItemPoint*>& itemPoints,
+	const QVector<QPointF>& parentPos)
+{
+	// The target positions do not depend on each other, so all points can be moved before the
+	// item's position is adjusted
+	for(int index = 0; index < itemPoints.size() && index < parentPos.size(); index++)
+		itemPoints[index]->setPosition(mapFromParent(parentPos[index]));
+
+	if (flags() & AdjustPositionOnResize) adjustPositionToFirstPoint();
+}
+
+//==================================================================================================
+
 qreal DrawingPolylineItem::distanceFromPointToLineSegment(const QPointF& point, const QLineF& line) const
 {
 	qreal distance = 1E10;
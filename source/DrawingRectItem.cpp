@@ -170,7 +170,7 @@ void DrawingRectItem::render(QPainter* painter)
 		QPen scenePen = painter->pen();
 
 		DrawingItemStyle* style = DrawingItem::style();
-		QPen pen = style->pen();
+		QPen pen = renderPen(style->pen());
 		QBrush brush = style->brush();
 
 		// Draw rect
@@ -185,6 +185,20 @@ void DrawingRectItem::render(QPainter* painter)
 
 //==================================================================================================
 
+void DrawingRectItem::writeState(QDataStream& stream) const
+{
+	DrawingItem::writeState(stream);
+	stream << mCornerRadiusX << mCornerRadiusY;
+}
+
+void DrawingRectItem::readState(QDataStream& stream)
+{
+	DrawingItem::readState(stream);
+	stream >> mCornerRadiusX >> mCornerRadiusY;
+}
+
+//==================================================================================================
+
 void DrawingRectItem::resizeEvent(DrawingItemPoint* itemPoint, const QPointF& parentPos)
 {
 	DrawingItem::resizeEvent(itemPoint, parentPos);
@@ -21,18 +21,183 @@
 #include "DrawingScene.h"
 #include "DrawingView.h"
 #include "DrawingItem.h"
+#include "DrawingItemFactory.h"
 #include "DrawingItemStyle.h"
 #include "DrawingItemPoint.h"
+#include "DrawingItemSource.h"
+#include "DrawingArena.h"
+#include "DrawingStyleDefaults.h"
+#include "DrawingCacheManager.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Approximate memory used by each entry of the item index table and by each materialized item
+static const qint64 itemIndexEntryCost = 64;
+static const qint64 materializedItemCost = 1024;
+
+// Items compacted into the arena are laid out again once this many of them, or a quarter of all
+// items, have been added, removed, or reordered
+static const int minimumCompactionChanges = 64;
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define DRAWINGSCENE_CULL_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DRAWINGSCENE_CULL_SSE2
+#endif
+
+static void insertEdge(QMap<qreal,int>& edges, qreal edge)
+{
+	edges[edge]++;
+}
+
+static void removeEdge(QMap<qreal,int>& edges, qreal edge)
+{
+	auto edgeIter = edges.find(edge);
+	if (edgeIter != edges.end() && --edgeIter.value() <= 0) edges.erase(edgeIter);
+}
+
+// Converts scene coordinates to float, rounding outward so that culling never misses an item
+static float floorToFloat(qreal value)
+{
+	float result = static_cast<float>(value);
+	return (result > value) ? std::nextafter(result, -std::numeric_limits<float>::infinity()) : result;
+}
+
+static float ceilToFloat(qreal value)
+{
+	float result = static_cast<float>(value);
+	return (result < value) ? std::nextafter(result, std::numeric_limits<float>::infinity()) : result;
+}
+
+// Copies the state that DrawingItem::copy() does not carry over from an item and its children to
+// their compacted copies, and records which point of each copy replaces which original point
+static void copyCompactedItem(DrawingItem* item, DrawingItem* copy,
+	QHash<DrawingItemPoint*,DrawingItemPoint*>& replacedPoints)
+{
+	copy->setId(item->id());
+	copy->setVisible(item->isVisible());
+
+	QList<DrawingItemPoint*> points = item->points();
+	QList<DrawingItemPoint*> copyPoints = copy->points();
+	for(int index = 0; index < points.size() && index < copyPoints.size(); index++)
+		replacedPoints.insert(points.at(index), copyPoints.at(index));
+
+	QList<DrawingItem*> children = item->children();
+	QList<DrawingItem*> copyChildren = copy->children();
+	for(int index = 0; index < children.size() && index < copyChildren.size(); index++)
+		copyCompactedItem(children.at(index), copyChildren.at(index), replacedPoints);
+}
+
+// Appends the index of each bounds entry that overlaps the given rect.  Comparisons with NaN
+// entries are always false, so hidden items are never returned.
+static void cullBounds(const float* minX, const float* minY, const float* maxX, const float* maxY,
+	int count, float left, float top, float right, float bottom, QVector<int>& indices)
+{
+	int index = 0;
+
+#if defined(DRAWINGSCENE_CULL_AVX)
+	const __m256 rectLeft = _mm256_set1_ps(left);
+	const __m256 rectTop = _mm256_set1_ps(top);
+	const __m256 rectRight = _mm256_set1_ps(right);
+	const __m256 rectBottom = _mm256_set1_ps(bottom);
+
+	for( ; index + 8 <= count; index += 8)
+	{
+		__m256 overlapX = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(minX + index), rectRight, _CMP_LE_OQ),
+			_mm256_cmp_ps(_mm256_loadu_ps(maxX + index), rectLeft, _CMP_GE_OQ));
+		__m256 overlapY = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(minY + index), rectBottom, _CMP_LE_OQ),
+			_mm256_cmp_ps(_mm256_loadu_ps(maxY + index), rectTop, _CMP_GE_OQ));
+
+		int mask = _mm256_movemask_ps(_mm256_and_ps(overlapX, overlapY));
+		for(int bit = 0; mask != 0; bit++, mask >>= 1)
+		{
+			if (mask & 0x01) indices.append(index + bit);
+		}
+	}
+#elif defined(DRAWINGSCENE_CULL_SSE2)
+	const __m128 rectLeft = _mm_set1_ps(left);
+	const __m128 rectTop = _mm_set1_ps(top);
+	const __m128 rectRight = _mm_set1_ps(right);
+	const __m128 rectBottom = _mm_set1_ps(bottom);
+
+	for( ; index + 4 <= count; index += 4)
+	{
+		__m128 overlapX = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(minX + index), rectRight),
+			_mm_cmpge_ps(_mm_loadu_ps(maxX + index), rectLeft));
+		__m128 overlapY = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(minY + index), rectBottom),
+			_mm_cmpge_ps(_mm_loadu_ps(maxY + index), rectTop));
+
+		int mask = _mm_movemask_ps(_mm_and_ps(overlapX, overlapY));
+		for(int bit = 0; mask != 0; bit++, mask >>= 1)
+		{
+			if (mask & 0x01) indices.append(index + bit);
+		}
+	}
+#endif
+
+	for( ; index < count; index++)
+	{
+		if (minX[index] <= right && maxX[index] >= left && minY[index] <= bottom && maxY[index] >= top)
+			indices.append(index);
+	}
+}
+
+//==================================================================================================
 
 DrawingScene::DrawingScene() : QObject()
 {
 	mSceneRect = QRectF(0, 0, 11000, 8500);
 	mBackgroundBrush = Qt::white;
+
+	mNextItemId = 1;
+
+	mItemIndexMethod = NoIndex;
+	mItemIndexDirty = true;
+	mItemIndexUsed = false;
+	mItemIndexCache = new DrawingCache("Item index", 50, this);
+	connect(mItemIndexCache, SIGNAL(releaseRequested(qint64)), this, SLOT(releaseItemIndex()));
+
+	mItemArena = nullptr;
+	mItemLayoutChanges = 0;
+	mItemCompactionTimer = new QTimer(this);
+	mItemCompactionTimer->setSingleShot(true);
+	mItemCompactionTimer->setInterval(1000);
+	connect(mItemCompactionTimer, SIGNAL(timeout()), this, SLOT(compactItems()));
+
+	mStyleDefaults = new DrawingStyleDefaults();
+
+	mItemSource = nullptr;
+	mMaterializedItemBudget = 10000;
+	mMaterializeCount = 0;
+	mMaterializedItemCache = new DrawingCache("Materialized items", 0, this);
+	connect(mMaterializedItemCache, SIGNAL(releaseRequested(qint64)), this, SLOT(releaseMaterializedItemCache(qint64)));
+
+	mItemUpdateInterval = 16;
 }
 
 DrawingScene::~DrawingScene()
 {
+	ItemUpdateBatch* batch = mPendingItemUpdates.fetchAndStoreAcquire(nullptr);
+	ItemUpdateBatch* nextBatch;
+
+	while (batch)
+	{
+		nextBatch = batch->next;
+		delete batch;
+		batch = nextBatch;
+	}
+
+	// Views may still be connected while the scene is being deleted
+	blockSignals(true);
+
+	releaseMaterializedItems();
 	clearItems();
+
+	delete mItemArena;
+	delete mStyleDefaults;
 }
 
 //==================================================================================================
@@ -71,7 +236,12 @@ void DrawingScene::addItem(DrawingItem* item)
 	if (item && item->mScene == nullptr)
 	{
 		mItems.append(item);
-		item->mScene = this;
+		registerItem(item);
+		mItemIndexDirty = true;
+
+		addItemBounds(item);
+		updateItemsBoundingRect();
+		noteItemLayoutChanges(1);
 	}
 }
 
@@ -79,35 +249,85 @@ void DrawingScene::insertItem(int index, DrawingItem* item)
 {
 	if (item && item->mScene == nullptr)
 	{
+		if (index < 0 || index > mItems.size()) index = mItems.size();
 		mItems.insert(index, item);
-		item->mScene = this;
+		registerItem(item);
+		mItemIndexDirty = true;
+
+		addItemBounds(item);
+		updateItemsBoundingRect();
+		noteItemLayoutChanges(1);
 	}
 }
 
 void DrawingScene::removeItem(DrawingItem* item)
 {
-	if (item && item->mScene == this)
+	if (item && item->mScene == this && item->mParent == nullptr)
 	{
-		mItems.removeAll(item);
+		auto materializedIter = mMaterializedItems.find(item->mId);
+
+		if (materializedIter != mMaterializedItems.end() && materializedIter->item == item)
+		{
+			// Removing a materialized item removes its record from the item source
+			mMaterializedItems.erase(materializedIter);
+			mMaterializedItemCache->setCost(mMaterializedItems.size() * materializedItemCost);
+			if (mItemSource) mItemSource->removeRecord(item->mId);
+		}
+		else
+		{
+			mItems.removeAll(item);
+			unregisterItem(item);
+			mItemIndexDirty = true;
+
+			removeItemBounds(item);
+			updateItemsBoundingRect();
+			noteItemLayoutChanges(1);
+		}
+
 		item->mScene = nullptr;
 	}
 }
 
 void DrawingScene::clearItems()
 {
-	DrawingItem* item = nullptr;
+	QList<DrawingItem*> items = mItems;
+
+	mItems.clear();
+	mItemsById.clear();
+	mItemIndexDirty = true;
+
+	mItemBounds.clear();
+	mItemLeftEdges.clear();
+	mItemTopEdges.clear();
+	mItemRightEdges.clear();
+	mItemBottomEdges.clear();
+	mItemGeometry.clear();
+	mAlignmentLeftEdges.clear();
+	mAlignmentTopEdges.clear();
+	mAlignmentRightEdges.clear();
+	mAlignmentBottomEdges.clear();
+	mAlignmentCenterXEdges.clear();
+	mAlignmentCenterYEdges.clear();
 
-	while (!mItems.empty())
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
 	{
-		item = mItems.first();
-		removeItem(item);
-		delete item;
-		item = nullptr;
+		(*itemIter)->mScene = nullptr;
+		delete *itemIter;
 	}
+
+	if (mItemArena) mItemArena->releaseUnusedSlabs();
+
+	updateItemsBoundingRect();
 }
 
 void DrawingScene::setItems(const QList<DrawingItem*>& items)
 {
+	int changeCount = 0;
+	for(int index = 0; index < items.size(); index++)
+	{
+		if (index >= mItems.size() || mItems.at(index) != items.at(index)) changeCount++;
+	}
+
 	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
 	{
 		(*itemIter)->mScene = nullptr;
@@ -115,9 +335,32 @@ void DrawingScene::setItems(const QList<DrawingItem*>& items)
 	}
 
 	mItems = items;
+	mItemsById.clear();
+	mItemIndexDirty = true;
+
+	mItemBounds.clear();
+	mItemLeftEdges.clear();
+	mItemTopEdges.clear();
+	mItemRightEdges.clear();
+	mItemBottomEdges.clear();
+	mItemGeometry.clear();
+	mAlignmentLeftEdges.clear();
+	mAlignmentTopEdges.clear();
+	mAlignmentRightEdges.clear();
+	mAlignmentBottomEdges.clear();
+	mAlignmentCenterXEdges.clear();
+	mAlignmentCenterYEdges.clear();
 
 	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
-		(*itemIter)->mScene = this;
+	{
+		registerItem(*itemIter);
+		addItemBounds(*itemIter);
+	}
+
+	updateItemsBoundingRect();
+	noteItemLayoutChanges(changeCount);
+
+	emit itemsReordered(mItems);
 }
 
 QList<DrawingItem*> DrawingScene::items() const
@@ -125,19 +368,342 @@ QList<DrawingItem*> DrawingScene::items() const
 	return mItems;
 }
 
+DrawingItem* DrawingScene::itemFromId(quint64 id) const
+{
+	DrawingItem* item = mItemsById.value(id, nullptr);
+
+	if (item == nullptr)
+	{
+		auto materializedIter = mMaterializedItems.find(id);
+		if (materializedIter != mMaterializedItems.end()) item = materializedIter->item;
+	}
+
+	return item;
+}
+
+QRectF DrawingScene::itemsBoundingRect() const
+{
+	QRectF rect = mItemsBoundingRect;
+	if (mItemSource) rect = rect.united(mItemSource->boundingRect());
+	return rect;
+}
+
+QList<qreal> DrawingScene::itemEdges(Qt::Orientation orientation, qreal minimum, qreal maximum,
+	const QList<DrawingItem*>& excludedItems) const
+{
+	QList<qreal> edges;
+	QMap<qreal,int> edgeCounts;
+
+	const QMap<qreal,int>* edgeMaps[3];
+	edgeMaps[0] = (orientation == Qt::Horizontal) ? &mAlignmentLeftEdges : &mAlignmentTopEdges;
+	edgeMaps[1] = (orientation == Qt::Horizontal) ? &mAlignmentCenterXEdges : &mAlignmentCenterYEdges;
+	edgeMaps[2] = (orientation == Qt::Horizontal) ? &mAlignmentRightEdges : &mAlignmentBottomEdges;
+
+	for(int mapIndex = 0; mapIndex < 3; mapIndex++)
+	{
+		for(auto edgeIter = edgeMaps[mapIndex]->lowerBound(minimum);
+			edgeIter != edgeMaps[mapIndex]->end() && edgeIter.key() <= maximum; edgeIter++)
+		{
+			edgeCounts[edgeIter.key()] += edgeIter.value();
+		}
+	}
+
+	if (!edgeCounts.isEmpty() && !excludedItems.isEmpty())
+	{
+		QSet<DrawingItem*> excludedTopLevelItems;
+		DrawingItem* topLevelItem;
+		qreal excludedEdges[3];
+
+		for(auto itemIter = excludedItems.begin(); itemIter != excludedItems.end(); itemIter++)
+		{
+			topLevelItem = *itemIter;
+			while (topLevelItem && topLevelItem->mParent) topLevelItem = topLevelItem->mParent;
+
+			auto boundsIter = mItemGeometry.find(topLevelItem);
+			if (boundsIter != mItemGeometry.end() && !excludedTopLevelItems.contains(topLevelItem))
+			{
+				excludedTopLevelItems.insert(topLevelItem);
+
+				excludedEdges[0] = (orientation == Qt::Horizontal) ? boundsIter->left() : boundsIter->top();
+				excludedEdges[1] = (orientation == Qt::Horizontal) ? boundsIter->center().x() : boundsIter->center().y();
+				excludedEdges[2] = (orientation == Qt::Horizontal) ? boundsIter->right() : boundsIter->bottom();
+
+				for(int edgeIndex = 0; edgeIndex < 3; edgeIndex++)
+				{
+					auto countIter = edgeCounts.find(excludedEdges[edgeIndex]);
+					if (countIter != edgeCounts.end()) countIter.value()--;
+				}
+			}
+		}
+	}
+
+	for(auto countIter = edgeCounts.begin(); countIter != edgeCounts.end(); countIter++)
+	{
+		if (countIter.value() > 0) edges.append(countIter.key());
+	}
+
+	return edges;
+}
+
+//==================================================================================================
+
+void DrawingScene::setItemIndexMethod(ItemIndexMethod method)
+{
+	QMutexLocker locker(&mItemIndexMutex);
+
+	mItemIndexMethod = method;
+
+	if (mItemIndexMethod == NoIndex)
+	{
+		mIndexMinX.clear();
+		mIndexMinY.clear();
+		mIndexMaxX.clear();
+		mIndexMaxY.clear();
+		mIndexItems.clear();
+		mIndexPositions.clear();
+	}
+
+	mItemIndexDirty = true;
+}
+
+DrawingScene::ItemIndexMethod DrawingScene::itemIndexMethod() const
+{
+	return mItemIndexMethod;
+}
+
+//==================================================================================================
+
+void DrawingScene::setItemArenaEnabled(bool enabled)
+{
+	if (enabled && mItemArena == nullptr)
+	{
+		mItemArena = new DrawingArena();
+	}
+	else if (!enabled && mItemArena)
+	{
+		delete mItemArena;
+		mItemArena = nullptr;
+	}
+}
+
+bool DrawingScene::isItemArenaEnabled() const
+{
+	return (mItemArena != nullptr);
+}
+
+DrawingArena* DrawingScene::itemArena() const
+{
+	return mItemArena;
+}
+
+DrawingStyleDefaults* DrawingScene::styleDefaults() const
+{
+	return mStyleDefaults;
+}
+
+DrawingItem* DrawingScene::createItem(const QString& typeName) const
+{
+	DrawingItem* item = nullptr;
+
+	// Items of the library's classes are constructed under the scene's defaults, which fall back
+	// to the global defaults as they are now
+	{
+		DrawingStyleDefaultsScope defaultsScope(mStyleDefaults);
+		item = DrawingItemFactory::createItem(typeName);
+	}
+
+	// Items copied from a prototype keep the style it was constructed with, so the properties
+	// the item took from it are replaced with the scene's values (constructed items already
+	// have them)
+	if (item)
+	{
+		QHash<DrawingItemStyle::Property,QVariant> values = mStyleDefaults->values();
+		QList<DrawingItem*> items;
+		items.append(item);
+
+		while (!items.isEmpty())
+		{
+			DrawingItem* currentItem = items.takeFirst();
+			DrawingItemStyle* style = currentItem->style();
+
+			for(auto valueIter = values.begin(); valueIter != values.end(); valueIter++)
+			{
+				if (style->hasValue(valueIter.key())) style->setValue(valueIter.key(), valueIter.value());
+			}
+
+			items.append(currentItem->children());
+		}
+	}
+
+	return item;
+}
+
+//==================================================================================================
+
+void DrawingScene::setItemSource(DrawingItemSource* source)
+{
+	releaseMaterializedItems();
+	mItemSource = source;
+
+	// Items already in the scene whose ids are taken by records of the new source get new ids
+	if (mItemSource)
+	{
+		QList<DrawingItem*> collidingItems;
+
+		for(auto itemIter = mItemsById.begin(); itemIter != mItemsById.end(); itemIter++)
+		{
+			if (mItemSource->containsRecord(itemIter.key())) collidingItems.append(itemIter.value());
+		}
+
+		for(auto itemIter = collidingItems.begin(); itemIter != collidingItems.end(); itemIter++)
+		{
+			mItemsById.remove((*itemIter)->mId);
+
+			while (mNextItemId == 0 || isItemIdUsed(mNextItemId)) mNextItemId++;
+			(*itemIter)->mId = mNextItemId++;
+			mItemsById.insert((*itemIter)->mId, *itemIter);
+		}
+	}
+}
+
+DrawingItemSource* DrawingScene::itemSource() const
+{
+	return mItemSource;
+}
+
+void DrawingScene::setMaterializedItemBudget(int budget)
+{
+	mMaterializedItemBudget = qMax(budget, 0);
+}
+
+int DrawingScene::materializedItemBudget() const
+{
+	return mMaterializedItemBudget;
+}
+
+QList<DrawingItem*> DrawingScene::materializedItems() const
+{
+	QList<DrawingItem*> items;
+
+	for(auto materializedIter = mMaterializedItems.begin(); materializedIter != mMaterializedItems.end(); materializedIter++)
+		items.append(materializedIter->item);
+
+	return items;
+}
+
+void DrawingScene::commitMaterializedItems()
+{
+	for(auto materializedIter = mMaterializedItems.begin(); materializedIter != mMaterializedItems.end(); materializedIter++)
+	{
+		if (materializedIter->edited)
+		{
+			if (mItemSource) mItemSource->storeItem(materializedIter->item);
+			materializedIter->edited = false;
+		}
+	}
+}
+
+void DrawingScene::pinItems(const QList<DrawingItem*>& items)
+{
+	DrawingItem* topLevelItem;
+
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+	{
+		topLevelItem = *itemIter;
+		while (topLevelItem && topLevelItem->mParent) topLevelItem = topLevelItem->mParent;
+
+		if (topLevelItem)
+		{
+			auto materializedIter = mMaterializedItems.find(topLevelItem->mId);
+			if (materializedIter != mMaterializedItems.end() && materializedIter->item == topLevelItem)
+				materializedIter->pinCount++;
+			else
+				mPinnedItems[topLevelItem]++;
+		}
+	}
+}
+
+void DrawingScene::unpinItems(const QList<DrawingItem*>& items)
+{
+	DrawingItem* topLevelItem;
+
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+	{
+		topLevelItem = *itemIter;
+		while (topLevelItem && topLevelItem->mParent) topLevelItem = topLevelItem->mParent;
+
+		if (topLevelItem)
+		{
+			auto materializedIter = mMaterializedItems.find(topLevelItem->mId);
+			if (materializedIter != mMaterializedItems.end() && materializedIter->item == topLevelItem)
+			{
+				if (materializedIter->pinCount > 0) materializedIter->pinCount--;
+			}
+			else
+			{
+				auto pinnedIter = mPinnedItems.find(topLevelItem);
+				if (pinnedIter != mPinnedItems.end() && --pinnedIter.value() <= 0) mPinnedItems.erase(pinnedIter);
+			}
+		}
+	}
+}
+
+//==================================================================================================
+
+void DrawingScene::postItemUpdates(const QVector<DrawingItemUpdate>& updates)
+{
+	if (!updates.isEmpty())
+	{
+		ItemUpdateBatch* batch = new ItemUpdateBatch();
+		ItemUpdateBatch* head;
+
+		batch->updates = updates;
+
+		do
+		{
+			head = mPendingItemUpdates.loadAcquire();
+			batch->next = head;
+		} while (!mPendingItemUpdates.testAndSetRelease(head, batch));
+
+		if (mItemUpdatesScheduled.testAndSetOrdered(0, 1))
+			QMetaObject::invokeMethod(this, "scheduleItemUpdates", Qt::QueuedConnection);
+	}
+}
+
+void DrawingScene::setItemUpdateInterval(int milliseconds)
+{
+	mItemUpdateInterval = qMax(milliseconds, 0);
+}
+
+int DrawingScene::itemUpdateInterval() const
+{
+	return mItemUpdateInterval;
+}
+
 //==================================================================================================
 
 QList<DrawingItem*> DrawingScene::visibleItems() const
 {
 	QList<DrawingItem*> foundItems;
+	if (!mMaterializedItems.isEmpty()) findItems(materializedItems(), foundItems);
 	findItems(mItems, foundItems);
 	return foundItems;
 }
 
 QList<DrawingItem*> DrawingScene::visibleItems(const DrawingView* view, const QPointF& pos) const
 {
+	// Item shapes depend on the pen width, so items are hit-tested with the scene's defaults
+	DrawingStyleDefaultsScope defaultsScope(mStyleDefaults);
+
 	QList<DrawingItem*> items;
-	QList<DrawingItem*> visibleItems = DrawingScene::visibleItems();
+	QList<DrawingItem*> visibleItems;
+
+	if ((mItemSource || mItemIndexMethod == BoundsTableIndex) && view)
+	{
+		qreal tolerance = view->mapToScene(QRect(0, 0, 8, 8)).width();
+		visibleItems = candidateItems(QRectF(pos.x() - tolerance, pos.y() - tolerance, 2 * tolerance, 2 * tolerance));
+	}
+	else visibleItems = DrawingScene::visibleItems();
 
 	for(auto itemIter = visibleItems.begin(); itemIter != visibleItems.end(); itemIter++)
 	{
@@ -149,8 +715,10 @@ QList<DrawingItem*> DrawingScene::visibleItems(const DrawingView* view, const QP
 
 QList<DrawingItem*> DrawingScene::visibleItems(const DrawingView* view, const QRectF& rect, Qt::ItemSelectionMode selectMode) const
 {
+	DrawingStyleDefaultsScope defaultsScope(mStyleDefaults);
+
 	QList<DrawingItem*> items;
-	QList<DrawingItem*> visibleItems = DrawingScene::visibleItems();
+	QList<DrawingItem*> visibleItems = (mItemSource || mItemIndexMethod == BoundsTableIndex) ? candidateItems(rect) : DrawingScene::visibleItems();
 
 	for(auto itemIter = visibleItems.begin(); itemIter != visibleItems.end(); itemIter++)
 	{
@@ -163,8 +731,11 @@ QList<DrawingItem*> DrawingScene::visibleItems(const DrawingView* view, const QR
 
 QList<DrawingItem*> DrawingScene::visibleItems(const DrawingView* view, const QPainterPath& path, Qt::ItemSelectionMode selectMode) const
 {
+	DrawingStyleDefaultsScope defaultsScope(mStyleDefaults);
+
 	QList<DrawingItem*> items;
-	QList<DrawingItem*> visibleItems = DrawingScene::visibleItems();
+	QList<DrawingItem*> visibleItems = (mItemSource || mItemIndexMethod == BoundsTableIndex) ?
+		candidateItems(path.boundingRect()) : DrawingScene::visibleItems();
 
 	for(auto itemIter = visibleItems.begin(); itemIter != visibleItems.end(); itemIter++)
 	{
@@ -177,8 +748,17 @@ QList<DrawingItem*> DrawingScene::visibleItems(const DrawingView* view, const QP
 
 DrawingItem* DrawingScene::visibleItemAt(const DrawingView* view, const QPointF& pos) const
 {
+	DrawingStyleDefaultsScope defaultsScope(mStyleDefaults);
+
 	DrawingItem* item = nullptr;
-	QList<DrawingItem*> visibleItems = DrawingScene::visibleItems();
+	QList<DrawingItem*> visibleItems;
+
+	if ((mItemSource || mItemIndexMethod == BoundsTableIndex) && view)
+	{
+		qreal tolerance = view->mapToScene(QRect(0, 0, 8, 8)).width();
+		visibleItems = candidateItems(QRectF(pos.x() - tolerance, pos.y() - tolerance, 2 * tolerance, 2 * tolerance));
+	}
+	else visibleItems = DrawingScene::visibleItems();
 
 	auto itemIter = visibleItems.end();
 	while (item == nullptr && itemIter != visibleItems.begin())
@@ -194,6 +774,8 @@ DrawingItem* DrawingScene::visibleItemAt(const DrawingView* view, const QPointF&
 
 void DrawingScene::render(QPainter* painter)
 {
+	DrawingStyleDefaultsScope defaultsScope(mStyleDefaults);
+
 	drawBackground(painter);
 	drawItems(painter);
 	drawForeground(painter);
@@ -206,6 +788,7 @@ void DrawingScene::addItems(const QList<DrawingItem*>& items)
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
 		addItem(*itemIter);
 
+	emit itemsAdded(items);
 	emit numberOfItemsChanged(mItems.size());
 }
 
@@ -214,6 +797,7 @@ void DrawingScene::insertItems(const QList<DrawingItem*>& items, const QHash<Dra
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
 		insertItem(index[*itemIter], *itemIter);
 
+	emit itemsAdded(items);
 	emit numberOfItemsChanged(mItems.size());
 }
 
@@ -222,6 +806,7 @@ void DrawingScene::removeItems(const QList<DrawingItem*>& items)
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
 		removeItem(*itemIter);
 
+	emit itemsRemoved(items);
 	emit numberOfItemsChanged(mItems.size());
 }
 
@@ -232,9 +817,41 @@ void DrawingScene::setItemsVisibility(const QList<DrawingItem*>& items, const QH
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
 		(*itemIter)->setVisible(visibility[*itemIter]);
 
+	markItemsChanged(items);
 	emit itemsVisibilityChanged(items);
 }
 
+void DrawingScene::setItemsStyleValues(const QList<DrawingItem*>& items,
+	const QVector<DrawingItemStyle::Property>& properties, const QVector<QVariant>& values,
+	const QVector<int>& valueIndices)
+{
+	const int propertyCount = properties.size();
+	int index = 0;
+	QVariant value;
+
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++, index++)
+	{
+		DrawingItemStyle* style = (*itemIter)->style();
+		if (style == nullptr) continue;
+
+		for(int propertyIndex = 0; propertyIndex < propertyCount; propertyIndex++)
+		{
+			if (valueIndices.isEmpty())
+				value = values.value(propertyIndex);
+			else
+				value = values.value(valueIndices.value(index * propertyCount + propertyIndex, -1));
+
+			if (value.isValid())
+				style->setValue(properties[propertyIndex], value);
+			else
+				style->unsetValue(properties[propertyIndex]);
+		}
+	}
+
+	markItemsChanged(items);
+	emit itemsStyleChanged(items);
+}
+
 //==================================================================================================
 
 void DrawingScene::moveItems(const QList<DrawingItem*>& items, const QHash<DrawingItem*,QPointF>& parentPos)
@@ -242,6 +859,7 @@ void DrawingScene::moveItems(const QList<DrawingItem*>& items, const QHash<Drawi
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
 		(*itemIter)->moveEvent(parentPos[*itemIter]);
 
+	markItemsChanged(items);
 	emit itemsPositionChanged(items);
 }
 
@@ -254,17 +872,55 @@ void DrawingScene::resizeItem(DrawingItemPoint* itemPoint, const QPointF& parent
 
 		itemPoint->item()->resizeEvent(itemPoint, parentPos);
 
+		markItemsChanged(items);
 		emit itemsGeometryChanged(items);
 	}
 }
 
-//==================================================================================================
+void DrawingScene::resizeItemPoints(const QVector<DrawingItemPoint*>& points, const QVector<QPointF>& parentPos)
+{
+	QList<DrawingItem*> items;
+	QHash<DrawingItem*,int> itemIndices;
+	QVector< QVector<DrawingItemPoint*> > itemPoints;
+	QVector< QVector<QPointF> > itemParentPos;
+	DrawingItem* item;
+
+	for(int index = 0; index < points.size() && index < parentPos.size(); index++)
+	{
+		item = (points[index]) ? points[index]->item() : nullptr;
+		if (item == nullptr) continue;
+
+		auto indexIter = itemIndices.find(item);
+		if (indexIter == itemIndices.end())
+		{
+			indexIter = itemIndices.insert(item, items.size());
+			items.append(item);
+			itemPoints.append(QVector<DrawingItemPoint*>());
+			itemParentPos.append(QVector<QPointF>());
+		}
+
+		itemPoints[indexIter.value()].append(points[index]);
+		itemParentPos[indexIter.value()].append(parentPos[index]);
+	}
+
+	if (!items.isEmpty())
+	{
+		for(int index = 0; index < items.size(); index++)
+			items[index]->resizePointsEvent(itemPoints[index], itemParentPos[index]);
+
+		markItemsChanged(items);
+		emit itemsGeometryChanged(items);
+	}
+}
+
+//==================================================================================================
 
 void DrawingScene::rotateItems(const QList<DrawingItem*>& items, const QHash<DrawingItem*,QPointF>& parentPos)
 {
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
 		(*itemIter)->rotateEvent(parentPos[*itemIter]);
 
+	markItemsChanged(items);
 	emit itemsTransformChanged(items);
 }
 
@@ -273,6 +929,7 @@ void DrawingScene::rotateBackItems(const QList<DrawingItem*>& items, const QHash
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
 		(*itemIter)->rotateBackEvent(parentPos[*itemIter]);
 
+	markItemsChanged(items);
 	emit itemsTransformChanged(items);
 }
 
@@ -281,6 +938,7 @@ void DrawingScene::flipItemsHorizontal(const QList<DrawingItem*>& items, const Q
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
 		(*itemIter)->flipHorizontalEvent(parentPos[*itemIter]);
 
+	markItemsChanged(items);
 	emit itemsTransformChanged(items);
 }
 
@@ -289,6 +947,7 @@ void DrawingScene::flipItemsVertical(const QList<DrawingItem*>& items, const QHa
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
 		(*itemIter)->flipVerticalEvent(parentPos[*itemIter]);
 
+	markItemsChanged(items);
 	emit itemsTransformChanged(items);
 }
 
@@ -303,6 +962,7 @@ void DrawingScene::insertItemPoint(DrawingItem* item, DrawingItemPoint* itemPoin
 
 		item->insertPoint(pointIndex, itemPoint);
 
+		markItemsChanged(items);
 		emit itemsGeometryChanged(items);
 	}
 }
@@ -316,6 +976,7 @@ void DrawingScene::removeItemPoint(DrawingItem* item, DrawingItemPoint* itemPoin
 
 		item->removePoint(itemPoint);
 
+		markItemsChanged(items);
 		emit itemsGeometryChanged(items);
 	}
 }
@@ -328,6 +989,11 @@ void DrawingScene::connectItemPoints(DrawingItemPoint* point1, DrawingItemPoint*
 	{
 		point1->addConnection(point2);
 		point2->addConnection(point1);
+
+		if (!mMaterializedItems.isEmpty())
+			markItemsChanged(QList<DrawingItem*>() << point1->item() << point2->item());
+
+		emit itemPointsConnected(point1, point2);
 	}
 }
 
@@ -337,11 +1003,158 @@ void DrawingScene::disconnectItemPoints(DrawingItemPoint* point1, DrawingItemPoi
 	{
 		point1->removeConnection(point2);
 		point2->removeConnection(point1);
+
+		if (!mMaterializedItems.isEmpty())
+			markItemsChanged(QList<DrawingItem*>() << point1->item() << point2->item());
+
+		emit itemPointsDisconnected(point1, point2);
 	}
 }
 
 //==================================================================================================
 
+void DrawingScene::applyItemUpdates()
+{
+	const int maximumDirtyRects = 64;
+
+	mItemUpdatesScheduled.storeRelease(0);
+
+	// Batches are pushed onto a stack, so reverse them to apply updates in the order posted
+	ItemUpdateBatch* batch = mPendingItemUpdates.fetchAndStoreAcquire(nullptr);
+	ItemUpdateBatch* orderedBatches = nullptr;
+	ItemUpdateBatch* nextBatch;
+
+	while (batch)
+	{
+		nextBatch = batch->next;
+		batch->next = orderedBatches;
+		orderedBatches = batch;
+		batch = nextBatch;
+	}
+
+	QList<DrawingItem*> updatedItems, positionItems, styleItems;
+	QSet<DrawingItem*> positionSet, styleSet;
+	QHash<DrawingItem*,QRectF> originalBounds;
+	DrawingItem* item;
+
+	while (orderedBatches)
+	{
+		batch = orderedBatches;
+
+		for(auto updateIter = batch->updates.constBegin(); updateIter != batch->updates.constEnd(); updateIter++)
+		{
+			item = itemFromId(updateIter->itemId());
+			if (item)
+			{
+				if (!originalBounds.contains(item))
+				{
+					originalBounds.insert(item, itemSceneBounds(item));
+					updatedItems.append(item);
+				}
+
+				if (updateIter->type() == DrawingItemUpdate::PositionUpdate)
+				{
+					item->setPosition(updateIter->position());
+
+					if (!positionSet.contains(item))
+					{
+						positionSet.insert(item);
+						positionItems.append(item);
+					}
+				}
+				else if (item->style())
+				{
+					item->style()->setValue(updateIter->property(), updateIter->value());
+
+					if (!styleSet.contains(item))
+					{
+						styleSet.insert(item);
+						styleItems.append(item);
+					}
+				}
+			}
+		}
+
+		orderedBatches = batch->next;
+		delete batch;
+	}
+
+	if (!updatedItems.isEmpty())
+	{
+		QList<QRectF> dirtyRects;
+		QRectF dirtyBounds;
+		QRectF itemDirtyRect;
+
+		for(auto itemIter = updatedItems.begin(); itemIter != updatedItems.end(); itemIter++)
+		{
+			itemDirtyRect = originalBounds.value(*itemIter).united(itemSceneBounds(*itemIter));
+			dirtyBounds = dirtyBounds.united(itemDirtyRect);
+			if (dirtyRects.size() <= maximumDirtyRects) dirtyRects.append(itemDirtyRect);
+		}
+
+		// Repainting a single larger area is cheaper than tracking a large number of small ones
+		if (dirtyRects.size() > maximumDirtyRects)
+		{
+			dirtyRects.clear();
+			dirtyRects.append(dirtyBounds);
+		}
+
+		markItemsChanged(updatedItems);
+
+		if (!positionItems.isEmpty()) emit itemsPositionChanged(positionItems);
+		if (!styleItems.isEmpty()) emit itemsStyleChanged(styleItems);
+		emit changed(dirtyRects);
+	}
+}
+
+void DrawingScene::scheduleItemUpdates()
+{
+	QTimer::singleShot(mItemUpdateInterval, this, SLOT(applyItemUpdates()));
+}
+
+void DrawingScene::releaseItemIndex()
+{
+	mItemIndexMutex.lock();
+
+	// The live index is exempt: releasing a table that is still culled against every paint would
+	// only rebuild it again.  Threads culling the table hold their own references to its storage.
+	bool released = !mItemIndexUsed;
+	if (released)
+	{
+		mIndexMinX = QVector<float>();
+		mIndexMinY = QVector<float>();
+		mIndexMaxX = QVector<float>();
+		mIndexMaxY = QVector<float>();
+		mIndexItems = QVector<DrawingItem*>();
+		mIndexPositions = QHash<DrawingItem*,int>();
+		mItemIndexDirty = true;
+	}
+	mItemIndexUsed = false;
+
+	mItemIndexMutex.unlock();
+
+	if (released) mItemIndexCache->setCost(0);
+}
+
+void DrawingScene::updateItemIndexCost()
+{
+	mItemIndexMutex.lock();
+	qint64 cost = mIndexItems.size() * itemIndexEntryCost;
+	mItemIndexMutex.unlock();
+
+	mItemIndexCache->setCost(cost);
+}
+
+void DrawingScene::releaseMaterializedItemCache(qint64 bytes)
+{
+	int releaseCount = static_cast<int>(qMin((bytes + materializedItemCost - 1) / materializedItemCost,
+		static_cast<qint64>(mMaterializedItems.size())));
+
+	evictMaterializedItems(mMaterializedItems.size() - releaseCount);
+}
+
+//==================================================================================================
+
 void DrawingScene::drawBackground(QPainter* painter)
 {
 	QPainter::RenderHints hints = painter->renderHints();
@@ -361,7 +1174,27 @@ void DrawingScene::drawBackground(QPainter* painter)
 
 void DrawingScene::drawItems(QPainter* painter)
 {
-	drawItems(painter, mItems);
+	const int materializeBatchSize = 1024;
+
+	if (mItemSource)
+	{
+		// Records are materialized, drawn, and evicted in batches so that zooming out over a very
+		// large source does not materialize every record in view at once
+		QList<quint64> records = mItemSource->records(paintedRect(painter));
+
+		for(int recordIndex = 0; recordIndex < records.size(); recordIndex += materializeBatchSize)
+		{
+			drawItems(painter, materializeItems(records.mid(recordIndex, materializeBatchSize)));
+			evictMaterializedItems(mMaterializedItemBudget);
+		}
+	}
+
+	if (mItemIndexMethod == BoundsTableIndex)
+	{
+		QRectF rect = paintedRect(painter);
+		drawItems(painter, (rect.isValid()) ? cullItems(rect) : mItems);
+	}
+	else drawItems(painter, mItems);
 }
 
 void DrawingScene::drawForeground(QPainter* painter)
@@ -371,6 +1204,477 @@ void DrawingScene::drawForeground(QPainter* painter)
 
 //==================================================================================================
 
+void DrawingScene::registerItem(DrawingItem* item)
+{
+	// The scene is set first so that the id cannot be changed through setId() once it is in use
+	item->mScene = this;
+
+	if (item->mId == 0 || isItemIdUsed(item->mId))
+	{
+		// Ids read from a file may be near the end of the range, so the next id wraps around
+		// past 0 and skips the ids in use instead of overflowing
+		while (mNextItemId == 0 || isItemIdUsed(mNextItemId)) mNextItemId++;
+		item->mId = mNextItemId++;
+	}
+	else if (item->mId >= mNextItemId && item->mId < std::numeric_limits<quint64>::max())
+		mNextItemId = item->mId + 1;
+
+	mItemsById.insert(item->mId, item);
+
+	for(auto childIter = item->mChildren.begin(); childIter != item->mChildren.end(); childIter++)
+		registerItem(*childIter);
+}
+
+bool DrawingScene::isItemIdUsed(quint64 id) const
+{
+	// Records of the item source share the id space but are not in mItemsById until materialized
+	return (mItemsById.contains(id) || (mItemSource && mItemSource->containsRecord(id)));
+}
+
+void DrawingScene::registerChildItem(DrawingItem* item)
+{
+	DrawingItem* topLevelItem = item;
+	while (topLevelItem->mParent) topLevelItem = topLevelItem->mParent;
+
+	// Materialized items are not registered, so neither are the children added to them
+	if (mItemsById.value(topLevelItem->mId) == topLevelItem) registerItem(item);
+}
+
+void DrawingScene::unregisterItem(DrawingItem* item)
+{
+	if (mItemsById.value(item->mId) == item) mItemsById.remove(item->mId);
+	item->mScene = nullptr;
+
+	for(auto childIter = item->mChildren.begin(); childIter != item->mChildren.end(); childIter++)
+		unregisterItem(*childIter);
+}
+
+//==================================================================================================
+
+QList<DrawingItem*> DrawingScene::materializeItems(const QList<quint64>& records) const
+{
+	QList<DrawingItem*> items;
+
+	if (mItemSource)
+	{
+		mMaterializeCount++;
+
+		for(auto recordIter = records.begin(); recordIter != records.end(); recordIter++)
+		{
+			auto materializedIter = mMaterializedItems.find(*recordIter);
+
+			if (materializedIter != mMaterializedItems.end())
+			{
+				materializedIter->lastUsed = mMaterializeCount;
+				items.append(materializedIter->item);
+			}
+			else
+			{
+				DrawingItem* item = mItemSource->createItem(*recordIter);
+
+				if (item)
+				{
+					MaterializedItem materializedItem;
+					materializedItem.item = item;
+					materializedItem.lastUsed = mMaterializeCount;
+					materializedItem.edited = false;
+					materializedItem.pinCount = 0;
+
+					item->mId = *recordIter;
+					item->mScene = const_cast<DrawingScene*>(this);
+
+					mMaterializedItems.insert(*recordIter, materializedItem);
+					items.append(item);
+				}
+			}
+		}
+
+		mMaterializedItemCache->setCost(mMaterializedItems.size() * materializedItemCost);
+		mMaterializedItemCache->touch();
+	}
+
+	return items;
+}
+
+void DrawingScene::evictMaterializedItems(int budget) const
+{
+	if (mMaterializedItems.size() > budget)
+	{
+		QVector< QPair<quint64,quint64> > candidates;
+
+		for(auto materializedIter = mMaterializedItems.begin(); materializedIter != mMaterializedItems.end(); materializedIter++)
+		{
+			if (!materializedIter->edited && materializedIter->pinCount == 0 &&
+				!materializedIter->item->isSelected() && materializedIter->lastUsed != mMaterializeCount)
+			{
+				candidates.append(qMakePair(materializedIter->lastUsed, materializedIter.key()));
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+
+		int evictCount = qMin(mMaterializedItems.size() - budget, candidates.size());
+		for(int candidateIndex = 0; candidateIndex < evictCount; candidateIndex++)
+		{
+			DrawingItem* item = mMaterializedItems.take(candidates[candidateIndex].second).item;
+			item->mScene = nullptr;
+			delete item;
+		}
+
+		mMaterializedItemCache->setCost(mMaterializedItems.size() * materializedItemCost);
+	}
+}
+
+void DrawingScene::releaseMaterializedItems()
+{
+	commitMaterializedItems();
+
+	for(auto materializedIter = mMaterializedItems.begin(); materializedIter != mMaterializedItems.end(); materializedIter++)
+	{
+		materializedIter->item->mScene = nullptr;
+		delete materializedIter->item;
+	}
+
+	mMaterializedItems.clear();
+	mMaterializedItemCache->setCost(0);
+}
+
+void DrawingScene::markItemsChanged(const QList<DrawingItem*>& items)
+{
+	QSet<DrawingItem*> changedItems;
+	DrawingItem* topLevelItem;
+
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+	{
+		topLevelItem = *itemIter;
+		while (topLevelItem && topLevelItem->mParent) topLevelItem = topLevelItem->mParent;
+
+		if (topLevelItem && !changedItems.contains(topLevelItem))
+		{
+			changedItems.insert(topLevelItem);
+
+			auto materializedIter = mMaterializedItems.find(topLevelItem->mId);
+			if (materializedIter != mMaterializedItems.end() && materializedIter->item == topLevelItem)
+				materializedIter->edited = true;
+			else if (mItemsById.value(topLevelItem->mId) == topLevelItem)
+			{
+				removeItemBounds(topLevelItem);
+				addItemBounds(topLevelItem);
+
+				if (mItemIndexMethod != NoIndex)
+				{
+					QMutexLocker locker(&mItemIndexMutex);
+					updateItemIndex(topLevelItem);
+				}
+			}
+		}
+	}
+
+	updateItemsBoundingRect();
+}
+
+void DrawingScene::compactItems()
+{
+	mItemCompactionTimer->stop();
+	mItemLayoutChanges = 0;
+
+	if (mItemArena)
+	{
+		QHash<DrawingItem*,DrawingItem*> replacedItems;
+		QHash<DrawingItemPoint*,DrawingItemPoint*> replacedPoints;
+		DrawingItem* item;
+		DrawingItem* copy;
+
+		// The copies are allocated one after another in z-order
+		DrawingArenaScope arenaScope(mItemArena);
+
+		for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
+		{
+			item = *itemIter;
+
+			if (!item->isSelected() && !mPinnedItems.contains(item))
+			{
+				copy = item->copy();
+				copyCompactedItem(item, copy, replacedPoints);
+				replacedItems.insert(item, copy);
+
+				removeItemBounds(item);
+				unregisterItem(item);
+				*itemIter = copy;
+				registerItem(copy);
+				addItemBounds(copy);
+			}
+		}
+
+		if (!replacedItems.isEmpty())
+		{
+			// Connections between two replaced points are made once from each side; points that
+			// were not replaced are connected to the replacement instead of the original
+			DrawingItemPoint* connectedPoint;
+
+			for(auto pointIter = replacedPoints.begin(); pointIter != replacedPoints.end(); pointIter++)
+			{
+				QList<DrawingItemPoint*> connections = pointIter.key()->connections();
+
+				for(auto connectionIter = connections.begin(); connectionIter != connections.end(); connectionIter++)
+				{
+					connectedPoint = replacedPoints.value(*connectionIter, *connectionIter);
+					pointIter.value()->addConnection(connectedPoint);
+
+					if (connectedPoint == *connectionIter)
+					{
+						connectedPoint->removeConnection(pointIter.key());
+						connectedPoint->addConnection(pointIter.value());
+					}
+				}
+			}
+
+			mItemIndexDirty = true;
+			updateItemsBoundingRect();
+
+			emit itemsCompacted(replacedItems);
+
+			for(auto itemIter = replacedItems.begin(); itemIter != replacedItems.end(); itemIter++)
+				delete itemIter.key();
+
+			mItemArena->releaseUnusedSlabs();
+		}
+	}
+}
+
+void DrawingScene::noteItemLayoutChanges(int count)
+{
+	if (mItemArena && count > 0)
+	{
+		mItemLayoutChanges += count;
+
+		// The timer is restarted by every change, so the items are compacted once the scene is idle
+		if (mItemLayoutChanges >= qMax(minimumCompactionChanges, mItems.size() / 4))
+			mItemCompactionTimer->start();
+	}
+}
+
+void DrawingScene::addItemBounds(DrawingItem* item)
+{
+	if (item->isVisible() && !mItemBounds.contains(item))
+	{
+		QRectF bounds = itemSceneBounds(item);
+
+		mItemBounds.insert(item, bounds);
+		insertEdge(mItemLeftEdges, bounds.left());
+		insertEdge(mItemTopEdges, bounds.top());
+		insertEdge(mItemRightEdges, bounds.right());
+		insertEdge(mItemBottomEdges, bounds.bottom());
+
+		// Alignment guides line up the items' geometry, not their pens and arrows
+		QRectF geometry = itemSceneGeometry(item);
+
+		mItemGeometry.insert(item, geometry);
+		insertEdge(mAlignmentLeftEdges, geometry.left());
+		insertEdge(mAlignmentTopEdges, geometry.top());
+		insertEdge(mAlignmentRightEdges, geometry.right());
+		insertEdge(mAlignmentBottomEdges, geometry.bottom());
+		insertEdge(mAlignmentCenterXEdges, geometry.center().x());
+		insertEdge(mAlignmentCenterYEdges, geometry.center().y());
+	}
+}
+
+void DrawingScene::removeItemBounds(DrawingItem* item)
+{
+	auto boundsIter = mItemBounds.find(item);
+
+	if (boundsIter != mItemBounds.end())
+	{
+		removeEdge(mItemLeftEdges, boundsIter->left());
+		removeEdge(mItemTopEdges, boundsIter->top());
+		removeEdge(mItemRightEdges, boundsIter->right());
+		removeEdge(mItemBottomEdges, boundsIter->bottom());
+		mItemBounds.erase(boundsIter);
+	}
+
+	auto geometryIter = mItemGeometry.find(item);
+
+	if (geometryIter != mItemGeometry.end())
+	{
+		removeEdge(mAlignmentLeftEdges, geometryIter->left());
+		removeEdge(mAlignmentTopEdges, geometryIter->top());
+		removeEdge(mAlignmentRightEdges, geometryIter->right());
+		removeEdge(mAlignmentBottomEdges, geometryIter->bottom());
+		removeEdge(mAlignmentCenterXEdges, geometryIter->center().x());
+		removeEdge(mAlignmentCenterYEdges, geometryIter->center().y());
+		mItemGeometry.erase(geometryIter);
+	}
+}
+
+void DrawingScene::updateItemsBoundingRect()
+{
+	QRectF rect;
+
+	if (!mItemBounds.isEmpty())
+	{
+		rect = QRectF(QPointF(mItemLeftEdges.firstKey(), mItemTopEdges.firstKey()),
+			QPointF(mItemRightEdges.lastKey(), mItemBottomEdges.lastKey()));
+	}
+
+	if (rect != mItemsBoundingRect)
+	{
+		mItemsBoundingRect = rect;
+		emit itemsBoundingRectChanged(mItemsBoundingRect);
+	}
+}
+
+QList<DrawingItem*> DrawingScene::candidateItems(const QRectF& sceneRect) const
+{
+	QList<DrawingItem*> foundItems;
+	if (mItemSource) findItems(materializeItems(mItemSource->records(sceneRect)), foundItems);
+	findItems((mItemIndexMethod == BoundsTableIndex) ? cullItems(sceneRect) : mItems, foundItems);
+	return foundItems;
+}
+
+QList<DrawingItem*> DrawingScene::cullItems(const QRectF& sceneRect) const
+{
+	QList<DrawingItem*> items;
+	QVector<int> indices;
+	bool rebuilt = false;
+
+	// The table is culled through implicitly shared copies taken under the mutex, so that
+	// releaseItemIndex() or an update on another thread cannot free the storage while it is read
+	mItemIndexMutex.lock();
+	if (mItemIndexDirty)
+	{
+		rebuildItemIndex();
+		rebuilt = true;
+	}
+	mItemIndexUsed = true;
+	const QVector<float> minX = mIndexMinX;
+	const QVector<float> minY = mIndexMinY;
+	const QVector<float> maxX = mIndexMaxX;
+	const QVector<float> maxY = mIndexMaxY;
+	const QVector<DrawingItem*> indexItems = mIndexItems;
+	mItemIndexMutex.unlock();
+
+	// The cost is reported from the scene's thread, outside of the index mutex
+	if (rebuilt)
+	{
+		if (QThread::currentThread() == thread())
+			const_cast<DrawingScene*>(this)->updateItemIndexCost();
+		else
+			QMetaObject::invokeMethod(const_cast<DrawingScene*>(this), "updateItemIndexCost", Qt::QueuedConnection);
+	}
+
+	mItemIndexCache->touch();
+
+	cullBounds(minX.constData(), minY.constData(), maxX.constData(), maxY.constData(),
+		indexItems.size(), floorToFloat(sceneRect.left()), floorToFloat(sceneRect.top()),
+		ceilToFloat(sceneRect.right()), ceilToFloat(sceneRect.bottom()), indices);
+
+	items.reserve(indices.size());
+	for(auto indexIter = indices.begin(); indexIter != indices.end(); indexIter++)
+		items.append(indexItems.at(*indexIter));
+
+	return items;
+}
+
+void DrawingScene::updateItemIndex(DrawingItem* item) const
+{
+	auto positionIter = mIndexPositions.find(item);
+
+	if (!mItemIndexDirty && positionIter != mIndexPositions.end())
+	{
+		int index = positionIter.value();
+		auto boundsIter = mItemBounds.find(item);
+
+		if (boundsIter != mItemBounds.end())
+		{
+			mIndexMinX[index] = floorToFloat(boundsIter->left());
+			mIndexMinY[index] = floorToFloat(boundsIter->top());
+			mIndexMaxX[index] = ceilToFloat(boundsIter->right());
+			mIndexMaxY[index] = ceilToFloat(boundsIter->bottom());
+		}
+		else
+		{
+			mIndexMinX[index] = std::numeric_limits<float>::quiet_NaN();
+			mIndexMinY[index] = std::numeric_limits<float>::quiet_NaN();
+			mIndexMaxX[index] = std::numeric_limits<float>::quiet_NaN();
+			mIndexMaxY[index] = std::numeric_limits<float>::quiet_NaN();
+		}
+	}
+}
+
+void DrawingScene::rebuildItemIndex() const
+{
+	int itemCount = mItems.size();
+
+	mIndexMinX.resize(itemCount);
+	mIndexMinY.resize(itemCount);
+	mIndexMaxX.resize(itemCount);
+	mIndexMaxY.resize(itemCount);
+	mIndexItems.resize(itemCount);
+	mIndexPositions.clear();
+	mIndexPositions.reserve(itemCount);
+
+	int index = 0;
+	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++, index++)
+	{
+		mIndexItems[index] = *itemIter;
+		mIndexPositions.insert(*itemIter, index);
+	}
+
+	mItemIndexDirty = false;
+
+	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
+		updateItemIndex(*itemIter);
+}
+
+QRectF DrawingScene::itemSceneBounds(DrawingItem* item) const
+{
+	QRectF bounds = item->mapToScene(item->boundingRect()).boundingRect();
+
+	DrawingItemStyle* style = item->style();
+	if (style)
+	{
+		// An item's boundingRect() does not necessarily include its pen width or arrows
+		qreal margin = style->valueLookup(DrawingItemStyle::PenWidth, QVariant(0.0)).toDouble();
+		if (style->startArrowStyle() != DrawingItemStyle::ArrowNone) margin = qMax(margin, style->startArrowSize());
+		if (style->endArrowStyle() != DrawingItemStyle::ArrowNone) margin = qMax(margin, style->endArrowSize());
+
+		bounds.adjust(-margin, -margin, margin, margin);
+	}
+
+	for(auto childIter = item->mChildren.begin(); childIter != item->mChildren.end(); childIter++)
+		bounds = bounds.united(itemSceneBounds(*childIter));
+
+	return bounds;
+}
+
+QRectF DrawingScene::itemSceneGeometry(DrawingItem* item) const
+{
+	QRectF geometry = item->mapToScene(item->boundingRect()).boundingRect();
+
+	for(auto childIter = item->mChildren.begin(); childIter != item->mChildren.end(); childIter++)
+		geometry = geometry.united(itemSceneGeometry(*childIter));
+
+	return geometry;
+}
+
+QRectF DrawingScene::paintedRect(QPainter* painter) const
+{
+	QRectF rect;
+
+	if (painter->device())
+	{
+		rect = painter->deviceTransform().inverted().mapRect(
+			QRectF(0, 0, painter->device()->width(), painter->device()->height()));
+	}
+
+	if (painter->hasClipping())
+		rect = (rect.isValid()) ? rect.intersected(painter->clipBoundingRect()) : painter->clipBoundingRect();
+
+	return rect;
+}
+
+//==================================================================================================
+
 void DrawingScene::findItems(const QList<DrawingItem*>& items, QList<DrawingItem*>& foundItems) const
 {
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
@@ -387,6 +1691,9 @@ void DrawingScene::findItems(const QList<DrawingItem*>& items, QList<DrawingItem
 
 void DrawingScene::drawItems(QPainter* painter, const QList<DrawingItem*>& items)
 {
+	bool skipTinyItems = (DrawingItem::renderFlags() & DrawingItem::SkipTinyItems);
+	QRectF deviceRect;
+
 	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
 	{
 		if ((*itemIter)->isVisible())
@@ -394,7 +1701,11 @@ void DrawingScene::drawItems(QPainter* painter, const QList<DrawingItem*>& items
 			painter->translate((*itemIter)->position());
 			painter->setTransform((*itemIter)->transformInverted(), true);
 
-			(*itemIter)->render(painter);
+			if (skipTinyItems) deviceRect = painter->transform().mapRect((*itemIter)->boundingRect());
+
+			// Children may extend beyond their parent's boundingRect(), so they are checked separately
+			if (!skipTinyItems || deviceRect.width() >= 2 || deviceRect.height() >= 2)
+				(*itemIter)->render(painter);
 
 			//painter->save();
 			//painter->setBrush(QColor(255, 0, 255, 128));
@@ -424,16 +1735,7 @@ bool DrawingScene::itemMatchesPoint(const DrawingView* view, DrawingItem* item,
 
 		// Check item points
 		if (!match && item->isSelected())
-		{
-			QList<DrawingItemPoint*> itemPoints = item->points();
-			QRectF pointSceneRect;
-
-			for(auto pointIter = itemPoints.begin(); !match && pointIter != itemPoints.end(); pointIter++)
-			{
-				pointSceneRect = view->mapToScene(view->pointRect(*pointIter));
-				match = pointSceneRect.contains(scenePos);
-			}
-		}
+			match = (view->pointAt(item, item->mapFromScene(scenePos)) != nullptr);
 	}
 
 	return match;
@@ -465,12 +1767,12 @@ bool DrawingScene::itemMatchesRect(const DrawingView* view, DrawingItem* item, c
 		// Check item points
 		if (!match && item->isSelected())
 		{
-			QList<DrawingItemPoint*> itemPoints = item->points();
+			QVector<QRect> pointRects = view->itemPointRects(item);
 			QRectF pointSceneRect;
 
-			for(auto pointIter = itemPoints.begin(); !match && pointIter != itemPoints.end(); pointIter++)
+			for(auto pointRectIter = pointRects.begin(); !match && pointRectIter != pointRects.end(); pointRectIter++)
 			{
-				pointSceneRect = view->mapToScene(view->pointRect(*pointIter));
+				pointSceneRect = view->mapToScene(*pointRectIter);
 
 				if (mode == Qt::IntersectsItemBoundingRect || mode == Qt::IntersectsItemShape)
 					match = rect.intersects(pointSceneRect);
@@ -509,12 +1811,12 @@ bool DrawingScene::itemMatchesPath(const DrawingView* view, DrawingItem* item, c
 		// Check item points
 		if (!match && item->isSelected())
 		{
-			QList<DrawingItemPoint*> itemPoints = item->points();
+			QVector<QRect> pointRects = view->itemPointRects(item);
 			QRectF pointSceneRect;
 
-			for(auto pointIter = itemPoints.begin(); !match && pointIter != itemPoints.end(); pointIter++)
+			for(auto pointRectIter = pointRects.begin(); !match && pointRectIter != pointRects.end(); pointRectIter++)
 			{
-				pointSceneRect = view->mapToScene(view->pointRect(*pointIter));
+				pointSceneRect = view->mapToScene(*pointRectIter);
 
 				if (mode == Qt::IntersectsItemBoundingRect || mode == Qt::IntersectsItemShape)
 					match = path.intersects(pointSceneRect);
@@ -0,0 +1,477 @@
+/* DrawingSceneDiff.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingSceneDiff.h"
+#include "DrawingScene.h"
+#include "DrawingView.h"
+#include "DrawingItem.h"
+#include "DrawingItemPoint.h"
+#include "DrawingItemStyle.h"
+#include "DrawingItemFactory.h"
+#include <algorithm>
+#include <functional>
+
+class DrawingSceneDiffTask : public QRunnable
+{
+private:
+	std::function<void()> mFunction;
+
+public:
+	DrawingSceneDiffTask(const std::function<void()>& function)
+	{
+		mFunction = function;
+	}
+
+	void run()
+	{
+		mFunction();
+	}
+};
+
+// Number of items hashed by each task
+static const int hashBatchSize = 4096;
+
+static quint64 hashData(const char* data, int size)
+{
+	QByteArray bytes = QByteArray::fromRawData(data, size);
+	return (static_cast<quint64>(qHash(bytes, 0x9E3779B9u)) << 32) | qHash(bytes, 0x85EBCA6Bu);
+}
+
+static quint64 cellKey(quint64 hash, int x, int y)
+{
+	quint64 cell = (static_cast<quint64>(static_cast<quint32>(x)) << 32) | static_cast<quint32>(y);
+	return hash ^ (cell * Q_UINT64_C(0x9E3779B97F4A7C15));
+}
+
+static DrawingItem* topLevelItem(DrawingItem* item)
+{
+	while (item && item->parent()) item = item->parent();
+	return item;
+}
+
+// Returns a sorted key for each connection of the item's points.  The connected item is identified
+// by its index in the new scene: indexes of items in the old scene are translated through matches.
+static QVector<quint64> connectionKeys(DrawingItem* item, const QHash<DrawingItem*,int>& indexes,
+	const QVector<int>* matches)
+{
+	QVector<quint64> keys;
+	QList<DrawingItemPoint*> points = item->points();
+
+	for(int index = 0; index < points.size(); index++)
+	{
+		QList<DrawingItemPoint*> connections = points[index]->connections();
+
+		for(auto connectionIter = connections.begin(); connectionIter != connections.end(); connectionIter++)
+		{
+			DrawingItem* otherItem = (*connectionIter)->item();
+			int otherIndex = indexes.value(topLevelItem(otherItem), -1);
+			if (matches && otherIndex >= 0) otherIndex = matches->at(otherIndex);
+
+			int otherPointIndex = (otherItem) ? otherItem->points().indexOf(*connectionIter) : -1;
+
+			keys.append((static_cast<quint64>(index & 0xFFFF) << 48) |
+				(static_cast<quint64>(static_cast<quint32>(otherIndex + 1)) << 16) |
+				static_cast<quint64>(otherPointIndex & 0xFFFF));
+		}
+	}
+
+	std::sort(keys.begin(), keys.end());
+	return keys;
+}
+
+static bool hasConnections(DrawingItem* item)
+{
+	QList<DrawingItemPoint*> points = item->points();
+	for(auto pointIter = points.begin(); pointIter != points.end(); pointIter++)
+	{
+		if (!(*pointIter)->connections().isEmpty()) return true;
+	}
+
+	return false;
+}
+
+static QRectF sceneBoundingRect(DrawingItem* item)
+{
+	return item->mapToScene(item->boundingRect()).boundingRect();
+}
+
+//==================================================================================================
+
+DrawingSceneDiff::DrawingSceneDiff()
+{
+	mUnchangedCount = 0;
+	mMatchDistance = 100;
+	mMaximumThreadCount = QThread::idealThreadCount();
+}
+
+DrawingSceneDiff::~DrawingSceneDiff() { }
+
+//==================================================================================================
+
+void DrawingSceneDiff::setMatchDistance(qreal distance)
+{
+	mMatchDistance = qMax(distance, 0.0);
+}
+
+qreal DrawingSceneDiff::matchDistance() const
+{
+	return mMatchDistance;
+}
+
+void DrawingSceneDiff::setMaximumThreadCount(int count)
+{
+	mMaximumThreadCount = qMax(count, 1);
+}
+
+int DrawingSceneDiff::maximumThreadCount() const
+{
+	return mMaximumThreadCount;
+}
+
+//==================================================================================================
+
+void DrawingSceneDiff::compare(DrawingScene* oldScene, DrawingScene* newScene)
+{
+	clear();
+
+	QVector<Record> oldRecords, newRecords;
+	computeRecords(oldScene, oldRecords);
+	computeRecords(newScene, newRecords);
+
+	// Match items by id
+	QHash<quint64,int> oldIds;
+	oldIds.reserve(oldRecords.size());
+	for(int index = 0; index < oldRecords.size(); index++)
+		oldIds.insert(oldRecords[index].item->id(), index);
+
+	for(int index = 0; index < newRecords.size(); index++)
+	{
+		int oldIndex = oldIds.value(newRecords[index].item->id(), -1);
+
+		if (oldIndex >= 0 && oldRecords[oldIndex].match < 0)
+		{
+			oldRecords[oldIndex].match = index;
+			newRecords[index].match = oldIndex;
+		}
+	}
+
+	// Match re-created items by content, then by geometry
+	matchByHash(oldRecords, newRecords, &Record::contentHash, false);
+	matchByHash(oldRecords, newRecords, &Record::geometryHash, true);
+
+	// Classify matched items
+	QHash<DrawingItem*,int> oldIndexes, newIndexes;
+	QVector<int> oldMatches(oldRecords.size());
+	oldIndexes.reserve(oldRecords.size());
+	newIndexes.reserve(newRecords.size());
+
+	for(int index = 0; index < oldRecords.size(); index++)
+	{
+		oldIndexes.insert(oldRecords[index].item, index);
+		oldMatches[index] = oldRecords[index].match;
+	}
+	for(int index = 0; index < newRecords.size(); index++)
+		newIndexes.insert(newRecords[index].item, index);
+
+	Change change;
+
+	for(int index = 0; index < newRecords.size(); index++)
+	{
+		const Record& newRecord = newRecords[index];
+
+		change.types = ChangeTypes();
+		change.oldItem = nullptr;
+		change.newItem = newRecord.item;
+
+		if (newRecord.match >= 0)
+		{
+			const Record& oldRecord = oldRecords[newRecord.match];
+			change.oldItem = oldRecord.item;
+
+			if (oldRecord.position != newRecord.position) change.types |= ItemMoved;
+			if (oldRecord.styleHash != newRecord.styleHash) change.types |= ItemRestyled;
+
+			// The content includes the style, so only a content change with the same style is
+			// known to be something other than a style change
+			if (oldRecord.geometryHash != newRecord.geometryHash ||
+				(oldRecord.contentHash != newRecord.contentHash && oldRecord.styleHash == newRecord.styleHash))
+			{
+				change.types |= ItemReshaped;
+			}
+
+			if ((hasConnections(oldRecord.item) || hasConnections(newRecord.item)) &&
+				connectionKeys(oldRecord.item, oldIndexes, &oldMatches) != connectionKeys(newRecord.item, newIndexes, nullptr))
+			{
+				change.types |= ItemReconnected;
+			}
+		}
+		else change.types = ItemAdded;
+
+		if (change.types)
+		{
+			change.oldRect = (change.oldItem) ? sceneBoundingRect(change.oldItem) : QRectF();
+			change.newRect = sceneBoundingRect(change.newItem);
+			mChanges.append(change);
+		}
+		else mUnchangedCount++;
+	}
+
+	for(int index = 0; index < oldRecords.size(); index++)
+	{
+		if (oldRecords[index].match < 0)
+		{
+			change.types = ItemRemoved;
+			change.oldItem = oldRecords[index].item;
+			change.newItem = nullptr;
+			change.oldRect = sceneBoundingRect(change.oldItem);
+			change.newRect = QRectF();
+			mChanges.append(change);
+		}
+	}
+}
+
+void DrawingSceneDiff::clear()
+{
+	mChanges.clear();
+	mUnchangedCount = 0;
+}
+
+QVector<DrawingSceneDiff::Change> DrawingSceneDiff::changes() const
+{
+	return mChanges;
+}
+
+int DrawingSceneDiff::changeCount(ChangeType type) const
+{
+	int count = 0;
+
+	for(auto changeIter = mChanges.begin(); changeIter != mChanges.end(); changeIter++)
+	{
+		if (changeIter->types & type) count++;
+	}
+
+	return count;
+}
+
+int DrawingSceneDiff::unchangedCount() const
+{
+	return mUnchangedCount;
+}
+
+//==================================================================================================
+
+void DrawingSceneDiff::highlightChanges(DrawingView* view) const
+{
+	if (view)
+	{
+		view->clearHighlights();
+
+		for(auto changeIter = mChanges.begin(); changeIter != mChanges.end(); changeIter++)
+		{
+			if (changeIter->types & ItemAdded)
+				view->addHighlight(changeIter->newRect, QColor(0, 192, 0));
+			else if (changeIter->types & ItemRemoved)
+				view->addHighlight(changeIter->oldRect, QColor(224, 0, 0));
+			else
+			{
+				if (changeIter->types & ItemMoved) view->addHighlight(changeIter->oldRect, QColor(0, 96, 255));
+				view->addHighlight(changeIter->newRect, QColor(255, 128, 0));
+			}
+		}
+	}
+}
+
+//==================================================================================================
+
+void DrawingSceneDiff::computeRecords(DrawingScene* scene, QVector<Record>& records) const
+{
+	QList<DrawingItem*> items;
+	if (scene) items = scene->items();
+
+	records.resize(items.size());
+	for(int index = 0; index < items.size(); index++)
+	{
+		records[index].item = items[index];
+		records[index].match = -1;
+	}
+
+	Record* recordData = records.data();
+
+	auto hashItems = [recordData](int begin, int end)
+	{
+		QByteArray state, geometry, style;
+
+		for(int index = begin; index < end; index++)
+		{
+			Record& record = recordData[index];
+			DrawingItem* item = record.item;
+			QString typeName = DrawingItemFactory::typeName(item);
+
+			record.position = item->position();
+
+			// Content: the item's canonical state without its leading position
+			state.clear();
+			{
+				QDataStream stream(&state, QIODevice::WriteOnly);
+				stream.setVersion(QDataStream::Qt_5_0);
+				stream << typeName;
+			}
+			state.append(DrawingItemFactory::canonicalState(item).mid(2 * static_cast<int>(sizeof(double))));
+			record.contentHash = hashData(state.constData(), state.size());
+
+			// Geometry: the item's type, transform, and point positions
+			geometry.clear();
+			{
+				QDataStream stream(&geometry, QIODevice::WriteOnly);
+				stream.setVersion(QDataStream::Qt_5_0);
+				stream << typeName << item->transform();
+
+				QList<DrawingItemPoint*> points = item->points();
+				for(auto pointIter = points.begin(); pointIter != points.end(); pointIter++)
+					stream << (*pointIter)->position();
+			}
+			record.geometryHash = hashData(geometry.constData(), geometry.size());
+
+			// Style: the values of the style properties in property order
+			style.clear();
+			if (item->style())
+			{
+				QDataStream stream(&style, QIODevice::WriteOnly);
+				stream.setVersion(QDataStream::Qt_5_0);
+
+				for(int property = 0; property < DrawingItemStyle::NumberOfProperties; property++)
+				{
+					DrawingItemStyle::Property styleProperty = static_cast<DrawingItemStyle::Property>(property);
+					if (item->style()->hasValue(styleProperty))
+						stream << static_cast<quint32>(property) << item->style()->value(styleProperty);
+				}
+			}
+			record.styleHash = hashData(style.constData(), style.size());
+		}
+	};
+
+	if (mMaximumThreadCount > 1 && records.size() > hashBatchSize)
+	{
+		QThreadPool threadPool;
+		threadPool.setMaxThreadCount(mMaximumThreadCount);
+
+		for(int begin = 0; begin < records.size(); begin += hashBatchSize)
+		{
+			int end = qMin(begin + hashBatchSize, records.size());
+			threadPool.start(new DrawingSceneDiffTask([hashItems, begin, end]() { hashItems(begin, end); }));
+		}
+
+		threadPool.waitForDone();
+	}
+	else hashItems(0, records.size());
+}
+
+void DrawingSceneDiff::matchByHash(QVector<Record>& oldRecords, QVector<Record>& newRecords,
+	quint64 Record::*hash, bool requireProximity) const
+{
+	// Bucket the unmatched old items by hash and by their cell in a grid with a spacing of
+	// matchDistance(), so that only the neighboring cells need to be searched for each new item
+	const qreal cellSize = qMax(mMatchDistance, 1.0);
+	const qreal maximumDistance2 = mMatchDistance * mMatchDistance;
+
+	QHash<quint64,QVector<int>> cells;
+	QHash<quint64,QVector<int>> groups;
+	QHash<quint64,int> groupPositions;
+
+	for(int index = 0; index < oldRecords.size(); index++)
+	{
+		const Record& record = oldRecords[index];
+
+		if (record.match < 0)
+		{
+			cells[cellKey(record.*hash, qFloor(record.position.x() / cellSize), qFloor(record.position.y() / cellSize))].append(index);
+			if (!requireProximity) groups[record.*hash].append(index);
+		}
+	}
+
+	if (cells.isEmpty()) return;
+
+	for(int index = 0; index < newRecords.size(); index++)
+	{
+		Record& record = newRecords[index];
+		if (record.match >= 0) continue;
+
+		int bestIndex = -1;
+		qreal bestDistance2 = maximumDistance2;
+		QVector<int>* bestCell = nullptr;
+		int bestCellIndex = -1;
+
+		int cellX = qFloor(record.position.x() / cellSize);
+		int cellY = qFloor(record.position.y() / cellSize);
+
+		for(int dy = -1; dy <= 1; dy++)
+		{
+			for(int dx = -1; dx <= 1; dx++)
+			{
+				auto cellIter = cells.find(cellKey(record.*hash, cellX + dx, cellY + dy));
+				if (cellIter == cells.end()) continue;
+
+				QVector<int>& cell = cellIter.value();
+				for(int cellIndex = 0; cellIndex < cell.size(); cellIndex++)
+				{
+					const Record& oldRecord = oldRecords[cell[cellIndex]];
+					if (oldRecord.match >= 0 || oldRecord.*hash != record.*hash) continue;
+
+					QPointF delta = oldRecord.position - record.position;
+					qreal distance2 = delta.x() * delta.x() + delta.y() * delta.y();
+
+					if (distance2 <= bestDistance2)
+					{
+						bestIndex = cell[cellIndex];
+						bestDistance2 = distance2;
+						bestCell = &cell;
+						bestCellIndex = cellIndex;
+					}
+				}
+			}
+		}
+
+		if (bestCell)
+		{
+			// Matched items are removed from their cell so that crowded cells shrink as they are used
+			(*bestCell)[bestCellIndex] = bestCell->last();
+			bestCell->removeLast();
+		}
+		else if (!requireProximity)
+		{
+			// Items with identical content that moved further than matchDistance() are paired in
+			// scene order
+			auto groupIter = groups.find(record.*hash);
+
+			if (groupIter != groups.end())
+			{
+				int& position = groupPositions[record.*hash];
+				while (position < groupIter->size() && oldRecords[groupIter->at(position)].match >= 0) position++;
+				if (position < groupIter->size()) bestIndex = groupIter->at(position);
+			}
+		}
+
+		if (bestIndex >= 0)
+		{
+			oldRecords[bestIndex].match = index;
+			record.match = bestIndex;
+		}
+	}
+}
@@ -0,0 +1,912 @@
+/* DrawingSceneSync.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingSceneSync.h"
+#include "DrawingScene.h"
+#include "DrawingItem.h"
+#include "DrawingItemPoint.h"
+#include "DrawingItemStyle.h"
+#include "DrawingItemFactory.h"
+#include "DrawingArena.h"
+#include "DrawingStyleDefaults.h"
+#include <algorithm>
+
+// Each delta is a QDataStream containing the number of operations followed by the operations.
+// Each operation starts with one of these codes.
+enum DrawingSceneDeltaOperation
+{
+	ResetSceneOperation,		// sceneRect, backgroundBrush
+	AddItemOperation,			// id, index, item (see DrawingItemFactory::writeItem())
+	RemoveItemOperation,		// id
+	ReorderItemsOperation,		// count, (id, index) pairs of the items that moved
+	SetPositionOperation,		// id, position
+	SetStyleOperation,			// id, count, (property, value) pairs
+	SetStateOperation,			// id, state (see DrawingItem::writeState())
+	ConnectOperation,			// id1, pointIndex1, id2, pointIndex2
+	DisconnectOperation			// id1, pointIndex1, id2, pointIndex2
+};
+
+static DrawingItem* topLevelItem(DrawingItem* item)
+{
+	while (item && item->parent()) item = item->parent();
+	return item;
+}
+
+static QByteArray encodeDelta(const QByteArray& operations, int operationCount)
+{
+	QByteArray delta;
+
+	if (operationCount > 0)
+	{
+		QDataStream stream(&delta, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_0);
+		stream << static_cast<quint32>(operationCount);
+		stream.writeRawData(operations.constData(), operations.size());
+	}
+
+	return delta;
+}
+
+//==================================================================================================
+
+DrawingScenePublisher::DrawingScenePublisher(DrawingScene* scene, QObject* parent) : QObject(parent)
+{
+	mScene = scene;
+	mServer = nullptr;
+
+	mFlushTimer = new QTimer(this);
+	mFlushTimer->setSingleShot(true);
+	mFlushTimer->setInterval(50);
+	connect(mFlushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+
+	mItemsReordered = false;
+
+	if (mScene)
+	{
+		QList<DrawingItem*> items = mScene->items();
+		for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+			mPublishedItems.insert((*itemIter)->id());
+		mPublishedOrder = items;
+
+		connect(mScene, SIGNAL(itemsAdded(const QList<DrawingItem*>&)), this, SLOT(recordAddedItems(const QList<DrawingItem*>&)));
+		connect(mScene, SIGNAL(itemsRemoved(const QList<DrawingItem*>&)), this, SLOT(recordRemovedItems(const QList<DrawingItem*>&)));
+		connect(mScene, SIGNAL(itemsReordered(const QList<DrawingItem*>&)), this, SLOT(recordReorderedItems()));
+		connect(mScene, SIGNAL(itemsCompacted(const QHash<DrawingItem*,DrawingItem*>&)), this, SLOT(recordCompactedItems(const QHash<DrawingItem*,DrawingItem*>&)));
+		connect(mScene, SIGNAL(itemsPositionChanged(const QList<DrawingItem*>&)), this, SLOT(recordPositionChanges(const QList<DrawingItem*>&)));
+		connect(mScene, SIGNAL(itemsStyleChanged(const QList<DrawingItem*>&)), this, SLOT(recordStyleChanges(const QList<DrawingItem*>&)));
+		connect(mScene, SIGNAL(itemsTransformChanged(const QList<DrawingItem*>&)), this, SLOT(recordStateChanges(const QList<DrawingItem*>&)));
+		connect(mScene, SIGNAL(itemsGeometryChanged(const QList<DrawingItem*>&)), this, SLOT(recordStateChanges(const QList<DrawingItem*>&)));
+		connect(mScene, SIGNAL(itemsVisibilityChanged(const QList<DrawingItem*>&)), this, SLOT(recordStateChanges(const QList<DrawingItem*>&)));
+		connect(mScene, SIGNAL(itemPointsConnected(DrawingItemPoint*,DrawingItemPoint*)), this, SLOT(recordConnection(DrawingItemPoint*,DrawingItemPoint*)));
+		connect(mScene, SIGNAL(itemPointsDisconnected(DrawingItemPoint*,DrawingItemPoint*)), this, SLOT(recordDisconnection(DrawingItemPoint*,DrawingItemPoint*)));
+	}
+}
+
+DrawingScenePublisher::~DrawingScenePublisher()
+{
+	close();
+}
+
+//==================================================================================================
+
+DrawingScene* DrawingScenePublisher::scene() const
+{
+	return mScene;
+}
+
+bool DrawingScenePublisher::listen(const QString& serverName)
+{
+	if (mServer == nullptr)
+	{
+		mServer = new QLocalServer(this);
+		connect(mServer, SIGNAL(newConnection()), this, SLOT(acceptSubscriber()));
+	}
+
+	// Remove a stale socket left behind by a publisher that crashed
+	QLocalServer::removeServer(serverName);
+
+	return mServer->listen(serverName);
+}
+
+void DrawingScenePublisher::close()
+{
+	if (mServer) mServer->close();
+
+	while (!mSockets.isEmpty())
+	{
+		QLocalSocket* socket = mSockets.takeFirst();
+		socket->disconnect(this);
+		socket->disconnectFromServer();
+		socket->deleteLater();
+	}
+}
+
+bool DrawingScenePublisher::isListening() const
+{
+	return (mServer && mServer->isListening());
+}
+
+QString DrawingScenePublisher::errorString() const
+{
+	return (mServer) ? mServer->errorString() : QString();
+}
+
+void DrawingScenePublisher::setFlushInterval(int milliseconds)
+{
+	mFlushTimer->setInterval(qMax(milliseconds, 0));
+}
+
+int DrawingScenePublisher::flushInterval() const
+{
+	return mFlushTimer->interval();
+}
+
+//==================================================================================================
+
+QByteArray DrawingScenePublisher::snapshot()
+{
+	QByteArray operations;
+	int operationCount = 0;
+
+	if (mScene)
+	{
+		QDataStream stream(&operations, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_0);
+
+		stream << static_cast<quint8>(ResetSceneOperation) << mScene->sceneRect() << mScene->backgroundBrush();
+		operationCount++;
+
+		QList<DrawingItem*> items = mScene->items();
+		mPublishedItems.clear();
+
+		for(int index = 0; index < items.size(); index++)
+		{
+			stream << static_cast<quint8>(AddItemOperation) << items[index]->id() << static_cast<qint32>(index);
+			DrawingItemFactory::writeItem(stream, items[index]);
+			operationCount++;
+
+			mPublishedItems.insert(items[index]->id());
+		}
+
+		for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+			writeItemConnections(stream, operationCount, *itemIter, mPublishedItems);
+
+		mPublishedOrder = items;
+	}
+
+	return encodeDelta(operations, operationCount);
+}
+
+QByteArray DrawingScenePublisher::takeDelta()
+{
+	QByteArray operations;
+	int operationCount = 0;
+
+	if (mScene)
+	{
+		QDataStream stream(&operations, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_0);
+
+		QList<DrawingItem*> items = mScene->items();
+		QList<QPair<int,DrawingItem*>> addedItems;
+		QSet<quint64> addedItemIds;
+
+		// Removed items.  An item that was removed and then added again is sent again in full.
+		for(auto idIter = mRemovedItems.begin(); idIter != mRemovedItems.end(); idIter++)
+		{
+			if (mPublishedItems.remove(*idIter))
+			{
+				stream << static_cast<quint8>(RemoveItemOperation) << *idIter;
+				operationCount++;
+			}
+		}
+
+		// Added items, in ascending order of their final index so that inserting them one at a
+		// time recreates the scene's item order
+		if (mItemsReordered)
+		{
+			// The whole item list was replaced, so compare it against the published items
+			QSet<quint64> currentItemIds;
+
+			for(int index = 0; index < items.size(); index++)
+			{
+				currentItemIds.insert(items[index]->id());
+				if (!mPublishedItems.contains(items[index]->id()))
+					addedItems.append(qMakePair(index, items[index]));
+			}
+
+			for(auto idIter = mPublishedItems.begin(); idIter != mPublishedItems.end(); )
+			{
+				if (!currentItemIds.contains(*idIter))
+				{
+					stream << static_cast<quint8>(RemoveItemOperation) << *idIter;
+					operationCount++;
+					idIter = mPublishedItems.erase(idIter);
+				}
+				else idIter++;
+			}
+		}
+		else if (!mAddedItems.isEmpty())
+		{
+			QSet<DrawingItem*> newItems;
+
+			DrawingItem* item;
+			for(auto idIter = mAddedItems.begin(); idIter != mAddedItems.end(); idIter++)
+			{
+				item = mScene->itemFromId(*idIter);
+				if (item && item->parent() == nullptr && !mPublishedItems.contains(*idIter))
+					newItems.insert(item);
+			}
+
+			// Only the added items are looked up; a single pass over the scene finds them in order
+			// once there are too many to search for one at a time
+			if (newItems.size() <= 8)
+			{
+				for(auto itemIter = newItems.begin(); itemIter != newItems.end(); itemIter++)
+				{
+					int index = items.indexOf(*itemIter);
+					if (index >= 0) addedItems.append(qMakePair(index, *itemIter));
+				}
+
+				std::sort(addedItems.begin(), addedItems.end(),
+					[](const QPair<int,DrawingItem*>& item1, const QPair<int,DrawingItem*>& item2) { return item1.first < item2.first; });
+			}
+			else
+			{
+				for(int index = 0; index < items.size() && addedItems.size() < newItems.size(); index++)
+				{
+					if (newItems.contains(items[index])) addedItems.append(qMakePair(index, items[index]));
+				}
+			}
+		}
+
+		// Reordered items are moved before the added items are inserted at their final indices
+		if (mItemsReordered)
+		{
+			QSet<DrawingItem*> newItems;
+			for(auto itemIter = addedItems.begin(); itemIter != addedItems.end(); itemIter++)
+				newItems.insert(itemIter->second);
+
+			writeMovedItems(stream, operationCount, items, newItems);
+		}
+
+		addedItemIds.clear();
+		for(auto itemIter = addedItems.begin(); itemIter != addedItems.end(); itemIter++)
+		{
+			stream << static_cast<quint8>(AddItemOperation) << itemIter->second->id() << static_cast<qint32>(itemIter->first);
+			DrawingItemFactory::writeItem(stream, itemIter->second);
+			operationCount++;
+
+			addedItemIds.insert(itemIter->second->id());
+			mPublishedItems.insert(itemIter->second->id());
+		}
+
+		for(auto itemIter = addedItems.begin(); itemIter != addedItems.end(); itemIter++)
+			writeItemConnections(stream, operationCount, itemIter->second, addedItemIds);
+
+		// Changed items
+		DrawingItem* item;
+		for(auto changeIter = mChangedItems.begin(); changeIter != mChangedItems.end(); changeIter++)
+		{
+			item = mScene->itemFromId(changeIter.key());
+
+			if (item && mPublishedItems.contains(changeIter.key()) && !addedItemIds.contains(changeIter.key()))
+			{
+				if (changeIter.value() & StateChange)
+				{
+					QByteArray state;
+					QDataStream stateStream(&state, QIODevice::WriteOnly);
+					stateStream.setVersion(stream.version());
+					item->writeState(stateStream);
+
+					stream << static_cast<quint8>(SetStateOperation) << changeIter.key() << state;
+					operationCount++;
+				}
+				else
+				{
+					if (changeIter.value() & PositionChange)
+					{
+						stream << static_cast<quint8>(SetPositionOperation) << changeIter.key() << item->position();
+						operationCount++;
+					}
+
+					if (changeIter.value() & StyleChange)
+					{
+						QHash<DrawingItemStyle::Property,QVariant> values;
+						if (item->style()) values = item->style()->values();
+
+						stream << static_cast<quint8>(SetStyleOperation) << changeIter.key() << static_cast<quint32>(values.size());
+						for(auto valueIter = values.begin(); valueIter != values.end(); valueIter++)
+							stream << static_cast<quint32>(valueIter.key()) << valueIter.value();
+						operationCount++;
+					}
+				}
+			}
+		}
+
+		// Connection changes, in the order they were made
+		for(auto changeIter = mConnectionChanges.begin(); changeIter != mConnectionChanges.end(); changeIter++)
+		{
+			DrawingItem* item1 = topLevelItem(mScene->itemFromId(changeIter->itemId1));
+			DrawingItem* item2 = topLevelItem(mScene->itemFromId(changeIter->itemId2));
+
+			if (item1 && item2 && mPublishedItems.contains(item1->id()) && mPublishedItems.contains(item2->id()))
+			{
+				stream << static_cast<quint8>((changeIter->connected) ? ConnectOperation : DisconnectOperation)
+					<< changeIter->itemId1 << static_cast<qint32>(changeIter->pointIndex1)
+					<< changeIter->itemId2 << static_cast<qint32>(changeIter->pointIndex2);
+				operationCount++;
+			}
+		}
+	}
+
+	mAddedItems.clear();
+	mRemovedItems.clear();
+	mChangedItems.clear();
+	mConnectionChanges.clear();
+	mItemsReordered = false;
+
+	// Copying the list is cheap until the scene next modifies its own
+	if (mScene) mPublishedOrder = mScene->items();
+
+	return encodeDelta(operations, operationCount);
+}
+
+//==================================================================================================
+
+void DrawingScenePublisher::flush()
+{
+	mFlushTimer->stop();
+
+	QByteArray delta = takeDelta();
+	if (!delta.isEmpty())
+	{
+		for(auto socketIter = mSockets.begin(); socketIter != mSockets.end(); socketIter++)
+			sendDelta(*socketIter, delta);
+
+		emit deltaReady(delta);
+	}
+}
+
+//==================================================================================================
+
+void DrawingScenePublisher::recordAddedItems(const QList<DrawingItem*>& items)
+{
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+		mAddedItems.append((*itemIter)->id());
+
+	if (!mFlushTimer->isActive()) mFlushTimer->start();
+}
+
+void DrawingScenePublisher::recordRemovedItems(const QList<DrawingItem*>& items)
+{
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+		mRemovedItems.insert((*itemIter)->id());
+
+	if (!mFlushTimer->isActive()) mFlushTimer->start();
+}
+
+void DrawingScenePublisher::recordReorderedItems()
+{
+	mItemsReordered = true;
+
+	if (!mFlushTimer->isActive()) mFlushTimer->start();
+}
+
+void DrawingScenePublisher::recordCompactedItems(const QHash<DrawingItem*,DrawingItem*>& replacedItems)
+{
+	// Compacted items keep their ids and order, so only the published order needs to follow them
+	for(auto itemIter = mPublishedOrder.begin(); itemIter != mPublishedOrder.end(); itemIter++)
+		*itemIter = replacedItems.value(*itemIter, *itemIter);
+}
+
+void DrawingScenePublisher::recordPositionChanges(const QList<DrawingItem*>& items)
+{
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+		recordChange(*itemIter, PositionChange);
+}
+
+void DrawingScenePublisher::recordStyleChanges(const QList<DrawingItem*>& items)
+{
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+		recordChange(*itemIter, StyleChange);
+}
+
+void DrawingScenePublisher::recordStateChanges(const QList<DrawingItem*>& items)
+{
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+		recordChange(*itemIter, StateChange);
+}
+
+void DrawingScenePublisher::recordConnection(DrawingItemPoint* point1, DrawingItemPoint* point2)
+{
+	recordConnectionChange(point1, point2, true);
+}
+
+void DrawingScenePublisher::recordDisconnection(DrawingItemPoint* point1, DrawingItemPoint* point2)
+{
+	recordConnectionChange(point1, point2, false);
+}
+
+//==================================================================================================
+
+void DrawingScenePublisher::acceptSubscriber()
+{
+	// Send any pending changes to the existing subscribers so that the new subscriber's snapshot
+	// starts from the same state
+	flush();
+
+	QLocalSocket* socket = mServer->nextPendingConnection();
+	while (socket)
+	{
+		connect(socket, SIGNAL(disconnected()), this, SLOT(releaseSubscriber()));
+		mSockets.append(socket);
+
+		sendDelta(socket, snapshot());
+
+		socket = mServer->nextPendingConnection();
+	}
+}
+
+void DrawingScenePublisher::releaseSubscriber()
+{
+	QLocalSocket* socket = qobject_cast<QLocalSocket*>(sender());
+
+	if (socket)
+	{
+		mSockets.removeAll(socket);
+		socket->deleteLater();
+	}
+}
+
+//==================================================================================================
+
+void DrawingScenePublisher::recordChange(DrawingItem* item, quint8 change)
+{
+	DrawingItem* topItem = topLevelItem(item);
+
+	if (topItem)
+	{
+		// Partial updates are only sent for top-level items without children; all other changes
+		// resend the state of the entire top-level item
+		if (topItem != item || !item->children().isEmpty()) change = StateChange;
+
+		mChangedItems[topItem->id()] |= change;
+
+		if (!mFlushTimer->isActive()) mFlushTimer->start();
+	}
+}
+
+void DrawingScenePublisher::recordConnectionChange(DrawingItemPoint* point1, DrawingItemPoint* point2, bool connected)
+{
+	if (point1 && point2 && point1->item() && point2->item())
+	{
+		ConnectionChange change;
+		change.itemId1 = point1->item()->id();
+		change.pointIndex1 = point1->item()->points().indexOf(point1);
+		change.itemId2 = point2->item()->id();
+		change.pointIndex2 = point2->item()->points().indexOf(point2);
+		change.connected = connected;
+		mConnectionChanges.append(change);
+
+		if (!mFlushTimer->isActive()) mFlushTimer->start();
+	}
+}
+
+void DrawingScenePublisher::writeItemConnections(QDataStream& stream, int& operationCount, DrawingItem* item,
+	const QSet<quint64>& writtenItems) const
+{
+	QList<DrawingItemPoint*> points = item->points();
+	QList<DrawingItemPoint*> connections;
+	DrawingItem* otherItem;
+	int otherIndex;
+
+	for(int index = 0; index < points.size(); index++)
+	{
+		connections = points[index]->connections();
+
+		for(auto connectionIter = connections.begin(); connectionIter != connections.end(); connectionIter++)
+		{
+			otherItem = (*connectionIter)->item();
+			if (otherItem == nullptr || topLevelItem(otherItem)->scene() != mScene) continue;
+
+			otherIndex = otherItem->points().indexOf(*connectionIter);
+
+			// Connections between two items in writtenItems are seen from both sides; only write
+			// them once
+			if (writtenItems.contains(topLevelItem(otherItem)->id()) &&
+				(otherItem->id() < item->id() || (otherItem->id() == item->id() && otherIndex < index)))
+				continue;
+
+			stream << static_cast<quint8>(ConnectOperation) << item->id() << static_cast<qint32>(index)
+				<< otherItem->id() << static_cast<qint32>(otherIndex);
+			operationCount++;
+		}
+	}
+
+	QList<DrawingItem*> children = item->children();
+	for(auto childIter = children.begin(); childIter != children.end(); childIter++)
+		writeItemConnections(stream, operationCount, *childIter, writtenItems);
+}
+
+void DrawingScenePublisher::writeMovedItems(QDataStream& stream, int& operationCount,
+	const QList<DrawingItem*>& items, const QSet<DrawingItem*>& addedItems) const
+{
+	// The subscriber's order is the published order without the removed items.  The longest run
+	// of items that kept their relative order stays in place and only the other items are sent,
+	// each with its index in the scene's order without the added items.
+	QHash<DrawingItem*,int> publishedIndex;
+	publishedIndex.reserve(mPublishedOrder.size());
+	for(int index = 0; index < mPublishedOrder.size(); index++)
+		publishedIndex.insert(mPublishedOrder[index], index);
+
+	QList<DrawingItem*> orderedItems;
+	QVector<int> orderedIndices;
+	orderedItems.reserve(items.size());
+	orderedIndices.reserve(items.size());
+
+	for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+	{
+		if (!addedItems.contains(*itemIter) && mPublishedItems.contains((*itemIter)->id()))
+		{
+			orderedItems.append(*itemIter);
+			orderedIndices.append(publishedIndex.value(*itemIter, -1));
+		}
+	}
+
+	// Longest increasing subsequence of the published indices: runEnds[k] is the position of the
+	// smallest index that ends a run of length k + 1
+	QVector<int> runEnds, previous(orderedIndices.size(), -1);
+	for(int position = 0; position < orderedIndices.size(); position++)
+	{
+		if (orderedIndices[position] < 0) continue;
+
+		int length = std::lower_bound(runEnds.begin(), runEnds.end(), orderedIndices[position],
+			[&orderedIndices](int endPosition, int index) { return orderedIndices[endPosition] < index; }) - runEnds.begin();
+
+		if (length > 0) previous[position] = runEnds[length - 1];
+		if (length == runEnds.size()) runEnds.append(position);
+		else runEnds[length] = position;
+	}
+
+	QVector<bool> inPlace(orderedIndices.size(), false);
+	for(int position = (runEnds.isEmpty()) ? -1 : runEnds.last(); position >= 0; position = previous[position])
+		inPlace[position] = true;
+
+	int movedCount = inPlace.count(false);
+	if (movedCount > 0)
+	{
+		stream << static_cast<quint8>(ReorderItemsOperation) << static_cast<quint32>(movedCount);
+		for(int position = 0; position < orderedItems.size(); position++)
+		{
+			if (!inPlace[position])
+				stream << orderedItems[position]->id() << static_cast<qint32>(position);
+		}
+		operationCount++;
+	}
+}
+
+void DrawingScenePublisher::sendDelta(QLocalSocket* socket, const QByteArray& delta)
+{
+	QByteArray frame;
+	QDataStream stream(&frame, QIODevice::WriteOnly);
+	stream << delta;
+
+	socket->write(frame);
+}
+
+//==================================================================================================
+//==================================================================================================
+
+DrawingSceneSubscriber::DrawingSceneSubscriber(DrawingScene* scene, QObject* parent) : QObject(parent)
+{
+	mScene = scene;
+
+	mMaximumDeltaSize = 256 * 1024 * 1024;
+
+	mSocket = new QLocalSocket(this);
+	connect(mSocket, SIGNAL(readyRead()), this, SLOT(readDeltas()));
+	connect(mSocket, SIGNAL(disconnected()), this, SIGNAL(disconnected()));
+}
+
+DrawingSceneSubscriber::~DrawingSceneSubscriber() { }
+
+//==================================================================================================
+
+DrawingScene* DrawingSceneSubscriber::scene() const
+{
+	return mScene;
+}
+
+void DrawingSceneSubscriber::connectToPublisher(const QString& serverName)
+{
+	mBuffer.clear();
+	mSocket->abort();
+	mSocket->connectToServer(serverName, QIODevice::ReadOnly);
+}
+
+void DrawingSceneSubscriber::disconnectFromPublisher()
+{
+	mSocket->disconnectFromServer();
+}
+
+bool DrawingSceneSubscriber::isConnected() const
+{
+	return (mSocket->state() == QLocalSocket::ConnectedState);
+}
+
+void DrawingSceneSubscriber::setMaximumDeltaSize(int bytes)
+{
+	mMaximumDeltaSize = qMax(bytes, 0);
+}
+
+int DrawingSceneSubscriber::maximumDeltaSize() const
+{
+	return mMaximumDeltaSize;
+}
+
+//==================================================================================================
+
+bool DrawingSceneSubscriber::applyDelta(const QByteArray& delta)
+{
+	if (mScene == nullptr) return false;
+
+	DrawingArenaScope arenaScope(mScene->itemArena());
+	DrawingStyleDefaultsScope defaultsScope(mScene->styleDefaults());
+
+	QDataStream stream(delta);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	quint32 operationCount = 0;
+	quint8 operation = 0;
+	quint64 id = 0, id2 = 0;
+	qint32 index = 0, index2 = 0;
+	quint32 count = 0;
+	DrawingItem* item;
+
+	stream >> operationCount;
+
+	for(quint32 i = 0; i < operationCount && stream.status() == QDataStream::Ok; i++)
+	{
+		stream >> operation;
+
+		switch (operation)
+		{
+		case ResetSceneOperation:
+			{
+				QRectF sceneRect;
+				QBrush backgroundBrush;
+				stream >> sceneRect >> backgroundBrush;
+
+				mScene->setItems(QList<DrawingItem*>());
+				mScene->setSceneRect(sceneRect);
+				mScene->setBackgroundBrush(backgroundBrush);
+			}
+			break;
+
+		case AddItemOperation:
+			stream >> id >> index;
+			item = DrawingItemFactory::readItem(stream);
+
+			if (item)
+			{
+				DrawingItem* existingItem = mScene->itemFromId(id);
+				if (existingItem && existingItem->parent() == nullptr)
+				{
+					mScene->removeItem(existingItem);
+					delete existingItem;
+				}
+
+				mScene->insertItem(index, item);
+			}
+			break;
+
+		case RemoveItemOperation:
+			stream >> id;
+			item = mScene->itemFromId(id);
+
+			if (item && item->parent() == nullptr)
+			{
+				mScene->removeItem(item);
+				delete item;
+			}
+			break;
+
+		case ReorderItemsOperation:
+			{
+				QList<QPair<int,DrawingItem*>> movedItems;
+				QSet<DrawingItem*> movedItemSet;
+
+				stream >> count;
+				for(quint32 j = 0; j < count && stream.status() == QDataStream::Ok; j++)
+				{
+					stream >> id >> index;
+					item = mScene->itemFromId(id);
+					if (item && item->parent() == nullptr && !movedItemSet.contains(item))
+					{
+						movedItems.append(qMakePair(static_cast<int>(index), item));
+						movedItemSet.insert(item);
+					}
+				}
+
+				// The moved items are taken out and inserted again in ascending order of their new
+				// index.  Items the publisher did not know about are kept.
+				QList<DrawingItem*> items;
+				QList<DrawingItem*> currentItems = mScene->items();
+				for(auto itemIter = currentItems.begin(); itemIter != currentItems.end(); itemIter++)
+				{
+					if (!movedItemSet.contains(*itemIter)) items.append(*itemIter);
+				}
+
+				for(auto itemIter = movedItems.begin(); itemIter != movedItems.end(); itemIter++)
+					items.insert(qBound(0, itemIter->first, items.size()), itemIter->second);
+
+				if (!movedItems.isEmpty()) mScene->setItems(items);
+			}
+			break;
+
+		case SetPositionOperation:
+			{
+				QPointF position;
+				stream >> id >> position;
+
+				item = mScene->itemFromId(id);
+				if (item) item->setPosition(position);
+			}
+			break;
+
+		case SetStyleOperation:
+			{
+				QHash<DrawingItemStyle::Property,QVariant> values;
+				quint32 property = 0;
+				QVariant value;
+
+				stream >> id >> count;
+				for(quint32 j = 0; j < count && stream.status() == QDataStream::Ok; j++)
+				{
+					stream >> property >> value;
+					values.insert(static_cast<DrawingItemStyle::Property>(property), value);
+				}
+
+				item = mScene->itemFromId(id);
+				if (item && item->style()) item->style()->setValues(values);
+			}
+			break;
+
+		case SetStateOperation:
+			{
+				QByteArray state;
+				stream >> id >> state;
+
+				item = mScene->itemFromId(id);
+				if (item) applyState(item, state);
+			}
+			break;
+
+		case ConnectOperation:
+		case DisconnectOperation:
+			{
+				stream >> id >> index >> id2 >> index2;
+
+				DrawingItemPoint* point1 = itemPoint(id, index);
+				DrawingItemPoint* point2 = itemPoint(id2, index2);
+
+				if (point1 && point2)
+				{
+					if (operation == ConnectOperation && !point1->isConnected(point2))
+						mScene->connectItemPoints(point1, point2);
+					else if (operation == DisconnectOperation)
+						mScene->disconnectItemPoints(point1, point2);
+				}
+			}
+			break;
+
+		default:
+			stream.setStatus(QDataStream::ReadCorruptData);
+			break;
+		}
+	}
+
+	emit deltaApplied();
+
+	return (stream.status() == QDataStream::Ok);
+}
+
+//==================================================================================================
+
+void DrawingSceneSubscriber::readDeltas()
+{
+	mBuffer.append(mSocket->readAll());
+
+	// Each delta is framed as a QByteArray written by QDataStream: a 32-bit big-endian length
+	// followed by the delta itself.  Complete frames are consumed from a read offset and removed
+	// from the buffer together afterwards.
+	int offset = 0;
+	bool oversized = false, failed = false;
+
+	while (!oversized && !failed && mBuffer.size() - offset >= 4)
+	{
+		quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(mBuffer.constData() + offset));
+		if (length == 0xFFFFFFFF) length = 0;
+
+		oversized = (length > static_cast<quint32>(mMaximumDeltaSize));
+		if (oversized || static_cast<quint32>(mBuffer.size() - offset - 4) < length) break;
+
+		failed = !applyDelta(mBuffer.mid(offset + 4, length));
+		offset += 4 + length;
+	}
+
+	if (oversized)
+	{
+		mBuffer.clear();
+		mSocket->abort();
+	}
+	else if (failed)
+	{
+		// The scene no longer matches the publisher's scene, and every later delta would build on
+		// the mismatch; a new connection starts again from a snapshot
+		connectToPublisher(mSocket->serverName());
+	}
+	else if (offset > 0) mBuffer.remove(0, offset);
+}
+
+//==================================================================================================
+
+void DrawingSceneSubscriber::applyState(DrawingItem* item, const QByteArray& state)
+{
+	QDataStream stream(state);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	// Children are recreated by readState(), so items with children are removed from the scene
+	// and added again so that the ids of their new children are registered with the scene
+	bool reinsert = (item->parent() == nullptr && !item->children().isEmpty());
+	int index = -1;
+
+	if (reinsert)
+	{
+		index = mScene->items().indexOf(item);
+		mScene->removeItem(item);
+	}
+
+	item->readState(stream);
+
+	if (!reinsert && item->parent() == nullptr && !item->children().isEmpty())
+	{
+		index = mScene->items().indexOf(item);
+		mScene->removeItem(item);
+		reinsert = true;
+	}
+
+	if (reinsert) mScene->insertItem(index, item);
+}
+
+DrawingItemPoint* DrawingSceneSubscriber::itemPoint(quint64 itemId, int pointIndex) const
+{
+	DrawingItemPoint* point = nullptr;
+
+	DrawingItem* item = mScene->itemFromId(itemId);
+	if (item)
+	{
+		QList<DrawingItemPoint*> points = item->points();
+		if (0 <= pointIndex && pointIndex < points.size()) point = points[pointIndex];
+	}
+
+	return point;
+}
@@ -0,0 +1,221 @@
+/* DrawingStyleDefaults.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingStyleDefaults.h"
+
+// Context used by DrawingItemStyle::valueLookup() on each thread, set by DrawingStyleDefaultsScope
+static thread_local DrawingStyleDefaults* threadDefaults = nullptr;
+
+// Hazard slot holding the snapshot a thread is reading, so that writers do not delete it.  Slots
+// are never freed; a slot released by an exiting thread is reused by the next new thread.
+struct DrawingStyleDefaultsHazard
+{
+	QAtomicPointer<void> snapshot;
+	QAtomicInt active;
+	DrawingStyleDefaultsHazard* next;
+};
+
+static QAtomicPointer<DrawingStyleDefaultsHazard> hazardList;
+
+class DrawingStyleDefaultsHazardOwner
+{
+public:
+	DrawingStyleDefaultsHazard* hazard;
+
+	DrawingStyleDefaultsHazardOwner()
+	{
+		hazard = hazardList.loadAcquire();
+		while (hazard && !hazard->active.testAndSetAcquire(0, 1)) hazard = hazard->next;
+
+		if (!hazard)
+		{
+			hazard = new DrawingStyleDefaultsHazard();
+			hazard->active.store(1);
+
+			do hazard->next = hazardList.loadAcquire();
+			while (!hazardList.testAndSetRelease(hazard->next, hazard));
+		}
+	}
+
+	~DrawingStyleDefaultsHazardOwner()
+	{
+		hazard->snapshot.storeRelease(nullptr);
+		hazard->active.storeRelease(0);
+	}
+};
+
+static thread_local DrawingStyleDefaultsHazardOwner threadHazard;
+
+//==================================================================================================
+
+DrawingStyleDefaults::DrawingStyleDefaults()
+{
+	mSnapshot.storeRelease(new Snapshot());
+}
+
+DrawingStyleDefaults::~DrawingStyleDefaults()
+{
+	delete mSnapshot.loadAcquire();
+	qDeleteAll(mRetiredSnapshots);
+}
+
+//==================================================================================================
+
+void DrawingStyleDefaults::setValues(const QHash<DrawingItemStyle::Property,QVariant>& values)
+{
+	QMutexLocker locker(&mMutex);
+
+	Snapshot* snapshot = new Snapshot();
+	snapshot->values = values;
+	replaceSnapshot(snapshot);
+}
+
+QHash<DrawingItemStyle::Property,QVariant> DrawingStyleDefaults::values() const
+{
+	QHash<DrawingItemStyle::Property,QVariant> values = acquireSnapshot()->values;
+	releaseSnapshot();
+
+	return values;
+}
+
+//==================================================================================================
+
+void DrawingStyleDefaults::setValue(DrawingItemStyle::Property index, const QVariant& value)
+{
+	QMutexLocker locker(&mMutex);
+
+	Snapshot* snapshot = new Snapshot(*mSnapshot.loadAcquire());
+	snapshot->values.insert(index, value);
+	replaceSnapshot(snapshot);
+}
+
+void DrawingStyleDefaults::unsetValue(DrawingItemStyle::Property index)
+{
+	QMutexLocker locker(&mMutex);
+
+	Snapshot* snapshot = new Snapshot(*mSnapshot.loadAcquire());
+	snapshot->values.remove(index);
+	replaceSnapshot(snapshot);
+}
+
+void DrawingStyleDefaults::clearValues()
+{
+	QMutexLocker locker(&mMutex);
+	replaceSnapshot(new Snapshot());
+}
+
+bool DrawingStyleDefaults::hasValue(DrawingItemStyle::Property index) const
+{
+	QVariant value;
+	return lookup(index, value);
+}
+
+QVariant DrawingStyleDefaults::value(DrawingItemStyle::Property index, const QVariant& fallbackValue) const
+{
+	QVariant value;
+	return (lookup(index, value)) ? value : fallbackValue;
+}
+
+//==================================================================================================
+
+DrawingStyleDefaults* DrawingStyleDefaults::global()
+{
+	static DrawingStyleDefaults defaults;
+	return &defaults;
+}
+
+DrawingStyleDefaults* DrawingStyleDefaults::current()
+{
+	return (threadDefaults) ? threadDefaults : global();
+}
+
+//==================================================================================================
+
+bool DrawingStyleDefaults::lookup(DrawingItemStyle::Property index, QVariant& value) const
+{
+	const Snapshot* snapshot = acquireSnapshot();
+	auto valueIter = snapshot->values.constFind(index);
+	bool found = (valueIter != snapshot->values.constEnd());
+	if (found) value = valueIter.value();
+	releaseSnapshot();
+
+	if (!found && this != global()) found = global()->lookup(index, value);
+
+	return found;
+}
+
+const DrawingStyleDefaults::Snapshot* DrawingStyleDefaults::acquireSnapshot() const
+{
+	// The snapshot is only safe to read once it is in the thread's hazard slot and is still the
+	// current snapshot; otherwise a writer may have retired it before seeing the hazard
+	DrawingStyleDefaultsHazard* hazard = threadHazard.hazard;
+	Snapshot* snapshot = mSnapshot.loadAcquire();
+	Snapshot* currentSnapshot = nullptr;
+
+	forever
+	{
+		hazard->snapshot.fetchAndStoreOrdered(snapshot);
+
+		currentSnapshot = mSnapshot.loadAcquire();
+		if (currentSnapshot == snapshot) break;
+
+		snapshot = currentSnapshot;
+	}
+
+	return snapshot;
+}
+
+void DrawingStyleDefaults::releaseSnapshot() const
+{
+	threadHazard.hazard->snapshot.storeRelease(nullptr);
+}
+
+void DrawingStyleDefaults::replaceSnapshot(Snapshot* snapshot)
+{
+	mRetiredSnapshots.append(mSnapshot.fetchAndStoreOrdered(snapshot));
+
+	// Any reader that could still be using a retired snapshot has it in its hazard slot
+	QSet<void*> hazardSnapshots;
+	for(DrawingStyleDefaultsHazard* hazard = hazardList.loadAcquire(); hazard; hazard = hazard->next)
+	{
+		void* hazardSnapshot = hazard->snapshot.loadAcquire();
+		if (hazardSnapshot) hazardSnapshots.insert(hazardSnapshot);
+	}
+
+	for(int index = mRetiredSnapshots.size() - 1; index >= 0; index--)
+	{
+		if (!hazardSnapshots.contains(mRetiredSnapshots.at(index)))
+			delete mRetiredSnapshots.takeAt(index);
+	}
+}
+
+//==================================================================================================
+//==================================================================================================
+
+DrawingStyleDefaultsScope::DrawingStyleDefaultsScope(DrawingStyleDefaults* defaults)
+{
+	mPreviousDefaults = threadDefaults;
+	threadDefaults = defaults;
+}
+
+DrawingStyleDefaultsScope::~DrawingStyleDefaultsScope()
+{
+	threadDefaults = mPreviousDefaults;
+}
@@ -190,7 +190,7 @@ void DrawingTextEllipseItem::render(QPainter* painter)
 		QFont sceneFont = painter->font();
 
 		DrawingItemStyle* style = DrawingItem::style();
-		QPen pen = style->pen();
+		QPen pen = renderPen(style->pen());
 		QBrush brush = style->brush();
 		QFont font = style->font();
 		QBrush textBrush = style->textBrush();
@@ -209,13 +209,27 @@ void DrawingTextEllipseItem::render(QPainter* painter)
 		painter->setBrush(Qt::transparent);
 		painter->setPen(textPen);
 		painter->setFont(painterFont);
-		painter->drawText(calculateTextRect(mCaption, font), Qt::AlignCenter, mCaption);
+		renderText(painter, calculateTextRect(mCaption, font), Qt::AlignCenter, mCaption);
 
 		painter->setBrush(sceneBrush);
 		painter->setPen(scenePen);
 		painter->setFont(sceneFont);
 	}
 }
+
+//==================================================================================================
+
+void DrawingTextEllipseItem::writeState(QDataStream& stream) const
+{
+	DrawingItem::writeState(stream);
+	stream << mCaption;
+}
+
+void DrawingTextEllipseItem::readState(QDataStream& stream)
+{
+	DrawingItem::readState(stream);
+	stream >> mCaption;
+}
 //==================================================================================================
 
 void DrawingTextEllipseItem::resizeEvent(DrawingItemPoint* itemPoint, const QPointF& parentPos)
@@ -135,7 +135,7 @@ void DrawingTextItem::render(QPainter* painter)
 		painter->setBrush(Qt::transparent);
 		painter->setPen(textPen);
 		painter->setFont(painterFont);
-		painter->drawText(calculateTextRect(mCaption, font, textAlignment), textAlignment, mCaption);
+		renderText(painter, calculateTextRect(mCaption, font, textAlignment), textAlignment, mCaption);
 
 		painter->setBrush(sceneBrush);
 		painter->setPen(scenePen);
@@ -145,6 +145,20 @@ void DrawingTextItem::render(QPainter* painter)
 
 //==================================================================================================
 
+void DrawingTextItem::writeState(QDataStream& stream) const
+{
+	DrawingItem::writeState(stream);
+	stream << mCaption;
+}
+
+void DrawingTextItem::readState(QDataStream& stream)
+{
+	DrawingItem::readState(stream);
+	stream >> mCaption;
+}
+
+//==================================================================================================
+
 QRectF DrawingTextItem::calculateTextRect(const QString& caption, const QFont& font,
 	Qt::Alignment textAlignment) const
 {
@@ -208,7 +208,7 @@ void DrawingTextPolygonItem::render(QPainter* painter)
 		QFont sceneFont = painter->font();
 
 		DrawingItemStyle* style = DrawingItem::style();
-		QPen pen = style->pen();
+		QPen pen = renderPen(style->pen());
 		QBrush brush = style->brush();
 		QFont font = style->font();
 		QBrush textBrush = style->textBrush();
@@ -227,7 +227,7 @@ void DrawingTextPolygonItem::render(QPainter* painter)
 		painter->setBrush(Qt::transparent);
 		painter->setPen(textPen);
 		painter->setFont(painterFont);
-		painter->drawText(calculateTextRect(mCaption, font), Qt::AlignCenter, mCaption);
+		renderText(painter, calculateTextRect(mCaption, font), Qt::AlignCenter, mCaption);
 
 		painter->setBrush(sceneBrush);
 		painter->setPen(scenePen);
@@ -237,6 +237,20 @@ void DrawingTextPolygonItem::render(QPainter* painter)
 
 //==================================================================================================
 
+void DrawingTextPolygonItem::writeState(QDataStream& stream) const
+{
+	DrawingItem::writeState(stream);
+	stream << mCaption;
+}
+
+void DrawingTextPolygonItem::readState(QDataStream& stream)
+{
+	DrawingItem::readState(stream);
+	stream >> mCaption;
+}
+
+//==================================================================================================
+
 DrawingItemPoint* DrawingTextPolygonItem::itemPointToInsert(const QPointF& itemPos, int& index)
 {
 	DrawingItemPoint* pointToInsert = new DrawingItemPoint(
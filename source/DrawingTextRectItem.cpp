@@ -212,7 +212,7 @@ void DrawingTextRectItem::render(QPainter* painter)
 		QFont sceneFont = painter->font();
 
 		DrawingItemStyle* style = DrawingItem::style();
-		QPen pen = style->pen();
+		QPen pen = renderPen(style->pen());
 		QBrush brush = style->brush();
 		QFont font = style->font();
 		QBrush textBrush = style->textBrush();
@@ -231,7 +231,7 @@ void DrawingTextRectItem::render(QPainter* painter)
 		painter->setBrush(Qt::transparent);
 		painter->setPen(textPen);
 		painter->setFont(painterFont);
-		painter->drawText(calculateTextRect(mCaption, font), Qt::AlignCenter, mCaption);
+		renderText(painter, calculateTextRect(mCaption, font), Qt::AlignCenter, mCaption);
 
 		painter->setBrush(sceneBrush);
 		painter->setPen(scenePen);
@@ -241,6 +241,20 @@ void DrawingTextRectItem::render(QPainter* painter)
 
 //==================================================================================================
 
+void DrawingTextRectItem::writeState(QDataStream& stream) const
+{
+	DrawingItem::writeState(stream);
+	stream << mCornerRadiusX << mCornerRadiusY << mCaption;
+}
+
+void DrawingTextRectItem::readState(QDataStream& stream)
+{
+	DrawingItem::readState(stream);
+	stream >> mCornerRadiusX >> mCornerRadiusY >> mCaption;
+}
+
+//==================================================================================================
+
 void DrawingTextRectItem::resizeEvent(DrawingItemPoint* itemPoint, const QPointF& parentPos)
 {
 	DrawingItem::resizeEvent(itemPoint, parentPos);
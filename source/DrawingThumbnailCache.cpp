@@ -0,0 +1,366 @@
+/* DrawingThumbnailCache.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingThumbnailCache.h"
+#include "DrawingDocument.h"
+#include "DrawingScene.h"
+#include <algorithm>
+
+class DrawingThumbnailJob : public QRunnable
+{
+private:
+	DrawingThumbnailCache* mCache;
+	QString mFileName;
+	qint64 mFileSize;
+	QDateTime mLastModified;
+	QString mCacheDirectory;
+	QSize mThumbnailSize;
+
+public:
+	DrawingThumbnailJob(DrawingThumbnailCache* cache, const QFileInfo& fileInfo)
+	{
+		mCache = cache;
+		mFileName = fileInfo.absoluteFilePath();
+		mFileSize = fileInfo.size();
+		mLastModified = fileInfo.lastModified();
+		mCacheDirectory = cache->mCacheDirectory;
+		mThumbnailSize = cache->mThumbnailSize;
+	}
+
+	void run()
+	{
+		QByteArray hash = DrawingThumbnailCache::fileHash(mFileName);
+		qint64 bytesWritten = 0;
+		QImage image;
+
+		if (!hash.isEmpty())
+		{
+			// Another file with identical contents may already have a thumbnail
+			QString thumbnailPath = DrawingThumbnailCache::thumbnailFilePath(mCacheDirectory, hash, mThumbnailSize);
+			if (QFile::exists(thumbnailPath)) image.load(thumbnailPath, "PNG");
+
+			if (image.isNull())
+			{
+				DrawingScene* scene = mCache->loadScene(mFileName);
+				if (scene)
+				{
+					image = DrawingThumbnailCache::renderThumbnail(scene, mThumbnailSize);
+					delete scene;
+
+					QSaveFile file(thumbnailPath);
+					if (!image.isNull() && file.open(QIODevice::WriteOnly) &&
+						image.save(&file, "PNG") && file.commit())
+					{
+						bytesWritten = QFileInfo(thumbnailPath).size();
+					}
+				}
+			}
+		}
+
+		QMetaObject::invokeMethod(mCache, "finishThumbnail", Qt::QueuedConnection,
+			Q_ARG(QString, mFileName), Q_ARG(QByteArray, hash), Q_ARG(qint64, mFileSize),
+			Q_ARG(QDateTime, mLastModified), Q_ARG(qint64, bytesWritten), Q_ARG(QImage, image));
+	}
+};
+
+//==================================================================================================
+
+DrawingThumbnailCache::DrawingThumbnailCache(const QString& cacheDirectory, QObject* parent) : QObject(parent)
+{
+	mCacheDirectory = QDir(cacheDirectory).absolutePath();
+	mThumbnailSize = QSize(256, 256);
+	mMaximumCacheSize = 64 * 1024 * 1024;
+	mCacheSize = 0;
+
+	QDir().mkpath(mCacheDirectory);
+
+	QFileInfoList thumbnailFiles = QDir(mCacheDirectory).entryInfoList(QStringList("*.png"), QDir::Files);
+	for(auto fileIter = thumbnailFiles.begin(); fileIter != thumbnailFiles.end(); fileIter++)
+		mCacheSize += fileIter->size();
+
+	readIndex();
+}
+
+DrawingThumbnailCache::~DrawingThumbnailCache()
+{
+	waitForDone();
+	writeIndex();
+}
+
+//==================================================================================================
+
+QString DrawingThumbnailCache::cacheDirectory() const
+{
+	return mCacheDirectory;
+}
+
+void DrawingThumbnailCache::setThumbnailSize(const QSize& size)
+{
+	mThumbnailSize = size;
+}
+
+QSize DrawingThumbnailCache::thumbnailSize() const
+{
+	return mThumbnailSize;
+}
+
+void DrawingThumbnailCache::setMaximumCacheSize(qint64 bytes)
+{
+	mMaximumCacheSize = qMax(bytes, Q_INT64_C(0));
+	if (mCacheSize > mMaximumCacheSize) trimCache();
+}
+
+qint64 DrawingThumbnailCache::maximumCacheSize() const
+{
+	return mMaximumCacheSize;
+}
+
+void DrawingThumbnailCache::setMaximumThreadCount(int count)
+{
+	mThreadPool.setMaxThreadCount(qMax(count, 1));
+}
+
+int DrawingThumbnailCache::maximumThreadCount() const
+{
+	return mThreadPool.maxThreadCount();
+}
+
+//==================================================================================================
+
+QImage DrawingThumbnailCache::thumbnail(const QString& fileName)
+{
+	QFileInfo fileInfo(fileName);
+	QString filePath = fileInfo.absoluteFilePath();
+	QImage image;
+
+	if (fileInfo.isFile())
+	{
+		bool upToDate = false;
+
+		auto indexIter = mIndex.find(filePath);
+		if (indexIter != mIndex.end())
+		{
+			upToDate = (indexIter->fileSize == fileInfo.size() && indexIter->lastModified == fileInfo.lastModified());
+			image.load(thumbnailFilePath(mCacheDirectory, indexIter->hash, mThumbnailSize), "PNG");
+			indexIter->lastUsed = QDateTime::currentMSecsSinceEpoch();
+		}
+
+		if ((!upToDate || image.isNull()) && !mPendingFiles.contains(filePath))
+		{
+			mPendingFiles.insert(filePath);
+			mThreadPool.start(new DrawingThumbnailJob(this, fileInfo));
+		}
+	}
+
+	return image;
+}
+
+void DrawingThumbnailCache::clear()
+{
+	waitForDone();
+
+	QFileInfoList thumbnailFiles = QDir(mCacheDirectory).entryInfoList(QStringList("*.png"), QDir::Files);
+	for(auto fileIter = thumbnailFiles.begin(); fileIter != thumbnailFiles.end(); fileIter++)
+		QFile::remove(fileIter->absoluteFilePath());
+
+	mIndex.clear();
+	mCacheSize = 0;
+}
+
+void DrawingThumbnailCache::waitForDone()
+{
+	mThreadPool.clear();
+	mThreadPool.waitForDone();
+	mPendingFiles.clear();
+}
+
+//==================================================================================================
+
+QImage DrawingThumbnailCache::renderThumbnail(DrawingScene* scene, const QSize& size)
+{
+	QImage image;
+
+	if (scene && size.isValid())
+	{
+		QRectF sceneRect = scene->sceneRect();
+		QSize imageSize = sceneRect.size().scaled(size, Qt::KeepAspectRatio).toSize().expandedTo(QSize(1, 1));
+
+		image = QImage(imageSize, QImage::Format_ARGB32_Premultiplied);
+		image.fill(Qt::transparent);
+
+		QPainter painter(&image);
+		painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing | QPainter::SmoothPixmapTransform);
+		painter.scale(imageSize.width() / sceneRect.width(), imageSize.height() / sceneRect.height());
+		painter.translate(-sceneRect.topLeft());
+
+		scene->render(&painter);
+	}
+
+	return image;
+}
+
+QByteArray DrawingThumbnailCache::fileHash(const QString& fileName)
+{
+	QByteArray hash;
+
+	QFile file(fileName);
+	if (file.open(QIODevice::ReadOnly))
+	{
+		QCryptographicHash hasher(QCryptographicHash::Sha1);
+		if (hasher.addData(&file)) hash = hasher.result();
+	}
+
+	return hash;
+}
+
+//==================================================================================================
+
+DrawingScene* DrawingThumbnailCache::loadScene(const QString& fileName) const
+{
+	DrawingScene* scene = nullptr;
+
+	// The page is read into a scene of its own rather than activated, since the document would
+	// delete an active page's scene along with itself
+	DrawingDocument document;
+	if (document.open(fileName) && document.pageCount() > 0)
+	{
+		QByteArray unresolvedConnections;
+		scene = DrawingDocument::readScene(document.pageData(0), unresolvedConnections);
+	}
+
+	return scene;
+}
+
+//==================================================================================================
+
+void DrawingThumbnailCache::finishThumbnail(const QString& fileName, const QByteArray& hash, qint64 fileSize,
+	const QDateTime& lastModified, qint64 bytesWritten, const QImage& image)
+{
+	mPendingFiles.remove(fileName);
+
+	// A file that could not be loaded gets no entry, so that its thumbnail is attempted again
+	if (!hash.isEmpty() && !image.isNull())
+	{
+		IndexEntry entry;
+		entry.fileSize = fileSize;
+		entry.lastModified = lastModified;
+		entry.hash = hash;
+		entry.lastUsed = QDateTime::currentMSecsSinceEpoch();
+		mIndex.insert(fileName, entry);
+	}
+
+	mCacheSize += bytesWritten;
+	if (mCacheSize > mMaximumCacheSize) trimCache();
+
+	emit thumbnailReady(fileName, image);
+}
+
+//==================================================================================================
+
+void DrawingThumbnailCache::trimCache()
+{
+	// Thumbnails are shared between files with identical contents, so a thumbnail was last used
+	// when the most recent of these files was last used.  Thumbnails missing from the index are
+	// removed first.
+	QHash<QString,qint64> lastUsed;
+	for(auto indexIter = mIndex.begin(); indexIter != mIndex.end(); indexIter++)
+	{
+		QString thumbnailName = QString::fromLatin1(indexIter->hash.toHex());
+		lastUsed[thumbnailName] = qMax(lastUsed.value(thumbnailName, 0), indexIter->lastUsed);
+	}
+
+	QFileInfoList thumbnailFiles = QDir(mCacheDirectory).entryInfoList(QStringList("*.png"), QDir::Files);
+	QVector<QPair<qint64,QFileInfo>> files;
+
+	mCacheSize = 0;
+	for(auto fileIter = thumbnailFiles.begin(); fileIter != thumbnailFiles.end(); fileIter++)
+	{
+		QString thumbnailName = fileIter->completeBaseName().section('-', 0, 0);
+		files.append(qMakePair(lastUsed.value(thumbnailName, 0), *fileIter));
+		mCacheSize += fileIter->size();
+	}
+
+	std::sort(files.begin(), files.end(), [](const QPair<qint64,QFileInfo>& file1, const QPair<qint64,QFileInfo>& file2) {
+		return file1.first < file2.first; });
+
+	// Trim a little below the limit so that the cache is not trimmed again for every new thumbnail
+	qint64 targetSize = mMaximumCacheSize - mMaximumCacheSize / 10;
+	for(auto fileIter = files.begin(); mCacheSize > targetSize && fileIter != files.end(); fileIter++)
+	{
+		if (QFile::remove(fileIter->second.absoluteFilePath()))
+			mCacheSize -= fileIter->second.size();
+	}
+}
+
+//==================================================================================================
+
+void DrawingThumbnailCache::readIndex()
+{
+	QFile file(QDir(mCacheDirectory).filePath("index.dat"));
+
+	if (file.open(QIODevice::ReadOnly))
+	{
+		QDataStream stream(&file);
+		stream.setVersion(QDataStream::Qt_5_0);
+
+		quint32 magic = 0, count = 0;
+		stream >> magic >> count;
+
+		if (magic == 0x4A544331)
+		{
+			QString fileName;
+			IndexEntry entry;
+
+			for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+			{
+				stream >> fileName >> entry.fileSize >> entry.lastModified >> entry.hash >> entry.lastUsed;
+				if (stream.status() == QDataStream::Ok) mIndex.insert(fileName, entry);
+			}
+		}
+	}
+}
+
+void DrawingThumbnailCache::writeIndex() const
+{
+	QSaveFile file(QDir(mCacheDirectory).filePath("index.dat"));
+
+	if (file.open(QIODevice::WriteOnly))
+	{
+		QDataStream stream(&file);
+		stream.setVersion(QDataStream::Qt_5_0);
+
+		stream << static_cast<quint32>(0x4A544331) << static_cast<quint32>(mIndex.size());
+		for(auto indexIter = mIndex.begin(); indexIter != mIndex.end(); indexIter++)
+		{
+			stream << indexIter.key() << indexIter->fileSize << indexIter->lastModified
+				<< indexIter->hash << indexIter->lastUsed;
+		}
+
+		file.commit();
+	}
+}
+
+//==================================================================================================
+
+QString DrawingThumbnailCache::thumbnailFilePath(const QString& directory, const QByteArray& hash, const QSize& size)
+{
+	return QDir(directory).filePath(QString("%1-%2x%3.png").arg(QString::fromLatin1(hash.toHex()))
+		.arg(size.width()).arg(size.height()));
+}
@@ -23,6 +23,7 @@
 #include "DrawingScene.h"
 #include "DrawingItem.h"
 #include "DrawingItemPoint.h"
+#include <algorithm>
 
 DrawingUndoCommand::DrawingUndoCommand(const QString& title, QUndoCommand* parent) :
 	QUndoCommand(title, parent) { }
@@ -32,6 +33,8 @@ DrawingUndoCommand::DrawingUndoCommand(const DrawingUndoCommand& command, QUndoC
 {
 	QList<QUndoCommand*> otherChildren;
 
+	pinItems(command.mPinScene, command.mPinnedItems);
+
 	for(int i = 0; i < command.childCount(); i++)
 		otherChildren.append(const_cast<QUndoCommand*>(command.child(i)));
 
@@ -58,7 +61,10 @@ DrawingUndoCommand::DrawingUndoCommand(const DrawingUndoCommand& command, QUndoC
 	}
 }
 
-DrawingUndoCommand::~DrawingUndoCommand() { }
+DrawingUndoCommand::~DrawingUndoCommand()
+{
+	if (mPinScene) mPinScene->unpinItems(mPinnedItems);
+}
 
 void DrawingUndoCommand::mergeChildren(const QUndoCommand* command)
 {
@@ -100,6 +106,19 @@ void DrawingUndoCommand::mergeChildren(const QUndoCommand* command)
 	}
 }
 
+void DrawingUndoCommand::pinItems(DrawingScene* scene, const QList<DrawingItem*>& items)
+{
+	if (scene && !items.isEmpty())
+	{
+		if (mPinScene && mPinScene != scene) mPinScene->unpinItems(mPinnedItems);
+		if (mPinScene != scene) mPinnedItems.clear();
+
+		mPinScene = scene;
+		mPinnedItems.append(items);
+		scene->pinItems(items);
+	}
+}
+
 //==================================================================================================
 
 DrawingAddItemsCommand::DrawingAddItemsCommand(DrawingScene* scene,
@@ -147,6 +166,7 @@ DrawingRemoveItemsCommand::DrawingRemoveItemsCommand(DrawingScene* scene,
 	mScene = scene;
 	mItems = items;
 	mUndone = true;
+	pinItems(mScene, mItems);
 	
 	if (mScene)
 	{
@@ -193,6 +213,7 @@ DrawingMoveItemsCommand::DrawingMoveItemsCommand(DrawingScene* scene,
 	mItems = items;
 	mScenePos = newPos;
 	mFinalMove = finalMove;
+	pinItems(mScene, mItems);
 	
 	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
 		mOriginalScenePos[*itemIter] = (*itemIter)->position();
@@ -250,6 +271,7 @@ DrawingResizeItemCommand::DrawingResizeItemCommand(DrawingScene* scene, DrawingI
 	
 	if (mPoint && mPoint->item())
 	{
+		pinItems(mScene, QList<DrawingItem*>() << mPoint->item());
 		mNewPos = mPoint->item()->mapToParent(mPoint->item()->mapFromScene(scenePos));
 		mOriginalPos = mPoint->item()->mapToParent(mPoint->position());
 	}
@@ -308,12 +330,81 @@ void DrawingResizeItemCommand::undo()
 
 //==================================================================================================
 
+DrawingResizeItemPointsCommand::DrawingResizeItemPointsCommand(DrawingScene* scene,
+	const QVector<DrawingItemPoint*>& points, const QVector<QPointF>& scenePos, bool finalResize,
+	QUndoCommand* parent) : DrawingUndoCommand("Resize Items", parent)
+{
+	mScene = scene;
+	mFinalResize = finalResize;
+
+	mPoints.reserve(points.size());
+	mNewPos.reserve(points.size());
+	mOriginalPos.reserve(points.size());
+
+	DrawingItem* item;
+	for(int index = 0; index < points.size() && index < scenePos.size(); index++)
+	{
+		item = (points[index]) ? points[index]->item() : nullptr;
+		if (item)
+		{
+			mPoints.append(points[index]);
+			mNewPos.append(item->mapToParent(item->mapFromScene(scenePos[index])));
+			mOriginalPos.append(item->mapToParent(points[index]->position()));
+			pinItems(mScene, QList<DrawingItem*>() << item);
+		}
+	}
+}
+
+DrawingResizeItemPointsCommand::~DrawingResizeItemPointsCommand() { }
+
+int DrawingResizeItemPointsCommand::id() const
+{
+	return ItemPointsResizeType;
+}
+
+bool DrawingResizeItemPointsCommand::mergeWith(const QUndoCommand* command)
+{
+	bool mergeSuccess = false;
+
+	if (command && command->id() == ItemPointsResizeType)
+	{
+		const DrawingResizeItemPointsCommand* resizeCommand =
+			static_cast<const DrawingResizeItemPointsCommand*>(command);
+
+		if (resizeCommand && mScene == resizeCommand->mScene &&
+			mPoints == resizeCommand->mPoints && !mFinalResize)
+		{
+			mNewPos = resizeCommand->mNewPos;
+			mFinalResize = resizeCommand->mFinalResize;
+			mergeChildren(resizeCommand);
+			mergeSuccess = true;
+		}
+	}
+
+	return mergeSuccess;
+}
+
+void DrawingResizeItemPointsCommand::redo()
+{
+	if (mScene) mScene->resizeItemPoints(mPoints, mNewPos);
+	DrawingUndoCommand::redo();
+}
+
+void DrawingResizeItemPointsCommand::undo()
+{
+	DrawingUndoCommand::undo();
+	if (mScene) mScene->resizeItemPoints(mPoints, mOriginalPos);
+}
+
+//==================================================================================================
+
 DrawingRotateItemsCommand::DrawingRotateItemsCommand(DrawingScene* scene,
 	const QList<DrawingItem*>& items, const QPointF& scenePos, QUndoCommand* parent)
 	: DrawingUndoCommand("Rotate Items", parent)
 {
 	mScene = scene;
 	mItems = items;
+	pinItems(mScene, mItems);
 
 	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
 		mParentPos[*itemIter] = (*itemIter)->mapToParent((*itemIter)->mapFromScene(scenePos));
@@ -346,6 +437,7 @@ DrawingRotateBackItemsCommand::DrawingRotateBackItemsCommand(DrawingScene* scene
 {
 	mScene = scene;
 	mItems = items;
+	pinItems(mScene, mItems);
 
 	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
 		mParentPos[*itemIter] = (*itemIter)->mapToParent((*itemIter)->mapFromScene(scenePos));
@@ -378,6 +470,7 @@ DrawingFlipItemsHorizontalCommand::DrawingFlipItemsHorizontalCommand(DrawingScen
 {
 	mScene = scene;
 	mItems = items;
+	pinItems(mScene, mItems);
 
 	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
 		mParentPos[*itemIter] = (*itemIter)->mapToParent((*itemIter)->mapFromScene(scenePos));
@@ -410,6 +503,7 @@ DrawingFlipItemsVerticalCommand::DrawingFlipItemsVerticalCommand(DrawingScene* s
 {
 	mScene = scene;
 	mItems = items;
+	pinItems(mScene, mItems);
 
 	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
 		mParentPos[*itemIter] = (*itemIter)->mapToParent((*itemIter)->mapFromScene(scenePos));
@@ -443,6 +537,7 @@ DrawingReorderItemsCommand::DrawingReorderItemsCommand(DrawingScene* scene,
 	mScene = scene;
 	mNewItemOrder = newItemOrder;
 	if (mScene) mOriginalItemOrder = mScene->items();
+	pinItems(mScene, mNewItemOrder);
 }
 
 DrawingReorderItemsCommand::~DrawingReorderItemsCommand() { }
@@ -474,7 +569,11 @@ DrawingSelectItemsCommand::DrawingSelectItemsCommand(DrawingView* view,
 	mSelectedItems = newSelectedItems;
 	mFinalSelect = finalSelect;
 	
-	if (mView) mOriginalSelectedItems = mView->selectedItems();
+	if (mView)
+	{
+		mOriginalSelectedItems = mView->selectedItems();
+		pinItems(mView->scene(), mSelectedItems + mOriginalSelectedItems);
+	}
 }
 
 DrawingSelectItemsCommand::~DrawingSelectItemsCommand() { }
@@ -498,7 +597,11 @@ bool DrawingSelectItemsCommand::mergeWith(const QUndoCommand* command)
 			for(auto itemIter = selectCommand->mSelectedItems.begin();
 				itemIter != selectCommand->mSelectedItems.end(); itemIter++)
 			{
-				if (!mSelectedItems.contains(*itemIter)) mSelectedItems.append(*itemIter);
+				if (!mSelectedItems.contains(*itemIter))
+				{
+					mSelectedItems.append(*itemIter);
+					if (mView) pinItems(mView->scene(), QList<DrawingItem*>() << *itemIter);
+				}
 			}
 
 			mFinalSelect = selectCommand->mFinalSelect;
@@ -533,6 +636,7 @@ DrawingItemInsertPointCommand::DrawingItemInsertPointCommand(DrawingScene* scene
 	mPoint = point;
 	mPointIndex = pointIndex;
 	mUndone = true;
+	if (mItem) pinItems(mScene, QList<DrawingItem*>() << mItem);
 }
 
 DrawingItemInsertPointCommand::~DrawingItemInsertPointCommand()
@@ -571,6 +675,7 @@ DrawingItemRemovePointCommand::DrawingItemRemovePointCommand(DrawingScene* scene
 	mUndone = true;
 	
 	mPointIndex = (mItem) ? mItem->points().indexOf(mPoint) : -1;
+	if (mItem) pinItems(mScene, QList<DrawingItem*>() << mItem);
 }
 
 DrawingItemRemovePointCommand::~DrawingItemRemovePointCommand()
@@ -606,6 +711,9 @@ DrawingItemPointConnectCommand::DrawingItemPointConnectCommand(DrawingScene* sce
 	mScene = scene;
 	mPoint1 = point1;
 	mPoint2 = point2;
+
+	if (mPoint1 && mPoint1->item()) pinItems(mScene, QList<DrawingItem*>() << mPoint1->item());
+	if (mPoint2 && mPoint2->item()) pinItems(mScene, QList<DrawingItem*>() << mPoint2->item());
 }
 
 DrawingItemPointConnectCommand::DrawingItemPointConnectCommand(
@@ -645,6 +753,9 @@ DrawingItemPointDisconnectCommand::DrawingItemPointDisconnectCommand(DrawingScen
 	mScene = scene;
 	mPoint1 = point1;
 	mPoint2 = point2;
+
+	if (mPoint1 && mPoint1->item()) pinItems(mScene, QList<DrawingItem*>() << mPoint1->item());
+	if (mPoint2 && mPoint2->item()) pinItems(mScene, QList<DrawingItem*>() << mPoint2->item());
 }
 
 DrawingItemPointDisconnectCommand::DrawingItemPointDisconnectCommand(
@@ -683,6 +794,7 @@ DrawingItemSetVisibilityCommand::DrawingItemSetVisibilityCommand(DrawingScene* s
 {
 	mScene = scene;
 	mItems = items;
+	pinItems(mScene, mItems);
 
 	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
 	{
@@ -709,3 +821,285 @@ void DrawingItemSetVisibilityCommand::undo()
 	DrawingUndoCommand::undo();
 	if (mScene) mScene->setItemsVisibility(mItems, mOriginalVisibility);
 }
+
+//==================================================================================================
+
+DrawingSetStyleCommand::DrawingSetStyleCommand(DrawingScene* scene, const QList<DrawingItem*>& items,
+	const QHash<DrawingItemStyle::Property,QVariant>& values, bool finalChange, QUndoCommand* parent)
+	: DrawingUndoCommand("Set Items' Style", parent)
+{
+	mScene = scene;
+	mItems = items;
+	mFinalChange = finalChange;
+	pinItems(mScene, mItems);
+
+	QList<DrawingItemStyle::Property> properties = values.keys();
+	std::sort(properties.begin(), properties.end());
+
+	for(auto propertyIter = properties.begin(); propertyIter != properties.end(); propertyIter++)
+	{
+		mProperties.append(*propertyIter);
+		mValues.append(values.value(*propertyIter));
+	}
+
+	// Items usually share a handful of values, so each distinct original value is stored once.
+	// QVariant cannot be hashed directly, so values are keyed by their serialized form.
+	QHash<QByteArray,int> valueTable;
+	QByteArray key;
+	QVariant value;
+
+	mOriginalValueIndices.reserve(mItems.size() * mProperties.size());
+
+	for(auto itemIter = mItems.begin(); itemIter != mItems.end(); itemIter++)
+	{
+		DrawingItemStyle* style = (*itemIter)->style();
+
+		for(auto propertyIter = mProperties.begin(); propertyIter != mProperties.end(); propertyIter++)
+		{
+			value = (style && style->hasValue(*propertyIter)) ? style->value(*propertyIter) : QVariant();
+
+			key.clear();
+			QDataStream stream(&key, QIODevice::WriteOnly);
+			stream << value;
+
+			auto tableIter = valueTable.find(key);
+			if (tableIter == valueTable.end())
+			{
+				tableIter = valueTable.insert(key, mOriginalValues.size());
+				mOriginalValues.append(value);
+			}
+
+			mOriginalValueIndices.append(tableIter.value());
+		}
+	}
+}
+
+DrawingSetStyleCommand::~DrawingSetStyleCommand() { }
+
+int DrawingSetStyleCommand::id() const
+{
+	return SetItemsStyleType;
+}
+
+bool DrawingSetStyleCommand::mergeWith(const QUndoCommand* command)
+{
+	bool mergeSuccess = false;
+
+	if (command && command->id() == SetItemsStyleType)
+	{
+		const DrawingSetStyleCommand* styleCommand =
+			static_cast<const DrawingSetStyleCommand*>(command);
+
+		if (styleCommand && mScene == styleCommand->mScene && mItems == styleCommand->mItems &&
+			mProperties == styleCommand->mProperties && !mFinalChange)
+		{
+			mValues = styleCommand->mValues;
+			mFinalChange = styleCommand->mFinalChange;
+			mergeChildren(styleCommand);
+			mergeSuccess = true;
+		}
+	}
+
+	return mergeSuccess;
+}
+
+void DrawingSetStyleCommand::redo()
+{
+	if (mScene) mScene->setItemsStyleValues(mItems, mProperties, mValues);
+	DrawingUndoCommand::redo();
+}
+
+void DrawingSetStyleCommand::undo()
+{
+	DrawingUndoCommand::undo();
+	if (mScene) mScene->setItemsStyleValues(mItems, mProperties, mOriginalValues, mOriginalValueIndices);
+}
+
+//==================================================================================================
+//==================================================================================================
+
+DrawingUndoStack::DrawingUndoStack(QObject* parent) : QObject(parent)
+{
+	mIndex = 0;
+	mCleanIndex = 0;
+	mUndoLimit = 0;
+}
+
+DrawingUndoStack::~DrawingUndoStack()
+{
+	qDeleteAll(mCommands);
+}
+
+//==================================================================================================
+
+void DrawingUndoStack::push(QUndoCommand* command)
+{
+	if (command)
+	{
+		bool wasClean = isClean(), couldUndo = canUndo(), couldRedo = canRedo();
+
+		command->redo();
+
+		// Pushing a command discards everything that could have been redone
+		deleteCommands(mIndex, mCommands.size());
+		if (mCleanIndex > mIndex) mCleanIndex = -1;
+
+		// As with QUndoStack, commands are not merged into the clean state
+		QUndoCommand* topCommand = (mIndex > 0) ? mCommands.at(mIndex - 1) : nullptr;
+		if (topCommand && command->id() != -1 && topCommand->id() == command->id() &&
+			mIndex != mCleanIndex && topCommand->mergeWith(command))
+		{
+			delete command;
+		}
+		else
+		{
+			mCommands.append(command);
+			mIndex++;
+
+			if (mUndoLimit > 0 && mIndex > mUndoLimit) deleteOldestCommands(mIndex - mUndoLimit);
+		}
+
+		emitChanges(wasClean, couldUndo, couldRedo);
+	}
+}
+
+void DrawingUndoStack::undo()
+{
+	if (canUndo())
+	{
+		bool wasClean = isClean(), couldUndo = canUndo(), couldRedo = canRedo();
+
+		mIndex--;
+		mCommands.at(mIndex)->undo();
+
+		emitChanges(wasClean, couldUndo, couldRedo);
+	}
+}
+
+void DrawingUndoStack::redo()
+{
+	if (canRedo())
+	{
+		bool wasClean = isClean(), couldUndo = canUndo(), couldRedo = canRedo();
+
+		mCommands.at(mIndex)->redo();
+		mIndex++;
+
+		emitChanges(wasClean, couldUndo, couldRedo);
+	}
+}
+
+void DrawingUndoStack::clear()
+{
+	bool wasClean = isClean(), couldUndo = canUndo(), couldRedo = canRedo();
+
+	deleteCommands(0, mCommands.size());
+	mIndex = 0;
+	mCleanIndex = 0;
+
+	emitChanges(wasClean, couldUndo, couldRedo);
+}
+
+//==================================================================================================
+
+void DrawingUndoStack::setUndoLimit(int limit)
+{
+	mUndoLimit = qMax(limit, 0);
+	if (mUndoLimit > 0 && mIndex > mUndoLimit) dropCommands(mIndex - mUndoLimit);
+}
+
+int DrawingUndoStack::undoLimit() const
+{
+	return mUndoLimit;
+}
+
+//==================================================================================================
+
+void DrawingUndoStack::dropCommands(int count)
+{
+	count = qBound(0, count, mCommands.size());
+
+	if (count > 0)
+	{
+		bool wasClean = isClean(), couldUndo = canUndo(), couldRedo = canRedo();
+
+		// The oldest commands are dropped first; commands that could be redone are only dropped
+		// once nothing is left to undo
+		int redoCount = count - qMin(count, mIndex);
+		if (redoCount > 0)
+		{
+			deleteCommands(mCommands.size() - redoCount, mCommands.size());
+			if (mCleanIndex > mCommands.size()) mCleanIndex = -1;
+		}
+
+		deleteOldestCommands(count - redoCount);
+
+		emitChanges(wasClean, couldUndo, couldRedo);
+	}
+}
+
+int DrawingUndoStack::count() const
+{
+	return mCommands.size();
+}
+
+//==================================================================================================
+
+void DrawingUndoStack::setClean()
+{
+	bool wasClean = isClean();
+
+	mCleanIndex = mIndex;
+	if (!wasClean) emit cleanChanged(true);
+}
+
+bool DrawingUndoStack::isClean() const
+{
+	return (mCleanIndex == mIndex);
+}
+
+//==================================================================================================
+
+bool DrawingUndoStack::canUndo() const
+{
+	return (mIndex > 0);
+}
+
+bool DrawingUndoStack::canRedo() const
+{
+	return (mIndex < mCommands.size());
+}
+
+QString DrawingUndoStack::undoText() const
+{
+	return (canUndo()) ? mCommands.at(mIndex - 1)->text() : QString();
+}
+
+QString DrawingUndoStack::redoText() const
+{
+	return (canRedo()) ? mCommands.at(mIndex)->text() : QString();
+}
+
+//==================================================================================================
+
+void DrawingUndoStack::deleteCommands(int first, int last)
+{
+	for(int i = last - 1; i >= first; i--) delete mCommands.takeAt(i);
+}
+
+void DrawingUndoStack::deleteOldestCommands(int count)
+{
+	deleteCommands(0, count);
+	mIndex -= count;
+
+	// The clean state is unreachable once the command leading to it is gone
+	if (mCleanIndex >= 0) mCleanIndex = (mCleanIndex >= count) ? mCleanIndex - count : -1;
+}
+
+void DrawingUndoStack::emitChanges(bool wasClean, bool couldUndo, bool couldRedo)
+{
+	emit indexChanged(mIndex);
+	if (wasClean != isClean()) emit cleanChanged(isClean());
+	if (couldUndo != canUndo()) emit canUndoChanged(canUndo());
+	if (couldRedo != canRedo()) emit canRedoChanged(canRedo());
+}
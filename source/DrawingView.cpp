@@ -25,6 +25,26 @@
 #include "DrawingItemPoint.h"
 #include "DrawingItemStyle.h"
 #include "DrawingUndo.h"
+#include "DrawingArena.h"
+#include "DrawingStyleDefaults.h"
+#include "DrawingCacheManager.h"
+#include <algorithm>
+
+// Size in pixels of the grid cells used to look up the rects of the selected items' points
+static const int pointRectGridSize = 32;
+
+// Commands do not report their size, so each is charged a fixed estimate
+static const qint64 undoCommandCost = 4096;
+
+static quint64 pointRectGridCell(int x, int y)
+{
+	return (static_cast<quint64>(static_cast<quint32>(x)) << 32) | static_cast<quint32>(y);
+}
+
+static int pointRectGridIndex(int coordinate)
+{
+	return qFloor(coordinate / static_cast<qreal>(pointRectGridSize));
+}
 
 DrawingView::DrawingView() : QAbstractScrollArea()
 {
@@ -38,18 +58,36 @@ DrawingView::DrawingView() : QAbstractScrollArea()
 	mFlags = (ViewOwnsScene | UndoableSelectCommands | SendsMouseMoveInfo);
 	mItemSelectionMode = Qt::ContainsItemBoundingRect;
 	mGrid = 50;
+	mGridColor = QColor(128, 128, 128);
+	mMajorGridInterval = 5;
+
+	mGridTileSpacing = 0;
+	mGridTileInterval = 0;
+	mGridTileCacheBudget = new DrawingCache("Grid tile", 0, this);
+	connect(mGridTileCacheBudget, SIGNAL(releaseRequested(qint64)), this, SLOT(releaseGridTile()));
 
 	mUndoStack.setUndoLimit(64);
 	connect(&mUndoStack, SIGNAL(cleanChanged(bool)), this, SIGNAL(cleanChanged(bool)));
 	connect(&mUndoStack, SIGNAL(canRedoChanged(bool)), this, SIGNAL(canRedoChanged(bool)));
 	connect(&mUndoStack, SIGNAL(canUndoChanged(bool)), this, SIGNAL(canUndoChanged(bool)));
 
+	mUndoStackCacheBudget = new DrawingCache("Undo history", 100, this);
+	connect(&mUndoStack, SIGNAL(indexChanged(int)), this, SLOT(updateUndoStackCost()));
+	connect(mUndoStackCacheBudget, SIGNAL(releaseRequested(qint64)), this, SLOT(releaseUndoStack(qint64)));
+
 	mMode = DefaultMode;
 	mScale = 1.0;
 
 	mSelectedItemPoint = nullptr;
 	connect(this, SIGNAL(selectionChanged(const QList<DrawingItem*>&)), this, SLOT(updateSelectionCenter()));
 
+	mPointRectsDirty = true;
+
+	mNewItemsCacheScale = 0;
+	mNewItemsCacheRenderFlags = 0;
+	mNewItemsCacheBudget = new DrawingCache("New items preview", 0, this);
+	connect(mNewItemsCacheBudget, SIGNAL(releaseRequested(qint64)), this, SLOT(releaseNewItemsCache()));
+
 	mMouseDownItem = nullptr;
 	mFocusItem = nullptr;
 
@@ -62,15 +100,28 @@ DrawingView::DrawingView() : QAbstractScrollArea()
 
 	mPanTimer.setInterval(16);
 	connect(&mPanTimer, SIGNAL(timeout()), this, SLOT(mousePanEvent()));
+
+	mInteracting = false;
+	mInteractiveQualityTimer.setSingleShot(true);
+	mInteractiveQualityTimer.setInterval(150);
+	connect(&mInteractiveQualityTimer, SIGNAL(timeout()), this, SLOT(endInteraction()));
+
+	mQualityLevel = FullQuality;
+	mFrameBudget = 25;
+	mSlowFrameCount = 0;
+	mFastFrameCount = 0;
+	mQualityRestoreTimer.setSingleShot(true);
+	connect(&mQualityRestoreTimer, SIGNAL(timeout()), this, SLOT(restoreFullQuality()));
 }
 
 DrawingView::~DrawingView()
 {
+	mUndoStack.disconnect(this);
+
 	mSelectedItems.clear();
 	mSelectedItemPoint = nullptr;
 
-	mMouseDownItem = nullptr;
-	mFocusItem = nullptr;
+	setMouseDownItem(nullptr);
 	while (!mClipboardItems.isEmpty()) delete mClipboardItems.takeFirst();
 
 	mDefaultInitialPositions.clear();
@@ -86,12 +137,25 @@ void DrawingView::setScene(DrawingScene* scene)
 {
 	if (mScene)
 	{
+		if (scene != mScene)
+		{
+			// The selection and undo history refer to items of the previous scene
+			setDefaultMode();
+			mUndoStack.clear();
+
+			mSelectedItemPoint = nullptr;
+			setMouseDownItem(nullptr);
+			mDefaultInitialPositions.clear();
+			mHighlights.clear();
+		}
+
 		disconnect(mScene);
 
 		if (mFlags & ViewOwnsScene) delete mScene;
 	}
 
 	mScene = scene;
+	mPointRectsDirty = true;
 
 	if (mScene)
 	{
@@ -100,9 +164,18 @@ void DrawingView::setScene(DrawingScene* scene)
 		connect(mScene, SIGNAL(itemsTransformChanged(const QList<DrawingItem*>&)), this, SIGNAL(itemsTransformChanged(const QList<DrawingItem*>&)));
 		connect(mScene, SIGNAL(itemsGeometryChanged(const QList<DrawingItem*>&)), this, SIGNAL(itemsGeometryChanged(const QList<DrawingItem*>&)));
 		connect(mScene, SIGNAL(itemsVisibilityChanged(const QList<DrawingItem*>&)), this, SIGNAL(itemsVisibilityChanged(const QList<DrawingItem*>&)));
+		connect(mScene, SIGNAL(itemsStyleChanged(const QList<DrawingItem*>&)), this, SIGNAL(itemsStyleChanged(const QList<DrawingItem*>&)));
 
 		connect(mScene, SIGNAL(itemsPositionChanged(const QList<DrawingItem*>&)), this, SLOT(updateSelectionCenter()));
 		connect(mScene, SIGNAL(itemsGeometryChanged(const QList<DrawingItem*>&)), this, SLOT(updateSelectionCenter()));
+		connect(mScene, SIGNAL(changed(const QList<QRectF>&)), this, SLOT(updateSceneRects(const QList<QRectF>&)));
+		connect(mScene, SIGNAL(itemsBoundingRectChanged(const QRectF&)), this, SLOT(updateScrollRange()));
+
+		connect(mScene, SIGNAL(itemsPositionChanged(const QList<DrawingItem*>&)), this, SLOT(invalidatePointRects()));
+		connect(mScene, SIGNAL(itemsTransformChanged(const QList<DrawingItem*>&)), this, SLOT(invalidatePointRects()));
+		connect(mScene, SIGNAL(itemsGeometryChanged(const QList<DrawingItem*>&)), this, SLOT(invalidatePointRects()));
+		connect(mScene, SIGNAL(itemsVisibilityChanged(const QList<DrawingItem*>&)), this, SLOT(invalidatePointRects()));
+		connect(mScene, SIGNAL(itemsRemoved(const QList<DrawingItem*>&)), this, SLOT(invalidatePointRects()));
 
 		void numberOfItemsChanged(int itemCount);
 	}
@@ -117,6 +190,7 @@ DrawingScene* DrawingView::scene() const
 
 void DrawingView::setFlags(Flags flags)
 {
+	if ((mFlags ^ flags) & ShowsGrid) viewport()->update();
 	mFlags = flags;
 }
 
@@ -125,6 +199,36 @@ DrawingView::Flags DrawingView::flags() const
 	return mFlags;
 }
 
+void DrawingView::setInteractiveQualityDelay(int milliseconds)
+{
+	mInteractiveQualityTimer.setInterval(qMax(milliseconds, 0));
+}
+
+int DrawingView::interactiveQualityDelay() const
+{
+	return mInteractiveQualityTimer.interval();
+}
+
+bool DrawingView::isInteracting() const
+{
+	return mInteracting;
+}
+
+void DrawingView::setFrameBudget(int milliseconds)
+{
+	mFrameBudget = qMax(milliseconds, 1);
+}
+
+int DrawingView::frameBudget() const
+{
+	return mFrameBudget;
+}
+
+DrawingView::QualityLevel DrawingView::qualityLevel() const
+{
+	return mQualityLevel;
+}
+
 //==================================================================================================
 
 void DrawingView::setItemSelectionMode(Qt::ItemSelectionMode mode)
@@ -142,6 +246,7 @@ Qt::ItemSelectionMode DrawingView::itemSelectionMode() const
 void DrawingView::setGrid(qreal grid)
 {
 	mGrid = grid;
+	if (mFlags & ShowsGrid) viewport()->update();
 }
 
 qreal DrawingView::grid() const
@@ -169,6 +274,28 @@ QPointF DrawingView::roundToGrid(const QPointF& scenePos) const
 	return QPointF(roundToGrid(scenePos.x()), roundToGrid(scenePos.y()));
 }
 
+void DrawingView::setGridColor(const QColor& color)
+{
+	mGridColor = color;
+	if (mFlags & ShowsGrid) viewport()->update();
+}
+
+QColor DrawingView::gridColor() const
+{
+	return mGridColor;
+}
+
+void DrawingView::setMajorGridInterval(int interval)
+{
+	mMajorGridInterval = qMax(interval, 1);
+	if (mFlags & ShowsGrid) viewport()->update();
+}
+
+int DrawingView::majorGridInterval() const
+{
+	return mMajorGridInterval;
+}
+
 //==================================================================================================
 
 void DrawingView::setUndoLimit(int undoLimit)
@@ -231,6 +358,7 @@ void DrawingView::selectItem(DrawingItem* item)
 	{
 		item->setSelected(true);
 		mSelectedItems.append(item);
+		mPointRectsDirty = true;
 	}
 }
 
@@ -240,6 +368,7 @@ void DrawingView::deselectItem(DrawingItem* item)
 	{
 		mSelectedItems.removeAll(item);
 		item->setSelected(false);
+		mPointRectsDirty = true;
 	}
 }
 
@@ -249,6 +378,7 @@ void DrawingView::clearSelection()
 		(*itemIter)->setSelected(false);
 
 	mSelectedItems.clear();
+	mPointRectsDirty = true;
 }
 
 QList<DrawingItem*> DrawingView::selectedItems() const
@@ -424,9 +554,32 @@ DrawingItem* DrawingView::visibleItemAt(const QPointF& scenePos) const
 
 //==================================================================================================
 
+void DrawingView::addHighlight(const QRectF& sceneRect, const QColor& color)
+{
+	Highlight highlight;
+	highlight.rect = sceneRect;
+	highlight.color = color;
+	mHighlights.append(highlight);
+
+	viewport()->update();
+}
+
+void DrawingView::clearHighlights()
+{
+	if (!mHighlights.isEmpty())
+	{
+		mHighlights.clear();
+		viewport()->update();
+	}
+}
+
+//==================================================================================================
+
 void DrawingView::render(QPainter* painter)
 {
-	if (mScene) mScene->render(painter);
+	drawBackground(painter);
+	drawItems(painter);
+	drawForeground(painter);
 }
 
 //==================================================================================================
@@ -464,6 +617,18 @@ void DrawingView::zoomFit()
 	}
 }
 
+void DrawingView::zoomFitItems()
+{
+	if (mScene)
+	{
+		QRectF itemsRect = mScene->itemsBoundingRect();
+		fitToView((itemsRect.width() > 0 && itemsRect.height() > 0) ? itemsRect : mScene->sceneRect());
+
+		emit scaleChanged(mScale);
+		viewport()->update();
+	}
+}
+
 //==================================================================================================
 
 void DrawingView::setDefaultMode()
@@ -472,8 +637,12 @@ void DrawingView::setDefaultMode()
 	setCursor(Qt::ArrowCursor);
 
 	while (!mNewItems.isEmpty()) delete mNewItems.takeFirst();
+	clearNewItemsCache();
 	emit newItemsChanged(mNewItems);
 
+	mVerticalGuides.clear();
+	mHorizontalGuides.clear();
+
 	clearSelection();
 	emit selectionChanged(mSelectedItems);
 
@@ -487,8 +656,12 @@ void DrawingView::setScrollMode()
 	setCursor(Qt::OpenHandCursor);
 
 	while (!mNewItems.isEmpty()) delete mNewItems.takeFirst();
+	clearNewItemsCache();
 	emit newItemsChanged(mNewItems);
 
+	mVerticalGuides.clear();
+	mHorizontalGuides.clear();
+
 	clearSelection();
 	emit selectionChanged(mSelectedItems);
 
@@ -502,8 +675,12 @@ void DrawingView::setZoomMode()
 	setCursor(Qt::CrossCursor);
 
 	while (!mNewItems.isEmpty()) delete mNewItems.takeFirst();
+	clearNewItemsCache();
 	emit newItemsChanged(mNewItems);
 
+	mVerticalGuides.clear();
+	mHorizontalGuides.clear();
+
 	clearSelection();
 	emit selectionChanged(mSelectedItems);
 
@@ -532,8 +709,21 @@ void DrawingView::setPlaceMode(const QList<DrawingItem*>& items)
 
 		deltaPos = roundToGrid(mapToScene(mapFromGlobal(QCursor::pos())) - centerPos);
 
-		for(auto itemIter = mNewItems.begin(); itemIter != mNewItems.end(); itemIter++)
-			(*itemIter)->setPosition((*itemIter)->position() + deltaPos);
+		clearNewItemsCache();
+		mNewItemsCacheScale = 0;
+		mNewItemsBounds = QRectF();
+
+		if (mNewItems.size() > 1)
+		{
+			// Sets of items are moved as a unit by a preview offset until they are placed
+			mNewItemsCenter = centerPos;
+			mNewItemsOffset = deltaPos;
+		}
+		else
+		{
+			for(auto itemIter = mNewItems.begin(); itemIter != mNewItems.end(); itemIter++)
+				(*itemIter)->setPosition((*itemIter)->position() + deltaPos);
+		}
 
 		emit newItemsChanged(mNewItems);
 
@@ -609,6 +799,8 @@ void DrawingView::paste()
 {
 	if (mMode == DefaultMode && mScene)
 	{
+		DrawingArenaScope arenaScope(mScene->itemArena());
+		DrawingStyleDefaultsScope defaultsScope(mScene->styleDefaults());
 		QList<DrawingItem*> newItems = DrawingItem::copyItems(mClipboardItems);
 
 		if (!newItems.isEmpty())
@@ -658,6 +850,7 @@ void DrawingView::selectItems(const QList<DrawingItem*>& items)
 		(*itemIter)->setSelected(false);
 
 	mSelectedItems = items;
+	mPointRectsDirty = true;
 
 	for(auto itemIter = mSelectedItems.begin(); itemIter != mSelectedItems.end(); itemIter++)
 		(*itemIter)->setSelected(true);
@@ -778,6 +971,34 @@ void DrawingView::resizeSelection(DrawingItemPoint* itemPoint, const QPointF& sc
 	}
 }
 
+void DrawingView::resizeSelectionPoints(const QList<DrawingItemPoint*>& itemPoints, const QPointF& deltaScenePos)
+{
+	if (mMode == DefaultMode && mScene && !mSelectedItems.isEmpty())
+	{
+		QSet<DrawingItem*> selectedItems = mSelectedItems.toSet();
+		QVector<DrawingItemPoint*> pointsToResize;
+		QVector<QPointF> scenePos;
+		DrawingItem* item;
+
+		for(auto pointIter = itemPoints.begin(); pointIter != itemPoints.end(); pointIter++)
+		{
+			item = (*pointIter) ? (*pointIter)->item() : nullptr;
+
+			if (item && selectedItems.contains(item) && (item->flags() & DrawingItem::CanResize))
+			{
+				pointsToResize.append(*pointIter);
+				scenePos.append(item->mapToScene((*pointIter)->position()) + deltaScenePos);
+			}
+		}
+
+		if (!pointsToResize.isEmpty())
+		{
+			resizeItemPointsCommand(pointsToResize, scenePos);
+			viewport()->update();
+		}
+	}
+}
+
 void DrawingView::rotateSelection()
 {
 	if (mMode == DefaultMode && mScene && !mSelectedItems.isEmpty())
@@ -796,6 +1017,8 @@ void DrawingView::rotateSelection()
 	}
 	else if (mMode == PlaceMode && mScene && !mNewItems.isEmpty())
 	{
+		applyNewItemsOffset();
+
 		QList<DrawingItem*> itemsToRotate;
 		for(auto itemIter = mNewItems.begin(); itemIter != mNewItems.end(); itemIter++)
 		{
@@ -811,6 +1034,7 @@ void DrawingView::rotateSelection()
 				parentPos[*itemIter] = (*itemIter)->mapToParent((*itemIter)->mapFromScene(scenePos));
 
 			mScene->rotateItems(itemsToRotate, parentPos);
+			applyNewItemsOffset();
 			viewport()->update();
 		}
 	}
@@ -834,6 +1058,8 @@ void DrawingView::rotateBackSelection()
 	}
 	else if (mMode == PlaceMode && mScene && !mNewItems.isEmpty())
 	{
+		applyNewItemsOffset();
+
 		QList<DrawingItem*> itemsToRotate;
 		for(auto itemIter = mNewItems.begin(); itemIter != mNewItems.end(); itemIter++)
 		{
@@ -849,6 +1075,7 @@ void DrawingView::rotateBackSelection()
 				parentPos[*itemIter] = (*itemIter)->mapToParent((*itemIter)->mapFromScene(scenePos));
 
 			mScene->rotateBackItems(itemsToRotate, parentPos);
+			applyNewItemsOffset();
 			viewport()->update();
 		}
 	}
@@ -872,6 +1099,8 @@ void DrawingView::flipSelectionHorizontal()
 	}
 	else if (mMode == PlaceMode && mScene && !mNewItems.isEmpty())
 	{
+		applyNewItemsOffset();
+
 		QList<DrawingItem*> itemsToFlip;
 		for(auto itemIter = mNewItems.begin(); itemIter != mNewItems.end(); itemIter++)
 		{
@@ -887,6 +1116,7 @@ void DrawingView::flipSelectionHorizontal()
 				parentPos[*itemIter] = (*itemIter)->mapToParent((*itemIter)->mapFromScene(scenePos));
 
 			mScene->flipItemsHorizontal(itemsToFlip, parentPos);
+			applyNewItemsOffset();
 			viewport()->update();
 		}
 	}
@@ -910,6 +1140,8 @@ void DrawingView::flipSelectionVertical()
 	}
 	else if (mMode == PlaceMode && mScene && !mNewItems.isEmpty())
 	{
+		applyNewItemsOffset();
+
 		QList<DrawingItem*> itemsToFlip;
 		for(auto itemIter = mNewItems.begin(); itemIter != mNewItems.end(); itemIter++)
 		{
@@ -925,11 +1157,22 @@ void DrawingView::flipSelectionVertical()
 				parentPos[*itemIter] = (*itemIter)->mapToParent((*itemIter)->mapFromScene(scenePos));
 
 			mScene->flipItemsVertical(itemsToFlip, parentPos);
+			applyNewItemsOffset();
 			viewport()->update();
 		}
 	}
 }
 
+void DrawingView::setSelectionStyleValues(const QHash<DrawingItemStyle::Property,QVariant>& values,
+	bool finalChange)
+{
+	if (mMode == DefaultMode && mScene && !mSelectedItems.isEmpty() && !values.isEmpty())
+	{
+		setItemsStyleCommand(mSelectedItems, values, finalChange);
+		viewport()->update();
+	}
+}
+
 //==================================================================================================
 
 void DrawingView::bringForward()
@@ -1185,25 +1428,54 @@ void DrawingView::ungroup()
 
 void DrawingView::paintEvent(QPaintEvent* event)
 {
-	QImage image(viewport()->width(), viewport()->height(), QImage::Format_RGB32);
+	// Only the exposed region of the viewport is rendered, so that small live updates from the
+	// scene do not require the entire scene to be redrawn
+	QRect exposedRect = event->rect().intersected(viewport()->rect());
+	if (exposedRect.isEmpty()) return;
+
+	QElapsedTimer paintTimer;
+	paintTimer.start();
+
+	QImage image(exposedRect.width(), exposedRect.height(), QImage::Format_RGB32);
 	image.fill(palette().brush(QPalette::Window).color());
 
 	// Render scene
 	QPainter painter(&image);
 
+	mPaintTransform = QTransform::fromTranslate(-exposedRect.left(), -exposedRect.top());
+	painter.setTransform(mPaintTransform);
 	painter.translate(-horizontalScrollBar()->value(), -verticalScrollBar()->value());
 	painter.setTransform(mViewportTransform, true);
-	painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
+
+	DrawingItem::RenderFlags renderFlags = DrawingItem::renderFlags();
+	DrawingItem::RenderFlags viewRenderFlags = renderFlags;
+	if (mInteracting) viewRenderFlags |= (DrawingItem::DraftPens | DrawingItem::DraftText);
+	if (mQualityLevel >= BoundingBoxText) viewRenderFlags |= DrawingItem::BoundingBoxText;
+	if (mQualityLevel >= SkipTinyItems) viewRenderFlags |= DrawingItem::SkipTinyItems;
+
+	if (!mInteracting && mQualityLevel < NoAntialiasing)
+		painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
+
+	DrawingItem::setRenderFlags(viewRenderFlags);
+
+	// Items are drawn with the defaults of the scene they belong to
+	DrawingStyleDefaultsScope defaultsScope((mScene) ? mScene->styleDefaults() : nullptr);
 
 	render(&painter);
 
+	DrawingItem::setRenderFlags(renderFlags);
+
 	painter.end();
+	mPaintTransform = QTransform();
 
 	// Render scene image on to widget
 	QPainter widgetPainter(viewport());
-	widgetPainter.drawImage(0, 0, image);
+	widgetPainter.drawImage(exposedRect.topLeft(), image);
+	widgetPainter.end();
 
-	Q_UNUSED(event);
+	// Small partial updates say little about how long the whole viewport takes to paint
+	if (exposedRect.width() * exposedRect.height() * 2 >= viewport()->width() * viewport()->height())
+		updateQualityLevel(paintTimer.elapsed());
 }
 
 void DrawingView::resizeEvent(QResizeEvent* event)
@@ -1236,7 +1508,7 @@ void DrawingView::mousePressEvent(QMouseEvent* event)
 			{
 				mDefaultMouseState = MouseSelect;
 
-				mMouseDownItem = visibleItemAt(mButtonDownScenePos);
+				setMouseDownItem(visibleItemAt(mButtonDownScenePos));
 				if (mMouseDownItem)
 				{
 					mDefaultInitialPositions.clear();
@@ -1255,8 +1527,6 @@ void DrawingView::mousePressEvent(QMouseEvent* event)
 						}
 					}
 				}
-
-				mFocusItem = mMouseDownItem;
 			}
 		}
 		else if (event->button() == Qt::MiddleButton)
@@ -1317,6 +1587,13 @@ void DrawingView::mouseMoveEvent(QMouseEvent* event)
 			{
 				mScene->resizeItem(mNewItems.first()->points()[1], roundToGrid(mScenePos));
 			}
+			else if (mNewItems.size() > 1)
+			{
+				if (mNewItemsBounds.isNull()) mNewItemsBounds = itemsSceneBounds(mNewItems);
+
+				mNewItemsOffset = roundToGrid(mScenePos - mNewItemsCenter);
+				mNewItemsOffset += updateAlignmentGuides(mNewItemsBounds.translated(mNewItemsOffset));
+			}
 			else
 			{
 				QPointF centerPos, deltaPos;
@@ -1326,6 +1603,7 @@ void DrawingView::mouseMoveEvent(QMouseEvent* event)
 				if (!mNewItems.isEmpty()) centerPos /= mNewItems.size();
 
 				deltaPos = roundToGrid(mScenePos - centerPos);
+				deltaPos += updateAlignmentGuides(itemsSceneBounds(mNewItems).translated(deltaPos));
 
 				for(auto itemIter = mNewItems.begin(); itemIter != mNewItems.end(); itemIter++)
 					(*itemIter)->setPosition((*itemIter)->position() + deltaPos);
@@ -1357,6 +1635,7 @@ void DrawingView::mouseMoveEvent(QMouseEvent* event)
 								(mSelectedItems.first()->flags() & DrawingItem::CanResize) &&
 								mSelectedItemPoint && (mSelectedItemPoint->flags() & DrawingItemPoint::Control));
 							mDefaultMouseState = (resizeItem) ? MouseResizeItem : MouseMoveItems;
+							if (mDefaultMouseState == MouseMoveItems) mDefaultInitialBounds = itemsSceneBounds(mSelectedItems);
 						}
 						else mDefaultMouseState = MouseRubberBand;
 					}
@@ -1368,6 +1647,7 @@ void DrawingView::mouseMoveEvent(QMouseEvent* event)
 						originalPositions[*itemIter] = (*itemIter)->position();
 
 					deltaScenePos = roundToGrid(mScenePos - mButtonDownScenePos);
+					deltaScenePos += updateAlignmentGuides(mDefaultInitialBounds.translated(deltaScenePos), mSelectedItems);
 					for(auto itemIter = mSelectedItems.begin(); itemIter != mSelectedItems.end(); itemIter++)
 					{
 						if ((*itemIter)->flags() & DrawingItem::CanMove)
@@ -1411,6 +1691,7 @@ void DrawingView::mouseMoveEvent(QMouseEvent* event)
 	}
 
 	if (mPanTimer.isActive()) mPanCurrentPos = event->pos();
+	if (mDragged && (event->buttons() & Qt::LeftButton)) beginInteraction();
 
 	if (event->buttons() != Qt::NoButton || mMode == PlaceMode) viewport()->update();
 }
@@ -1446,7 +1727,10 @@ void DrawingView::mouseReleaseEvent(QMouseEvent* event)
 					QList<DrawingItem*> newItems;
 					DrawingItem* newItem;
 					QList<DrawingItemPoint*> points;
+					DrawingArenaScope arenaScope(mScene->itemArena());
+					DrawingStyleDefaultsScope defaultsScope(mScene->styleDefaults());
 
+					applyNewItemsOffset();
 					addItemsCommand(mNewItems, true);
 
 					for(auto itemIter = mNewItems.begin(); itemIter != mNewItems.end(); itemIter++)
@@ -1511,6 +1795,7 @@ void DrawingView::mouseReleaseEvent(QMouseEvent* event)
 						originalPositions[*itemIter] = (*itemIter)->position();
 
 					deltaScenePos = roundToGrid(mScenePos - mButtonDownScenePos);
+					deltaScenePos += updateAlignmentGuides(mDefaultInitialBounds.translated(deltaScenePos), mSelectedItems);
 					for(auto itemIter = mSelectedItems.begin(); itemIter != mSelectedItems.end(); itemIter++)
 					{
 						if ((*itemIter)->flags() & DrawingItem::CanMove)
@@ -1558,6 +1843,9 @@ void DrawingView::mouseReleaseEvent(QMouseEvent* event)
 				mDefaultSelectedItemPointOriginalPos = QPointF();
 				mDefaultMouseState = MouseReady;
 
+				mVerticalGuides.clear();
+				mHorizontalGuides.clear();
+
 				updateSelectionCenter();
 			}
 		}
@@ -1592,7 +1880,7 @@ void DrawingView::mouseDoubleClickEvent(QMouseEvent* event)
 			{
 				mDefaultMouseState = MouseSelect;
 
-				mMouseDownItem = visibleItemAt(mButtonDownScenePos);
+				setMouseDownItem(visibleItemAt(mButtonDownScenePos));
 				if (mMouseDownItem)
 				{
 					mDefaultInitialPositions.clear();
@@ -1611,8 +1899,6 @@ void DrawingView::mouseDoubleClickEvent(QMouseEvent* event)
 						}
 					}
 				}
-
-				mFocusItem = mMouseDownItem;
 			}
 		}
 
@@ -1623,6 +1909,8 @@ void DrawingView::mouseDoubleClickEvent(QMouseEvent* event)
 
 void DrawingView::wheelEvent(QWheelEvent* event)
 {
+	beginInteraction();
+
 	if (event->modifiers() && Qt::ControlModifier)
 	{
 		if (event->delta() > 0) zoomIn();
@@ -1647,7 +1935,11 @@ void DrawingView::keyReleaseEvent(QKeyEvent* event)
 
 void DrawingView::drawBackground(QPainter* painter)
 {
-	if (mScene) mScene->drawBackground(painter);
+	if (mScene)
+	{
+		mScene->drawBackground(painter);
+		if (mFlags & ShowsGrid) drawGrid(painter);
+	}
 }
 
 void DrawingView::drawItems(QPainter* painter)
@@ -1662,7 +1954,7 @@ void DrawingView::drawForeground(QPainter* painter)
 		mScene->drawForeground(painter);
 
 		// Draw new items
-		mScene->drawItems(painter, mNewItems);
+		drawNewItems(painter);
 
 		// Draw item points
 		QColor color = mScene->backgroundBrush().color();
@@ -1672,35 +1964,51 @@ void DrawingView::drawForeground(QPainter* painter)
 
 		painter->save();
 
-		painter->resetTransform();
+		painter->setTransform(mPaintTransform);
 		painter->setRenderHints(QPainter::Antialiasing, false);
 		painter->setPen(QPen(color, 1));
 		painter->setBrush(QColor(0, 224, 0));
 
-		for(auto itemIter = mSelectedItems.begin(); itemIter != mSelectedItems.end(); itemIter++)
+		bool aggregateHandles = (mQualityLevel >= AggregateHandles && mSelectedItems.size() > 1);
+		if (aggregateHandles)
 		{
-			if ((*itemIter)->isVisible())
+			// Outline the entire selection once instead of drawing every point of every item
+			QRect selectionRect;
+			for(auto itemIter = mSelectedItems.begin(); itemIter != mSelectedItems.end(); itemIter++)
 			{
-				QList<DrawingItemPoint*> itemPoints = (*itemIter)->points();
+				if ((*itemIter)->isVisible())
+					selectionRect = selectionRect.united(mapFromScene((*itemIter)->mapToScene((*itemIter)->boundingRect()).boundingRect()));
+			}
 
-				for(auto pointIter = itemPoints.begin(); pointIter != itemPoints.end(); pointIter++)
-				{
-					QRect pointRect = DrawingView::pointRect(*pointIter).adjusted(0, 0, -1, -1);
+			painter->setBrush(Qt::NoBrush);
+			painter->drawRect(selectionRect.adjusted(0, 0, -1, -1));
+		}
 
-					if (((*pointIter)->flags() & DrawingItemPoint::Control) ||
-						((*pointIter)->flags() == DrawingItemPoint::NoFlags))
-					{
-						pointRect.adjust(1, 1, -1, -1);
-						painter->drawRect(pointRect);
-					}
+		if (!aggregateHandles) updatePointRects();
+
+		QPoint scrollOffset(horizontalScrollBar()->value(), verticalScrollBar()->value());
 
-					if ((*pointIter)->flags() & DrawingItemPoint::Connection)
+		for(auto pointRectIter = mPointRects.begin(); !aggregateHandles && pointRectIter != mPointRects.end(); pointRectIter++)
+		{
+			DrawingItemPoint* point = pointRectIter->point;
+
+			if (point->item()->isVisible())
+			{
+				QRect pointRect = pointRectIter->rect.translated(-scrollOffset).adjusted(0, 0, -1, -1);
+
+				if ((point->flags() & DrawingItemPoint::Control) ||
+					(point->flags() == DrawingItemPoint::NoFlags))
+				{
+					pointRect.adjust(1, 1, -1, -1);
+					painter->drawRect(pointRect);
+				}
+
+				if (point->flags() & DrawingItemPoint::Connection)
+				{
+					for(int x = 0; x <= pointRect.width(); x++)
 					{
-						for(int x = 0; x <= pointRect.width(); x++)
-						{
-							painter->drawPoint(pointRect.left() + x, pointRect.bottom() + 1 - x);
-							painter->drawPoint(pointRect.left() + x, pointRect.top() + x);
-						}
+						painter->drawPoint(pointRect.left() + x, pointRect.bottom() + 1 - x);
+						painter->drawPoint(pointRect.left() + x, pointRect.top() + x);
 					}
 				}
 			}
@@ -1709,11 +2017,12 @@ void DrawingView::drawForeground(QPainter* painter)
 		painter->restore();
 
 		// Draw hotpoints
-		QList<DrawingItem*> items = mNewItems + mSelectedItems;
+		// Sets of new items are only moved on placement, so they show no hotpoints until then
+		QList<DrawingItem*> items = ((mNewItems.size() == 1) ? mNewItems : QList<DrawingItem*>()) + mSelectedItems;
 
 		painter->save();
 
-		painter->resetTransform();
+		painter->setTransform(mPaintTransform);
 		painter->setRenderHints(QPainter::Antialiasing, false);
 		painter->setBrush(QColor(255, 128, 0, 128));
 		painter->setPen(QPen(painter->brush(), 1));
@@ -1749,6 +2058,66 @@ void DrawingView::drawForeground(QPainter* painter)
 
 		painter->restore();
 
+		// Draw highlights
+		if (!mHighlights.isEmpty())
+		{
+			const int minimumHighlightSize = 6;
+			QRectF sceneVisibleRect = visibleRect();
+
+			painter->save();
+
+			painter->setTransform(mPaintTransform);
+			painter->setRenderHints(QPainter::Antialiasing, false);
+
+			for(auto highlightIter = mHighlights.begin(); highlightIter != mHighlights.end(); highlightIter++)
+			{
+				if (!highlightIter->rect.intersects(sceneVisibleRect) && !sceneVisibleRect.contains(highlightIter->rect.center()))
+					continue;
+
+				QRect highlightRect = mapFromScene(highlightIter->rect);
+				if (highlightRect.width() < minimumHighlightSize || highlightRect.height() < minimumHighlightSize)
+				{
+					QPoint center = highlightRect.center();
+					highlightRect.setWidth(qMax(highlightRect.width(), minimumHighlightSize));
+					highlightRect.setHeight(qMax(highlightRect.height(), minimumHighlightSize));
+					highlightRect.moveCenter(center);
+				}
+
+				QColor fillColor = highlightIter->color;
+				fillColor.setAlpha(48);
+
+				painter->setPen(QPen(highlightIter->color, 1));
+				painter->setBrush(fillColor);
+				painter->drawRect(highlightRect.adjusted(0, 0, -1, -1));
+			}
+
+			painter->restore();
+		}
+
+		// Draw alignment guides
+		if (!mVerticalGuides.isEmpty() || !mHorizontalGuides.isEmpty())
+		{
+			painter->save();
+
+			painter->setTransform(mPaintTransform);
+			painter->setRenderHints(QPainter::Antialiasing, false);
+			painter->setPen(QPen(QColor(255, 0, 255), 1, Qt::DashLine));
+
+			for(auto guideIter = mVerticalGuides.begin(); guideIter != mVerticalGuides.end(); guideIter++)
+			{
+				int x = mapFromScene(QPointF(*guideIter, 0)).x();
+				painter->drawLine(x, 0, x, viewport()->height());
+			}
+
+			for(auto guideIter = mHorizontalGuides.begin(); guideIter != mHorizontalGuides.end(); guideIter++)
+			{
+				int y = mapFromScene(QPointF(0, *guideIter)).y();
+				painter->drawLine(0, y, viewport()->width(), y);
+			}
+
+			painter->restore();
+		}
+
 		// Draw rubber band
 		QStyleOptionRubberBand option;
 		option.initFrom(viewport());
@@ -1756,7 +2125,7 @@ void DrawingView::drawForeground(QPainter* painter)
 		option.shape = QRubberBand::Rectangle;
 
 		painter->save();
-		painter->resetTransform();
+		painter->setTransform(mPaintTransform);
 
 		QStyleHintReturnMask mask;
 		if (viewport()->style()->styleHint(QStyle::SH_RubberBand_Mask, &option, viewport(), &mask))
@@ -1783,10 +2152,18 @@ void DrawingView::updateSelectionCenter()
 	}
 }
 
+void DrawingView::updateSceneRects(const QList<QRectF>& sceneRects)
+{
+	for(auto rectIter = sceneRects.begin(); rectIter != sceneRects.end(); rectIter++)
+		viewport()->update(mapFromScene(*rectIter).normalized().adjusted(-2, -2, 2, 2));
+}
+
 void DrawingView::mousePanEvent()
 {
 	if (mScene)
 	{
+		if (mPanCurrentPos != mPanStartPos) beginInteraction();
+
 		QRectF visibleRect = DrawingView::visibleRect();
 		QRectF sceneRect = mScene->sceneRect();
 
@@ -1854,6 +2231,75 @@ void DrawingView::mousePanEvent()
 	}
 }
 
+void DrawingView::endInteraction()
+{
+	if (mInteracting)
+	{
+		// Repaint the entire view once at full quality
+		mInteracting = false;
+		viewport()->update();
+	}
+}
+
+void DrawingView::restoreFullQuality()
+{
+	if (mQualityLevel != FullQuality)
+	{
+		mQualityLevel = FullQuality;
+		mSlowFrameCount = 0;
+		mFastFrameCount = 0;
+		emit qualityLevelChanged(mQualityLevel);
+
+		viewport()->update();
+	}
+}
+
+void DrawingView::updateScrollRange()
+{
+	if (mFlags & ScrollRangeFollowsItems)
+	{
+		// Keep the visible area where it is while the scroll range changes
+		QRectF visibleRect = DrawingView::visibleRect();
+
+		recalculateContentSize(visibleRect);
+		centerOn(visibleRect.center());
+
+		viewport()->update();
+	}
+}
+
+void DrawingView::invalidatePointRects()
+{
+	mPointRectsDirty = true;
+}
+
+void DrawingView::updateUndoStackCost()
+{
+	mUndoStackCacheBudget->setCost(mUndoStack.count() * undoCommandCost);
+	mUndoStackCacheBudget->touch();
+}
+
+void DrawingView::releaseUndoStack(qint64 bytes)
+{
+	// Only as many of the oldest commands as are needed to free the requested memory are dropped
+	mUndoStack.dropCommands(static_cast<int>(qMin((bytes + undoCommandCost - 1) / undoCommandCost,
+		static_cast<qint64>(mUndoStack.count()))));
+	mUndoStackCacheBudget->setCost(mUndoStack.count() * undoCommandCost);
+}
+
+void DrawingView::releaseNewItemsCache()
+{
+	// The new items are drawn directly until the cache is rebuilt at a new scale
+	clearNewItemsCache();
+}
+
+void DrawingView::releaseGridTile()
+{
+	// The tile is regenerated on the next paint
+	mGridTile = QImage();
+	mGridTileCacheBudget->setCost(0);
+}
+
 //==================================================================================================
 
 void DrawingView::addItemsCommand(const QList<DrawingItem*>& items, bool place, QUndoCommand* command)
@@ -1913,6 +2359,30 @@ void DrawingView::resizeItemCommand(DrawingItemPoint* itemPoint, const QPointF&
 	}
 }
 
+void DrawingView::resizeItemPointsCommand(const QVector<DrawingItemPoint*>& itemPoints,
+	const QVector<QPointF>& scenePos, QUndoCommand* command)
+{
+	DrawingResizeItemPointsCommand* resizeCommand =
+		new DrawingResizeItemPointsCommand(mScene, itemPoints, scenePos, true, command);
+	QList<DrawingItem*> resizeItems;
+	QSet<DrawingItem*> resizeItemSet;
+
+	for(auto pointIter = itemPoints.begin(); pointIter != itemPoints.end(); pointIter++)
+	{
+		if (!resizeItemSet.contains((*pointIter)->item()))
+		{
+			resizeItemSet.insert((*pointIter)->item());
+			resizeItems.append((*pointIter)->item());
+		}
+	}
+
+	resizeCommand->redo();
+	tryToMaintainConnections(resizeItems, true, true, nullptr, resizeCommand);
+	resizeCommand->undo();
+
+	if (!command) mUndoStack.push(resizeCommand);
+}
+
 void DrawingView::rotateItemsCommand(const QList<DrawingItem*>& items, const QPointF& scenePos, QUndoCommand* command)
 {
 	DrawingRotateItemsCommand* rotateCommand =
@@ -2019,6 +2489,15 @@ void DrawingView::hideItemsCommand(const QList<DrawingItem*>& items, QUndoComman
 	if (!command) mUndoStack.push(visibilityCommand);
 }
 
+void DrawingView::setItemsStyleCommand(const QList<DrawingItem*>& items,
+	const QHash<DrawingItemStyle::Property,QVariant>& values, bool finalChange, QUndoCommand* command)
+{
+	DrawingSetStyleCommand* styleCommand =
+		new DrawingSetStyleCommand(mScene, items, values, finalChange, command);
+
+	if (!command) mUndoStack.push(styleCommand);
+}
+
 //==================================================================================================
 
 void DrawingView::placeItems(const QList<DrawingItem*>& items, QUndoCommand* command)
@@ -2132,6 +2611,336 @@ void DrawingView::disconnectAll(DrawingItemPoint* itemPoint, QUndoCommand* comma
 
 //==================================================================================================
 
+void DrawingView::beginInteraction()
+{
+	if (mFlags & InteractiveQuality)
+	{
+		mInteracting = true;
+		mInteractiveQualityTimer.start();
+	}
+}
+
+void DrawingView::applyNewItemsOffset()
+{
+	if (mNewItems.size() > 1)
+	{
+		mNewItemsCenter = QPointF();
+
+		for(auto itemIter = mNewItems.begin(); itemIter != mNewItems.end(); itemIter++)
+		{
+			if (!mNewItemsOffset.isNull()) (*itemIter)->setPosition((*itemIter)->position() + mNewItemsOffset);
+			mNewItemsCenter += (*itemIter)->mapToScene((*itemIter)->centerPos());
+		}
+
+		mNewItemsCenter /= mNewItems.size();
+		mNewItemsOffset = QPointF();
+		mNewItemsBounds = QRectF();
+
+		clearNewItemsCache();
+		mNewItemsCacheScale = 0;
+	}
+}
+
+void DrawingView::drawNewItems(QPainter* painter)
+{
+	const int maximumCacheSize = 4096;
+
+	if (mNewItems.size() > 1)
+	{
+		// Render the new items once at the current scale, quality and render hints, then paint
+		// the cached image at the preview offset for each frame.  Rotating or flipping the items
+		// clears the cache.
+		int renderFlags = static_cast<int>(DrawingItem::renderFlags());
+
+		if (mNewItemsCacheScale != mScale || mNewItemsCacheRenderFlags != renderFlags ||
+			mNewItemsCacheRenderHints != painter->renderHints())
+		{
+			mNewItemsCacheRect = QRectF();
+			for(auto itemIter = mNewItems.begin(); itemIter != mNewItems.end(); itemIter++)
+				mNewItemsCacheRect = mNewItemsCacheRect.united(mScene->itemSceneBounds(*itemIter));
+			mNewItemsCacheRect.adjust(-1 / mScale, -1 / mScale, 1 / mScale, 1 / mScale);
+
+			QSize cacheSize = (mNewItemsCacheRect.size() * mScale).toSize().expandedTo(QSize(1, 1));
+
+			if (cacheSize.width() <= maximumCacheSize && cacheSize.height() <= maximumCacheSize)
+			{
+				mNewItemsCache = QImage(cacheSize, QImage::Format_ARGB32_Premultiplied);
+				mNewItemsCache.fill(Qt::transparent);
+
+				QPainter cachePainter(&mNewItemsCache);
+				cachePainter.setRenderHints(painter->renderHints());
+				cachePainter.scale(mScale, mScale);
+				cachePainter.translate(-mNewItemsCacheRect.topLeft());
+				mScene->drawItems(&cachePainter, mNewItems);
+			}
+			else mNewItemsCache = QImage();
+
+			mNewItemsCacheScale = mScale;
+			mNewItemsCacheRenderFlags = renderFlags;
+			mNewItemsCacheRenderHints = painter->renderHints();
+			mNewItemsCacheBudget->setCost(mNewItemsCache.byteCount());
+		}
+
+		mNewItemsCacheBudget->touch();
+
+		painter->save();
+		painter->translate(mNewItemsOffset);
+
+		// Items that are too large to cache at this scale are drawn directly
+		if (!mNewItemsCache.isNull())
+			painter->drawImage(mNewItemsCacheRect, mNewItemsCache);
+		else
+			mScene->drawItems(painter, mNewItems);
+
+		painter->restore();
+	}
+	else mScene->drawItems(painter, mNewItems);
+}
+
+void DrawingView::clearNewItemsCache()
+{
+	mNewItemsCache = QImage();
+	mNewItemsCacheBudget->setCost(0);
+}
+
+void DrawingView::drawGrid(QPainter* painter)
+{
+	const int minimumSpacing = 8;
+	const int maximumTileSize = 1024;
+
+	if (mGrid <= 0 || mScale <= 0) return;
+
+	QRectF gridRect = mScene->sceneRect().intersected(visibleRect());
+	if (gridRect.isEmpty()) return;
+
+	// When zoomed out, drop whole intervals of lines so that the drawn grid stays aligned with the
+	// snap grid but never gets denser than one line per minimumSpacing pixels
+	int interval = qMax(mMajorGridInterval, 1);
+	qreal spacing = mGrid;
+	while (spacing * mScale < minimumSpacing) spacing *= qMax(interval, 2);
+
+	QColor minorColor = mGridColor;
+	minorColor.setAlphaF(mGridColor.alphaF() * 0.35);
+
+	qreal period = spacing * interval;
+	int tileSize = qMax(qFloor(period * mScale), 1);
+
+	if (tileSize <= maximumTileSize)
+	{
+		if (mGridTile.isNull() || mGridTileSpacing != period * mScale || mGridTileInterval != interval ||
+			mGridTileColor != mGridColor)
+		{
+			mGridTile = QImage(tileSize, tileSize, QImage::Format_ARGB32_Premultiplied);
+			mGridTile.fill(Qt::transparent);
+
+			// Major lines run along the top and left edges of the tile and are drawn last
+			QPainter tilePainter(&mGridTile);
+			for(int index = interval - 1; index >= 0; index--)
+			{
+				QColor color = (index == 0) ? mGridColor : minorColor;
+				int offset = qRound(index * tileSize / static_cast<qreal>(interval));
+				tilePainter.fillRect(offset, 0, 1, tileSize, color);
+				tilePainter.fillRect(0, offset, tileSize, 1, color);
+			}
+			tilePainter.end();
+
+			mGridTileSpacing = period * mScale;
+			mGridTileInterval = interval;
+			mGridTileColor = mGridColor;
+			mGridTileCacheBudget->setCost(mGridTile.byteCount());
+		}
+
+		mGridTileCacheBudget->touch();
+
+		// The tile is rounded down to whole pixels and stretched back to one period, so that
+		// nearest-neighbor sampling never skips a line
+		QBrush gridBrush(mGridTile);
+		gridBrush.setTransform(QTransform::fromScale(period / tileSize, period / tileSize));
+
+		painter->save();
+		painter->setBrushOrigin(0, 0);
+		painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+		painter->fillRect(gridRect, gridBrush);
+		painter->restore();
+	}
+	else
+	{
+		// Zoomed in far enough that only a few lines are visible, so they are drawn directly
+		QPen minorPen(minorColor, 1);
+		QPen majorPen(mGridColor, 1);
+		minorPen.setCosmetic(true);
+		majorPen.setCosmetic(true);
+
+		painter->save();
+		painter->setRenderHint(QPainter::Antialiasing, false);
+
+		qint64 first = qCeil(gridRect.left() / spacing);
+		qint64 last = qFloor(gridRect.right() / spacing);
+		for(qint64 index = first; index <= last; index++)
+		{
+			painter->setPen((index % interval == 0) ? majorPen : minorPen);
+			painter->drawLine(QPointF(index * spacing, gridRect.top()), QPointF(index * spacing, gridRect.bottom()));
+		}
+
+		first = qCeil(gridRect.top() / spacing);
+		last = qFloor(gridRect.bottom() / spacing);
+		for(qint64 index = first; index <= last; index++)
+		{
+			painter->setPen((index % interval == 0) ? majorPen : minorPen);
+			painter->drawLine(QPointF(gridRect.left(), index * spacing), QPointF(gridRect.right(), index * spacing));
+		}
+
+		painter->restore();
+	}
+}
+
+QRectF DrawingView::itemsSceneBounds(const QList<DrawingItem*>& items) const
+{
+	QRectF bounds;
+
+	if (mScene)
+	{
+		for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+			bounds = bounds.united(mScene->itemSceneGeometry(*itemIter));
+	}
+
+	return bounds;
+}
+
+QPointF DrawingView::updateAlignmentGuides(const QRectF& sceneRect, const QList<DrawingItem*>& excludedItems)
+{
+	const int alignmentTolerance = 6;
+
+	QPointF offset;
+
+	mVerticalGuides.clear();
+	mHorizontalGuides.clear();
+
+	if (mScene && (mFlags & AlignmentGuides) && !sceneRect.isNull())
+	{
+		qreal tolerance = alignmentTolerance / mScale;
+		qreal xValues[3] = { sceneRect.left(), sceneRect.center().x(), sceneRect.right() };
+		qreal yValues[3] = { sceneRect.top(), sceneRect.center().y(), sceneRect.bottom() };
+
+		offset.setX(alignEdges(Qt::Horizontal, xValues, tolerance, excludedItems, mVerticalGuides));
+		offset.setY(alignEdges(Qt::Vertical, yValues, tolerance, excludedItems, mHorizontalGuides));
+
+		if ((mFlags & SnapToAlignmentGuides) == 0) offset = QPointF();
+	}
+
+	return offset;
+}
+
+qreal DrawingView::alignEdges(Qt::Orientation orientation, const qreal values[3], qreal tolerance,
+	const QList<DrawingItem*>& excludedItems, QList<qreal>& guides) const
+{
+	qreal offset = 0;
+	bool found = false;
+
+	QList<qreal> edges;
+
+	// Only the narrow windows around the selection's edges and center are searched, so that a
+	// large selection does not visit every edge that it spans.  The windows are in ascending
+	// order, so edges where they overlap are skipped to keep the list sorted and unique.
+	for(int valueIndex = 0; valueIndex < 3; valueIndex++)
+	{
+		QList<qreal> windowEdges = mScene->itemEdges(orientation,
+			values[valueIndex] - tolerance, values[valueIndex] + tolerance, excludedItems);
+
+		for(auto edgeIter = windowEdges.begin(); edgeIter != windowEdges.end(); edgeIter++)
+		{
+			if (edges.isEmpty() || *edgeIter > edges.last()) edges.append(*edgeIter);
+		}
+	}
+
+	// Find the edge closest to any of the values, using binary search on the sorted edges
+	for(int valueIndex = 0; valueIndex < 3; valueIndex++)
+	{
+		for(auto edgeIter = std::lower_bound(edges.begin(), edges.end(), values[valueIndex] - tolerance);
+			edgeIter != edges.end() && *edgeIter <= values[valueIndex] + tolerance; edgeIter++)
+		{
+			if (!found || qAbs(*edgeIter - values[valueIndex]) < qAbs(offset))
+			{
+				offset = *edgeIter - values[valueIndex];
+				found = true;
+			}
+		}
+	}
+
+	if (found)
+	{
+		// When snapping, only the edges that line up exactly are shown; otherwise all nearby
+		// edges are shown
+		bool snap = (mFlags & SnapToAlignmentGuides);
+		qreal shift = (snap) ? offset : 0;
+		qreal matchTolerance = (snap) ? tolerance / 1000 : tolerance;
+
+		for(int valueIndex = 0; valueIndex < 3; valueIndex++)
+		{
+			qreal value = values[valueIndex] + shift;
+
+			for(auto edgeIter = std::lower_bound(edges.begin(), edges.end(), value - matchTolerance);
+				edgeIter != edges.end() && *edgeIter <= value + matchTolerance; edgeIter++)
+			{
+				if (!guides.contains(*edgeIter)) guides.append(*edgeIter);
+			}
+		}
+	}
+
+	return offset;
+}
+
+void DrawingView::updateQualityLevel(qint64 paintTime)
+{
+	const int slowFramesToStepDown = 2;
+	const int fastFramesToStepUp = 10;
+
+	QualityLevel level = mQualityLevel;
+
+	if (mFlags & AdaptiveQuality)
+	{
+		// Frames between half the budget and the full budget reset both counts, so the level
+		// only changes when painting is clearly too slow or clearly fast enough
+		if (paintTime > mFrameBudget)
+		{
+			mSlowFrameCount++;
+			mFastFrameCount = 0;
+		}
+		else if (2 * paintTime < mFrameBudget)
+		{
+			mFastFrameCount++;
+			mSlowFrameCount = 0;
+		}
+		else
+		{
+			mSlowFrameCount = 0;
+			mFastFrameCount = 0;
+		}
+
+		if (mSlowFrameCount >= slowFramesToStepDown && level < AggregateHandles)
+		{
+			level = static_cast<QualityLevel>(level + 1);
+			mSlowFrameCount = 0;
+		}
+		else if (mFastFrameCount >= fastFramesToStepUp && level > FullQuality)
+		{
+			level = static_cast<QualityLevel>(level - 1);
+			mFastFrameCount = 0;
+		}
+	}
+	else level = FullQuality;
+
+	if (level != mQualityLevel)
+	{
+		mQualityLevel = level;
+		emit qualityLevelChanged(mQualityLevel);
+	}
+
+	// Fast frames only arrive while the view keeps changing, so an idle view is restored directly
+	if (mQualityLevel > FullQuality) mQualityRestoreTimer.start(mInteractiveQualityTimer.interval());
+	else mQualityRestoreTimer.stop();
+}
+
 void DrawingView::recalculateContentSize(const QRectF& targetSceneRect)
 {
 	qreal dx = 0, dy = 0;
@@ -2150,6 +2959,12 @@ void DrawingView::recalculateContentSize(const QRectF& targetSceneRect)
 		}
 		else targetRect = sceneRect;
 
+		if (mFlags & ScrollRangeFollowsItems)
+		{
+			QRectF itemsRect = mScene->itemsBoundingRect();
+			if (itemsRect.isValid()) targetRect = targetRect.united(itemsRect);
+		}
+
 		int contentWidth = qRound(targetRect.width() * mScale);
 		int contentHeight = qRound(targetRect.height() * mScale);
 		int viewportWidth = maximumViewportSize().width();
@@ -2242,6 +3057,28 @@ DrawingItemPoint* DrawingView::pointAt(DrawingItem* item, const QPointF& itemPos
 	DrawingItemPoint* itemPoint = nullptr;
 
 	if (item)
+		updatePointRects();
+
+	if (item && mPointRectRanges.contains(item))
+	{
+		// Only look at the point rects in the grid cell under the position
+		QPoint pos = mViewportTransform.map(item->mapToScene(itemPos)).toPoint();
+		QPair<int,int> range = mPointRectRanges.value(item);
+
+		auto gridIter = mPointRectGrid.find(pointRectGridCell(pointRectGridIndex(pos.x()), pointRectGridIndex(pos.y())));
+		if (gridIter != mPointRectGrid.end())
+		{
+			for(auto indexIter = gridIter->begin(); itemPoint == nullptr && indexIter != gridIter->end(); indexIter++)
+			{
+				if (range.first <= *indexIter && *indexIter < range.first + range.second &&
+					mPointRects.at(*indexIter).rect.contains(pos))
+				{
+					itemPoint = mPointRects.at(*indexIter).point;
+				}
+			}
+		}
+	}
+	else if (item)
 	{
 		QList<DrawingItemPoint*> itemPoints = item->points();
 		QRectF pointItemRect;
@@ -2256,6 +3093,70 @@ DrawingItemPoint* DrawingView::pointAt(DrawingItem* item, const QPointF& itemPos
 	return itemPoint;
 }
 
+QVector<QRect> DrawingView::itemPointRects(DrawingItem* item) const
+{
+	QVector<QRect> pointRects;
+
+	if (item)
+		updatePointRects();
+
+	if (item && mPointRectRanges.contains(item))
+	{
+		QPoint scrollOffset(horizontalScrollBar()->value(), verticalScrollBar()->value());
+		QPair<int,int> range = mPointRectRanges.value(item);
+
+		pointRects.reserve(range.second);
+		for(int index = range.first; index < range.first + range.second; index++)
+			pointRects.append(mPointRects.at(index).rect.translated(-scrollOffset));
+	}
+	else if (item)
+	{
+		QList<DrawingItemPoint*> itemPoints = item->points();
+		for(auto pointIter = itemPoints.begin(); pointIter != itemPoints.end(); pointIter++)
+			pointRects.append(pointRect(*pointIter));
+	}
+
+	return pointRects;
+}
+
+void DrawingView::updatePointRects() const
+{
+	if (mPointRectsDirty || mPointRectsTransform != mViewportTransform)
+	{
+		QPoint scrollOffset(horizontalScrollBar()->value(), verticalScrollBar()->value());
+		PointRect pointRect;
+
+		mPointRects.clear();
+		mPointRectRanges.clear();
+		mPointRectGrid.clear();
+
+		for(auto itemIter = mSelectedItems.begin(); itemIter != mSelectedItems.end(); itemIter++)
+		{
+			QList<DrawingItemPoint*> itemPoints = (*itemIter)->points();
+
+			mPointRectRanges.insert(*itemIter, qMakePair(mPointRects.size(), itemPoints.size()));
+
+			for(auto pointIter = itemPoints.begin(); pointIter != itemPoints.end(); pointIter++)
+			{
+				pointRect.point = *pointIter;
+				pointRect.rect = DrawingView::pointRect(*pointIter).translated(scrollOffset);
+
+				// Each rect is added to every grid cell that it overlaps
+				for(int x = pointRectGridIndex(pointRect.rect.left()); x <= pointRectGridIndex(pointRect.rect.right()); x++)
+				{
+					for(int y = pointRectGridIndex(pointRect.rect.top()); y <= pointRectGridIndex(pointRect.rect.bottom()); y++)
+						mPointRectGrid[pointRectGridCell(x, y)].append(mPointRects.size());
+				}
+
+				mPointRects.append(pointRect);
+			}
+		}
+
+		mPointRectsTransform = mViewportTransform;
+		mPointRectsDirty = false;
+	}
+}
+
 //==================================================================================================
 
 bool DrawingView::shouldConnect(DrawingItemPoint* point1, DrawingItemPoint* point2) const
@@ -2292,6 +3193,27 @@ bool DrawingView::shouldDisconnect(DrawingItemPoint* point1, DrawingItemPoint* p
 
 //==================================================================================================
 
+void DrawingView::setMouseDownItem(DrawingItem* item)
+{
+	// The items may be materialized from the scene's item source, which would otherwise be free
+	// to delete them while the view still refers to them
+	if (mScene)
+	{
+		QList<DrawingItem*> pinnedItems, unpinnedItems;
+		if (item) pinnedItems << item << item;
+		if (mMouseDownItem) unpinnedItems << mMouseDownItem;
+		if (mFocusItem) unpinnedItems << mFocusItem;
+
+		mScene->pinItems(pinnedItems);
+		mScene->unpinItems(unpinnedItems);
+	}
+
+	mMouseDownItem = item;
+	mFocusItem = item;
+}
+
+//==================================================================================================
+
 void DrawingView::sendMouseInfoText(const QPointF& pos)
 {
 	if (mFlags & SendsMouseMoveInfo)
@@ -0,0 +1,569 @@
+/* DrawingBenchmark.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingBenchmark.h"
+#include "DrawingScene.h"
+#include "DrawingArena.h"
+#include "DrawingItem.h"
+#include "DrawingItemPoint.h"
+#include "DrawingStoredPoint.h"
+#include "DrawingItemStyle.h"
+#include "DrawingRectItem.h"
+#include "DrawingEllipseItem.h"
+#include "DrawingLineItem.h"
+#include "DrawingPolygonItem.h"
+#include "DrawingTextRectItem.h"
+
+// Small xorshift generator, so that a seed produces the same sequence on every platform
+class DrawingBenchmarkRandom
+{
+private:
+	quint64 mState;
+
+public:
+	DrawingBenchmarkRandom(quint32 seed)
+	{
+		mState = seed * Q_UINT64_C(0x9E3779B97F4A7C15) + 1;
+	}
+
+	quint32 next()
+	{
+		mState ^= mState >> 12;
+		mState ^= mState << 25;
+		mState ^= mState >> 27;
+		return static_cast<quint32>((mState * Q_UINT64_C(2685821657736338717)) >> 32);
+	}
+
+	int integer(int minimum, int maximum)
+	{
+		return minimum + static_cast<int>(next() % static_cast<quint32>(maximum - minimum + 1));
+	}
+
+	qreal real(qreal minimum, qreal maximum)
+	{
+		return minimum + (maximum - minimum) * (next() / 4294967296.0);
+	}
+};
+
+// Number of areas culled by each iteration of a cull measurement
+static const int benchmarkCullQueries = 200;
+
+// Number of frames measured by each iteration of the churn benchmark
+static const int benchmarkChurnFrames = 30;
+
+//==================================================================================================
+
+static DrawingItem* createItem(quint32 seed, const QRectF& sceneRect)
+{
+	DrawingBenchmarkRandom random(seed);
+	DrawingItem* item = nullptr;
+
+	qreal x = random.real(sceneRect.left(), sceneRect.right());
+	qreal y = random.real(sceneRect.top(), sceneRect.bottom());
+	qreal width = random.real(20, 300);
+	qreal height = random.real(20, 300);
+	QRectF rect(-width / 2, -height / 2, width, height);
+
+	switch (random.integer(0, 4))
+	{
+	case 0:
+		{
+			DrawingRectItem* rectItem = new DrawingRectItem();
+			rectItem->setRect(rect);
+			item = rectItem;
+		}
+		break;
+	case 1:
+		{
+			DrawingEllipseItem* ellipseItem = new DrawingEllipseItem();
+			ellipseItem->setEllipse(rect);
+			item = ellipseItem;
+		}
+		break;
+	case 2:
+		{
+			DrawingLineItem* lineItem = new DrawingLineItem();
+			lineItem->setLine(QLineF(QPointF(0, 0), rect.bottomRight()));
+			item = lineItem;
+		}
+		break;
+	case 3:
+		{
+			QPolygonF polygon;
+			int pointCount = random.integer(3, 6);
+			for(int index = 0; index < pointCount; index++)
+			{
+				qreal angle = 2 * M_PI * index / pointCount;
+				polygon.append(QPointF(width / 2 * qCos(angle), height / 2 * qSin(angle)));
+			}
+
+			DrawingPolygonItem* polygonItem = new DrawingPolygonItem();
+			polygonItem->setPolygon(polygon);
+			item = polygonItem;
+		}
+		break;
+	default:
+		{
+			DrawingTextRectItem* textRectItem = new DrawingTextRectItem();
+			textRectItem->setRect(rect);
+			textRectItem->setCaption(QString("Item %1").arg(seed % 1000));
+			item = textRectItem;
+		}
+		break;
+	}
+
+	item->setPosition(x, y);
+	item->style()->setValue(DrawingItemStyle::PenWidth, random.real(1, 8));
+
+	return item;
+}
+
+static DrawingScene* createScene(quint32 seed, int itemCount, bool arenaEnabled)
+{
+	DrawingScene* scene = new DrawingScene();
+	scene->setItemIndexMethod(DrawingScene::BoundsTableIndex);
+	scene->setItemArenaEnabled(arenaEnabled);
+
+	DrawingBenchmarkRandom random(seed);
+	DrawingArenaScope arenaScope(scene->itemArena());
+
+	for(int index = 0; index < itemCount; index++)
+		scene->addItem(createItem(random.next(), scene->sceneRect()));
+
+	return scene;
+}
+
+// Replaces half of the scene's items with new items at random positions in the z-order, so that
+// the items are no longer allocated in the order they are painted
+static void editScene(DrawingScene* scene, quint32 seed)
+{
+	DrawingBenchmarkRandom random(seed);
+	DrawingArenaScope arenaScope(scene->itemArena());
+
+	int editCount = scene->items().size() / 2;
+	for(int index = 0; index < editCount; index++)
+	{
+		QList<DrawingItem*> items = scene->items();
+		DrawingItem* item = items.at(random.integer(0, items.size() - 1));
+
+		scene->removeItem(item);
+		delete item;
+
+		scene->insertItem(random.integer(0, items.size() - 1), createItem(random.next(), scene->sceneRect()));
+	}
+}
+
+static qreal renderTime(DrawingScene* scene, const QSize& size, int iterationCount)
+{
+	QImage image(size, QImage::Format_ARGB32_Premultiplied);
+	QRectF rect = scene->sceneRect();
+	QElapsedTimer timer;
+	qint64 time = 0;
+
+	for(int iteration = 0; iteration < iterationCount; iteration++)
+	{
+		image.fill(scene->backgroundBrush().color());
+
+		QPainter painter(&image);
+		painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
+		painter.scale(size.width() / rect.width(), size.height() / rect.height());
+		painter.translate(-rect.topLeft());
+
+		timer.start();
+		scene->render(&painter);
+		time += timer.nsecsElapsed();
+	}
+
+	return time / 1.0e6 / qMax(iterationCount, 1);
+}
+
+static qreal cullTime(DrawingScene* scene, quint32 seed, int iterationCount)
+{
+	DrawingBenchmarkRandom random(seed);
+	QRectF sceneRect = scene->sceneRect();
+	QVector<QRectF> rects;
+	QElapsedTimer timer;
+	qint64 time = 0;
+
+	for(int index = 0; index < benchmarkCullQueries; index++)
+	{
+		qreal width = sceneRect.width() * random.real(0.05, 0.2);
+		qreal height = sceneRect.height() * random.real(0.05, 0.2);
+		rects.append(QRectF(random.real(sceneRect.left(), sceneRect.right() - width),
+			random.real(sceneRect.top(), sceneRect.bottom() - height), width, height));
+	}
+
+	for(int iteration = 0; iteration < iterationCount; iteration++)
+	{
+		timer.start();
+		for(auto rectIter = rects.begin(); rectIter != rects.end(); rectIter++)
+			scene->visibleItems(nullptr, *rectIter, Qt::IntersectsItemBoundingRect);
+		time += timer.nsecsElapsed();
+	}
+
+	return time / 1.0e3 / qMax(iterationCount * benchmarkCullQueries, 1);
+}
+
+//==================================================================================================
+
+DrawingBenchmark::DrawingBenchmark()
+{
+	mSeed = 1;
+	mItemCount = 20000;
+	mIterationCount = 10;
+	mChurnCount = 5000;
+	mImageSize = QSize(1024, 768);
+	mBenchmarks = AllBenchmarks;
+}
+
+DrawingBenchmark::~DrawingBenchmark() { }
+
+//==================================================================================================
+
+void DrawingBenchmark::setSeed(quint32 seed)
+{
+	mSeed = seed;
+}
+
+quint32 DrawingBenchmark::seed() const
+{
+	return mSeed;
+}
+
+void DrawingBenchmark::setItemCount(int count)
+{
+	mItemCount = qMax(count, 1);
+}
+
+int DrawingBenchmark::itemCount() const
+{
+	return mItemCount;
+}
+
+void DrawingBenchmark::setIterationCount(int count)
+{
+	mIterationCount = qMax(count, 1);
+}
+
+int DrawingBenchmark::iterationCount() const
+{
+	return mIterationCount;
+}
+
+void DrawingBenchmark::setChurnCount(int count)
+{
+	mChurnCount = qMax(count, 1);
+}
+
+int DrawingBenchmark::churnCount() const
+{
+	return mChurnCount;
+}
+
+void DrawingBenchmark::setImageSize(const QSize& size)
+{
+	mImageSize = size.expandedTo(QSize(1, 1));
+}
+
+QSize DrawingBenchmark::imageSize() const
+{
+	return mImageSize;
+}
+
+void DrawingBenchmark::setBenchmarks(Benchmarks benchmarks)
+{
+	mBenchmarks = benchmarks;
+}
+
+DrawingBenchmark::Benchmarks DrawingBenchmark::benchmarks() const
+{
+	return mBenchmarks;
+}
+
+//==================================================================================================
+
+void DrawingBenchmark::run()
+{
+	mResults.clear();
+
+	if (mBenchmarks & ArenaBenchmark) runArenaBenchmark();
+	if (mBenchmarks & ChurnBenchmark) runChurnBenchmark();
+	if (mBenchmarks & GeometryBenchmark) runGeometryBenchmark();
+}
+
+QVector<DrawingBenchmark::Result> DrawingBenchmark::results() const
+{
+	return mResults;
+}
+
+QString DrawingBenchmark::report() const
+{
+	QString report;
+
+	for(auto resultIter = mResults.begin(); resultIter != mResults.end(); resultIter++)
+	{
+		report += QString("%1 / %2: %3 %4 %5\n").arg(benchmarkName(resultIter->benchmark))
+			.arg(resultIter->configuration).arg(resultIter->measurement)
+			.arg(resultIter->value, 0, 'f', 3).arg(resultIter->unit);
+	}
+
+	return report;
+}
+
+QString DrawingBenchmark::comparisonReport(const QVector<Result>& baseline) const
+{
+	QString report;
+
+	for(auto resultIter = mResults.begin(); resultIter != mResults.end(); resultIter++)
+	{
+		report += QString("%1 / %2: %3 %4 %5").arg(benchmarkName(resultIter->benchmark))
+			.arg(resultIter->configuration).arg(resultIter->measurement)
+			.arg(resultIter->value, 0, 'f', 3).arg(resultIter->unit);
+
+		for(auto baselineIter = baseline.begin(); baselineIter != baseline.end(); baselineIter++)
+		{
+			if (baselineIter->benchmark == resultIter->benchmark &&
+				baselineIter->configuration == resultIter->configuration &&
+				baselineIter->measurement == resultIter->measurement)
+			{
+				report += QString(" (baseline %1").arg(baselineIter->value, 0, 'f', 3);
+				if (baselineIter->value != 0)
+				{
+					report += QString(", %1%").arg(
+						100 * (resultIter->value - baselineIter->value) / baselineIter->value, 0, 'f', 1);
+				}
+				report += ")";
+				break;
+			}
+		}
+
+		report += "\n";
+	}
+
+	return report;
+}
+
+bool DrawingBenchmark::saveResults(const QString& fileName) const
+{
+	QSaveFile file(fileName);
+	bool success = file.open(QIODevice::WriteOnly | QIODevice::Text);
+
+	if (success)
+	{
+		// One tab-separated result per line
+		QTextStream stream(&file);
+		for(auto resultIter = mResults.begin(); resultIter != mResults.end(); resultIter++)
+		{
+			stream << benchmarkName(resultIter->benchmark) << '\t' << resultIter->configuration << '\t'
+				<< resultIter->measurement << '\t' << QString::number(resultIter->value, 'g', 10) << '\t'
+				<< resultIter->unit << '\n';
+		}
+
+		stream.flush();
+		success = file.commit();
+	}
+
+	return success;
+}
+
+QVector<DrawingBenchmark::Result> DrawingBenchmark::loadResults(const QString& fileName)
+{
+	QVector<Result> results;
+
+	QFile file(fileName);
+	if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		QTextStream stream(&file);
+		while (!stream.atEnd())
+		{
+			QStringList fields = stream.readLine().split('\t');
+			if (fields.size() == 5 && benchmarkFromName(fields[0]) != 0)
+			{
+				Result result;
+				result.benchmark = benchmarkFromName(fields[0]);
+				result.configuration = fields[1];
+				result.measurement = fields[2];
+				result.value = fields[3].toDouble();
+				result.unit = fields[4];
+				results.append(result);
+			}
+		}
+	}
+
+	return results;
+}
+
+//==================================================================================================
+
+QString DrawingBenchmark::benchmarkName(Benchmark benchmark)
+{
+	QString name;
+
+	switch (benchmark)
+	{
+	case ArenaBenchmark: name = "arena"; break;
+	case ChurnBenchmark: name = "churn"; break;
+	case GeometryBenchmark: name = "geometry"; break;
+	default: break;
+	}
+
+	return name;
+}
+
+DrawingBenchmark::Benchmark DrawingBenchmark::benchmarkFromName(const QString& name)
+{
+	Benchmark benchmark = static_cast<Benchmark>(0);
+
+	if (name == benchmarkName(ArenaBenchmark)) benchmark = ArenaBenchmark;
+	else if (name == benchmarkName(ChurnBenchmark)) benchmark = ChurnBenchmark;
+	else if (name == benchmarkName(GeometryBenchmark)) benchmark = GeometryBenchmark;
+
+	return benchmark;
+}
+
+//==================================================================================================
+
+void DrawingBenchmark::runArenaBenchmark()
+{
+	const int configurationCount = 3;
+	const char* configurations[configurationCount] = { "Heap", "Arena after edits", "Arena compacted" };
+
+	for(int configurationIndex = 0; configurationIndex < configurationCount; configurationIndex++)
+	{
+		DrawingScene* scene = createScene(mSeed, mItemCount, configurationIndex > 0);
+		editScene(scene, mSeed + 1);
+		if (configurationIndex == 2) scene->compactItems();
+
+		addResult(ArenaBenchmark, configurations[configurationIndex], "render",
+			renderTime(scene, mImageSize, mIterationCount), "ms/frame");
+		addResult(ArenaBenchmark, configurations[configurationIndex], "cull",
+			cullTime(scene, mSeed + 2, mIterationCount), "us/query");
+
+		if (scene->itemArena())
+		{
+			addResult(ArenaBenchmark, configurations[configurationIndex], "slabs allocated",
+				scene->itemArena()->slabCount(), "slabs");
+		}
+
+		delete scene;
+	}
+}
+
+void DrawingBenchmark::runChurnBenchmark()
+{
+	const int configurationCount = 3;
+	const char* configurations[configurationCount] = { "No index", "Bounds table", "Bounds table rebuilt" };
+
+	for(int configurationIndex = 0; configurationIndex < configurationCount; configurationIndex++)
+	{
+		DrawingScene* scene = createScene(mSeed, mItemCount, false);
+		if (configurationIndex == 0) scene->setItemIndexMethod(DrawingScene::NoIndex);
+
+		DrawingBenchmarkRandom random(mSeed + 3);
+		QList<DrawingItem*> items = scene->items();
+		QRectF sceneRect = scene->sceneRect();
+		QRectF viewRect(sceneRect.center() - QPointF(sceneRect.width() / 8, sceneRect.height() / 8),
+			QSizeF(sceneRect.width() / 4, sceneRect.height() / 4));
+		QElapsedTimer timer;
+		qint64 updateTime = 0, cullTime = 0;
+		int frameCount = mIterationCount * benchmarkChurnFrames;
+
+		for(int frame = 0; frame < frameCount; frame++)
+		{
+			QList<DrawingItem*> movedItems;
+			QHash<DrawingItem*,QPointF> positions;
+
+			for(int index = 0; index < mChurnCount && index < items.size(); index++)
+			{
+				DrawingItem* item = items.at(random.integer(0, items.size() - 1));
+				if (!positions.contains(item)) movedItems.append(item);
+				positions.insert(item, item->position() + QPointF(random.real(-20, 20), random.real(-20, 20)));
+			}
+
+			timer.start();
+			scene->moveItems(movedItems, positions);
+
+			// Setting the method again marks the table dirty, so it is rebuilt by the next cull
+			if (configurationIndex == 2) scene->setItemIndexMethod(DrawingScene::BoundsTableIndex);
+			updateTime += timer.nsecsElapsed();
+
+			timer.start();
+			scene->visibleItems(nullptr, viewRect, Qt::IntersectsItemBoundingRect);
+			cullTime += timer.nsecsElapsed();
+		}
+
+		addResult(ChurnBenchmark, configurations[configurationIndex], "update",
+			updateTime / 1.0e6 / frameCount, "ms/frame");
+		addResult(ChurnBenchmark, configurations[configurationIndex], "cull",
+			cullTime / 1.0e6 / frameCount, "ms/frame");
+
+		delete scene;
+	}
+}
+
+void DrawingBenchmark::runGeometryBenchmark()
+{
+	const int configurationCount = 2;
+	const char* configurations[configurationCount] = { "Bounds table", "No index" };
+
+	// The configurations are named the same in both builds so that comparisonReport() can match
+	// them; the storage measured is recorded as a result of its own
+	addResult(GeometryBenchmark, "Storage", "coordinate size", 8 * sizeof(DrawingStoredPoint::Coordinate), "bits");
+
+	for(int configurationIndex = 0; configurationIndex < configurationCount; configurationIndex++)
+	{
+		DrawingScene* scene = createScene(mSeed, mItemCount, true);
+		if (configurationIndex == 1) scene->setItemIndexMethod(DrawingScene::NoIndex);
+
+		if (configurationIndex == 0)
+		{
+			// Items, points, and styles are allocated from the arena, so its slabs hold the memory
+			// used by the items themselves; the stored positions are the part that the build changes
+			QList<DrawingItem*> items = scene->items();
+			qint64 pointCount = 0;
+
+			for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+				pointCount += 1 + (*itemIter)->points().size();
+
+			addResult(GeometryBenchmark, "Storage", "arena memory",
+				static_cast<qreal>(scene->itemArena()->slabCount()) * scene->itemArena()->slabSize() / items.size(),
+				"bytes/item");
+			addResult(GeometryBenchmark, "Storage", "stored positions",
+				static_cast<qreal>(pointCount * sizeof(DrawingStoredPoint)) / items.size(), "bytes/item");
+		}
+
+		addResult(GeometryBenchmark, configurations[configurationIndex], "cull",
+			cullTime(scene, mSeed + 2, mIterationCount), "us/query");
+
+		delete scene;
+	}
+}
+
+void DrawingBenchmark::addResult(Benchmark benchmark, const QString& configuration,
+	const QString& measurement, qreal value, const QString& unit)
+{
+	Result result;
+	result.benchmark = benchmark;
+	result.configuration = configuration;
+	result.measurement = measurement;
+	result.value = value;
+	result.unit = unit;
+	mResults.append(result);
+}
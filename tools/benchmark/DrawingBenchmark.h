@@ -0,0 +1,227 @@
+/* DrawingBenchmark.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGBENCHMARK_H
+#define DRAWINGBENCHMARK_H
+
+#include <QtGui>
+
+/*! \brief Measures the performance of the optional storage and indexing modes of DrawingScene.
+ *
+ * DrawingBenchmark builds randomized scenes from the same seed() for each configuration of a
+ * benchmark, so that the configurations are compared on identical content.  Each measurement is
+ * repeated iterationCount() times and the average is recorded in results().
+ *
+ * The following benchmarks are available:
+ * \li #ArenaBenchmark renders and culls a scene whose items have been allocated from the heap,
+ * from a DrawingArena after a series of removals, insertions, and reorders, and from the same
+ * arena after DrawingScene::compactItems() has laid them out in z-order again.
+ * \li #ChurnBenchmark moves churnCount() items through DrawingScene::moveItems() every frame and
+ * then culls the visible area, with no item index, with the #DrawingScene::BoundsTableIndex
+ * updated in place, and with the same table rebuilt every frame as a tree index would need to be.
+ * \li #GeometryBenchmark measures the memory used by the items of a scene and the time to cull
+ * it with and without an item index.  Since the JADE_SINGLE_PRECISION_GEOMETRY storage is chosen
+ * when the library is built, the benchmark is run once with each build: the results of the first
+ * run are written with saveResults() and passed to comparisonReport() in the second run.
+ *
+ * DrawingBenchmark does not require a DrawingView, but a QGuiApplication must exist since the
+ * scenes contain text items.  It is built by the benchmark tool project rather than as part of
+ * the library.
+ */
+class DrawingBenchmark
+{
+public:
+	//! \brief Enum representing the benchmarks that can be run.
+	enum Benchmark
+	{
+		ArenaBenchmark = 0x01,			//!< Render and cull times with and without the item arena
+		ChurnBenchmark = 0x02,			//!< Update and cull times while many items move each frame
+		GeometryBenchmark = 0x04,		//!< Item memory and cull times of the geometry storage
+		AllBenchmarks = 0x07			//!< All of the above benchmarks
+	};
+	Q_DECLARE_FLAGS(Benchmarks, Benchmark)
+
+	//! \brief Describes a single measurement made by a benchmark.
+	struct Result
+	{
+		Benchmark benchmark;			//!< The benchmark that made the measurement
+		QString configuration;			//!< The configuration of the scene that was measured
+		QString measurement;			//!< What was measured
+		qreal value;					//!< The average measured value
+		QString unit;					//!< The unit of the value
+	};
+
+private:
+	quint32 mSeed;
+	int mItemCount;
+	int mIterationCount;
+	int mChurnCount;
+	QSize mImageSize;
+	Benchmarks mBenchmarks;
+
+	QVector<Result> mResults;
+
+public:
+	//! \brief Create a new DrawingBenchmark with default settings.
+	DrawingBenchmark();
+
+	//! \brief Delete an existing DrawingBenchmark object.
+	~DrawingBenchmark();
+
+
+	/*! \brief Sets the seed used to generate the scenes, edits, and measured areas.
+	 *
+	 * The default seed is 1.
+	 *
+	 * \sa seed()
+	 */
+	void setSeed(quint32 seed);
+
+	/*! \brief Returns the seed used to generate the scenes, edits, and measured areas.
+	 *
+	 * \sa setSeed()
+	 */
+	quint32 seed() const;
+
+	/*! \brief Sets the number of items in each scene.
+	 *
+	 * The default count is 20000.
+	 *
+	 * \sa itemCount()
+	 */
+	void setItemCount(int count);
+
+	/*! \brief Returns the number of items in each scene.
+	 *
+	 * \sa setItemCount()
+	 */
+	int itemCount() const;
+
+	/*! \brief Sets the number of times each measurement is repeated.
+	 *
+	 * The default count is 10.
+	 *
+	 * \sa iterationCount()
+	 */
+	void setIterationCount(int count);
+
+	/*! \brief Returns the number of times each measurement is repeated.
+	 *
+	 * \sa setIterationCount()
+	 */
+	int iterationCount() const;
+
+	/*! \brief Sets the number of items moved each frame by the #ChurnBenchmark.
+	 *
+	 * The default count is 5000.
+	 *
+	 * \sa churnCount()
+	 */
+	void setChurnCount(int count);
+
+	/*! \brief Returns the number of items moved each frame by the #ChurnBenchmark.
+	 *
+	 * \sa setChurnCount()
+	 */
+	int churnCount() const;
+
+	/*! \brief Sets the size of the images rendered by the benchmarks.
+	 *
+	 * The default size is 1024 x 768.
+	 *
+	 * \sa imageSize()
+	 */
+	void setImageSize(const QSize& size);
+
+	/*! \brief Returns the size of the images rendered by the benchmarks.
+	 *
+	 * \sa setImageSize()
+	 */
+	QSize imageSize() const;
+
+	/*! \brief Sets which benchmarks are run.
+	 *
+	 * The default is #AllBenchmarks.
+	 *
+	 * \sa benchmarks()
+	 */
+	void setBenchmarks(Benchmarks benchmarks);
+
+	/*! \brief Returns which benchmarks are run.
+	 *
+	 * \sa setBenchmarks()
+	 */
+	Benchmarks benchmarks() const;
+
+
+	/*! \brief Runs each of the enabled benchmarks().
+	 *
+	 * Any previous results() are cleared first.
+	 */
+	void run();
+
+	//! \brief Returns the measurements made by the last call to run().
+	QVector<Result> results() const;
+
+	//! \brief Returns a readable summary of the results().
+	QString report() const;
+
+	/*! \brief Returns a readable comparison of the results() with those of an earlier run.
+	 *
+	 * Results are matched by benchmark, configuration, and measurement.  Results without a
+	 * match in the baseline are listed as in report().
+	 *
+	 * \sa loadResults()
+	 */
+	QString comparisonReport(const QVector<Result>& baseline) const;
+
+	/*! \brief Writes the results() to the specified file so that a later run can be compared
+	 * against them.
+	 *
+	 * Returns true on success, false otherwise.
+	 *
+	 * \sa loadResults(), comparisonReport()
+	 */
+	bool saveResults(const QString& fileName) const;
+
+	/*! \brief Reads results written by saveResults() from the specified file.
+	 *
+	 * Returns an empty vector if the file cannot be read.
+	 */
+	static QVector<Result> loadResults(const QString& fileName);
+
+	//! \brief Returns the name of the specified benchmark, as accepted by benchmarkFromName().
+	static QString benchmarkName(Benchmark benchmark);
+
+	//! \brief Returns the benchmark with the specified name, or 0 if there is none.
+	static Benchmark benchmarkFromName(const QString& name);
+
+private:
+	void runArenaBenchmark();
+	void runChurnBenchmark();
+	void runGeometryBenchmark();
+
+	void addResult(Benchmark benchmark, const QString& configuration, const QString& measurement,
+		qreal value, const QString& unit);
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(DrawingBenchmark::Benchmarks)
+
+#endif
@@ -0,0 +1,32 @@
+TEMPLATE = app
+TARGET = benchmark
+
+DESTDIR = bin
+INCLUDEPATH += ../../include
+
+CONFIG += release warn_on c++11 qt console
+CONFIG -= debug app_bundle
+QT += widgets network
+
+# Must match the setting used to build libjade.pro, since it changes the layout of the items;
+# build and run once with each setting to compare them with the geometry benchmark
+#DEFINES += JADE_SINGLE_PRECISION_GEOMETRY
+
+# Build libjade.pro first; the benchmark links against the static library it produces
+LIBS += -L../../lib -ljade
+win32:PRE_TARGETDEPS += ../../lib/jade.lib
+!win32:PRE_TARGETDEPS += ../../lib/libjade.a
+qtConfig(system-zlib): LIBS += -lz
+
+!win32:MOC_DIR = release
+!win32:OBJECTS_DIR = release
+!win32:RCC_DIR = release
+
+# --------------------------------------------------------------------------------------------------
+
+SOURCES += \
+	DrawingBenchmark.cpp \
+	main.cpp
+
+HEADERS += \
+	DrawingBenchmark.h
@@ -0,0 +1,98 @@
+/* main.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingBenchmark.h"
+#include <QtWidgets>
+
+int main(int argc, char* argv[])
+{
+	QApplication application(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Measures the performance of the optional storage and indexing "
+		"modes of DrawingScene.");
+	parser.addHelpOption();
+
+	QCommandLineOption benchmarkOption("benchmark", "Benchmark to run (may be repeated; all by default).", "name");
+	QCommandLineOption seedOption("seed", "Seed for the randomized scenes and edits.", "seed");
+	QCommandLineOption itemCountOption("items", "Number of items in each scene.", "count");
+	QCommandLineOption iterationCountOption("iterations", "Number of times each measurement is repeated.", "count");
+	QCommandLineOption churnCountOption("churn", "Number of items moved each frame by the churn benchmark.", "count");
+	QCommandLineOption saveOption("save", "Write the results to a file for a later --baseline comparison.", "file");
+	QCommandLineOption baselineOption("baseline", "Compare the results with those saved by an earlier run.", "file");
+	parser.addOption(benchmarkOption);
+	parser.addOption(seedOption);
+	parser.addOption(itemCountOption);
+	parser.addOption(iterationCountOption);
+	parser.addOption(churnCountOption);
+	parser.addOption(saveOption);
+	parser.addOption(baselineOption);
+	parser.process(application);
+
+	DrawingBenchmark benchmark;
+	if (parser.isSet(seedOption)) benchmark.setSeed(parser.value(seedOption).toUInt());
+	if (parser.isSet(itemCountOption)) benchmark.setItemCount(parser.value(itemCountOption).toInt());
+	if (parser.isSet(iterationCountOption)) benchmark.setIterationCount(parser.value(iterationCountOption).toInt());
+	if (parser.isSet(churnCountOption)) benchmark.setChurnCount(parser.value(churnCountOption).toInt());
+
+	if (parser.isSet(benchmarkOption))
+	{
+		DrawingBenchmark::Benchmarks benchmarks;
+		QStringList names = parser.values(benchmarkOption);
+
+		for(auto nameIter = names.begin(); nameIter != names.end(); nameIter++)
+		{
+			DrawingBenchmark::Benchmark selectedBenchmark = DrawingBenchmark::benchmarkFromName(*nameIter);
+			if (selectedBenchmark == 0)
+			{
+				QTextStream(stderr) << "Unknown benchmark: " << *nameIter << endl;
+				return 1;
+			}
+
+			benchmarks |= selectedBenchmark;
+		}
+
+		benchmark.setBenchmarks(benchmarks);
+	}
+
+	benchmark.run();
+
+	QTextStream output(stdout);
+	if (parser.isSet(baselineOption))
+	{
+		QVector<DrawingBenchmark::Result> baseline = DrawingBenchmark::loadResults(parser.value(baselineOption));
+		if (baseline.isEmpty())
+		{
+			QTextStream(stderr) << "Unable to read baseline: " << parser.value(baselineOption) << endl;
+			return 1;
+		}
+
+		output << benchmark.comparisonReport(baseline) << endl;
+	}
+	else output << benchmark.report() << endl;
+
+	if (parser.isSet(saveOption) && !benchmark.saveResults(parser.value(saveOption)))
+	{
+		QTextStream(stderr) << "Unable to write results: " << parser.value(saveOption) << endl;
+		return 1;
+	}
+
+	return 0;
+}
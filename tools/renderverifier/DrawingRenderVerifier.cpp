@@ -0,0 +1,808 @@
+/* DrawingRenderVerifier.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingRenderVerifier.h"
+#include "DrawingScene.h"
+#include "DrawingItem.h"
+#include "DrawingItemPoint.h"
+#include "DrawingItemStyle.h"
+#include "DrawingItemUpdate.h"
+#include "DrawingItemSource.h"
+#include "DrawingArena.h"
+#include "DrawingRectItem.h"
+#include "DrawingEllipseItem.h"
+#include "DrawingLineItem.h"
+#include "DrawingPolygonItem.h"
+#include "DrawingTextRectItem.h"
+#include "DrawingImageExporter.h"
+
+// Small xorshift generator, so that a seed produces the same sequence on every platform
+class DrawingVerifierRandom
+{
+private:
+	quint64 mState;
+
+public:
+	DrawingVerifierRandom(quint32 seed)
+	{
+		mState = seed * Q_UINT64_C(0x9E3779B97F4A7C15) + 1;
+	}
+
+	quint32 next()
+	{
+		mState ^= mState >> 12;
+		mState ^= mState << 25;
+		mState ^= mState >> 27;
+		return static_cast<quint32>((mState * Q_UINT64_C(2685821657736338717)) >> 32);
+	}
+
+	int integer(int minimum, int maximum)
+	{
+		return minimum + static_cast<int>(next() % static_cast<quint32>(maximum - minimum + 1));
+	}
+
+	qreal real(qreal minimum, qreal maximum)
+	{
+		return minimum + (maximum - minimum) * (next() / 4294967296.0);
+	}
+
+	QColor color()
+	{
+		int red = integer(0, 255);
+		int green = integer(0, 255);
+		int blue = integer(0, 255);
+		return QColor(red, green, blue);
+	}
+};
+
+struct DrawingVerifierEdit
+{
+	enum Type { Move, Resize, Rotate, Flip, Visibility, Style, Add, Remove, Reorder, NumberOfTypes };
+
+	Type type;
+	int itemIndex;
+	int pointIndex;
+	QPointF position;
+	quint32 seed;
+	DrawingItemStyle::Property property;
+	QVariant value;
+};
+
+// Size of the tiles used by DrawingRenderVerifier::TiledRenderPath, in pixels
+static const int verifierTileSize = 64;
+
+//==================================================================================================
+
+// Item source for DrawingRenderVerifier::ItemSourcePath that holds copies of the visible items of
+// another scene as its records
+class DrawingVerifierItemSource : public DrawingItemSource
+{
+private:
+	QHash<quint64,DrawingItem*> mItems;
+	QHash<quint64,QRectF> mBounds;
+	QList<quint64> mOrder;
+	QRectF mBoundingRect;
+
+public:
+	DrawingVerifierItemSource() { }
+
+	~DrawingVerifierItemSource()
+	{
+		qDeleteAll(mItems);
+	}
+
+	void setItems(DrawingScene* scene)
+	{
+		qDeleteAll(mItems);
+		mItems.clear();
+		mBounds.clear();
+		mOrder.clear();
+		mBoundingRect = QRectF();
+
+		QList<DrawingItem*> items = scene->items();
+		for(auto itemIter = items.begin(); itemIter != items.end(); itemIter++)
+		{
+			if ((*itemIter)->isVisible())
+			{
+				QRectF bounds = (*itemIter)->mapToScene((*itemIter)->boundingRect()).boundingRect();
+
+				mItems.insert((*itemIter)->id(), (*itemIter)->copy());
+				mBounds.insert((*itemIter)->id(), bounds);
+				mOrder.append((*itemIter)->id());
+				mBoundingRect = mBoundingRect.united(bounds);
+			}
+		}
+	}
+
+	QList<quint64> records(const QRectF& sceneRect) const
+	{
+		QList<quint64> ids;
+
+		for(auto idIter = mOrder.begin(); idIter != mOrder.end(); idIter++)
+		{
+			if (mBounds.value(*idIter).intersects(sceneRect)) ids.append(*idIter);
+		}
+
+		return ids;
+	}
+
+	QRectF boundingRect() const
+	{
+		return mBoundingRect;
+	}
+
+	bool containsRecord(quint64 id) const
+	{
+		return mItems.contains(id);
+	}
+
+	DrawingItem* createItem(quint64 id)
+	{
+		DrawingItem* item = mItems.value(id, nullptr);
+		return (item) ? item->copy() : nullptr;
+	}
+
+	// The scene of the ItemSourcePath is never edited, so nothing is written back
+	void storeItem(const DrawingItem* item)
+	{
+		Q_UNUSED(item);
+	}
+
+	void removeRecord(quint64 id)
+	{
+		Q_UNUSED(id);
+	}
+};
+
+//==================================================================================================
+
+static DrawingItem* createItem(quint32 seed, const QRectF& sceneRect)
+{
+	DrawingVerifierRandom random(seed);
+	DrawingItem* item = nullptr;
+
+	qreal x = random.real(sceneRect.left(), sceneRect.right());
+	qreal y = random.real(sceneRect.top(), sceneRect.bottom());
+	qreal width = random.real(100, 1500);
+	qreal height = random.real(100, 1500);
+	QRectF rect(-width / 2, -height / 2, width, height);
+
+	switch (random.integer(0, 4))
+	{
+	case 0:
+		{
+			DrawingRectItem* rectItem = new DrawingRectItem();
+			rectItem->setRect(rect);
+			item = rectItem;
+		}
+		break;
+	case 1:
+		{
+			DrawingEllipseItem* ellipseItem = new DrawingEllipseItem();
+			ellipseItem->setEllipse(rect);
+			item = ellipseItem;
+		}
+		break;
+	case 2:
+		{
+			DrawingLineItem* lineItem = new DrawingLineItem();
+			lineItem->setLine(QLineF(QPointF(0, 0), rect.bottomRight() * random.real(-2, 2)));
+			item = lineItem;
+		}
+		break;
+	case 3:
+		{
+			QPolygonF polygon;
+			int pointCount = random.integer(3, 6);
+			for(int index = 0; index < pointCount; index++)
+			{
+				qreal angle = 2 * M_PI * index / pointCount;
+				qreal radius = random.real(0.5, 1.0);
+				polygon.append(QPointF(width / 2 * radius * qCos(angle), height / 2 * radius * qSin(angle)));
+			}
+
+			DrawingPolygonItem* polygonItem = new DrawingPolygonItem();
+			polygonItem->setPolygon(polygon);
+			item = polygonItem;
+		}
+		break;
+	default:
+		{
+			DrawingTextRectItem* textRectItem = new DrawingTextRectItem();
+			textRectItem->setRect(rect);
+			textRectItem->setCaption(QString("Item %1").arg(seed % 1000));
+			item = textRectItem;
+		}
+		break;
+	}
+
+	item->setPosition(x, y);
+
+	DrawingItemStyle* style = item->style();
+	style->setValue(DrawingItemStyle::PenColor, random.color());
+	style->setValue(DrawingItemStyle::PenWidth, random.real(1, 24));
+	style->setValue(DrawingItemStyle::BrushColor, random.color());
+
+	if (dynamic_cast<DrawingLineItem*>(item))
+	{
+		uint startArrowStyle = random.integer(DrawingItemStyle::ArrowNone, DrawingItemStyle::ArrowHarpoonMirrored);
+		uint endArrowStyle = random.integer(DrawingItemStyle::ArrowNone, DrawingItemStyle::ArrowHarpoonMirrored);
+		style->setValue(DrawingItemStyle::StartArrowStyle, startArrowStyle);
+		style->setValue(DrawingItemStyle::StartArrowSize, random.real(20, 150));
+		style->setValue(DrawingItemStyle::EndArrowStyle, endArrowStyle);
+		style->setValue(DrawingItemStyle::EndArrowSize, random.real(20, 150));
+	}
+
+	return item;
+}
+
+static DrawingScene* createScene(quint32 seed, int itemCount, bool arenaEnabled)
+{
+	DrawingScene* scene = new DrawingScene();
+	scene->setItemArenaEnabled(arenaEnabled);
+
+	DrawingArenaScope arenaScope(scene->itemArena());
+	DrawingVerifierRandom random(seed);
+	QList<DrawingItem*> items;
+
+	for(int index = 0; index < itemCount; index++)
+		items.append(createItem(random.next(), scene->sceneRect()));
+
+	scene->addItems(items);
+	return scene;
+}
+
+//==================================================================================================
+
+static DrawingVerifierEdit randomEdit(DrawingVerifierRandom& random, DrawingScene* scene)
+{
+	DrawingVerifierEdit edit;
+	QList<DrawingItem*> items = scene->items();
+	QRectF sceneRect = scene->sceneRect();
+
+	edit.type = (items.isEmpty()) ? DrawingVerifierEdit::Add :
+		static_cast<DrawingVerifierEdit::Type>(random.integer(0, DrawingVerifierEdit::NumberOfTypes - 1));
+	edit.itemIndex = (items.isEmpty()) ? 0 : random.integer(0, items.size() - 1);
+	edit.pointIndex = 0;
+	edit.seed = random.next();
+	edit.property = DrawingItemStyle::PenColor;
+
+	switch (edit.type)
+	{
+	case DrawingVerifierEdit::Move:
+		{
+			qreal x = random.real(sceneRect.left(), sceneRect.right());
+			qreal y = random.real(sceneRect.top(), sceneRect.bottom());
+			edit.position = QPointF(x, y);
+		}
+		break;
+	case DrawingVerifierEdit::Resize:
+		{
+			edit.pointIndex = random.integer(0, items[edit.itemIndex]->points().size() - 1);
+			qreal dx = random.real(-500, 500);
+			qreal dy = random.real(-500, 500);
+			edit.position = QPointF(dx, dy);
+		}
+		break;
+	case DrawingVerifierEdit::Style:
+		switch (random.integer(0, 2))
+		{
+		case 0:
+			edit.property = DrawingItemStyle::PenColor;
+			edit.value = random.color();
+			break;
+		case 1:
+			edit.property = DrawingItemStyle::BrushColor;
+			edit.value = random.color();
+			break;
+		default:
+			// Pen width changes the item's scene bounds, so the item index must be updated too
+			edit.property = DrawingItemStyle::PenWidth;
+			edit.value = random.real(1, 48);
+			break;
+		}
+		break;
+	case DrawingVerifierEdit::Reorder:
+		edit.pointIndex = random.integer(0, items.size() - 1);
+		break;
+	default:
+		break;
+	}
+
+	return edit;
+}
+
+static void applyEdit(DrawingScene* scene, const DrawingVerifierEdit& edit, bool postUpdates,
+	QList<DrawingItem*>& removedItems)
+{
+	QList<DrawingItem*> items = scene->items();
+	DrawingItem* item = items.value(edit.itemIndex, nullptr);
+	if (item == nullptr && edit.type != DrawingVerifierEdit::Add) return;
+
+	// Added items go into the scene's arena, if it has one
+	DrawingArenaScope arenaScope(scene->itemArena());
+
+	QList<DrawingItem*> editItems;
+	if (item) editItems.append(item);
+
+	QHash<DrawingItem*,QPointF> positions;
+	QVector<DrawingItemUpdate> updates;
+
+	switch (edit.type)
+	{
+	case DrawingVerifierEdit::Move:
+		if (postUpdates)
+		{
+			updates.append(DrawingItemUpdate(item->id(), edit.position));
+			scene->postItemUpdates(updates);
+			scene->applyItemUpdates();
+		}
+		else
+		{
+			positions.insert(item, edit.position);
+			scene->moveItems(editItems, positions);
+		}
+		break;
+	case DrawingVerifierEdit::Resize:
+		{
+			DrawingItemPoint* point = item->points().value(edit.pointIndex, nullptr);
+			if (point) scene->resizeItem(point, item->mapToScene(point->position()) + edit.position);
+		}
+		break;
+	case DrawingVerifierEdit::Rotate:
+		positions.insert(item, item->position());
+		scene->rotateItems(editItems, positions);
+		break;
+	case DrawingVerifierEdit::Flip:
+		positions.insert(item, item->position());
+		scene->flipItemsHorizontal(editItems, positions);
+		break;
+	case DrawingVerifierEdit::Visibility:
+		{
+			QHash<DrawingItem*,bool> visibility;
+			visibility.insert(item, !item->isVisible());
+			scene->setItemsVisibility(editItems, visibility);
+		}
+		break;
+	case DrawingVerifierEdit::Style:
+		if (postUpdates)
+		{
+			updates.append(DrawingItemUpdate(item->id(), edit.property, edit.value));
+			scene->postItemUpdates(updates);
+			scene->applyItemUpdates();
+		}
+		else
+		{
+			scene->setItemsStyleValues(editItems, QVector<DrawingItemStyle::Property>() << edit.property,
+				QVector<QVariant>() << edit.value);
+		}
+		break;
+	case DrawingVerifierEdit::Add:
+		editItems.clear();
+		editItems.append(createItem(edit.seed, scene->sceneRect()));
+		scene->addItems(editItems);
+		break;
+	case DrawingVerifierEdit::Remove:
+		scene->removeItems(editItems);
+		removedItems.append(item);
+		break;
+	case DrawingVerifierEdit::Reorder:
+		{
+			QHash<DrawingItem*,int> indices;
+			indices.insert(item, edit.pointIndex);
+			scene->removeItems(editItems);
+			scene->insertItems(editItems, indices);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+//==================================================================================================
+
+static QRectF randomViewRect(DrawingVerifierRandom& random, const QRectF& sceneRect, const QSize& size)
+{
+	qreal width = sceneRect.width() * random.real(0.1, 1.0);
+	qreal height = width * size.height() / size.width();
+	qreal left = random.real(sceneRect.left(), sceneRect.right() - width);
+	qreal top = random.real(sceneRect.top(), sceneRect.bottom() - height);
+	return QRectF(left, top, width, height);
+}
+
+static QImage renderImage(DrawingScene* scene, const QRectF& rect, const QSize& size, int tileSize)
+{
+	QImage image(size, QImage::Format_ARGB32_Premultiplied);
+	image.fill(scene->backgroundBrush().color());
+
+	QPainter painter(&image);
+	painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing | QPainter::SmoothPixmapTransform);
+
+	if (tileSize <= 0) tileSize = qMax(size.width(), size.height());
+
+	for(int y = 0; y < size.height(); y += tileSize)
+	{
+		for(int x = 0; x < size.width(); x += tileSize)
+		{
+			painter.save();
+
+			if (tileSize < size.width() || tileSize < size.height())
+				painter.setClipRect(QRect(x, y, tileSize, tileSize));
+
+			painter.scale(size.width() / rect.width(), size.height() / rect.height());
+			painter.translate(-rect.topLeft());
+			scene->render(&painter);
+
+			painter.restore();
+		}
+	}
+
+	painter.end();
+
+	return image;
+}
+
+static QImage exportImage(DrawingScene* scene, const QRectF& rect, const QSize& size)
+{
+	DrawingImageExporter exporter(scene);
+	exporter.setSceneRect(rect);
+	exporter.setImageSize(size);
+	exporter.setBandHeight(qMax(size.height() / 5, 1));
+	exporter.setMaximumThreadCount(4);
+
+	QImage image;
+	QBuffer buffer;
+	buffer.open(QIODevice::WriteOnly);
+
+	if (exporter.exportImage(&buffer, DrawingImageExporter::PngFormat))
+		image = QImage::fromData(buffer.data(), "PNG");
+
+	return image;
+}
+
+static void compareImages(const QImage& reference, const QImage& image, int tolerance,
+	qint64& pixelsMismatched, int& maximumDifference)
+{
+	pixelsMismatched = 0;
+	maximumDifference = 0;
+
+	if (image.size() != reference.size())
+	{
+		pixelsMismatched = static_cast<qint64>(reference.width()) * reference.height();
+		maximumDifference = 255;
+		return;
+	}
+
+	QImage referenceImage = reference.convertToFormat(QImage::Format_ARGB32);
+	QImage comparedImage = image.convertToFormat(QImage::Format_ARGB32);
+
+	for(int y = 0; y < referenceImage.height(); y++)
+	{
+		const QRgb* referenceLine = reinterpret_cast<const QRgb*>(referenceImage.constScanLine(y));
+		const QRgb* comparedLine = reinterpret_cast<const QRgb*>(comparedImage.constScanLine(y));
+
+		for(int x = 0; x < referenceImage.width(); x++)
+		{
+			int difference = qMax(qMax(qAbs(qRed(referenceLine[x]) - qRed(comparedLine[x])),
+				qAbs(qGreen(referenceLine[x]) - qGreen(comparedLine[x]))),
+				qMax(qAbs(qBlue(referenceLine[x]) - qBlue(comparedLine[x])),
+				qAbs(qAlpha(referenceLine[x]) - qAlpha(comparedLine[x]))));
+
+			maximumDifference = qMax(maximumDifference, difference);
+			if (difference > tolerance) pixelsMismatched++;
+		}
+	}
+}
+
+//==================================================================================================
+
+DrawingRenderVerifier::DrawingRenderVerifier()
+{
+	mSeed = 1;
+	mItemCount = 500;
+	mEditCount = 200;
+	mEditsPerFrame = 10;
+	mImageSize = QSize(400, 300);
+	mTolerance = 2;
+	mPaths = AllPaths;
+
+	mFrameCount = 0;
+	mReferenceRenderTime = 0;
+}
+
+DrawingRenderVerifier::~DrawingRenderVerifier() { }
+
+//==================================================================================================
+
+void DrawingRenderVerifier::setSeed(quint32 seed)
+{
+	mSeed = seed;
+}
+
+quint32 DrawingRenderVerifier::seed() const
+{
+	return mSeed;
+}
+
+void DrawingRenderVerifier::setItemCount(int count)
+{
+	mItemCount = qMax(count, 0);
+}
+
+int DrawingRenderVerifier::itemCount() const
+{
+	return mItemCount;
+}
+
+void DrawingRenderVerifier::setEditCount(int count)
+{
+	mEditCount = qMax(count, 0);
+}
+
+int DrawingRenderVerifier::editCount() const
+{
+	return mEditCount;
+}
+
+void DrawingRenderVerifier::setEditsPerFrame(int count)
+{
+	mEditsPerFrame = qMax(count, 1);
+}
+
+int DrawingRenderVerifier::editsPerFrame() const
+{
+	return mEditsPerFrame;
+}
+
+void DrawingRenderVerifier::setImageSize(const QSize& size)
+{
+	mImageSize = size.expandedTo(QSize(1, 1));
+}
+
+QSize DrawingRenderVerifier::imageSize() const
+{
+	return mImageSize;
+}
+
+void DrawingRenderVerifier::setTolerance(int tolerance)
+{
+	mTolerance = qBound(0, tolerance, 255);
+}
+
+int DrawingRenderVerifier::tolerance() const
+{
+	return mTolerance;
+}
+
+void DrawingRenderVerifier::setPaths(Paths paths)
+{
+	mPaths = paths;
+}
+
+DrawingRenderVerifier::Paths DrawingRenderVerifier::paths() const
+{
+	return mPaths;
+}
+
+void DrawingRenderVerifier::setFailureDirectory(const QString& directory)
+{
+	mFailureDirectory = directory;
+}
+
+QString DrawingRenderVerifier::failureDirectory() const
+{
+	return mFailureDirectory;
+}
+
+//==================================================================================================
+
+bool DrawingRenderVerifier::verify()
+{
+	const Path allPaths[] = { BoundsTableIndexPath, TiledRenderPath, BandedExportPath, PostedUpdatesPath,
+		ArenaPath, ItemSourcePath };
+
+	mResults.clear();
+	mFrameCount = 0;
+	mReferenceRenderTime = 0;
+
+	// Every path gets its own scene, so that the state kept by each optimization persists across
+	// the whole edit sequence
+	DrawingScene* referenceScene = createScene(mSeed, mItemCount, false);
+	QList<DrawingItem*> referenceRemovedItems;
+	DrawingVerifierItemSource itemSource;
+
+	QVector<DrawingScene*> scenes;
+	QVector< QList<DrawingItem*> > removedItems;
+	PathResult result;
+
+	for(auto pathIter = std::begin(allPaths); pathIter != std::end(allPaths); pathIter++)
+	{
+		if (mPaths & *pathIter)
+		{
+			result.path = *pathIter;
+			result.framesCompared = 0;
+			result.framesMismatched = 0;
+			result.firstMismatchedFrame = -1;
+			result.pixelsMismatched = 0;
+			result.maximumDifference = 0;
+			result.renderTime = 0;
+			mResults.append(result);
+
+			// The scene of the ItemSourcePath holds no items of its own; its source is refilled from
+			// the reference scene before each frame
+			DrawingScene* scene = createScene(mSeed, (*pathIter == ItemSourcePath) ? 0 : mItemCount,
+				(*pathIter == ArenaPath));
+			scene->setItemIndexMethod(DrawingScene::BoundsTableIndex);
+			scenes.append(scene);
+		}
+	}
+
+	removedItems.resize(scenes.size());
+
+	DrawingVerifierRandom random(mSeed ^ 0x5BD1E995u);
+	QElapsedTimer timer;
+	QImage referenceImage, image;
+	qint64 pixelsMismatched;
+	int maximumDifference;
+	int editIndex = 0;
+	bool success = true;
+
+	while (true)
+	{
+		// Render and compare a frame
+		QRectF viewRect = randomViewRect(random, referenceScene->sceneRect(), mImageSize);
+
+		timer.start();
+		referenceImage = renderImage(referenceScene, viewRect, mImageSize, 0);
+		mReferenceRenderTime += timer.nsecsElapsed();
+
+		for(int index = 0; index < scenes.size(); index++)
+		{
+			PathResult& pathResult = mResults[index];
+
+			if (pathResult.path == ArenaPath)
+			{
+				scenes[index]->compactItems();
+			}
+			else if (pathResult.path == ItemSourcePath)
+			{
+				// Releases the items materialized for the previous frame before their records change
+				scenes[index]->setItemSource(nullptr);
+				itemSource.setItems(referenceScene);
+				scenes[index]->setItemSource(&itemSource);
+			}
+
+			timer.start();
+			if (pathResult.path == TiledRenderPath)
+				image = renderImage(scenes[index], viewRect, mImageSize, verifierTileSize);
+			else if (pathResult.path == BandedExportPath)
+				image = exportImage(scenes[index], viewRect, mImageSize);
+			else
+				image = renderImage(scenes[index], viewRect, mImageSize, 0);
+			pathResult.renderTime += timer.nsecsElapsed();
+
+			compareImages(referenceImage, image, mTolerance, pixelsMismatched, maximumDifference);
+
+			pathResult.framesCompared++;
+			pathResult.pixelsMismatched += pixelsMismatched;
+			pathResult.maximumDifference = qMax(pathResult.maximumDifference, maximumDifference);
+
+			if (pixelsMismatched > 0)
+			{
+				pathResult.framesMismatched++;
+				success = false;
+
+				if (pathResult.firstMismatchedFrame < 0)
+				{
+					pathResult.firstMismatchedFrame = mFrameCount;
+
+					if (!mFailureDirectory.isEmpty())
+					{
+						QDir directory(mFailureDirectory);
+						QString baseName = QString("%1-frame%2").arg(pathName(pathResult.path)).arg(mFrameCount);
+						referenceImage.save(directory.filePath(baseName + "-reference.png"));
+						image.save(directory.filePath(baseName + "-actual.png"));
+					}
+				}
+			}
+		}
+
+		mFrameCount++;
+
+		if (editIndex >= mEditCount) break;
+
+		// Apply the same edits to every scene
+		for(int frameEdit = 0; frameEdit < mEditsPerFrame && editIndex < mEditCount; frameEdit++, editIndex++)
+		{
+			DrawingVerifierEdit edit = randomEdit(random, referenceScene);
+
+			applyEdit(referenceScene, edit, false, referenceRemovedItems);
+			for(int index = 0; index < scenes.size(); index++)
+			{
+				if (mResults[index].path != ItemSourcePath)
+					applyEdit(scenes[index], edit, (mResults[index].path == PostedUpdatesPath), removedItems[index]);
+			}
+		}
+	}
+
+	delete referenceScene;
+	qDeleteAll(referenceRemovedItems);
+
+	for(int index = 0; index < scenes.size(); index++)
+	{
+		delete scenes[index];
+		qDeleteAll(removedItems[index]);
+	}
+
+	return success;
+}
+
+QVector<DrawingRenderVerifier::PathResult> DrawingRenderVerifier::results() const
+{
+	return mResults;
+}
+
+int DrawingRenderVerifier::frameCount() const
+{
+	return mFrameCount;
+}
+
+qint64 DrawingRenderVerifier::referenceRenderTime() const
+{
+	return mReferenceRenderTime;
+}
+
+QString DrawingRenderVerifier::report() const
+{
+	QString report = QString("Reference: %1 frames in %2 ms\n").arg(mFrameCount).arg(mReferenceRenderTime / 1.0e6, 0, 'f', 2);
+
+	for(auto resultIter = mResults.begin(); resultIter != mResults.end(); resultIter++)
+	{
+		qreal speedup = (resultIter->renderTime > 0) ?
+			static_cast<qreal>(mReferenceRenderTime) / resultIter->renderTime : 0;
+
+		report += QString("%1: %2 of %3 frames mismatched (%4 pixels, maximum difference %5), %6 ms, %7x reference\n")
+			.arg(pathName(resultIter->path)).arg(resultIter->framesMismatched).arg(resultIter->framesCompared)
+			.arg(resultIter->pixelsMismatched).arg(resultIter->maximumDifference)
+			.arg(resultIter->renderTime / 1.0e6, 0, 'f', 2).arg(speedup, 0, 'f', 2);
+	}
+
+	return report;
+}
+
+//==================================================================================================
+
+QString DrawingRenderVerifier::pathName(Path path)
+{
+	QString name;
+
+	switch (path)
+	{
+	case BoundsTableIndexPath: name = "BoundsTableIndex"; break;
+	case TiledRenderPath: name = "TiledRender"; break;
+	case BandedExportPath: name = "BandedExport"; break;
+	case PostedUpdatesPath: name = "PostedUpdates"; break;
+	case ArenaPath: name = "Arena"; break;
+	case ItemSourcePath: name = "ItemSource"; break;
+	default: break;
+	}
+
+	return name;
+}
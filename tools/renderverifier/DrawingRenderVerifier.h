@@ -0,0 +1,250 @@
+/* DrawingRenderVerifier.h
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DRAWINGRENDERVERIFIER_H
+#define DRAWINGRENDERVERIFIER_H
+
+#include <QtGui>
+
+/*! \brief Checks that the optimized rendering paths of DrawingScene produce the same pixels as the
+ * reference rendering path.
+ *
+ * DrawingRenderVerifier builds a randomized scene for the reference path and for each of the
+ * enabled paths() from the same seed(), then applies the same randomized sequence of edits to
+ * every scene.  The edits move, resize, rotate, flip, show and hide, restyle, add, remove, and
+ * reorder items through the scene's slots and postItemUpdates(), so any state that an
+ * optimization keeps between frames must be updated correctly for the scenes to stay identical.
+ *
+ * After every editsPerFrame() edits, a randomly chosen area of the scene is rendered through the
+ * reference path, which is DrawingScene::render() with no item index, and through each enabled
+ * path.  Each rendered image is compared to the reference image pixel by pixel.  Pixels with a
+ * channel that differs by more than tolerance() are counted as mismatched.  The time spent
+ * rendering each path is measured along with the comparison, so that speedups and correctness are
+ * validated together.
+ *
+ * verify() runs the entire sequence and returns true if every frame of every path matched.  The
+ * details are available from results() and report().  If failureDirectory() is set, the first
+ * mismatched frame of each path is saved there along with the reference image.
+ *
+ * Only the scene's rendering is verified.  The optimizations made by DrawingView (the reduced
+ * #DrawingView::InteractiveQuality and #DrawingView::AdaptiveQuality levels, which change the
+ * pixels by design, the cached grid tile, and the cached placement preview) are not covered.
+ *
+ * DrawingRenderVerifier does not require a DrawingView, but a QGuiApplication must exist since the
+ * scenes contain text items.  It is built by the renderverifier tool project rather than as part
+ * of the library.
+ */
+class DrawingRenderVerifier
+{
+public:
+	//! \brief Enum representing the optimized rendering paths that can be verified.
+	enum Path
+	{
+		BoundsTableIndexPath = 0x01,	//!< DrawingScene::render() with the #DrawingScene::BoundsTableIndex
+										//!< item index
+		TiledRenderPath = 0x02,			//!< The image is rendered as clipped tiles with the item index
+		BandedExportPath = 0x04,		//!< The image is rendered in parallel bands by DrawingImageExporter
+										//!< with the item index (the timing includes PNG encoding)
+		PostedUpdatesPath = 0x08,		//!< Items are moved using DrawingScene::postItemUpdates() instead
+										//!< of the scene's slots, with the item index
+		ArenaPath = 0x10,				//!< Items are allocated from the scene's DrawingArena and laid
+										//!< out again by DrawingScene::compactItems() before each frame
+		ItemSourcePath = 0x20,			//!< The items are provided by a DrawingItemSource holding a copy
+										//!< of the reference scene, and are materialized as they are drawn
+		AllPaths = 0x3F					//!< All of the above paths
+	};
+	Q_DECLARE_FLAGS(Paths, Path)
+
+	//! \brief Describes the results of verifying a single path.
+	struct PathResult
+	{
+		Path path;						//!< The verified path
+		int framesCompared;				//!< Number of frames rendered and compared
+		int framesMismatched;			//!< Number of frames with at least one mismatched pixel
+		int firstMismatchedFrame;		//!< Index of the first mismatched frame, or -1
+		qint64 pixelsMismatched;		//!< Total number of mismatched pixels in all frames
+		int maximumDifference;			//!< Largest difference of any channel of any pixel
+		qint64 renderTime;				//!< Total time spent rendering the path, in nanoseconds
+	};
+
+private:
+	quint32 mSeed;
+	int mItemCount;
+	int mEditCount;
+	int mEditsPerFrame;
+	QSize mImageSize;
+	int mTolerance;
+	Paths mPaths;
+	QString mFailureDirectory;
+
+	QVector<PathResult> mResults;
+	int mFrameCount;
+	qint64 mReferenceRenderTime;
+
+public:
+	//! \brief Create a new DrawingRenderVerifier with default settings.
+	DrawingRenderVerifier();
+
+	//! \brief Delete an existing DrawingRenderVerifier object.
+	~DrawingRenderVerifier();
+
+
+	/*! \brief Sets the seed used to generate the scenes, edits, and rendered areas.
+	 *
+	 * The same seed always produces the same sequence.  The default seed is 1.
+	 *
+	 * \sa seed()
+	 */
+	void setSeed(quint32 seed);
+
+	/*! \brief Returns the seed used to generate the scenes, edits, and rendered areas.
+	 *
+	 * \sa setSeed()
+	 */
+	quint32 seed() const;
+
+	/*! \brief Sets the number of items in each scene before any edits are made.
+	 *
+	 * The default count is 500.
+	 *
+	 * \sa itemCount()
+	 */
+	void setItemCount(int count);
+
+	/*! \brief Returns the number of items in each scene before any edits are made.
+	 *
+	 * \sa setItemCount()
+	 */
+	int itemCount() const;
+
+	/*! \brief Sets the total number of edits made to each scene.
+	 *
+	 * The default count is 200.
+	 *
+	 * \sa editCount()
+	 */
+	void setEditCount(int count);
+
+	/*! \brief Returns the total number of edits made to each scene.
+	 *
+	 * \sa setEditCount()
+	 */
+	int editCount() const;
+
+	/*! \brief Sets the number of edits made between each rendered frame.
+	 *
+	 * One frame is also rendered before the first edit.  The default count is 10.
+	 *
+	 * \sa editsPerFrame()
+	 */
+	void setEditsPerFrame(int count);
+
+	/*! \brief Returns the number of edits made between each rendered frame.
+	 *
+	 * \sa setEditsPerFrame()
+	 */
+	int editsPerFrame() const;
+
+	/*! \brief Sets the size of the rendered images in pixels.
+	 *
+	 * The default size is 400 x 300 pixels.
+	 *
+	 * \sa imageSize()
+	 */
+	void setImageSize(const QSize& size);
+
+	/*! \brief Returns the size of the rendered images in pixels.
+	 *
+	 * \sa setImageSize()
+	 */
+	QSize imageSize() const;
+
+	/*! \brief Sets the largest difference allowed in any channel of a pixel.
+	 *
+	 * A small tolerance absorbs antialiasing differences caused by rounding.  The default
+	 * tolerance is 2.
+	 *
+	 * \sa tolerance()
+	 */
+	void setTolerance(int tolerance);
+
+	/*! \brief Returns the largest difference allowed in any channel of a pixel.
+	 *
+	 * \sa setTolerance()
+	 */
+	int tolerance() const;
+
+	/*! \brief Sets the rendering paths to verify against the reference path.
+	 *
+	 * The default is #AllPaths.
+	 *
+	 * \sa paths()
+	 */
+	void setPaths(Paths paths);
+
+	/*! \brief Returns the rendering paths to verify against the reference path.
+	 *
+	 * \sa setPaths()
+	 */
+	Paths paths() const;
+
+	/*! \brief Sets the directory in which mismatched frames are saved.
+	 *
+	 * If the directory is empty, no images are saved.  This is the default.
+	 *
+	 * \sa failureDirectory()
+	 */
+	void setFailureDirectory(const QString& directory);
+
+	/*! \brief Returns the directory in which mismatched frames are saved.
+	 *
+	 * \sa setFailureDirectory()
+	 */
+	QString failureDirectory() const;
+
+
+	/*! \brief Runs the edit sequence and compares every enabled path with the reference path.
+	 *
+	 * Returns true if no pixels were mismatched, false otherwise.
+	 */
+	bool verify();
+
+	//! \brief Returns the results of the last call to verify() for each enabled path.
+	QVector<PathResult> results() const;
+
+	//! \brief Returns the number of frames rendered by the last call to verify().
+	int frameCount() const;
+
+	/*! \brief Returns the total time spent rendering the reference path in the last call to
+	 * verify(), in nanoseconds.
+	 */
+	qint64 referenceRenderTime() const;
+
+	//! \brief Returns a human-readable summary of the results of the last call to verify().
+	QString report() const;
+
+
+	//! \brief Returns the name of the specified path.
+	static QString pathName(Path path);
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(DrawingRenderVerifier::Paths)
+
+#endif
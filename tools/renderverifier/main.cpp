@@ -0,0 +1,56 @@
+/* main.cpp
+ *
+ * Copyright (C) 2013-2017 Jason Allen
+ *
+ * This file is part of the jade application.
+ *
+ * jade is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * jade is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with jade.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DrawingRenderVerifier.h"
+#include <QtWidgets>
+
+int main(int argc, char* argv[])
+{
+	QApplication application(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Checks the optimized rendering paths of DrawingScene against "
+		"the reference rendering path.");
+	parser.addHelpOption();
+
+	QCommandLineOption seedOption("seed", "Seed for the randomized scenes and edits.", "seed");
+	QCommandLineOption itemCountOption("items", "Number of items in each scene.", "count");
+	QCommandLineOption editCountOption("edits", "Number of edits applied to each scene.", "count");
+	QCommandLineOption failureDirectoryOption("failures",
+		"Directory where the first mismatched frame of each path is saved.", "directory");
+	parser.addOption(seedOption);
+	parser.addOption(itemCountOption);
+	parser.addOption(editCountOption);
+	parser.addOption(failureDirectoryOption);
+	parser.process(application);
+
+	DrawingRenderVerifier verifier;
+	if (parser.isSet(seedOption)) verifier.setSeed(parser.value(seedOption).toUInt());
+	if (parser.isSet(itemCountOption)) verifier.setItemCount(parser.value(itemCountOption).toInt());
+	if (parser.isSet(editCountOption)) verifier.setEditCount(parser.value(editCountOption).toInt());
+	if (parser.isSet(failureDirectoryOption)) verifier.setFailureDirectory(parser.value(failureDirectoryOption));
+
+	bool success = verifier.verify();
+
+	QTextStream output(stdout);
+	output << verifier.report() << endl;
+
+	return (success) ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+TEMPLATE = app
+TARGET = renderverifier
+
+DESTDIR = bin
+INCLUDEPATH += ../../include
+
+CONFIG += release warn_on c++11 qt console
+CONFIG -= debug app_bundle
+QT += widgets network
+
+# Build libjade.pro first; the verifier links against the static library it produces
+LIBS += -L../../lib -ljade
+win32:PRE_TARGETDEPS += ../../lib/jade.lib
+!win32:PRE_TARGETDEPS += ../../lib/libjade.a
+qtConfig(system-zlib): LIBS += -lz
+
+!win32:MOC_DIR = release
+!win32:OBJECTS_DIR = release
+!win32:RCC_DIR = release
+
+# --------------------------------------------------------------------------------------------------
+
+SOURCES += \
+	DrawingRenderVerifier.cpp \
+	main.cpp
+
+HEADERS += \
+	DrawingRenderVerifier.h